@@ -0,0 +1,38 @@
+#include <string.h>
+
+#include "agenda.h"
+
+
+bool agenda_insere(struct agenda *agenda, const struct comando_agendado *comando)
+{
+    if (agenda->num_comandos == AGENDA_TAMANHO)
+        return false;
+
+    //comandos com o mesmo instante ficam na ordem de chegada
+    int posicao = agenda->num_comandos;
+    while (posicao > 0 && agenda->comandos[posicao - 1].instante_us > comando->instante_us) {
+        agenda->comandos[posicao] = agenda->comandos[posicao - 1];
+        posicao--;
+    }
+    agenda->comandos[posicao] = *comando;
+    agenda->num_comandos++;
+    return true;
+}
+
+
+bool agenda_retira(struct agenda *agenda, int64_t limite_us, struct comando_agendado *comando)
+{
+    if (agenda->num_comandos == 0 || agenda->comandos[0].instante_us > limite_us)
+        return false;
+
+    *comando = agenda->comandos[0];
+    agenda->num_comandos--;
+    memmove(&agenda->comandos[0], &agenda->comandos[1], agenda->num_comandos * sizeof(agenda->comandos[0]));
+    return true;
+}
+
+
+int64_t agenda_proximo(const struct agenda *agenda)
+{
+    return (agenda->num_comandos > 0) ? agenda->comandos[0].instante_us : INT64_MAX;
+}
@@ -0,0 +1,39 @@
+/*Agenda dos comandos com hora marcada: uma fila de tamanho fixo em ordem de instante. Quem trava a fila (os
+produtores do UDP e a task do PWM a usam com um spinlock), arma o timer e aplica o lote no LEDC é o main.c;
+como em calibracao.h, aqui só tem aritmética, nada do ESP-IDF, para dar para compilar e conferir no PC*/
+#ifndef AGENDA_H
+#define AGENDA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "canais.h"
+
+//Comandos que podem estar esperando a hora ao mesmo tempo
+#define AGENDA_TAMANHO              8
+
+//Comando com hora marcada: no instante os canais da máscara passam a ter os valores de 'canais' (os
+//outros índices são ignorados), todos travados no LEDC no mesmo lote
+struct comando_agendado{
+    int64_t  instante_us;       //esp_timer_get_time()
+    uint32_t mascara;
+    bool     sincroniza;        //reinicia juntos os timers dos canais da máscara
+    struct parametros_pwm canais[NUM_CANAIS_PWM];
+};
+
+//Comandos esperando, o primeiro é o de menor instante
+struct agenda{
+    struct comando_agendado comandos[AGENDA_TAMANHO];
+    int num_comandos;
+};
+
+//Põe o comando na posição do instante dele, depois dos que têm o mesmo instante. Retorna false se está cheia
+bool agenda_insere(struct agenda *agenda, const struct comando_agendado *comando);
+
+//Tira o primeiro comando se o instante dele é até limite_us
+bool agenda_retira(struct agenda *agenda, int64_t limite_us, struct comando_agendado *comando);
+
+//Instante do primeiro comando, INT64_MAX se a agenda está vazia
+int64_t agenda_proximo(const struct agenda *agenda);
+
+#endif
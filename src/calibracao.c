@@ -0,0 +1,127 @@
+#include "calibracao.h"
+
+
+int calibracao_faixa(uint32_t frequencia)
+{
+    if (frequencia == 0)
+        return -1;
+    int faixa = 31 - __builtin_clz(frequencia);                 //floor(log2(frequencia))
+    return (faixa < CALIBRACAO_NUM_FAIXAS) ? faixa : CALIBRACAO_NUM_FAIXAS - 1;
+}
+
+
+int64_t calibracao_pulsos_contados(uint32_t estouros, int32_t contagem, int32_t limite, int64_t pulsos_anteriores)
+{
+    int64_t pulsos = (int64_t)estouros * limite + contagem;
+    if (pulsos < pulsos_anteriores)
+        pulsos += limite;                                       //a interrupção do último estouro ainda não rodou
+    return pulsos;
+}
+
+
+uint64_t calibracao_frequencia_medida_mhz(const struct amostra_contagem *amostras, int num_amostras)
+{
+    if (num_amostras < 2)
+        return 0;
+
+    //as contas são feitas a partir da primeira amostra, para os valores ficarem pequenos no double
+    double media_t = 0, media_p = 0;
+    for (int i = 0; i < num_amostras; i++) {
+        media_t += (double)(amostras[i].instante_us - amostras[0].instante_us);
+        media_p += (double)(amostras[i].pulsos - amostras[0].pulsos);
+    }
+    media_t /= num_amostras;
+    media_p /= num_amostras;
+
+    double covariancia = 0, variancia = 0;
+    for (int i = 0; i < num_amostras; i++) {
+        double t = (double)(amostras[i].instante_us - amostras[0].instante_us) - media_t;
+        double p = (double)(amostras[i].pulsos - amostras[0].pulsos) - media_p;
+        covariancia += t * p;
+        variancia   += t * t;
+    }
+    if (variancia <= 0)
+        return 0;
+
+    //pulsos por us vezes 1e9 dá mHz
+    double frequencia_mhz = covariancia / variancia * 1e9;
+    return (frequencia_mhz > 0) ? (uint64_t)(frequencia_mhz + 0.5) : 0;
+}
+
+
+uint64_t calibracao_frequencia_timer_mhz(uint32_t clock_hz, uint32_t divisor, uint32_t resolucao)
+{
+    //frequencia = clock * 256 / (divisor * 2^resolucao), a mesma conta do calcula_timer_pwm
+    uint64_t numerador   = ((uint64_t)clock_hz << 8) * 1000;
+    uint64_t denominador = (uint64_t)divisor << resolucao;
+    if (denominador == 0)
+        return 0;
+    return (numerador + denominador / 2) / denominador;
+}
+
+
+int32_t calibracao_erro_ppm(uint64_t medida_mhz, uint64_t referencia_mhz)
+{
+    if (referencia_mhz == 0)
+        return 0;
+    int64_t diferenca = (int64_t)medida_mhz - (int64_t)referencia_mhz;
+    //a referência vai até 4e10 mHz, então diferenca * 1e6 cabe no int64
+    int64_t erro = (diferenca * 1000000 + (diferenca >= 0 ? 1 : -1) * (int64_t)(referencia_mhz / 2)) /
+                   (int64_t)referencia_mhz;
+    if (erro > INT32_MAX)
+        return INT32_MAX;
+    if (erro < INT32_MIN)
+        return INT32_MIN;
+    return (int32_t)erro;
+}
+
+
+int32_t calibracao_duty_medido(uint32_t amostras_altas, uint32_t total_amostras)
+{
+    if (total_amostras == 0 || amostras_altas > total_amostras)
+        return -1;
+    return (int32_t)(((uint64_t)amostras_altas * 65535 + total_amostras / 2) / total_amostras);
+}
+
+
+uint32_t calibracao_ciclos_janela_duty(uint64_t frequencia_mhz, uint32_t janela_us, uint32_t cpu_mhz)
+{
+    if (frequencia_mhz == 0)
+        return 0;
+
+    //períodos inteiros na janela: janela_us * 1e-6 s * frequencia_mhz / 1000
+    uint64_t periodos = (uint64_t)janela_us * frequencia_mhz / 1000000000;
+    if (periodos == 0)
+        return 0;
+
+    //ciclos de um período vezes o número de períodos, arredondado no fim para não acumular o erro
+    uint64_t ciclos = (periodos * cpu_mhz * 1000000000 + frequencia_mhz / 2) / frequencia_mhz;
+    return (ciclos > UINT32_MAX) ? 0 : (uint32_t)ciclos;
+}
+
+
+bool calibracao_registra(struct tabela_calibracao *tabela, uint32_t frequencia, int32_t desvio_ppm)
+{
+    int faixa = calibracao_faixa(frequencia);
+    if (faixa < 0 || desvio_ppm > CALIBRACAO_DESVIO_MAXIMO_PPM || desvio_ppm < -CALIBRACAO_DESVIO_MAXIMO_PPM)
+        return false;
+
+    struct faixa_calibracao *f = &tabela->faixas[faixa];
+    int32_t peso = (f->medidas < CALIBRACAO_PESO_MAXIMO) ? f->medidas + 1 : CALIBRACAO_PESO_MAXIMO;
+    f->desvio_ppm += (desvio_ppm - f->desvio_ppm) / peso;
+    if (f->medidas < UINT16_MAX)
+        f->medidas++;
+    return true;
+}
+
+
+uint32_t calibracao_clock_efetivo(const struct tabela_calibracao *tabela, uint32_t frequencia, uint32_t clock_nominal)
+{
+    int faixa = calibracao_faixa(frequencia);
+    if (faixa < 0 || tabela->faixas[faixa].medidas == 0)
+        return clock_nominal;
+
+    //a saída sai desvio_ppm acima da conta com o clock nominal: é como se o clock fosse esse tanto maior
+    int64_t correcao = ((int64_t)clock_nominal * tabela->faixas[faixa].desvio_ppm) / 1000000;
+    return (uint32_t)((int64_t)clock_nominal + correcao);
+}
@@ -0,0 +1,72 @@
+/*Cálculos da medição das saídas (loopback pelo contador de pulsos) e da tabela de calibração por faixa de
+frequência. Aqui só tem aritmética, nada do ESP-IDF, para dar para compilar no PC e conferir os resultados
+contra capturas gravadas: o GET /api/medicao devolve as amostras da última medição*/
+#ifndef CALIBRACAO_H
+#define CALIBRACAO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//Uma faixa por oitava: a faixa k vale de 2^k até 2^(k+1)-1 Hz, a maior frequência do LEDC (40 MHz) fica na 25
+#define CALIBRACAO_NUM_FAIXAS           26
+
+//A média de uma faixa pesa cada medida nova como se houvesse no máximo esse número de medidas antes dela,
+//assim uma faixa com muitas medidas antigas ainda acompanha uma mudança
+#define CALIBRACAO_PESO_MAXIMO          8
+
+//Um desvio maior que esse não vem do clock: o pino está sendo forçado de fora ou o canal mudou durante a medida
+#define CALIBRACAO_DESVIO_MAXIMO_PPM    5000
+
+//Leitura do contador de pulsos: quantas bordas de subida foram contadas até o instante
+struct amostra_contagem{
+    int64_t instante_us;
+    int64_t pulsos;
+};
+
+//Correção de uma faixa: quanto a saída medida ficou, em média, acima da calculada com o clock nominal
+struct faixa_calibracao{
+    int32_t  desvio_ppm;
+    uint16_t medidas;           //0: a faixa usa o clock nominal
+    uint16_t reservado;
+};
+
+struct tabela_calibracao{
+    struct faixa_calibracao faixas[CALIBRACAO_NUM_FAIXAS];
+};
+
+//Faixa da tabela de uma frequência, -1 se ela for 0
+int calibracao_faixa(uint32_t frequencia);
+
+//Total de pulsos de uma leitura do contador que volta a zero ao chegar em 'limite', com os 'estouros' que a
+//interrupção contou até ali. Entre o contador zerar e a interrupção rodar, a leitura pega a contagem nova com
+//os estouros antigos e o total fica 'limite' pulsos para trás. O contador só sobe durante a medição, então um
+//total menor que o da leitura anterior ('pulsos_anteriores', negativo na primeira) é esse estouro pendente.
+//Isso só se vê com no máximo um estouro desde a leitura anterior: com mais, quem lê ainda precisa dar tempo
+//para a interrupção rodar antes de conferir os estouros
+int64_t calibracao_pulsos_contados(uint32_t estouros, int32_t contagem, int32_t limite, int64_t pulsos_anteriores);
+
+//Frequência em mHz pela reta que melhor passa pelas leituras do contador (mínimos quadrados), o que dilui
+//a incerteza do instante de cada leitura. Devolve 0 com menos de 2 amostras ou sem tempo entre elas
+uint64_t calibracao_frequencia_medida_mhz(const struct amostra_contagem *amostras, int num_amostras);
+
+//Frequência em mHz que um timer do LEDC gera com esse clock, divisor (ponto fixo 10.8) e resolução
+uint64_t calibracao_frequencia_timer_mhz(uint32_t clock_hz, uint32_t divisor, uint32_t resolucao);
+
+//Erro de uma frequência em relação à referência, em partes por milhão
+int32_t calibracao_erro_ppm(uint64_t medida_mhz, uint64_t referencia_mhz);
+
+//Duty em unidades finas (65535 = 100%) a partir das amostras do pino, -1 sem amostras
+int32_t calibracao_duty_medido(uint32_t amostras_altas, uint32_t total_amostras);
+
+//Ciclos da CPU de uma janela com um número inteiro de períodos, a maior que cabe em janela_us. Amostrar o
+//pino num número inteiro de períodos não depende de onde a janela começa. Devolve 0 se nem um período cabe
+uint32_t calibracao_ciclos_janela_duty(uint64_t frequencia_mhz, uint32_t janela_us, uint32_t cpu_mhz);
+
+//Junta o desvio de uma medida na média da faixa. Devolve false (sem alterar a tabela) se o desvio não é
+//plausível ou a frequência não tem faixa
+bool calibracao_registra(struct tabela_calibracao *tabela, uint32_t frequencia, int32_t desvio_ppm);
+
+//Clock que o cálculo do timer deve usar para essa frequência: o nominal corrigido pelo desvio da faixa
+uint32_t calibracao_clock_efetivo(const struct tabela_calibracao *tabela, uint32_t frequencia, uint32_t clock_nominal);
+
+#endif
@@ -0,0 +1,58 @@
+/*Configuração pedida e aplicada de um canal, comum ao main.c e aos arquivos sem nada do ESP-IDF que trabalham com ela
+(o parser do formulário, por exemplo), para que eles compilem no PC com os testes de test/*/
+#ifndef CANAIS_H
+#define CANAIS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//O LEDC do ESP32 tem 16 canais: os 8 primeiros são do grupo high speed e os 8 últimos do low speed
+#define NUM_CANAIS_PWM        16
+
+//O duty pedido é guardado em unidades finas (65535 = 100%), assim a API e o UDP podem pedir mais
+//resolução que 1%. A página continua trabalhando em percentual
+#define DUTY_FINO_MAXIMO                65535
+#define PERCENTUAL_PARA_DUTY_FINO(p)    (((p) * DUTY_FINO_MAXIMO + 50) / 100)
+#define DUTY_FINO_PARA_PERCENTUAL(d)    (((d) * 100 + DUTY_FINO_MAXIMO / 2) / DUTY_FINO_MAXIMO)
+
+struct parametros_pwm{
+    bool estado;
+    int frequencia;
+    int duty_fino;              //0 a DUTY_FINO_MAXIMO
+    int fase;                   //início do pulso dentro do período, 0 a DUTY_FINO_MAXIMO (hpoint do LEDC)
+    int gerador;                //enum gerador, periférico que gera o sinal
+    int tempo_morto_ns;         //MCPWM complementar: atraso das bordas de subida das duas saídas
+    int pulsos;                 //RMT: 0 gera o sinal contínuo, N uma rajada de N pulsos
+    bool complementar;          //MCPWM: o pino do canal vizinho sai invertido, com o tempo morto
+};
+
+//Compara campo a campo: o struct tem padding depois dos bool, e um memcmp compararia esses bytes, que
+//não têm valor definido
+static inline bool parametros_iguais(const struct parametros_pwm *a, const struct parametros_pwm *b)
+{
+    return a->estado == b->estado && a->frequencia == b->frequencia && a->duty_fino == b->duty_fino &&
+           a->fase == b->fase && a->gerador == b->gerador && a->tempo_morto_ns == b->tempo_morto_ns &&
+           a->pulsos == b->pulsos && a->complementar == b->complementar;
+}
+
+//Valores que realmente foram aplicados no hardware (a frequência e o duty são quantizados pelo gerador)
+struct pwm_aplicado{
+    bool estado;
+    uint32_t frequencia;
+    uint32_t resolucao_duty;
+    uint32_t duty;              //limitado para o pulso terminar dentro do período quando há fase
+    uint32_t hpoint;
+    int32_t  erro_ppm;
+    int8_t   timer;             //timer do LEDC, operador do MCPWM ou canal do RMT usado, -1 se desligado
+    int8_t   gerador;           //enum gerador
+};
+
+//Compara dois estados aplicados campo a campo, sem o padding do struct
+static inline bool aplicado_igual(const struct pwm_aplicado *a, const struct pwm_aplicado *b)
+{
+    return a->estado == b->estado && a->frequencia == b->frequencia && a->resolucao_duty == b->resolucao_duty &&
+           a->duty == b->duty && a->hpoint == b->hpoint && a->erro_ppm == b->erro_ppm && a->timer == b->timer &&
+           a->gerador == b->gerador;
+}
+
+#endif
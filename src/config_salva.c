@@ -0,0 +1,59 @@
+#include "config_salva.h"
+
+
+void config_salva_empacota(const struct parametros_pwm *canais, struct canal_salvo *salvos)
+{
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        salvos[i].frequencia_estado = (uint32_t)canais[i].frequencia |
+                                      (canais[i].estado ? CANAL_SALVO_BIT_ESTADO : 0);
+        salvos[i].duty_fino         = (uint16_t)canais[i].duty_fino;
+        salvos[i].fase              = (uint16_t)canais[i].fase;
+        salvos[i].gerador           = (uint8_t)canais[i].gerador;
+        salvos[i].complementar      = canais[i].complementar;
+        salvos[i].pulsos            = (uint16_t)canais[i].pulsos;
+        salvos[i].tempo_morto_ns    = (uint32_t)canais[i].tempo_morto_ns;
+    }
+}
+
+
+bool config_salva_desempacota(const struct canal_salvo *salvos, struct parametros_pwm *canais,
+                              bool (*valida)(const struct parametros_pwm *parametros))
+{
+    bool validos = true;
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        canais[i] = (struct parametros_pwm){
+            .estado         = (salvos[i].frequencia_estado & CANAL_SALVO_BIT_ESTADO) != 0,
+            .frequencia     = (int)(salvos[i].frequencia_estado & ~CANAL_SALVO_BIT_ESTADO),
+            .duty_fino      = salvos[i].duty_fino,
+            .fase           = salvos[i].fase,
+            .gerador        = salvos[i].gerador,
+            .tempo_morto_ns = (salvos[i].tempo_morto_ns > INT32_MAX) ? INT32_MAX : (int)salvos[i].tempo_morto_ns,
+            .pulsos         = salvos[i].pulsos,
+            .complementar   = salvos[i].complementar != 0,
+        };
+        validos &= valida(&canais[i]);
+    }
+    return validos;
+}
+
+
+void config_salva_conta_gravacao(struct gravacoes_por_minuto *gravacoes, uint32_t minuto)
+{
+    //o contador ainda é de uma hora atrás (ou mais): recomeça
+    if (gravacoes->minuto[minuto % 60] != minuto) {
+        gravacoes->minuto[minuto % 60]   = minuto;
+        gravacoes->contagem[minuto % 60] = 0;
+    }
+    gravacoes->contagem[minuto % 60]++;
+}
+
+
+uint32_t config_salva_gravacoes_ultima_hora(const struct gravacoes_por_minuto *gravacoes, uint32_t minuto)
+{
+    uint32_t total = 0;
+    for (int m = 0; m < 60; m++) {
+        if (minuto - gravacoes->minuto[m] < 60)
+            total += gravacoes->contagem[m];
+    }
+    return total;
+}
@@ -0,0 +1,48 @@
+/*Formato dos canais salvos na NVS (na configuração e nos presets) e a conta das gravações da última hora. Quem
+abre a NVS, calcula o CRC dos blobs e agrupa as gravações é o main.c; como em calibracao.h, aqui só tem
+aritmética, nada do ESP-IDF, para dar para compilar e conferir no PC*/
+#ifndef CONFIG_SALVA_H
+#define CONFIG_SALVA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "canais.h"
+
+#define CANAL_SALVO_BIT_ESTADO      0x80000000u     //o estado vai no bit mais alto da frequência salva
+
+//Canal salvo na NVS, com campos de largura fixa e sem padding: frequência com o estado no bit
+//CANAL_SALVO_BIT_ESTADO (ela não passa de 26 bits), duty e fase em unidades finas e o gerador com os seus
+//parâmetros. Sem padding, dois canais salvos podem ser comparados com memcmp
+struct __attribute__((packed)) canal_salvo{
+    uint32_t frequencia_estado;
+    uint16_t duty_fino;
+    uint16_t fase;
+    uint8_t  gerador;
+    uint8_t  complementar;
+    uint16_t pulsos;
+    uint32_t tempo_morto_ns;
+};
+_Static_assert(sizeof(struct canal_salvo) == 16, "formato do canal salvo mudou");
+
+//Gravações por minuto da última hora: um contador para cada minuto, que é zerado quando o minuto dele volta
+struct gravacoes_por_minuto{
+    uint16_t contagem[60];
+    uint32_t minuto[60];        //minuto desde o boot a que cada contador se refere
+};
+
+//Converte os NUM_CANAIS_PWM canais para o formato salvo
+void config_salva_empacota(const struct parametros_pwm *canais, struct canal_salvo *salvos);
+
+//Converte os canais salvos. Mesmo com o CRC do blob certo, só aceita valores que a API aceitaria: retorna
+//false se algum canal não passa no 'valida'
+bool config_salva_desempacota(const struct canal_salvo *salvos, struct parametros_pwm *canais,
+                              bool (*valida)(const struct parametros_pwm *parametros));
+
+//Conta uma gravação no minuto
+void config_salva_conta_gravacao(struct gravacoes_por_minuto *gravacoes, uint32_t minuto);
+
+//Gravações nos 60 minutos até 'minuto', ele incluído
+uint32_t config_salva_gravacoes_ultima_hora(const struct gravacoes_por_minuto *gravacoes, uint32_t minuto);
+
+#endif
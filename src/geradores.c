@@ -0,0 +1,160 @@
+#include "geradores.h"
+
+
+static const char *nomes_geradores[NUM_GERADORES] = {"ledc", "mcpwm", "rmt"};
+
+
+const char *gerador_nome(int gerador)
+{
+    return (gerador >= 0 && gerador < NUM_GERADORES) ? nomes_geradores[gerador] : "?";
+}
+
+
+//Erro em partes por milhão da frequência clock / divisao, pela razão exata e não pela obtida arredondada em mHz
+//(que em 1 Hz já erra 500 ppm)
+static int32_t erro_ppm(uint32_t clock, uint64_t divisao, uint32_t frequencia)
+{
+    int64_t pedida = (int64_t)frequencia * (int64_t)divisao;
+    return (int32_t)((((int64_t)clock - pedida) * 1000000) / pedida);
+}
+
+
+bool gerador_calcula_mcpwm(uint32_t frequencia, uint32_t duty_fino, uint32_t tempo_morto_ns,
+                           struct config_mcpwm *config)
+{
+    if (frequencia == 0 || frequencia > GERADOR_MCPWM_CLOCK_HZ / GERADOR_MCPWM_PERIODO_MINIMO)
+        return false;
+
+    //o menor prescaler com que o período cabe no contador
+    uint64_t por_periodo = (uint64_t)frequencia * GERADOR_MCPWM_PERIODO_MAXIMO;
+    uint32_t prescaler = (uint32_t)((GERADOR_MCPWM_CLOCK_HZ + por_periodo - 1) / por_periodo);
+    if (prescaler < 1)
+        prescaler = 1;
+    if (prescaler > GERADOR_MCPWM_PRESCALER_MAXIMO)
+        return false;
+
+    //o driver calcula o período com a resolução do timer em Hz inteiros, a conta aqui é a mesma
+    uint32_t resolucao = GERADOR_MCPWM_CLOCK_HZ / prescaler;
+    uint32_t periodo   = resolucao / frequencia;
+    if (periodo < GERADOR_MCPWM_PERIODO_MINIMO)
+        return false;
+
+    //tempo morto em ticks do clock do grupo, arredondado
+    uint64_t tempo_morto = ((uint64_t)tempo_morto_ns * (GERADOR_MCPWM_CLOCK_HZ / 1000000) + 500) / 1000;
+    if (tempo_morto > GERADOR_MCPWM_TEMPO_MORTO_MAXIMO)
+        return false;
+
+    config->prescaler      = prescaler;
+    config->periodo        = periodo;
+    config->comparador     = (uint32_t)(((uint64_t)duty_fino * periodo + 32767) / 65535);
+    config->tempo_morto    = (uint32_t)tempo_morto;
+    config->frequencia_mhz = ((uint64_t)GERADOR_MCPWM_CLOCK_HZ * 1000 + (uint64_t)prescaler * periodo / 2) /
+                             ((uint64_t)prescaler * periodo);
+    config->erro_ppm       = erro_ppm(GERADOR_MCPWM_CLOCK_HZ, (uint64_t)prescaler * periodo, frequencia);
+    return true;
+}
+
+
+//Metades de item necessárias para uma duração (cada metade tem no máximo GERADOR_RMT_DURACAO_MAXIMA ticks)
+static uint32_t metades_rmt(uint32_t ticks)
+{
+    return (ticks + GERADOR_RMT_DURACAO_MAXIMA - 1) / GERADOR_RMT_DURACAO_MAXIMA;
+}
+
+
+bool gerador_calcula_rmt(uint32_t frequencia, uint32_t duty_fino, uint32_t pulsos, struct config_rmt *config)
+{
+    if (frequencia == 0 || frequencia > GERADOR_RMT_CLOCK_HZ / 2 || pulsos > GERADOR_RMT_PULSOS_MAXIMOS)
+        return false;
+    uint32_t repeticoes = (pulsos > 0) ? pulsos : 1;
+
+    //o período em ticks diminui com o divisor, e com ele as metades: o primeiro que couber tem mais resolução
+    for (uint32_t divisor = 1; divisor <= GERADOR_RMT_DIVISOR_MAXIMO; divisor++) {
+        uint64_t clock  = GERADOR_RMT_CLOCK_HZ / divisor;
+        uint64_t ticks  = (clock + frequencia / 2) / frequencia;
+        if (ticks < 2)
+            return false;           //com um divisor maior só piora
+        uint32_t alto   = (uint32_t)(((uint64_t)duty_fino * ticks + 32767) / 65535);
+        uint32_t baixo  = (uint32_t)ticks - alto;
+        uint64_t metades = (uint64_t)(metades_rmt(alto) + metades_rmt(baixo)) * repeticoes;
+        uint64_t itens  = (metades + 1) / 2;
+        if (itens > GERADOR_RMT_ITENS_MAXIMOS)
+            continue;
+
+        config->divisor        = divisor;
+        config->ticks_alto     = alto;
+        config->ticks_baixo    = baixo;
+        config->itens          = (uint32_t)itens;
+        config->frequencia_mhz = ((uint64_t)GERADOR_RMT_CLOCK_HZ * 1000 + divisor * ticks / 2) / (divisor * ticks);
+        config->erro_ppm       = erro_ppm(GERADOR_RMT_CLOCK_HZ, divisor * ticks, frequencia);
+        return true;
+    }
+    return false;
+}
+
+
+int gerador_monta_itens_rmt(const struct config_rmt *config, uint32_t pulsos, uint32_t *itens, int maximo)
+{
+    uint32_t repeticoes = (pulsos > 0) ? pulsos : 1;
+    int metade = 0;                 //metades escritas; a par é a primeira do item
+
+    for (uint32_t p = 0; p < repeticoes; p++) {
+        for (int nivel = 1; nivel >= 0; nivel--) {
+            uint32_t restante = nivel ? config->ticks_alto : config->ticks_baixo;
+            while (restante > 0) {
+                uint32_t duracao = (restante > GERADOR_RMT_DURACAO_MAXIMA) ? GERADOR_RMT_DURACAO_MAXIMA : restante;
+                restante -= duracao;
+                int item = metade / 2;
+                if (item >= maximo)
+                    return -1;
+                uint32_t valor = duracao | ((uint32_t)nivel << 15);
+                if (metade % 2 == 0)
+                    itens[item] = valor;            //a outra metade zerada é o fim, se nada vier depois
+                else
+                    itens[item] |= valor << 16;
+                metade++;
+            }
+        }
+    }
+    return (metade + 1) / 2;
+}
+
+
+bool gerador_config_cabe(const struct canal_gerador *canais, int num_canais, int canais_por_grupo,
+                         int timers_por_grupo)
+{
+    int usados[NUM_GERADORES] = {0};
+
+    for (int i = 0; i < num_canais; i++) {
+        if (!canais[i].ligado)
+            continue;
+        if (canais[i].gerador >= NUM_GERADORES)
+            return false;
+        usados[canais[i].gerador]++;
+
+        //a saída complementar sai no pino do vizinho
+        if (canais[i].gerador == GERADOR_MCPWM && canais[i].complementar) {
+            int vizinho = i ^ 1;
+            if (vizinho >= num_canais || canais[vizinho].ligado)
+                return false;
+        }
+    }
+    if (usados[GERADOR_MCPWM] > GERADOR_MCPWM_OPERADORES || usados[GERADOR_RMT] > GERADOR_RMT_CANAIS)
+        return false;
+
+    //timers do LEDC: cada frequência distinta de um grupo ocupa um
+    for (int inicio = 0; inicio < num_canais; inicio += canais_por_grupo) {
+        int distintas = 0;
+        for (int i = inicio; i < inicio + canais_por_grupo && i < num_canais; i++) {
+            if (!canais[i].ligado || canais[i].gerador != GERADOR_LEDC)
+                continue;
+            int anterior = inicio;
+            while (anterior < i && !(canais[anterior].ligado && canais[anterior].gerador == GERADOR_LEDC &&
+                                     canais[anterior].frequencia == canais[i].frequencia))
+                anterior++;
+            if (anterior == i && ++distintas > timers_por_grupo)
+                return false;
+        }
+    }
+    return true;
+}
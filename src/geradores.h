@@ -0,0 +1,88 @@
+/*Contas dos geradores de sinal dos canais além do LEDC: o MCPWM (período inteiro em ticks, saída complementar
+com tempo morto) e o RMT (o sinal descrito como uma lista de durações, contínuo ou uma rajada de pulsos), e a
+conferência de que uma configuração cabe nos recursos de cada periférico. Como em calibracao.h, aqui só tem
+aritmética, nada do ESP-IDF, para dar para compilar e conferir no PC*/
+#ifndef GERADORES_H
+#define GERADORES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//Periférico que gera o sinal de um canal
+enum gerador{
+    GERADOR_LEDC,               //o padrão: timers compartilhados, fade por hardware e fase
+    GERADOR_MCPWM,              //período inteiro sem divisor fracionário, saída complementar com tempo morto
+    GERADOR_RMT,                //sinal contínuo ou rajada de pulsos, com qualquer duty em frequências baixas
+    NUM_GERADORES
+};
+
+/*MCPWM: 2 unidades com 3 timers/operadores cada. O grupo roda a GERADOR_MCPWM_CLOCK_HZ e cada timer divide
+esse clock por um prescaler de 8 bits; o período é um contador de 16 bits. O tempo morto conta no clock do
+grupo, num registrador de 16 bits*/
+#define GERADOR_MCPWM_OPERADORES        6
+#define GERADOR_MCPWM_CLOCK_HZ          80000000
+#define GERADOR_MCPWM_PRESCALER_MAXIMO  256
+#define GERADOR_MCPWM_PERIODO_MAXIMO    65535
+#define GERADOR_MCPWM_PERIODO_MINIMO    2
+#define GERADOR_MCPWM_TEMPO_MORTO_MAXIMO 65535
+
+/*RMT: 8 canais, cada um com um bloco de 64 itens. Um item tem duas metades (nível e duração de 15 bits) e a
+duração conta no clock APB dividido por um divisor de 8 bits. Um item do bloco fica para o marcador de fim*/
+#define GERADOR_RMT_CANAIS              8
+#define GERADOR_RMT_CLOCK_HZ            80000000
+#define GERADOR_RMT_DIVISOR_MAXIMO      255
+#define GERADOR_RMT_DURACAO_MAXIMA      32767
+#define GERADOR_RMT_ITENS_MAXIMOS       63
+#define GERADOR_RMT_PULSOS_MAXIMOS      GERADOR_RMT_ITENS_MAXIMOS       //um item (alto e baixo) por pulso
+
+//Configuração de um timer do MCPWM para uma frequência e um duty
+struct config_mcpwm{
+    uint32_t prescaler;         //1 a GERADOR_MCPWM_PRESCALER_MAXIMO
+    uint32_t periodo;           //ticks do timer por período
+    uint32_t comparador;        //ticks em nível alto
+    uint32_t tempo_morto;       //ticks do clock do grupo
+    uint64_t frequencia_mhz;    //frequência que o timer realmente gera, em mHz
+    int32_t  erro_ppm;
+};
+
+//Configuração de um canal do RMT para uma frequência, um duty e um número de pulsos
+struct config_rmt{
+    uint32_t divisor;           //1 a GERADOR_RMT_DIVISOR_MAXIMO
+    uint32_t ticks_alto;        //duração do nível alto de um período
+    uint32_t ticks_baixo;
+    uint32_t itens;             //itens do bloco usados pelo sinal inteiro
+    uint64_t frequencia_mhz;
+    int32_t  erro_ppm;
+};
+
+//O que a conferência dos recursos precisa saber de cada canal
+struct canal_gerador{
+    bool     ligado;
+    uint8_t  gerador;           //enum gerador
+    bool     complementar;      //MCPWM: o pino do canal vizinho (índice ^ 1) sai invertido
+    uint32_t frequencia;
+};
+
+//Nome do gerador na API ("ledc", "mcpwm", "rmt"), "?" se o número não for de um gerador
+const char *gerador_nome(int gerador);
+
+//Maior resolução (menor prescaler) que faz o período caber nos 16 bits. Devolve false se a frequência
+//não é possível ou o tempo morto não cabe no registrador
+bool gerador_calcula_mcpwm(uint32_t frequencia, uint32_t duty_fino, uint32_t tempo_morto_ns,
+                           struct config_mcpwm *config);
+
+//Menor divisor (mais resolução) com que o sinal inteiro cabe no bloco do canal: um período com pulsos = 0
+//(repetido pelo modo de laço) ou a rajada toda. Devolve false se não couber nem com o maior divisor
+bool gerador_calcula_rmt(uint32_t frequencia, uint32_t duty_fino, uint32_t pulsos, struct config_rmt *config);
+
+//Escreve os itens do RMT (no formato do rmt_item32_t: duração0 | nível0 << 15 | duração1 << 16 | nível1 << 31)
+//e devolve quantos foram escritos, -1 se não couberem em maximo
+int gerador_monta_itens_rmt(const struct config_rmt *config, uint32_t pulsos, uint32_t *itens, int maximo);
+
+//Confere se os canais ligados cabem no hardware: os timers do LEDC de cada grupo (canais do grupo com a
+//mesma frequência dividem um timer), os operadores do MCPWM, os canais do RMT e o pino do vizinho de cada
+//saída complementar, que precisa estar desligado
+bool gerador_config_cabe(const struct canal_gerador *canais, int num_canais, int canais_por_grupo,
+                         int timers_por_grupo);
+
+#endif
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "json_canal.h"
+#include "geradores.h"
+
+
+int json_canal_formata(char *json, size_t tamanho, int canal, int gpio, const struct parametros_pwm *pedido,
+                       const struct pwm_aplicado *aplicado)
+{
+    return snprintf(json, tamanho,
+                    "{\"canal\":%d,\"gpio\":%d,\"estado\":%s,\"frequencia\":%d,\"percentual_duty\":%d,\"duty_fino\":%d,"
+                    "\"fase\":%d,\"frequencia_aplicada\":%u,\"erro_ppm\":%d,\"resolucao_duty\":%u,\"duty\":%u,"
+                    "\"hpoint\":%u,\"timer\":%d,\"gerador\":\"%s\",\"complementar\":%s,\"tempo_morto_ns\":%d,"
+                    "\"pulsos\":%d}",
+                    canal,
+                    gpio,
+                    aplicado->estado ? "true" : "false",
+                    pedido->frequencia,
+                    DUTY_FINO_PARA_PERCENTUAL(pedido->duty_fino),
+                    pedido->duty_fino,
+                    pedido->fase,
+                    (unsigned)aplicado->frequencia,
+                    (int)aplicado->erro_ppm,
+                    (unsigned)aplicado->resolucao_duty,
+                    (unsigned)aplicado->duty,
+                    (unsigned)aplicado->hpoint,
+                    aplicado->timer,
+                    gerador_nome(pedido->gerador),
+                    pedido->complementar ? "true" : "false",
+                    pedido->tempo_morto_ns,
+                    pedido->pulsos);
+}
+
+
+size_t json_canal_mensagem_ws(char *mensagem, size_t tamanho, int64_t agora_us, const int *pinos,
+                              const struct parametros_pwm *pedido, const struct pwm_aplicado *aplicado,
+                              struct parametros_pwm *pedido_enviado, struct pwm_aplicado *aplicado_enviado,
+                              bool todos, int *mudaram)
+{
+    size_t usado = snprintf(mensagem, tamanho, "{\"us\":%lld,\"canais\":[", (long long)agora_us);
+    *mudaram = 0;
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        if (!todos && parametros_iguais(&pedido[i], &pedido_enviado[i]) &&
+            aplicado_igual(&aplicado[i], &aplicado_enviado[i]))
+            continue;
+        if ((*mudaram)++)
+            mensagem[usado++] = ',';
+        usado += json_canal_formata(mensagem + usado, tamanho - usado, i, pinos[i], &pedido[i], &aplicado[i]);
+    }
+    if (*mudaram == 0)
+        return 0;
+    usado += snprintf(mensagem + usado, tamanho - usado, "]}");
+    memcpy(pedido_enviado, pedido, NUM_CANAIS_PWM * sizeof(*pedido));
+    memcpy(aplicado_enviado, aplicado, NUM_CANAIS_PWM * sizeof(*aplicado));
+    return usado;
+}
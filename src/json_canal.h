@@ -0,0 +1,30 @@
+/*JSON do estado dos canais: o de um canal, com o pedido e o que foi aplicado (GET/PUT /api/pwm), e a mensagem
+do /ws só com os canais que mudaram desde a anterior. Quem lê o estado publicado e envia pelos sockets é o
+main.c; como em calibracao.h, aqui só tem aritmética e texto, nada do ESP-IDF, para dar para compilar e
+conferir no PC*/
+#ifndef JSON_CANAL_H
+#define JSON_CANAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "canais.h"
+
+#define JSON_CANAL_TAMANHO              384     //JSON de um canal no GET/PUT /api/pwm e no /ws
+
+//Mensagem do /ws com todos os canais, como no GET /api/pwm
+#define JSON_MENSAGEM_WS_TAMANHO        (NUM_CANAIS_PWM * JSON_CANAL_TAMANHO + 32)
+
+//Escreve o JSON com o pedido e o estado aplicado do canal, retorna o tamanho escrito
+int json_canal_formata(char *json, size_t tamanho, int canal, int gpio, const struct parametros_pwm *pedido,
+                       const struct pwm_aplicado *aplicado);
+
+//Monta a mensagem do /ws, {"us":<instante>,"canais":[<canais que mudaram>]}, com os canais diferentes do
+//último envio (todos com 'todos'), e copia o estado para os '_enviado'. Retorna o tamanho, 0 se nenhum mudou
+size_t json_canal_mensagem_ws(char *mensagem, size_t tamanho, int64_t agora_us, const int *pinos,
+                              const struct parametros_pwm *pedido, const struct pwm_aplicado *aplicado,
+                              struct parametros_pwm *pedido_enviado, struct pwm_aplicado *aplicado_enviado,
+                              bool todos, int *mudaram);
+
+#endif
@@ -1,36 +1,206 @@
+//Os logs de depuração são compilados e ficam desligados pelo nível em tempo de execução (padrão INFO),
+//que pode ser trocado pelo PUT /api/log?nivel=debug sem regravar o firmware
+#define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+
 #include <esp_wifi.h>               //Conexão Wireless
 #include "esp_log.h"                //log de eventos no monitor serial
+#include "esp_system.h"             //heap livre para o /metrics e esp_random
+#include "esp_heap_caps.h"          //maior bloco livre do heap
 #include <esp_http_server.h>        //biblioteca para poder usar o server http
-#include "freertos/event_groups.h"  //grupo de eventos
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"          //tasks do PWM e da NVS
+#include "freertos/semphr.h"        //mutex dos sockets escritos pelas tasks de envio http
 #include "nvs_flash.h"              //memória nvs
+#include "nvs.h"                    //configuração dos canais salva na nvs
+#include "esp32/rom/crc.h"          //CRC do blob salvo na nvs
 #include "driver/ledc.h"            //PWM
-#include <math.h>                   //Função log
+#include "driver/pcnt.h"            //contador de pulsos que mede a frequência das saídas
+#include "driver/mcpwm.h"           //gerador MCPWM: período inteiro e saída complementar com tempo morto
+#include "driver/rmt.h"             //gerador RMT: sinal descrito por durações, contínuo ou em rajada
+#include "driver/gpio.h"            //nível do pino na medição do duty
+#include "soc/gpio_sig_map.h"       //entrada do PCNT na matriz de GPIO
+#include "soc/gpio_periph.h"        //registrador do IO_MUX de cada pino
+#include "esp32/rom/gpio.h"         //gpio_matrix_in
+#include "esp_timer.h"              //tempo em microssegundos para medir a latência da task do PWM
+#include "lwip/sockets.h"           //controle por UDP
+#include "xtensa/hal.h"             //contador de ciclos da CPU, para medir a janela de escrita de um lote
 #include <sys/param.h>              //Função MIN
 #include <string.h>
+#include <stdlib.h>                 //strtol
+
+#include "canais.h"                 //configuração pedida de um canal
+#include "timer_pwm.h"              //divisor e resolução do timer do LEDC para uma frequência
+#include "parser.h"                 //formulário html e campos do JSON, a entrada que vem da rede
+#include "saida_html.h"             //respostas em chunks sem heap
+#include "calibracao.h"             //contas da medição e da calibração das saídas, sem nada do ESP-IDF
+#include "geradores.h"              //contas do MCPWM e do RMT e a conferência dos recursos de cada gerador
+#include "seqlock.h"                //troca da configuração entre os handlers e a task do PWM sem travar a leitura
+#include "sequencia.h"              //interpretador e máquina de passos do sequenciador, sem nada do ESP-IDF
+#include "agenda.h"                 //fila dos comandos com hora marcada, sem nada do ESP-IDF
+#include "protocolo_udp.h"          //formato e validação dos pacotes de controle por UDP, sem nada do ESP-IDF
+#include "presets.h"                //tabela dos presets, vizinho e nome, sem nada do ESP-IDF
+#include "config_salva.h"           //formato dos canais salvos na NVS e gravações por minuto, sem nada do ESP-IDF
+#include "metricas.h"               //histogramas de latência e o texto do Prometheus, sem nada do ESP-IDF
+#include "medicao.h"                //porta, resultado e JSON da medição das saídas, sem nada do ESP-IDF
+#include "json_canal.h"             //JSON de um canal e a mensagem do /ws com os que mudaram, sem nada do ESP-IDF
+#include "pagina_etags.h"           //ETag da página embutida, gerado no build junto com os .gz
 
 
 
 
 /*------------------------Mapeamento de Hardware----------------------*/
-//Vamos definir quais pinos do ESP serão usados como saída do PWM0 e PWM1
-#define pino_PWM0    18
-#define pino_PMW1    19
+//Os 16 canais do LEDC (NUM_CANAIS_PWM, em canais.h) são 8 do grupo high speed e 8 do low speed.
+//Cada grupo tem 4 timers que são divididos entre os canais com a mesma frequência.
+#define NUM_CANAIS_POR_MODO   8
+#define NUM_TIMERS_POR_MODO   4
+
+//Pinos de saída de cada canal (evitando os pinos de strapping e os da flash)
+static const int pinos_pwm[NUM_CANAIS_PWM] = {
+    18, 19, 21, 22, 23, 25, 26, 27,     //canais high speed 0 a 7
+    32, 33,  4,  5, 13, 14, 16, 17,     //canais low speed 8 a 15
+};
 
 
 
 /*------------------------Definições de Projeto-----------------------*/
-/* O event Group do wireless permite muitos eventos por grupo mas nos só nos importamos com 2 eventos:
- * - Conseguimos conexão com o AP com um IP
- * - Falhamos na conexão apos o número máximo de tentativas*/
-#define WIFI_CONNECTED_BIT BIT0
-#define WIFI_FAIL_BIT      BIT1
+/*Aqui definimos o SSID e a Senha da rede wireless. Se a conexão cair (ou não acontecer) o ESP tenta de novo
+para sempre, dobrando a espera a cada falha de WIFI_ESPERA_MINIMA_MS até WIFI_ESPERA_MAXIMA_MS. A espera é
+sorteada entre a metade e o total para vários dispositivos não tentarem juntos quando o AP volta*/
+#define ESP_WIFI_SSID           "tira_o_zoio"
+#define ESP_WIFI_PASS           "jabuticaba"
+#define WIFI_ESPERA_MINIMA_MS   500
+#define WIFI_ESPERA_MAXIMA_MS   60000
+
+
+//Task que aplica as configurações no LEDC. Fica no core 1, longe da pilha wireless, e com prioridade
+//acima da task do server http (5) para aplicar o pedido assim que ele é publicado
+#define TASK_PWM_STACK        4096      //a task também executa as sequências e publica o fim delas
+#define TASK_PWM_PRIORIDADE   6
+#define TASK_PWM_CORE         1
+
+
+/*Server http. Todos os handlers rodam na mesma task, então nenhum pode ficar preso num cliente lento: cada
+chamada ao socket espera no máximo HTTP_ESPERA_SOCKET_S e o corpo inteiro precisa chegar em HTTP_PRAZO_CORPO_MS,
+senão a requisição recebe 408 e o socket é fechado. As respostas que não cabem no buffer de envio do TCP
+(abaixo) saem por outras tasks, então a do server não espera nenhum cliente ler. Com o LRU ligado, um
+cliente novo fecha a conexão parada há mais tempo quando os HTTP_MAX_SOCKETS estão ocupados (o lwip tem
+CONFIG_LWIP_MAX_SOCKETS=16: o server usa 3 internamente e sobra 1 para o controle por UDP)*/
+#define HTTP_MAX_SOCKETS            12
+#define HTTP_ESPERA_SOCKET_S        2
+#define HTTP_PRAZO_CORPO_MS         3000
+#define HTTP_CORE                   0       //longe da task do PWM
+#define HTTP_STACK                  6144    //a task do server é a única que o httpd_start aloca no heap
+#define HTTP_MAX_URI_HANDLERS       24      //o padrão (8) já está todo ocupado
+
+/*Envio das respostas maiores que o buffer de envio do TCP (5744 bytes): o /metrics tem uns 30 KB e o
+/api/medicao passa dele com os canais medidos. As outras (a página tem menos de 3 KB comprimida) cabem
+inteiras no buffer e o handler volta sem esperar o cliente. O handler só põe o socket numa fila de
+HTTP_FILA_ENVIOS; uma das HTTP_TASKS_ENVIO tasks monta a resposta e a escreve sem bloquear (MSG_DONTWAIT),
+esperando um tick quando o buffer enche. Quem não leu tudo em HTTP_PRAZO_ENVIO_MS tem a conexão fechada, e
+com a fila cheia a resposta é 503 com Retry-After*/
+#define HTTP_TASKS_ENVIO            2
+#define HTTP_FILA_ENVIOS            8
+#define HTTP_PRAZO_ENVIO_MS         5000
+#define TASK_ENVIO_HTTP_STACK       4096
+#define TASK_ENVIO_HTTP_PRIORIDADE  4       //abaixo do server http, que só põe na fila
+#define TASK_ENVIO_HTTP_CORE        0
+
+
+/*Controle por UDP para bancadas de teste: pacotes binários de tamanho fixo com um cabeçalho e até
+NUM_CANAIS_PWM comandos. O formato está em src/protocolo_udp.h, e tools/cliente_udp.py é um cliente*/
+#define UDP_PORTA_CONTROLE          5005
+#define TASK_UDP_STACK              3072
+#define TASK_UDP_PRIORIDADE         5       //a mesma do server http
+#define TASK_UDP_CORE               0
+
+
+//Tamanho máximo aceito para o corpo do formulário html (o corpo é lido em pedaços de FORMULARIO_PEDACO)
+#define FORMULARIO_TAMANHO_MAXIMO   2048
+#define FORMULARIO_PEDACO           64
+
+
+//Quantas operações no LEDC o registro circular guarda (com o instante de cada uma) para diagnóstico
+#define TRACE_LEDC_TAMANHO          32
+
 
+//Agenda de comandos com hora marcada. O timer acorda a task do PWM AGENDA_ANTECEDENCIA_US antes do
+//instante: ela prepara o lote e espera o resto em laço já dentro da seção crítica das escritas no LEDC,
+//para não depender da latência de acordar nem ser interrompida entre o instante e as escritas
+#define AGENDA_ANTECEDENCIA_US      200
+#define CPU_MHZ                     CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
 
-/*Aqui definimos o SSID, a Senha e o número máximo de tentativas que vamos 
-tentar ao se conectar ao access point da rede wireless*/
-#define ESP_WIFI_SSID      "tira_o_zoio"
-#define ESP_WIFI_PASS      "jabuticaba"
-#define ESP_MAXIMUM_RETRY  10
+
+/*Medição das saídas (loopback): o pino do canal também entra, pela matriz de GPIO, no contador de pulsos
+(PCNT), sem fio externo e sem tirar o pino do LEDC. A porta e as amostras estão em medicao.h. Com o período
+maior que a janela o duty não é medido*/
+#define MEDICAO_UNIDADE_PCNT        PCNT_UNIT_0
+#define MEDICAO_LIMITE_PCNT         30000   //o contador é de 16 bits: ao chegar aqui ele zera e a interrupção conta
+#define MEDICAO_ESPERA_ISR_US       5       //mais que a latência da interrupção do PCNT, que roda neste core
+#define TASK_MEDICAO_STACK          3072
+#define TASK_MEDICAO_PRIORIDADE     1       //a amostragem do duty ocupa a CPU, só roda quando o core está livre
+#define TASK_MEDICAO_CORE           1
+
+
+/*Presets: até PRESET_MAXIMO configurações completas dos canais, com nome, salvas na NVS (uma chave por
+preset, cada canal compactado em 16 bytes) e guardadas na RAM prontas para publicar. A troca é feita pela
+task do PWM numa passada só, então todos os canais mudam no mesmo lote do LEDC. O botão BOOT da placa
+avança para o próximo preset. O tamanho da tabela e do nome está em presets.h*/
+#define PRESET_PINO_PROXIMO         0       //botão BOOT, -1 para não usar
+#define PRESET_PINO_ANTERIOR        -1
+#define PRESET_DEBOUNCE_US          200000
+
+
+/*Geradores: cada canal escolhe o periférico que gera o seu sinal (ver geradores.h). O LEDC é o padrão e o
+único com fase, rampa por fade, lote sincronizado e calibração; o MCPWM dá período inteiro em até 80 MHz de
+resolução e saída complementar com tempo morto, que sai no pino do canal vizinho (índice ^ 1, que precisa
+estar desligado); o RMT gera o sinal contínuo ou uma rajada de GERADOR_RMT_PULSOS_MAXIMOS pulsos no máximo,
+com qualquer duty em frequências baixas. O MCPWM e o RMT mudam na hora em que a task do PWM passa pelo
+canal, fora do lote do LEDC*/
+#define GERADOR_TEMPO_MORTO_MAXIMO_NS   ((GERADOR_MCPWM_TEMPO_MORTO_MAXIMO * 1000) / (GERADOR_MCPWM_CLOCK_HZ / 1000000))
+
+
+/*Estado dos canais empurrado por WebSocket (/ws) para a página: quando o estado aplicado muda, a task do
+WebSocket monta uma mensagem só com os canais que mudaram desde a anterior e a mesma mensagem vai para
+todos os assinantes. As mudanças que chegam juntas saem numa mensagem só, no máximo WS_TAXA_MAXIMA_HZ por
+segundo, então uma rampa do sequenciador não vira uma mensagem por passo. Cada assinante ocupa um dos
+HTTP_MAX_SOCKETS*/
+#define WS_TAXA_MAXIMA_HZ           10
+#define WS_MAX_ASSINANTES           10
+#define WS_QUADRO_RECEBIDO_MAXIMO   32      //o cliente não manda comandos, quadros maiores fecham a conexão
+#define TASK_WS_STACK               3072
+#define TASK_WS_PRIORIDADE          2       //abaixo do server http, que faz o envio
+#define TASK_WS_CORE                0
+
+
+//Quantas tasks além da do server http têm a pilha acompanhada no /metrics
+#define NUM_TASKS_MONITORADAS       (5 + HTTP_TASKS_ENVIO)
+
+
+/*Configuração dos canais salva na NVS para voltar igual depois de um reboot. A gravação espera
+NVS_ATRASO_GRAVACAO_MS sem nenhuma alteração e leva só o estado mais recente, então arrastar um slider vira
+uma gravação só. Uma alteração que não para (um script mudando o duty sem parar) grava no máximo a cada
+NVS_ESPERA_MAXIMA_MS, e duas gravações ficam pelo menos NVS_INTERVALO_MINIMO_MS uma da outra: no máximo 60
+por hora. A versão muda se o formato do blob mudar*/
+#define NVS_NAMESPACE_PWM           "pwm"
+#define NVS_CHAVE_CANAIS            "canais"
+#define NVS_VERSAO_CANAIS           5       //2: duty em unidades finas, 3: fase, 4: gerador, 5: canal_salvo
+#define NVS_CHAVE_CALIBRACAO        "calibracao"
+#define NVS_VERSAO_CALIBRACAO       1
+#define NVS_VERSAO_PRESET           2       //a chave de cada preset é "preset<n>". 2: gerador
+#define NVS_ATRASO_GRAVACAO_MS      5000
+#define NVS_ESPERA_MAXIMA_MS        60000
+#define NVS_INTERVALO_MINIMO_MS     60000
+
+//Task que grava na NVS: prioridade baixa, a gravação pode esperar
+#define TASK_NVS_STACK              3072
+#define TASK_NVS_PRIORIDADE         1
+
+
+/*Memória. Nada no caminho de uma requisição ou da aplicação nos geradores usa o heap: as pilhas e os
+controles das tasks do projeto são estáticos, as respostas são montadas em buffers na pilha do handler e
+todas as tabelas têm tamanho fixo, conferido na compilação. O heap fica para o ESP-IDF (wireless, lwip, o
+server http no httpd_start e a NVS durante uma gravação) e o relatório do boot mostra as duas partes*/
+#define MEMORIA_ALINHAMENTO         4       //as áreas do relatório são arredondadas como no linker
 
 
 /*-----------------------------------------------Constantes de Projeto --------------------------------------*/
@@ -39,24 +209,477 @@ static const char *TAG = "LOG";             //A tag que será impressa no log do
 
 
 
+/*---------------------------Arquivos da Página Web (embutidos na flash já comprimidos)----------------------*/
+//Gerados a partir de webpage/ e embutidos pelo EMBED_FILES do src/CMakeLists.txt. Os valores dos canais
+//não fazem parte da página: o app.js busca pelo /api/pwm
+extern const uint8_t index_html_gz_inicio[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_fim[]    asm("_binary_index_html_gz_end");
+extern const uint8_t style_css_gz_inicio[]  asm("_binary_style_css_gz_start");
+extern const uint8_t style_css_gz_fim[]     asm("_binary_style_css_gz_end");
+extern const uint8_t app_js_gz_inicio[]     asm("_binary_app_js_gz_start");
+extern const uint8_t app_js_gz_fim[]        asm("_binary_app_js_gz_end");
+
+
 /*----------------------------------------------------Objetos------------------------------------------------*/
 
-//Handle dos Eventos Wireless
-static EventGroupHandle_t s_wifi_event_group;
+//Timer que agenda a próxima tentativa de conexão wireless
+static esp_timer_handle_t timer_reconexao_wifi;
 
-//Handle do server http
+//Handle do server http. Ele é iniciado quando a rede dá um IP e parado quando o IP é perdido
 static httpd_handle_t server =NULL;
 
-struct parametros_pwm{
-    bool estado;
-    int frequencia;
-    int percentual_duty;
-}parametros_pwm;
+
+
+
+//Blob da configuração dos canais na NVS. A geração conta as gravações e o CRC cobre tudo que vem antes dele
+struct config_salva{
+    uint32_t versao;
+    uint32_t geracao;
+    struct canal_salvo canais[NUM_CANAIS_PWM];
+    uint32_t crc;
+};
+
+//Blob da tabela de calibração na NVS, gravado só quando uma medição pede a calibração
+struct calibracao_salva{
+    uint32_t versao;
+    struct tabela_calibracao tabela;
+    uint32_t crc;
+};
+
+//Blob de um preset na NVS, o CRC cobre tudo que vem antes dele
+struct preset_salvo{
+    uint32_t versao;
+    char     nome[PRESET_NOME_TAMANHO];
+    struct canal_salvo canais[NUM_CANAIS_PWM];
+    uint32_t crc;
+};
+
+//Arquivo estático da página, servido como está (gzip) e revalidado pelo ETag
+struct arquivo_estatico{
+    const char    *uri;
+    const char    *tipo;            //Content-Type do arquivo descomprimido
+    const uint8_t *inicio;
+    const uint8_t *fim;
+    const char    *etag;            //hash do conteúdo entre aspas, calculado no build
+};
+
+
+
+//Operações de registrador do LEDC feitas pelo atualiza_PWM. Cada uma é contada como aplicada quando
+//precisou ser feita ou evitada quando o hardware já estava no valor pedido
+enum op_ledc{
+    OP_LEDC_TIMER,          //ledc_timer_set: divisor e resolução de um timer
+    OP_LEDC_VINCULO,        //ledc_bind_channel_timer: qual timer o canal usa
+    OP_LEDC_DUTY,           //ledc_set_duty_with_hpoint (o ledc_update_duty vai no lote)
+    OP_LEDC_PARADA,         //ledc_stop
+    OP_LEDC_RAMPA,          //ledc_set_fade_with_time + ledc_fade_start, rampa de duty feita pelo hardware
+    NUM_OPS_LEDC
+};
+
+//Uma operação no LEDC guardada no registro circular: quando foi feita, em qual timer/canal e com qual valor
+struct registro_op_ledc{
+    int64_t  instante_us;       //esp_timer_get_time() logo depois da chamada ao driver
+    uint32_t valor;             //divisor, timer, duty ou nível de parada, conforme a operação
+    uint8_t  op;                //enum op_ledc
+    uint8_t  modo;              //grupo high/low speed
+    uint8_t  indice;            //número do timer (OP_LEDC_TIMER) ou do canal no grupo
+    uint8_t  falhou;
+};
+
+//Latências exportadas como histogramas pelo /metrics: o tempo total de cada URI e das fases do caminho
+//de um pedido (interpretar o corpo e aplicar no LEDC)
+enum metrica_latencia{
+    MET_GET_PAGINA,
+    MET_GET_CSS,
+    MET_GET_JS,
+    MET_POST_FORMULARIO,
+    MET_GET_API_PWM,
+    MET_PUT_API_PWM,
+    MET_GET_API_LEDC,
+    MET_GET_API_LEDC_TRACE,
+    MET_GET_METRICS,
+    MET_PUT_API_LOG,
+    MET_GET_API_SEQ,
+    MET_PUT_API_SEQ,
+    MET_DELETE_API_SEQ,
+    MET_GET_API_AGENDA,
+    MET_GET_API_MEDICAO,
+    MET_PUT_API_MEDICAO,
+    MET_DELETE_API_MEDICAO,
+    MET_GET_API_PRESET,
+    MET_PUT_API_PRESET,
+    MET_POST_API_PRESET,
+    MET_DELETE_API_PRESET,
+    MET_GET_WS,                 //handshake e quadros recebidos do /ws
+    MET_FASE_PARSE,             //leitura dos campos do formulário ou do JSON
+    MET_FASE_APLICACAO,         //task do PWM aplicando uma publicação no LEDC
+    MET_PUBLICACAO_APLICACAO,   //da publicação até o estado aplicado ser publicado
+    MET_UDP_COMANDO,            //da chegada de um pacote UDP até o envio da resposta
+    MET_SEQUENCIA_ATRASO,       //do prazo de um passo do sequenciador até ele estar aplicado no LEDC
+    MET_AGENDA_ATRASO,          //do instante de um comando agendado até o fim do lote no LEDC
+    MET_PRESET_TROCA,           //do pedido de troca de preset (até da interrupção) até o fim do lote no LEDC
+    MET_WS_ENVIO,               //envio de uma mensagem do WebSocket para todos os assinantes
+    MET_HTTP_ENVIO,             //de uma resposta entrar na fila das tasks de envio até o último byte
+    NUM_METRICAS_LATENCIA
+};
+
+//Handler http com a latência medida: o httpd_uri_t chama executa_handler_medido(), que chama o handler
+struct handler_medido{
+    esp_err_t (*handler)(httpd_req_t *req);
+    enum metrica_latencia metrica;
+};
+
+//Programa entregue pelos handlers para a task do PWM (num_passos 0 para a sequência do canal)
+struct programa_sequencia{
+    int canal;                  //-1: nenhum programa esperando a task
+    int num_passos;
+    struct passo_sequencia passos[SEQ_MAX_PASSOS];
+};
+
+//Situação da sequência de um canal, publicada pela task do PWM junto com o estado aplicado
+struct estado_sequencia{
+    bool     executando;
+    uint8_t  passo;
+    uint8_t  num_passos;
+    uint32_t passos_executados;
+    uint32_t atraso_maximo_us;
+};
+
+//Escritas no LEDC que a task do PWM junta numa passada e faz de uma vez, com as interrupções desligadas:
+//o ledc_update_duty (que trava duty e hpoint novos no fim do período) e o ledc_stop de cada canal, e o
+//reinício dos timers pedidos. Assim canais do mesmo timer mudam na mesma borda
+struct lote_ledc{
+    uint32_t atualizar;
+    uint32_t parar;
+    uint8_t  reiniciar[LEDC_SPEED_MODE_MAX];    //um bit por timer
+    int64_t  instante_us;       //comando agendado: as escritas esperam esse instante, 0 não espera
+};
+
+//Estado de um timer do LEDC para o alocador: a configuração que ele gera e quantos canais o usam
+struct timer_pwm{
+    uint32_t frequencia;
+    struct config_timer_pwm config;
+    uint8_t usuarios;
+};
+
+//Gerador de sinal dos canais. calcula só faz as contas (os handlers também usam, para responder com o que o
+//hardware vai ter); aplica e libera mexem no periférico e são chamadas só pela task do PWM. libera para a
+//saída e devolve o pino e os recursos do canal, quando ele troca de gerador
+struct gerador_pwm{
+    esp_err_t (*calcula)(const struct parametros_pwm *parametros, struct pwm_aplicado *aplicado);
+    esp_err_t (*aplica)(int pwm_index, const struct parametros_pwm *parametros, uint32_t rampa_ms,
+                        struct lote_ledc *lote);
+    void      (*libera)(int pwm_index);
+};
 
 
 
 /*-------------------------------------------------Variáveis Globais-----------------------------------------*/
-static struct parametros_pwm pwm[2]={{0,5000,50}, {0,5000,50}};
+/*Configuração pedida para os canais. Os produtores (handlers do http) publicam com publica_config_pwm()
+e a task do PWM lê com le_config_pwm(). É um seqlock: quem escreve incrementa a sequência antes e depois
+da cópia (ímpar = escrita em andamento) e quem lê repete a cópia até pegar a mesma sequência par antes e
+depois (src/seqlock.h), assim a leitura nunca trava e nunca vê um canal pela metade. Os escritores se
+revezam no spinlock*/
+static struct parametros_pwm config_pwm[NUM_CANAIS_PWM]={[0 ... NUM_CANAIS_PWM-1] = {0,5000,PERCENTUAL_PARA_DUTY_FINO(50),0}};
+static uint32_t seq_config_pwm;
+static int64_t  instante_publicacao_us;     //quando a última configuração foi publicada
+static portMUX_TYPE mux_config_pwm = portMUX_INITIALIZER_UNLOCKED;
+
+//Estado aplicado no hardware. pwm_aplicado é de uso exclusivo da task do PWM e é copiado para
+//estado_publicado (outro seqlock, com a task como único escritor) para os handlers lerem
+static struct pwm_aplicado pwm_aplicado[NUM_CANAIS_PWM];
+static struct {
+    struct parametros_pwm   pedido[NUM_CANAIS_PWM];
+    struct pwm_aplicado     aplicado[NUM_CANAIS_PWM];
+    struct estado_sequencia sequencias[NUM_CANAIS_PWM];
+} estado_publicado;
+static uint32_t seq_estado_publicado;
+
+//Handle da task que aplica a configuração no LEDC
+static TaskHandle_t task_pwm_handle = NULL;
+
+/*Sequenciador. Os programas chegam dos handlers por uma caixa de uma posição (sequencia_recebida, protegida
+pelo spinlock) e são executados pela task do PWM, que é a única que mexe no LEDC. O timer acorda a task no
+prazo do próximo passo: o esp_timer tem resolução de microssegundos, o tick do FreeRTOS é de 10 ms*/
+static struct programa_sequencia sequencia_recebida = {.canal = -1};
+static portMUX_TYPE mux_sequencia = portMUX_INITIALIZER_UNLOCKED;
+static struct execucao_sequencia sequencias[NUM_CANAIS_PWM];
+static esp_timer_handle_t timer_sequencia;
+static uint32_t passos_sequencia;           //passos executados por todos os canais
+static uint32_t sequencias_interrompidas;   //sequências paradas porque a saída não pôde ser aplicada
+
+//Agenda de comandos com hora marcada, em ordem de instante. Os produtores (UDP) inserem e a task do PWM
+//retira, ambos com o spinlock. A janela é o tempo entre a primeira e a última escrita de um lote
+static struct agenda agenda;
+static portMUX_TYPE mux_agenda = portMUX_INITIALIZER_UNLOCKED;
+static portMUX_TYPE mux_lote_ledc = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t comandos_agendados_executados;
+static uint32_t comandos_agendados_recusados;   //não couberam nos timers na hora de aplicar
+static uint32_t atraso_maximo_agenda_us;
+static uint32_t lotes_ledc;
+static uint32_t janela_lote_ultima_ns;
+static uint32_t janela_lote_maxima_ns;
+
+/*Medição das saídas e calibração. Os handlers pedem as medições marcando os canais nas máscaras e a task
+da medição, única que usa o PCNT, guarda os resultados. A tabela de calibração é lida pelo cálculo do timer
+(na task do PWM e nos handlers) e alterada pela task da medição ou pelo DELETE, sempre com o spinlock;
+quem altera avisa a task do PWM por calibracao_alterada para ela reaplicar os canais*/
+static TaskHandle_t task_medicao_handle = NULL;
+static uint32_t medicoes_pedidas;
+static uint32_t calibracoes_pedidas;
+static struct medicao_canal medicoes[NUM_CANAIS_PWM];
+static struct amostra_contagem captura[MEDICAO_AMOSTRAS];  //leituras do contador da última medição
+static int canal_captura = -1;
+static portMUX_TYPE mux_medicao = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t medicoes_feitas;
+static volatile uint32_t estouros_pcnt;
+static struct tabela_calibracao calibracao;
+static portMUX_TYPE mux_calibracao = portMUX_INITIALIZER_UNLOCKED;
+static bool calibracao_alterada;
+
+/*Presets. A tabela é alterada pelos handlers e lida pela task do PWM, as duas com o spinlock. Os pedidos
+de troca chegam por preset_pedido (índice, dos handlers e do UDP) ou passos_preset (próximo/anterior,
+também da interrupção do botão) e só a task do PWM os resolve e escreve preset_atual*/
+static struct preset_pwm presets[PRESET_MAXIMO];
+static portMUX_TYPE mux_presets = portMUX_INITIALIZER_UNLOCKED;
+static int preset_pedido = -1;
+static int passos_preset;
+static uint32_t instante_pedido_preset_us;  //32 bits de baixo do esp_timer_get_time: um store de 64 bits no
+                                            //Xtensa vira uma chamada da libatomic, que não serve na interrupção
+static int preset_atual = -1;
+static uint32_t trocas_preset;
+static uint32_t trocas_preset_recusadas;    //a configuração do preset não coube no hardware na hora de aplicar
+static int64_t ultimo_botao_preset_us;      //só a interrupção do botão usa
+
+/*WebSocket. A lista de assinantes só é alterada na task do server http: no handshake e no envio, que roda
+lá pelo httpd_queue_work e assim nunca disputa o socket com o server. A mensagem é montada pela task do
+WebSocket e não é reescrita enquanto o envio anterior não termina (envio_ws_pendente)*/
+static TaskHandle_t task_ws_handle = NULL;
+static int assinantes_ws[WS_MAX_ASSINANTES];    //fd do socket de cada assinante
+static int num_assinantes_ws;
+static bool assinante_ws_novo;              //a próxima mensagem leva todos os canais
+static char mensagem_ws[JSON_MENSAGEM_WS_TAMANHO];
+static size_t tamanho_mensagem_ws;
+static bool envio_ws_pendente;
+static uint32_t mensagens_ws;               //mensagens montadas, cada uma enviada a todos os assinantes
+static uint32_t quadros_ws;                 //quadros enviados, somando todos os assinantes
+static uint64_t bytes_ws;
+static uint32_t assinantes_ws_removidos;    //conexões fechadas ou que não aceitaram o envio
+
+//Timers de cada grupo (high/low speed) e quantos canais estão usando cada um. Junto com pwm_aplicado e
+//timer_vinculado é a cópia do que está nos registradores, usada para só escrever o que mudou
+static struct timer_pwm timers_pwm[LEDC_SPEED_MODE_MAX][NUM_TIMERS_POR_MODO];
+
+//Timer ao qual o canal está ligado no hardware (o setup_PWM liga todos no timer 0)
+static int8_t timer_vinculado[NUM_CANAIS_PWM];
+
+/*Geradores, só da task do PWM. gerador_ativo é o periférico que está com o pino de cada canal (um canal
+desligado fica com o LEDC parado). O operador do MCPWM e o canal do RMT são ocupados quando o canal liga
+no gerador e devolvidos quando ele desliga ou troca, e a configuração escrita em cada um fica guardada
+para só mexer no periférico quando ela muda*/
+static uint8_t  gerador_ativo[NUM_CANAIS_PWM];
+static int8_t   canal_do_operador_mcpwm[GERADOR_MCPWM_OPERADORES] = {[0 ... GERADOR_MCPWM_OPERADORES-1] = -1};
+static struct config_mcpwm config_operador_mcpwm[GERADOR_MCPWM_OPERADORES];
+static bool     complementar_ativo[NUM_CANAIS_PWM];     //o MCPWM do canal está com o pino do vizinho
+static int8_t   canal_do_rmt[GERADOR_RMT_CANAIS] = {[0 ... GERADOR_RMT_CANAIS-1] = -1};
+static struct config_rmt config_canal_rmt[GERADOR_RMT_CANAIS];
+static uint32_t pulsos_canal_rmt[GERADOR_RMT_CANAIS];
+static uint32_t itens_rmt[GERADOR_RMT_CANAIS][GERADOR_RMT_ITENS_MAXIMOS];  //no formato do rmt_item32_t
+static uint32_t trocas_gerador;             //canais que passaram de um gerador para outro
+static uint32_t escritas_gerador[NUM_GERADORES];    //só MCPWM e RMT, o LEDC tem os contadores dele
+static uint32_t falhas_gerador[NUM_GERADORES];
+
+//Contadores das operações no LEDC, escritos só pela task do PWM
+static uint32_t ops_ledc_aplicadas[NUM_OPS_LEDC];
+static uint32_t ops_ledc_evitadas[NUM_OPS_LEDC];
+static uint32_t ops_ledc_falhas[NUM_OPS_LEDC];
+static const char *nomes_ops_ledc[NUM_OPS_LEDC] = {"timer", "vinculo", "duty", "parada", "rampa"};
+
+//Registro circular das últimas operações no LEDC. Só a task do PWM escreve; a leitura pelo /api/ledc/trace
+//é só para diagnóstico e pode pegar uma entrada sendo sobrescrita
+static struct registro_op_ledc trace_ledc[TRACE_LEDC_TAMANHO];
+static uint32_t trace_ledc_total;           //total de operações registradas desde o boot
+
+//Conexão wireless: falhas seguidas (definem a próxima espera) e quantas vezes o IP foi obtido desde o boot
+static uint32_t tentativas_wifi;
+static uint32_t conexoes_wifi;
+
+//Instantes desde o boot em que as saídas do PWM ficaram válidas e em que o server passou a responder
+static int64_t instante_primeira_saida_us;
+static int64_t instante_servindo_us;
+
+//Pacotes de controle por UDP recebidos, por status da resposta (só a task do UDP escreve)
+static TaskHandle_t task_udp_handle = NULL;
+static uint32_t pacotes_udp[NUM_STATUS_UDP];
+static const char *nomes_status_udp[NUM_STATUS_UDP] = {"ok", "invalido", "fora_da_faixa", "atrasado", "sem_timer",
+                                                        "agenda_cheia"};
+
+//Requisições cujo corpo não chegou dentro do prazo (respondidas com 408), só a task do server escreve
+static uint32_t corpos_expirados;
+
+//Resposta para uma task de envio: o socket e a função que escreve o corpo
+struct envio_http{
+    httpd_handle_t server;
+    int            fd;
+    const char    *tipo;                            //Content-Type
+    void         (*escreve)(struct saida_html *saida);
+    int64_t        inicio_us;                       //quando o handler pôs na fila
+};
+
+//Onde a saída de uma task de envio escreve: a task ('slot' em envios_em_curso) e até quando ela espera
+struct escrita_http{
+    httpd_handle_t server;
+    int            slot;
+    int64_t        prazo_us;
+};
+
+enum resultado_envio_http{
+    ENVIO_HTTP_ENVIADO,
+    ENVIO_HTTP_FILA_CHEIA,
+    ENVIO_HTTP_FALHOU,                              //o prazo venceu ou o socket foi fechado no meio
+    NUM_RESULTADOS_ENVIO_HTTP
+};
+
+//Fila das tasks de envio e o socket que cada uma está escrevendo (-1 nenhum), tudo com o mutex. O
+//fecha_socket_http também o pega: um socket nunca é fechado, e o número reaproveitado por outra conexão,
+//no meio de uma escrita
+static struct envio_http fila_envios_http[HTTP_FILA_ENVIOS];
+static int inicio_fila_envios_http;
+static int num_envios_http;
+static struct {
+    int  fd;
+    bool fechado;                                   //o httpd fechou o socket, o resto da resposta é descartado
+} envios_em_curso[HTTP_TASKS_ENVIO];
+static SemaphoreHandle_t mutex_envios_http;
+static StaticSemaphore_t buffer_mutex_envios_http;
+static TaskHandle_t tasks_envio_http[HTTP_TASKS_ENVIO];
+static TaskHandle_t task_server_http;               //a pilha dela vai no /metrics, montado numa task de envio
+static uint32_t envios_http[NUM_RESULTADOS_ENVIO_HTTP];
+static const char *nomes_envios_http[NUM_RESULTADOS_ENVIO_HTTP] = {"enviado", "fila_cheia", "falha"};
+
+//Canais que a task do PWM desistiu de aplicar (nenhum timer livre mesmo depois das outras trocas)
+static uint32_t canais_nao_aplicados;
+
+//Histogramas de latência de cada core
+static struct histograma_latencia histogramas[portNUM_PROCESSORS][NUM_METRICAS_LATENCIA];
+
+//Nome e rótulos de cada histograma no /metrics. Os de uma mesma família ficam em sequência
+static const struct nome_metrica metricas_latencia[NUM_METRICAS_LATENCIA] = {
+    [MET_GET_PAGINA]           = {"pwm_http_requisicao_segundos", "uri=\"/\",metodo=\"GET\""},
+    [MET_GET_CSS]              = {"pwm_http_requisicao_segundos", "uri=\"/style.css\",metodo=\"GET\""},
+    [MET_GET_JS]               = {"pwm_http_requisicao_segundos", "uri=\"/app.js\",metodo=\"GET\""},
+    [MET_POST_FORMULARIO]      = {"pwm_http_requisicao_segundos", "uri=\"/\",metodo=\"POST\""},
+    [MET_GET_API_PWM]          = {"pwm_http_requisicao_segundos", "uri=\"/api/pwm\",metodo=\"GET\""},
+    [MET_PUT_API_PWM]          = {"pwm_http_requisicao_segundos", "uri=\"/api/pwm\",metodo=\"PUT\""},
+    [MET_GET_API_LEDC]         = {"pwm_http_requisicao_segundos", "uri=\"/api/ledc\",metodo=\"GET\""},
+    [MET_GET_API_LEDC_TRACE]   = {"pwm_http_requisicao_segundos", "uri=\"/api/ledc/trace\",metodo=\"GET\""},
+    [MET_GET_METRICS]          = {"pwm_http_requisicao_segundos", "uri=\"/metrics\",metodo=\"GET\""},
+    [MET_PUT_API_LOG]          = {"pwm_http_requisicao_segundos", "uri=\"/api/log\",metodo=\"PUT\""},
+    [MET_GET_API_SEQ]          = {"pwm_http_requisicao_segundos", "uri=\"/api/seq\",metodo=\"GET\""},
+    [MET_PUT_API_SEQ]          = {"pwm_http_requisicao_segundos", "uri=\"/api/seq\",metodo=\"PUT\""},
+    [MET_DELETE_API_SEQ]       = {"pwm_http_requisicao_segundos", "uri=\"/api/seq\",metodo=\"DELETE\""},
+    [MET_GET_API_AGENDA]       = {"pwm_http_requisicao_segundos", "uri=\"/api/agenda\",metodo=\"GET\""},
+    [MET_GET_API_MEDICAO]      = {"pwm_http_requisicao_segundos", "uri=\"/api/medicao\",metodo=\"GET\""},
+    [MET_PUT_API_MEDICAO]      = {"pwm_http_requisicao_segundos", "uri=\"/api/medicao\",metodo=\"PUT\""},
+    [MET_DELETE_API_MEDICAO]   = {"pwm_http_requisicao_segundos", "uri=\"/api/medicao\",metodo=\"DELETE\""},
+    [MET_GET_API_PRESET]       = {"pwm_http_requisicao_segundos", "uri=\"/api/preset\",metodo=\"GET\""},
+    [MET_PUT_API_PRESET]       = {"pwm_http_requisicao_segundos", "uri=\"/api/preset\",metodo=\"PUT\""},
+    [MET_POST_API_PRESET]      = {"pwm_http_requisicao_segundos", "uri=\"/api/preset\",metodo=\"POST\""},
+    [MET_DELETE_API_PRESET]    = {"pwm_http_requisicao_segundos", "uri=\"/api/preset\",metodo=\"DELETE\""},
+    [MET_GET_WS]               = {"pwm_http_requisicao_segundos", "uri=\"/ws\",metodo=\"GET\""},
+    [MET_FASE_PARSE]           = {"pwm_fase_segundos", "fase=\"parse\""},
+    [MET_FASE_APLICACAO]       = {"pwm_fase_segundos", "fase=\"aplicacao\""},
+    [MET_PUBLICACAO_APLICACAO] = {"pwm_publicacao_ate_aplicacao_segundos", ""},
+    [MET_UDP_COMANDO]          = {"pwm_udp_comando_segundos", ""},
+    [MET_SEQUENCIA_ATRASO]     = {"pwm_sequencia_atraso_segundos", ""},
+    [MET_AGENDA_ATRASO]        = {"pwm_agenda_atraso_segundos", ""},
+    [MET_PRESET_TROCA]         = {"pwm_preset_troca_segundos", ""},
+    [MET_WS_ENVIO]             = {"pwm_ws_envio_segundos", ""},
+    [MET_HTTP_ENVIO]           = {"pwm_http_envio_segundos", ""},
+};
+
+//Tasks com a menor folga da pilha informada no /metrics (a do server http é guardada pelo handler do /metrics)
+static TaskHandle_t tasks_monitoradas[NUM_TASKS_MONITORADAS];
+static int num_tasks_monitoradas;
+
+//Pilhas e controles das tasks do projeto, no .bss: criar uma task não depende do heap e o que elas
+//ocupam aparece no link (no ESP-IDF a pilha é contada em bytes)
+static StackType_t  pilha_task_pwm[TASK_PWM_STACK];
+static StaticTask_t tcb_task_pwm;
+static StackType_t  pilha_task_nvs[TASK_NVS_STACK];
+static StaticTask_t tcb_task_nvs;
+static StackType_t  pilha_task_udp[TASK_UDP_STACK];
+static StaticTask_t tcb_task_udp;
+static StackType_t  pilha_task_medicao[TASK_MEDICAO_STACK];
+static StaticTask_t tcb_task_medicao;
+static StackType_t  pilha_task_ws[TASK_WS_STACK];
+static StaticTask_t tcb_task_ws;
+static StackType_t  pilhas_tasks_envio_http[HTTP_TASKS_ENVIO][TASK_ENVIO_HTTP_STACK];
+static StaticTask_t tcbs_tasks_envio_http[HTTP_TASKS_ENVIO];
+
+//Heap que o httpd_start alocou (pilha da task do server, sockets e tabela de URIs), medido na primeira vez
+static uint32_t heap_httpd;
+
+//Nível de log atual da TAG, na ordem do esp_log_level_t
+static esp_log_level_t nivel_log = ESP_LOG_INFO;
+static const char *nomes_niveis_log[] = {"nenhum", "erro", "aviso", "info", "debug", "verbose"};
+
+//Gravações da configuração na NVS, feitas só pela task da NVS. As da última hora ficam em 60 contadores
+//(um por minuto) para o /metrics
+static TaskHandle_t task_nvs_handle = NULL;
+static uint32_t geracao_config_salva;
+static uint32_t gravacoes_nvs;
+static uint32_t gravacoes_nvs_evitadas;     //a configuração voltou ao que já estava salvo
+static uint32_t falhas_nvs;
+static struct gravacoes_por_minuto gravacoes_nvs_por_minuto;
+
+//Arquivos da página servidos pelo arquivo_estatico_get_handler
+static const struct arquivo_estatico arquivos_estaticos[] = {
+    {"/",          "text/html",              index_html_gz_inicio, index_html_gz_fim, PAGINA_ETAG_INDEX_HTML},
+    {"/style.css", "text/css",               style_css_gz_inicio,  style_css_gz_fim,  PAGINA_ETAG_STYLE_CSS},
+    {"/app.js",    "application/javascript", app_js_gz_inicio,     app_js_gz_fim,     PAGINA_ETAG_APP_JS},
+};
+#define NUM_ARQUIVOS_ESTATICOS ((int)(sizeof(arquivos_estaticos) / sizeof(arquivos_estaticos[0])))
+
+//Limites do .data e do .bss na DRAM, definidos pelo linker script do ESP-IDF
+extern int _data_start, _data_end, _bss_start, _bss_end;
+
+//Maiores áreas estáticas do projeto, no relatório do boot e no /metrics
+static const struct {
+    const char *nome;
+    size_t      bytes;
+} areas_memoria[] = {
+    {"pilhas_tasks", sizeof(pilha_task_pwm) + sizeof(pilha_task_nvs) + sizeof(pilha_task_udp) +
+                     sizeof(pilha_task_medicao) + sizeof(pilha_task_ws) + sizeof(pilhas_tasks_envio_http)},
+    {"controles_tasks", sizeof(tcb_task_pwm) + sizeof(tcb_task_nvs) + sizeof(tcb_task_udp) +
+                        sizeof(tcb_task_medicao) + sizeof(tcb_task_ws) + sizeof(tcbs_tasks_envio_http)},
+    {"canais", sizeof(config_pwm) + sizeof(pwm_aplicado) + sizeof(estado_publicado)},
+    {"sequencias", sizeof(sequencias) + sizeof(sequencia_recebida)},
+    {"agenda", sizeof(agenda)},
+    {"medicao", sizeof(medicoes) + sizeof(captura) + sizeof(calibracao)},
+    {"presets", sizeof(presets)},
+    {"websocket", sizeof(mensagem_ws) + sizeof(assinantes_ws)},
+    {"geradores", sizeof(itens_rmt) + sizeof(config_canal_rmt) + sizeof(config_operador_mcpwm)},
+    {"trace_ledc", sizeof(trace_ledc)},
+    {"histogramas", sizeof(histogramas)},
+};
+#define NUM_AREAS_MEMORIA ((int)(sizeof(areas_memoria) / sizeof(areas_memoria[0])))
+
+//Capacidades que dependem umas das outras, conferidas na compilação em vez de descobertas em campo
+_Static_assert(NUM_CANAIS_PWM <= 32, "as máscaras de canais são de 32 bits");
+_Static_assert(HTTP_MAX_SOCKETS + 3 + 1 <= CONFIG_LWIP_MAX_SOCKETS,
+               "o server usa 3 sockets internos e o UDP usa 1 além de HTTP_MAX_SOCKETS");
+_Static_assert(WS_MAX_ASSINANTES < HTTP_MAX_SOCKETS, "os assinantes do /ws não podem ocupar todos os sockets");
+_Static_assert(GERADOR_RMT_CANAIS <= RMT_CHANNEL_MAX && GERADOR_MCPWM_OPERADORES == 3 * MCPWM_UNIT_MAX,
+               "os geradores não batem com o hardware");
+//o pedido copiado pelo handler, a proposta do publica_config_pwm, o buffer da resposta e o JSON de um
+//canal ocupam no máximo metade da pilha do server; a outra metade fica para o httpd e o log
+_Static_assert(2 * sizeof(struct parametros_pwm[NUM_CANAIS_PWM]) + sizeof(struct saida_html) +
+               JSON_CANAL_TAMANHO <= HTTP_STACK / 2, "aumente HTTP_STACK");
+//o mesmo nas tasks de envio, com a maior resposta que elas montam: a cópia das medições para o /api/medicao
+_Static_assert(sizeof(struct medicao_canal[NUM_CANAIS_PWM]) + sizeof(struct amostra_contagem[MEDICAO_AMOSTRAS]) +
+               sizeof(struct tabela_calibracao) + sizeof(struct saida_html) <= TASK_ENVIO_HTTP_STACK / 2,
+               "aumente TASK_ENVIO_HTTP_STACK");
 
 
 
@@ -67,66 +690,526 @@ static void setup_PWM();     //Realiza as configurações iniciais do PWM.
 
 static void setup_nvs();     //Inicia a memória nvs. Ela é necessária para se conectar à rede Wireless
 
-void wifi_init_sta(); //Configura a rede wireless
+void wifi_init_sta(); //Configura a rede wireless e começa a conexão, sem esperar por ela
 
-/* Lida com os Eventos da rede Wireless(reconexão, IPs, etc), essa função é ativada durante a chamada de 
- * void wifi_init_sta() e permanece monitorando os eventos de rede e imprimindo no terminal
- * as tentativas de conexão e o endereço IP recebido que o ESP ganhou*/
+/* Lida com os Eventos da rede Wireless(reconexão, IPs, etc), essa função é registrada por
+ * void wifi_init_sta() e permanece monitorando os eventos de rede: agenda as novas tentativas de
+ * conexão, inicia o server quando o ESP ganha um IP e o para quando o IP é perdido*/
 static void event_handler(void* arg, esp_event_base_t event_base,
                                 int32_t event_id, void* event_data);
 
-//static void atualiza_PWM(struct parametros_PWM pwm); //Atualiza os valores de resolução do duty, frequencia e duty cicle
+//Callback do timer de reconexão: faz a próxima tentativa de conexão
+static void reconecta_wifi(void *arg);
 
-static int calc_resolucao_duty(long double pwm_freq,long double timer_clk_freq);
+//static void atualiza_PWM(struct parametros_PWM pwm); //Atualiza os valores de resolução do duty, frequencia e duty cicle
 
 //Cria o Server, Faz as configurações Padrão e Inicia os URI Handlers para os GETs
 static httpd_handle_t start_webserver(void);
 
-//Imprimimos a Webpage
-static void print_webpage(httpd_req_t *req,struct parametros_pwm *pwm);
+//Põe a resposta na fila das tasks de envio, que escrevem o corpo com 'escreve'. Responde 503 se a fila está cheia
+static esp_err_t responde_por_task_envio(httpd_req_t *req, const char *tipo, void (*escreve)(struct saida_html *saida));
+
+//Task que monta e escreve no socket as respostas grandes, sem segurar a task do server
+static void task_envio_http(void *pvParameter);
+
+//Chamado pela task de envio: tira o primeiro envio da fila e ocupa 'slot' com o socket dele
+static bool retira_envio_http(int slot, struct envio_http *envio);
 
-//handler do Get da Página Principal
-static esp_err_t main_page_get_handler(httpd_req_t *req);
+//Escreve tudo no socket da task de envio sem bloquear, esperando um tick quando o buffer está cheio.
+//Retorna erro se o socket foi fechado ou o prazo venceu
+static int escreve_socket_http(struct escrita_http *escrita, const char *dados, size_t tamanho);
+
+//Função de envio da saida_html nas tasks de envio: manda um chunk http, já com o tamanho em hexa
+static int envia_chunk_socket(void *escrita, const char *dados, size_t tamanho);
+
+//close_fn do server: fecha o socket, descartando o envio dele que estiver na fila ou sendo escrito
+static void fecha_socket_http(httpd_handle_t hd, int fd);
+
+//handler do GET da página e dos seus arquivos: envia o gzip embutido ou 304 se o navegador já o tem
+static esp_err_t arquivo_estatico_get_handler(httpd_req_t *req);
 
 //handler do formulário html do pwm0
 static esp_err_t pwm_post_handler(httpd_req_t *req);
 
-static void processa_post_request(struct parametros_pwm *pwm,char *content);
+//httpd_req_recv() que desiste com HTTPD_SOCK_ERR_TIMEOUT quando passa do instante 'prazo_us'
+static int recebe_com_prazo(httpd_req_t *req, char *buffer, size_t tamanho, int64_t prazo_us);
+
+//Aplica os parâmetros no canal, retorna erro se não existir timer livre para a frequência pedida.
+//Só deve ser chamada pela task do PWM
+static esp_err_t atualiza_PWM(int pwm_index,const struct parametros_pwm *parametros, uint32_t rampa_ms,
+                              struct lote_ledc *lote);
+
+//Faz as escritas juntadas no lote de uma vez, com as interrupções desligadas e a partir do instante do
+//lote, e devolve a janela em ns
+static uint32_t aplica_lote_ledc(struct lote_ledc *lote);
+
+//timer_pwm_calcula com o clock corrigido pela tabela de calibração da faixa da frequência
+static esp_err_t calcula_timer_calibrado(uint32_t frequencia, struct config_timer_pwm *timer);
+
+//Calcula os valores que o hardware terá com esses parâmetros (menos o timer, que depende do alocador)
+static esp_err_t calcula_pwm_aplicado(const struct parametros_pwm *parametros, struct pwm_aplicado *aplicado);
+
+//O mesmo cálculo no gerador do canal (ver geradores_pwm)
+static esp_err_t calcula_saida(const struct parametros_pwm *parametros, struct pwm_aplicado *aplicado);
+
+//Troca o gerador do canal se preciso e aplica os parâmetros nele. Só deve ser chamada pela task do PWM
+static esp_err_t atualiza_saida(int pwm_index, const struct parametros_pwm *parametros, uint32_t rampa_ms,
+                                struct lote_ledc *lote);
+
+//Para o canal do LEDC fora do lote e libera o timer, antes do pino ir para outro gerador
+static void libera_saida_ledc(int pwm_index);
+
+//Gerador MCPWM: contas, aplicação num operador livre (ou no que o canal já usa) e liberação
+static esp_err_t calcula_saida_mcpwm(const struct parametros_pwm *parametros, struct pwm_aplicado *aplicado);
+static esp_err_t atualiza_saida_mcpwm(int pwm_index, const struct parametros_pwm *parametros, uint32_t rampa_ms,
+                                      struct lote_ledc *lote);
+static void libera_saida_mcpwm(int pwm_index);
+
+//Gerador RMT: contas, aplicação num canal livre do RMT (ou no que o canal já usa) e liberação
+static esp_err_t calcula_saida_rmt(const struct parametros_pwm *parametros, struct pwm_aplicado *aplicado);
+static esp_err_t atualiza_saida_rmt(int pwm_index, const struct parametros_pwm *parametros, uint32_t rampa_ms,
+                                    struct lote_ledc *lote);
+static void libera_saida_rmt(int pwm_index);
+
+//Devolve o pino do canal ao LEDC (parado), a não ser que ele seja a saída complementar do vizinho
+static void devolve_pino_ledc(int pwm_index);
+
+//Conta uma escrita no MCPWM ou no RMT como feita ou falha e devolve o erro
+static esp_err_t conta_escrita_gerador(enum gerador gerador, esp_err_t erro);
+
+//Frequência que o gerador do canal deveria gerar, em mHz (no LEDC, já com a calibração)
+static esp_err_t calcula_frequencia_prevista(const struct parametros_pwm *parametros, uint64_t *frequencia_mhz);
+
+//Confere as faixas de todos os campos e se o gerador consegue gerar a frequência com esse duty
+static bool parametros_validos(const struct parametros_pwm *parametros);
+
+//Publica a configuração dos canais marcados em 'mascara' para a task do PWM aplicar. Retorna
+//ESP_ERR_NOT_FOUND se a configuração resultante não couber no hardware (config_cabe_no_hardware)
+static esp_err_t publica_config_pwm(uint32_t mascara, const struct parametros_pwm *novos);
+
+//Copia a configuração pedida mais recente, sem travar quem escreve
+static void le_config_pwm(struct parametros_pwm *destino);
+
+//Copia o estado aplicado mais recente (pedido e valores do hardware de cada canal)
+static void le_estado_publicado(struct parametros_pwm *pedido, struct pwm_aplicado *aplicado);
+
+//Verifica se os canais ligados cabem no hardware: as frequências do LEDC nos 4 timers de cada grupo, os
+//operadores do MCPWM, os canais do RMT e os pinos das saídas complementares
+static bool config_cabe_no_hardware(const struct parametros_pwm *config);
+
+//Task que espera novas configurações e as aplica no LEDC
+static void task_pwm(void *pvParameter);
+
+//Task que grava na NVS a configuração publicada, juntando as alterações próximas numa gravação só
+static void task_nvs(void *pvParameter);
+
+//Entrega um programa (ou num_passos 0 para parar) para a task do PWM executar no canal
+static esp_err_t entrega_programa_sequencia(int canal, const struct passo_sequencia *passos, int num_passos);
+
+//Chamado pela task do PWM: começa o programa que estiver esperando na caixa, se houver
+static void recebe_programa_sequencia(void);
 
-static void atualiza_PWM(int pwm_index,uint32_t frequencia, uint32_t percentual_duty);
+//Chamado pela task do PWM: executa os passos vencidos e devolve os canais que estão com a sequência.
+//Em 'vencidos' ficam os canais que tiveram um passo executado agora
+static uint32_t executa_sequencias(int64_t agora_us, uint32_t *vencidos);
 
-static void cria_delay(void *pvParameter);
+//Prazo do próximo passo (ou fim de rampa) de todas as sequências, INT64_MAX se nenhuma está rodando
+static int64_t proximo_prazo_sequencias(void);
+
+//Callback do timer do sequenciador: acorda a task do PWM
+static void acorda_task_pwm(void *arg);
+
+//Lê a situação das sequências publicada pela task do PWM
+static void le_estado_sequencias(struct estado_sequencia *destino);
+
+//handlers do /api/seq: situação das sequências, envio de um programa e parada
+static esp_err_t api_seq_get_handler(httpd_req_t *req);
+static esp_err_t api_seq_put_handler(httpd_req_t *req);
+static esp_err_t api_seq_delete_handler(httpd_req_t *req);
+
+//Põe um comando na agenda, em ordem de instante, e acorda a task do PWM
+static esp_err_t agenda_comando(const struct comando_agendado *comando);
+
+//Chamado pela task do PWM: tira da agenda o primeiro comando se o instante dele é até limite_us
+static bool retira_comando_agendado(int64_t limite_us, struct comando_agendado *comando);
+
+//Instante do primeiro comando da agenda, INT64_MAX se ela está vazia
+static int64_t proximo_comando_agendado(void);
+
+//handler do GET /api/agenda: relógio do ESP32, comandos esperando e a precisão dos lotes
+static esp_err_t api_agenda_get_handler(httpd_req_t *req);
+
+//Task que mede as saídas pedidas pelo PUT /api/medicao e, se pedido, atualiza a tabela de calibração
+static void task_medicao(void *pvParameter);
+
+//Mede a frequência e o duty do canal pelo loopback no PCNT. Retorna erro se o canal está desligado
+static esp_err_t mede_canal(int pwm_index, struct medicao_canal *medicao, struct amostra_contagem *amostras);
+
+//Lê o contador de pulsos junto com os estouros contados pela interrupção e o instante da leitura. A leitura
+//anterior da mesma medição (pulsos negativos na primeira) resolve um estouro que a interrupção ainda não contou
+static void le_contagem_pcnt(struct amostra_contagem *amostra, int64_t pulsos_anteriores);
+
+//Interrupção do PCNT: o contador chegou no limite e voltou a zero
+static void conta_estouro_pcnt(void *arg);
+
+//handlers do /api/medicao: resultados e tabela, pedido de medição e limpeza da calibração
+static esp_err_t api_medicao_get_handler(httpd_req_t *req);
+static void escreve_medicao(struct saida_html *saida);
+static esp_err_t api_medicao_put_handler(httpd_req_t *req);
+static esp_err_t api_medicao_delete_handler(httpd_req_t *req);
+
+//Lê a tabela de calibração salva na NVS, retorna erro (e não altera 'destino') se não houver uma válida
+static esp_err_t carrega_calibracao(struct tabela_calibracao *destino);
+
+//Grava a tabela de calibração na NVS
+static esp_err_t grava_calibracao(const struct tabela_calibracao *tabela);
+
+//Pede a troca para o preset 'indice', que a task do PWM faz na próxima passada. ESP_ERR_NOT_FOUND se ele está vazio
+static esp_err_t pede_preset(int indice);
+
+//Pede para andar 'passo' presets ocupados a partir do atual (1 próximo, -1 anterior)
+static esp_err_t pede_preset_vizinho(int passo);
+
+//O mesmo pedido, feito de dentro de uma interrupção: só soma o passo e acorda a task do PWM
+static void pede_preset_vizinho_isr(int passo);
+
+//Interrupção dos botões de próximo/anterior, com o passo no argumento
+static void botao_preset_isr(void *arg);
+
+//Configura os pinos dos botões de troca de preset
+static void setup_botoes_preset(void);
+
+//Chamado pela task do PWM: resolve o pedido de troca pendente, copia os canais do preset escolhido e devolve
+//o índice dele, -1 se não há troca
+static int recebe_troca_preset(struct parametros_pwm *canais, uint32_t *instante_pedido_us);
+
+//Guarda os canais como o preset 'indice' na RAM e na NVS
+static esp_err_t salva_preset(int indice, const char *nome, const struct parametros_pwm *canais);
+
+//Apaga o preset 'indice' da RAM e da NVS
+static esp_err_t apaga_preset(int indice);
+
+//Lê os presets salvos na NVS para a RAM, ignorando os inválidos
+static void carrega_presets(void);
+
+//handlers do /api/preset: lista, salvar a configuração atual, aplicar e apagar
+static esp_err_t api_preset_get_handler(httpd_req_t *req);
+static esp_err_t api_preset_put_handler(httpd_req_t *req);
+static esp_err_t api_preset_post_handler(httpd_req_t *req);
+static esp_err_t api_preset_delete_handler(httpd_req_t *req);
+
+//handler do /ws: o handshake inscreve a conexão para receber o estado dos canais
+static esp_err_t ws_handler(httpd_req_t *req);
+
+//Task que junta as mudanças do estado aplicado e monta a mensagem do WebSocket
+static void task_ws(void *pvParameter);
+
+//Envia a mensagem do WebSocket para todos os assinantes, executada na task do server http
+static void envia_mensagem_ws(void *arg);
+
+//Task que recebe os pacotes de controle por UDP e responde cada um
+static void task_udp(void *pvParameter);
+
+//Valida e publica (ou agenda) um pacote de controle, preenchendo a resposta. Devolve o tamanho da resposta
+static size_t processa_pacote_udp(const uint8_t *pacote, size_t tamanho, int64_t chegada_us,
+                                  uint32_t *ultima_sequencia, struct udp_resposta_agendada *resposta);
+
+//Lê a configuração salva na NVS, retorna erro (e não altera 'destino') se não houver uma válida
+static esp_err_t carrega_config_salva(struct parametros_pwm *destino);
+
+//Grava a configuração na NVS com a próxima geração e o CRC
+static esp_err_t grava_config_salva(const struct parametros_pwm *config);
+
+//CRC do blob, sem o próprio campo do CRC
+static uint32_t crc_config_salva(const struct config_salva *blob);
+
+//Quantas gravações na NVS houve nos últimos 60 minutos
+static uint32_t gravacoes_nvs_ultima_hora(void);
+
+//Escolhe o timer para o canal: reaproveita um timer com a mesma frequência ou ocupa um livre
+static esp_err_t aloca_timer_pwm(int pwm_index, uint32_t frequencia, const struct config_timer_pwm *config, int *timer);
+
+//Libera o timer usado pelo canal, se houver
+static void libera_timer_pwm(int pwm_index);
+
+//Conta uma operação no LEDC como aplicada (ou falha, se erro != ESP_OK), guarda no registro circular com
+//o instante e devolve o erro
+static esp_err_t conta_op_ledc(enum op_ledc op, ledc_mode_t modo, int indice, uint32_t valor, esp_err_t erro);
+
+//handler do GET /api/ledc/trace: últimas operações no LEDC com o instante de cada uma
+static esp_err_t api_ledc_trace_get_handler(httpd_req_t *req);
+
+//handler do GET /api/ledc: contadores de operações aplicadas, evitadas e com falha no LEDC
+static esp_err_t api_ledc_get_handler(httpd_req_t *req);
+
+//Chama o handler http guardado no user_ctx da URI e registra a latência dele
+static esp_err_t executa_handler_medido(httpd_req_t *req);
+
+//Conta uma duração no histograma da métrica, no core atual
+static void registra_latencia(enum metrica_latencia metrica, int64_t duracao_us);
+
+//Inclui a task na lista das que têm a folga da pilha informada no /metrics
+static void monitora_task(TaskHandle_t handle);
+
+//Cria a task com a pilha e o controle estáticos dados e a inclui no /metrics
+static TaskHandle_t cria_task(TaskFunction_t funcao, const char *nome, StackType_t *pilha, uint32_t tamanho,
+                              StaticTask_t *tcb, UBaseType_t prioridade, BaseType_t core);
+
+//Imprime no log a memória estática do projeto, as pilhas e o heap depois do boot
+static void relata_memoria(void);
+
+//handler do GET /metrics: latências, operações no LEDC, heap e pilhas no formato texto do Prometheus
+static esp_err_t metrics_get_handler(httpd_req_t *req);
+static void escreve_metricas(struct saida_html *saida);
+
+//handler do PUT /api/log?nivel=...: troca o nível de log sem regravar o firmware
+static esp_err_t api_log_put_handler(httpd_req_t *req);
+
+//Grupo (high/low speed) e número do canal do LEDC a partir do índice geral do canal
+static inline ledc_mode_t modo_do_canal(int pwm_index) { return (pwm_index < NUM_CANAIS_POR_MODO) ? LEDC_HIGH_SPEED_MODE : LEDC_LOW_SPEED_MODE; }
+static inline ledc_channel_t canal_ledc(int pwm_index) { return (ledc_channel_t)(pwm_index % NUM_CANAIS_POR_MODO); }
+
+//handler do GET da API REST: /api/pwm (todos os canais) ou /api/pwm/{n}
+static esp_err_t api_pwm_get_handler(httpd_req_t *req);
+
+//handler do PUT da API REST: /api/pwm/{n} com um JSON contendo os campos a alterar
+static esp_err_t api_pwm_put_handler(httpd_req_t *req);
+
+//Retorna o índice do canal da URI /api/pwm/{n}, -1 para /api/pwm e -2 se a URI for inválida
+static int api_indice_canal(const char *uri, const char *prefixo);
+
+
+//Geradores na ordem do enum gerador
+static const struct gerador_pwm geradores_pwm[NUM_GERADORES] = {
+    [GERADOR_LEDC]  = {calcula_pwm_aplicado, atualiza_PWM,         libera_saida_ledc},
+    [GERADOR_MCPWM] = {calcula_saida_mcpwm,  atualiza_saida_mcpwm, libera_saida_mcpwm},
+    [GERADOR_RMT]   = {calcula_saida_rmt,    atualiza_saida_rmt,   libera_saida_rmt},
+};
 
 
 /*--------------------------------------Declaração dos GETs do http------------------------------------------*/
+//Todas as URIs passam pelo executa_handler_medido, que mede a latência do handler guardado no user_ctx
+#define URI_MEDIDA(h, m) ((void *)&(const struct handler_medido){ .handler = (h), .metrica = (m) })
+
 //a declaração do GET da página Principal
 static const httpd_uri_t main_page = {
     .uri       = "/",
     .method    = HTTP_GET,
-    .handler   = main_page_get_handler,
-    .user_ctx  = NULL
+    .handler   = executa_handler_medido,
+    .user_ctx  = URI_MEDIDA(arquivo_estatico_get_handler, MET_GET_PAGINA)
+};
+
+//a folha de estilo e o script da página
+static const httpd_uri_t style_css = {
+    .uri       = "/style.css",
+    .method    = HTTP_GET,
+    .handler   = executa_handler_medido,
+    .user_ctx  = URI_MEDIDA(arquivo_estatico_get_handler, MET_GET_CSS)
+};
+
+static const httpd_uri_t app_js = {
+    .uri       = "/app.js",
+    .method    = HTTP_GET,
+    .handler   = executa_handler_medido,
+    .user_ctx  = URI_MEDIDA(arquivo_estatico_get_handler, MET_GET_JS)
 };
 
 // URI handler do formulário do pwm0 
 static const httpd_uri_t post_pwm = {
     .uri      = "/",
     .method   = HTTP_POST,
-    .handler  = pwm_post_handler,
-    .user_ctx = NULL
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(pwm_post_handler, MET_POST_FORMULARIO)
+};
+
+// URI handler da leitura dos canais pela API REST
+static const httpd_uri_t api_pwm_get = {
+    .uri      = "/api/pwm*",
+    .method   = HTTP_GET,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_pwm_get_handler, MET_GET_API_PWM)
+};
+
+// URI handler dos contadores de operações no LEDC
+static const httpd_uri_t api_ledc_get = {
+    .uri      = "/api/ledc",
+    .method   = HTTP_GET,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_ledc_get_handler, MET_GET_API_LEDC)
+};
+
+// URI handler do registro das últimas operações no LEDC
+static const httpd_uri_t api_ledc_trace_get = {
+    .uri      = "/api/ledc/trace",
+    .method   = HTTP_GET,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_ledc_trace_get_handler, MET_GET_API_LEDC_TRACE)
+};
+
+// URI handler da alteração de um canal pela API REST
+static const httpd_uri_t api_pwm_put = {
+    .uri      = "/api/pwm/*",
+    .method   = HTTP_PUT,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_pwm_put_handler, MET_PUT_API_PWM)
+};
+
+// URI handler das métricas (Prometheus)
+static const httpd_uri_t metrics_get = {
+    .uri      = "/metrics",
+    .method   = HTTP_GET,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(metrics_get_handler, MET_GET_METRICS)
+};
+
+// URI handler da troca do nível de log
+static const httpd_uri_t api_log_put = {
+    .uri      = "/api/log",
+    .method   = HTTP_PUT,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_log_put_handler, MET_PUT_API_LOG)
+};
+
+
+// URI handlers do sequenciador
+static const httpd_uri_t api_seq_get = {
+    .uri      = "/api/seq*",
+    .method   = HTTP_GET,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_seq_get_handler, MET_GET_API_SEQ)
+};
+
+static const httpd_uri_t api_seq_put = {
+    .uri      = "/api/seq/*",
+    .method   = HTTP_PUT,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_seq_put_handler, MET_PUT_API_SEQ)
+};
+
+static const httpd_uri_t api_seq_delete = {
+    .uri      = "/api/seq/*",
+    .method   = HTTP_DELETE,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_seq_delete_handler, MET_DELETE_API_SEQ)
+};
+
+
+// URI handler da agenda de comandos
+static const httpd_uri_t api_agenda_get = {
+    .uri      = "/api/agenda",
+    .method   = HTTP_GET,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_agenda_get_handler, MET_GET_API_AGENDA)
+};
+
+
+
+// URI handlers da medição das saídas e da calibração
+static const httpd_uri_t api_medicao_get = {
+    .uri      = "/api/medicao",
+    .method   = HTTP_GET,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_medicao_get_handler, MET_GET_API_MEDICAO)
+};
+
+static const httpd_uri_t api_medicao_put = {
+    .uri      = "/api/medicao*",
+    .method   = HTTP_PUT,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_medicao_put_handler, MET_PUT_API_MEDICAO)
+};
+
+static const httpd_uri_t api_medicao_delete = {
+    .uri      = "/api/medicao",
+    .method   = HTTP_DELETE,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_medicao_delete_handler, MET_DELETE_API_MEDICAO)
+};
+
+
+// URI handlers dos presets
+static const httpd_uri_t api_preset_get = {
+    .uri      = "/api/preset",
+    .method   = HTTP_GET,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_preset_get_handler, MET_GET_API_PRESET)
+};
+
+static const httpd_uri_t api_preset_put = {
+    .uri      = "/api/preset/*",
+    .method   = HTTP_PUT,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_preset_put_handler, MET_PUT_API_PRESET)
+};
+
+static const httpd_uri_t api_preset_post = {
+    .uri      = "/api/preset*",
+    .method   = HTTP_POST,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_preset_post_handler, MET_POST_API_PRESET)
+};
+
+static const httpd_uri_t api_preset_delete = {
+    .uri      = "/api/preset/*",
+    .method   = HTTP_DELETE,
+    .handler  = executa_handler_medido,
+    .user_ctx = URI_MEDIDA(api_preset_delete_handler, MET_DELETE_API_PRESET)
+};
+
+
+// URI handler do WebSocket com o estado dos canais
+static const httpd_uri_t ws_estado = {
+    .uri          = "/ws",
+    .method       = HTTP_GET,
+    .handler      = executa_handler_medido,
+    .user_ctx     = URI_MEDIDA(ws_handler, MET_GET_WS),
+    .is_websocket = true
+};
+
+
+//Todas as URIs, na ordem em que são registradas no server
+static const httpd_uri_t *const uris_http[] = {
+    &main_page, &style_css, &app_js, &post_pwm, &api_pwm_get, &api_pwm_put, &api_ledc_get, &api_ledc_trace_get,
+    &metrics_get, &api_log_put, &api_seq_get, &api_seq_put, &api_seq_delete, &api_agenda_get, &api_medicao_get,
+    &api_medicao_put, &api_medicao_delete, &api_preset_get, &api_preset_put, &api_preset_post, &api_preset_delete,
+    &ws_estado,
 };
+#define NUM_URIS_HTTP ((int)(sizeof(uris_http) / sizeof(uris_http[0])))
+_Static_assert(NUM_URIS_HTTP <= HTTP_MAX_URI_HANDLERS, "aumente HTTP_MAX_URI_HANDLERS");
 
 
 /*-----------------------------------------Função Main--------------------------------------------------------*/
 
 void app_main() {
-    setup_PWM();                    //configura os canais e timers do PWM0
-    setup_nvs();                    //inicia a memória nvs necessária para uso do wireless
-    wifi_init_sta();                //inicia o wireless e se conecta à rede
-    server = start_webserver();     //configura e inicia o server
-   // atualiza_PWM(0,5, 30);
-   // atualiza_PWM(1,10, 70);
-    xTaskCreate(&cria_delay, "cria_delay", 512,NULL,5,NULL );
-
+    setup_nvs();                    //inicia a memória nvs, com a configuração salva e os dados do wireless
+    setup_PWM();                    //configura os canais e timers do PWM e carrega a configuração salva
+    //cria a task que aplica as configurações e publica o estado inicial (o salvo ou o de config_pwm[])
+    task_pwm_handle = cria_task(&task_pwm, "task_pwm", pilha_task_pwm, TASK_PWM_STACK, &tcb_task_pwm,
+                                TASK_PWM_PRIORIDADE, TASK_PWM_CORE);
+    publica_config_pwm(UINT32_MAX, config_pwm);
+    setup_botoes_preset();          //os botões acordam a task do PWM, que já existe
+    //só agora a task da NVS começa, para não regravar a configuração que acabou de ser carregada
+    task_nvs_handle = cria_task(&task_nvs, "task_nvs", pilha_task_nvs, TASK_NVS_STACK, &tcb_task_nvs,
+                                TASK_NVS_PRIORIDADE, tskNO_AFFINITY);
+    wifi_init_sta();                //inicia o wireless, o server é iniciado quando a rede der um IP
+    //o socket UDP pode ser aberto antes do IP, ele passa a receber quando a rede conectar
+    task_udp_handle = cria_task(&task_udp, "task_udp", pilha_task_udp, TASK_UDP_STACK, &tcb_task_udp,
+                                TASK_UDP_PRIORIDADE, TASK_UDP_CORE);
+    //a medição das saídas só trabalha quando pedida pelo PUT /api/medicao
+    task_medicao_handle = cria_task(&task_medicao, "task_medicao", pilha_task_medicao, TASK_MEDICAO_STACK,
+                                    &tcb_task_medicao, TASK_MEDICAO_PRIORIDADE, TASK_MEDICAO_CORE);
+    //o estado só é empurrado quando houver assinantes no /ws
+    task_ws_handle = cria_task(&task_ws, "task_ws", pilha_task_ws, TASK_WS_STACK, &tcb_task_ws,
+                               TASK_WS_PRIORIDADE, TASK_WS_CORE);
+    //as respostas grandes do server, que só sobe depois do IP
+    mutex_envios_http = xSemaphoreCreateMutexStatic(&buffer_mutex_envios_http);
+    for (int t = 0; t < HTTP_TASKS_ENVIO; t++) {
+        envios_em_curso[t].fd = -1;
+        tasks_envio_http[t] = cria_task(&task_envio_http, "task_envio_http", pilhas_tasks_envio_http[t],
+                                        TASK_ENVIO_HTTP_STACK, &tcbs_tasks_envio_http[t],
+                                        TASK_ENVIO_HTTP_PRIORIDADE, TASK_ENVIO_HTTP_CORE);
+    }
+    relata_memoria();               //o que o projeto ocupa, antes do wireless conectar e o server subir
 }
 
 /*-------------------------------Implementação das Funções Auxiliares-----------------------------------------*/
@@ -136,8 +1219,10 @@ void app_main() {
 static void setup_PWM()
 {
 
-    //************************Struct e Configuração do Timer0******************************
-    ledc_timer_config_t pwm_timer_config = { //Configurações do PWM0
+    //************************Struct e Configuração do Timer0 de cada grupo***********************
+    //os canais começam todos ligados ao timer 0 do seu grupo, com duty 0, até o atualiza_PWM alocar
+    //o timer certo para cada um
+    ledc_timer_config_t pwm_timer_config = {
         .duty_resolution =   LEDC_TIMER_4_BIT,       // resolução do duty do PWM
         .freq_hz =           5000,                   // frequencia do sinal PWM
         .speed_mode =        LEDC_HIGH_SPEED_MODE,   // modo do timer
@@ -147,39 +1232,59 @@ static void setup_PWM()
     // Aplicar os parâmetros da struct no timer
     ESP_ERROR_CHECK(ledc_timer_config(&pwm_timer_config));
 
-    //************************Struct e Configuração do Timer1****************************************
-    pwm_timer_config.timer_num = LEDC_TIMER_1;
-    // Aplicar os parâmetros da struct no timer 1
+    pwm_timer_config.speed_mode = LEDC_LOW_SPEED_MODE;
     ESP_ERROR_CHECK(ledc_timer_config(&pwm_timer_config));
 
-    //************************Struct e Configuração do channel0******************************
-    ledc_channel_config_t pwm_channel_config = {
-        .gpio_num   = pino_PWM0,                  //Gpio de saída do sinal PWM
-        .speed_mode = LEDC_HIGH_SPEED_MODE,       //modo do PWM
-        .channel    = LEDC_CHANNEL_0,             //Canal do PWM
-        .intr_type  = LEDC_INTR_DISABLE,          //interrupções
-        .timer_sel  = LEDC_TIMER_0,               //qual timer está asociado a esse canal
-        .duty       = 10,                          //duty cicle inicial
-        .hpoint     = 0,         
-    };
-    // Aplicar os parâmetros da struct no canal
-    ESP_ERROR_CHECK(ledc_channel_config(&pwm_channel_config));
+    //************************Struct e Configuração dos canais**********************************
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        ledc_channel_config_t pwm_channel_config = {
+            .gpio_num   = pinos_pwm[i],               //Gpio de saída do sinal PWM
+            .speed_mode = modo_do_canal(i),           //modo do PWM
+            .channel    = canal_ledc(i),              //Canal do PWM
+            .intr_type  = LEDC_INTR_DISABLE,          //interrupções
+            .timer_sel  = LEDC_TIMER_0,               //qual timer está asociado a esse canal
+            .duty       = 0,                          //duty cicle inicial
+            .hpoint     = 0,
+        };
+        // Aplicar os parâmetros da struct no canal
+        ESP_ERROR_CHECK(ledc_channel_config(&pwm_channel_config));
+        pwm_aplicado[i].timer = -1;
+    }
+
+    //as rampas do sequenciador usam o fade do LEDC, que avisa o fim de cada rampa por interrupção
+    ESP_ERROR_CHECK(ledc_fade_func_install(0));
 
+    //as duas unidades do MCPWM com o clock que as contas de geradores.c supõem. Os operadores, os canais do
+    //RMT e os pinos só são configurados quando um canal liga num desses geradores
+    ESP_ERROR_CHECK(mcpwm_group_set_resolution(MCPWM_UNIT_0, GERADOR_MCPWM_CLOCK_HZ));
+    ESP_ERROR_CHECK(mcpwm_group_set_resolution(MCPWM_UNIT_1, GERADOR_MCPWM_CLOCK_HZ));
 
+    //o driver do RMT aloca os objetos dos canais no heap: instalados todos aqui, no boot, o heap que sobra
+    //já é o de regime e a aplicação de um canal no RMT não aloca nada. O rmt_config de cada canal, que
+    //liga o pino, continua na primeira vez que um canal usa o RMT
+    for (int canal = 0; canal < GERADOR_RMT_CANAIS; canal++)
+        ESP_ERROR_CHECK(rmt_driver_install((rmt_channel_t)canal, 0, 0));
+
+    const esp_timer_create_args_t sequencia = {
+        .callback = &acorda_task_pwm,
+        .name     = "sequencia",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&sequencia, &timer_sequencia));
 
-    //************************Struct e Configuração do channel1****************************************
-    pwm_channel_config.gpio_num  = pino_PMW1;
-    pwm_channel_config.channel   = LEDC_CHANNEL_1;
-    pwm_channel_config.timer_sel = LEDC_TIMER_1;
-    pwm_channel_config.duty      = 2;
+    //a calibração vem antes da configuração, o primeiro cálculo dos timers já usa a tabela
+    if (carrega_calibracao(&calibracao) != ESP_OK)
+        ESP_LOGI(TAG, "Sem calibracao salva, usando o clock nominal");
 
-    // Aplicar os parâmetros da struct no canal 1
-    ESP_ERROR_CHECK(ledc_channel_config(&pwm_channel_config));
+    //volta com a configuração de antes do reboot, se houver uma válida na NVS. Ela é aplicada assim que
+    //a task do PWM é criada, antes do wireless
+    if (carrega_config_salva(config_pwm) != ESP_OK)
+        ESP_LOGI(TAG, "Sem configuracao salva, usando a configuracao padrao");
+    carrega_presets();
 }
 
 
 
-/*----Inicializa a memória nvs pois é necessária para o funcionamento do Wireless---------*/
+/*----Inicializa a memória nvs, usada pelo Wireless e para guardar a configuração dos canais---------*/
 static void setup_nvs()
 {
     esp_err_t ret = nvs_flash_init();
@@ -193,36 +1298,66 @@ static void setup_nvs()
 
 
 /*----------------Lida com os Eventos da rede Wireless, conexão à rede e endereço IP-----------------------*/
-//essa função é executada em segundo plano
+//essa função é executada em segundo plano, na task de eventos do sistema
 static void event_handler(void* arg, esp_event_base_t event_base,
                                 int32_t event_id, void* event_data)
 {
-    static uint32_t numero_tentativa_de_conexao_wifi = 0;//numero atual da tentativa de se conectar a rede,
-                                                         //tentativas máximas= EXAMPLE_ESP_MAXIMUM_RETRY
-    
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect(); //se o Wifi ja foi iniciado tenta se conectar
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (numero_tentativa_de_conexao_wifi < ESP_MAXIMUM_RETRY) { //se o numero atual de tentativas
-            esp_wifi_connect();                                             //de conexão não atingiu o máximo
-            numero_tentativa_de_conexao_wifi++;                             //tenta denovo            
-            ESP_LOGI(TAG, "retry to connect to the AP");
-        } else {
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);          //se o numero atingiu o máximo ativa
-        }                                                                   //o envento de falha no wifi            
-        ESP_LOGI(TAG,"connect to the AP fail");
+        //a espera dobra a cada falha seguida, até o máximo, e é sorteada entre a metade e o total
+        uint32_t espera_ms = WIFI_ESPERA_MINIMA_MS;
+        for (uint32_t t = 0; t < tentativas_wifi && espera_ms < WIFI_ESPERA_MAXIMA_MS; t++)
+            espera_ms *= 2;
+        espera_ms = MIN(espera_ms, WIFI_ESPERA_MAXIMA_MS);
+        espera_ms = espera_ms / 2 + esp_random() % (espera_ms / 2 + 1);
+        tentativas_wifi++;
+
+        esp_timer_stop(timer_reconexao_wifi);          //pode não estar rodando, o erro não importa
+        esp_timer_start_once(timer_reconexao_wifi, (uint64_t)espera_ms * 1000);
+        ESP_LOGI(TAG,"connect to the AP fail, retry %u in %u ms", tentativas_wifi, espera_ms);
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) { //se estamos conectados a rede vamos
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;         //imprimir o IP no terminal via ESP_LOGI()
         ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
-        numero_tentativa_de_conexao_wifi = 0;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        tentativas_wifi = 0;
+        conexoes_wifi++;
+
+        if (server == NULL)
+            server = start_webserver();
+        if (server != NULL && instante_servindo_us == 0) {
+            instante_servindo_us = esp_timer_get_time();
+            ESP_LOGI(TAG, "Server respondendo em %lld ms desde o boot", instante_servindo_us / 1000);
+        }
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_LOST_IP) {
+        //sem IP o server não tem como responder: para e libera os sockets até a rede voltar
+        ESP_LOGI(TAG, "lost ip");
+        if (server != NULL) {
+            httpd_stop(server);
+            server = NULL;
+            //os sockets foram fechados e um envio que estava na fila do server foi descartado
+            num_assinantes_ws = 0;
+            __atomic_store_n(&envio_ws_pendente, false, __ATOMIC_RELEASE);
+        }
     }
 }
 
+
+static void reconecta_wifi(void *arg)
+{
+    esp_wifi_connect();
+}
+
+
 /*---------------------------Inicializa a Conexão Wireless-------------------------*/
+//Só configura e liga o wireless: a conexão, as novas tentativas e o server ficam com o event_handler,
+//então as saídas do PWM e o resto do boot não esperam pela rede
 void wifi_init_sta()
 {
-    s_wifi_event_group = xEventGroupCreate();
+    const esp_timer_create_args_t reconexao = {
+        .callback = &reconecta_wifi,
+        .name     = "reconexao_wifi",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&reconexao, &timer_reconexao_wifi));
 
     ESP_ERROR_CHECK(esp_netif_init());
 
@@ -233,19 +1368,24 @@ void wifi_init_sta()
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
-    esp_event_handler_instance_t instance_any_id;
-    esp_event_handler_instance_t instance_got_ip;
+    //os handlers ficam registrados para sempre, não precisam das instâncias
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
                                                         ESP_EVENT_ANY_ID,
                                                         &event_handler,
                                                         NULL,
-                                                        &instance_any_id));
+                                                        NULL));
 
     ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
                                                         IP_EVENT_STA_GOT_IP,
                                                         &event_handler,
                                                         NULL,
-                                                        &instance_got_ip));
+                                                        NULL));
+
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
+                                                        IP_EVENT_STA_LOST_IP,
+                                                        &event_handler,
+                                                        NULL,
+                                                        NULL));
 
     wifi_config_t wifi_config = {
         .sta = {
@@ -267,31 +1407,6 @@ void wifi_init_sta()
     ESP_ERROR_CHECK(esp_wifi_start() );
 
     ESP_LOGI(TAG, "wifi_init_sta finished.");
-
-    /* Waiting until either the connection is established (WIFI_CONNECTED_BIT) or connection failed for the maximum
-     * number of re-tries (WIFI_FAIL_BIT). The bits are set by event_handler() (see above) */
-    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
-            WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-            pdFALSE,
-            pdFALSE,
-            portMAX_DELAY);
-
-    /* xEventGroupWaitBits() returns the bits before the call returned, hence we can test which event actually
-     * happened. */
-    if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "connected to ap SSID:%s password:%s",
-                 ESP_WIFI_SSID, ESP_WIFI_PASS);
-    } else if (bits & WIFI_FAIL_BIT) {
-        ESP_LOGI(TAG, "Failed to connect to SSID:%s, password:%s",
-                 ESP_WIFI_SSID, ESP_WIFI_PASS);
-    } else {
-        ESP_LOGE(TAG, "UNEXPECTED EVENT");
-    }
-
-    /* The event will not be processed after unregister */
-    ESP_ERROR_CHECK(esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, instance_got_ip));
-    ESP_ERROR_CHECK(esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, instance_any_id));
-    vEventGroupDelete(s_wifi_event_group);
 }
 
 
@@ -302,14 +1417,29 @@ static httpd_handle_t start_webserver(void)
     httpd_handle_t server   = NULL;
     httpd_config_t config   = HTTPD_DEFAULT_CONFIG();
     config.lru_purge_enable = true;
+    config.uri_match_fn     = httpd_uri_match_wildcard;   //permite as URIs /api/pwm/{n}
+    config.max_uri_handlers = HTTP_MAX_URI_HANDLERS;
+    config.max_open_sockets = HTTP_MAX_SOCKETS;
+    config.recv_wait_timeout = HTTP_ESPERA_SOCKET_S;
+    config.send_wait_timeout = HTTP_ESPERA_SOCKET_S;
+    config.core_id          = HTTP_CORE;
+    config.stack_size       = HTTP_STACK;
+    config.close_fn         = fecha_socket_http;
 
     // Inicia o server http
     printf("Iniciando o Server na Porta: '%d'\n", config.server_port);
+    uint32_t heap_antes = esp_get_free_heap_size();
     if (httpd_start(&server, &config) == ESP_OK) {
         // Set URI handlers
         printf("Registrando URI handlers\n");
-        httpd_register_uri_handler(server, &main_page);
-        httpd_register_uri_handler(server, &post_pwm);
+        for (int u = 0; u < NUM_URIS_HTTP; u++)
+            httpd_register_uri_handler(server, uris_http[u]);
+        //o server é parado e iniciado de novo quando a rede cai; a primeira medida é a que vale
+        if (heap_httpd == 0) {
+            heap_httpd = heap_antes - esp_get_free_heap_size();
+            ESP_LOGI(TAG, "Server http: %u bytes do heap (pilha de %d bytes, %d sockets, %d URIs)",
+                     heap_httpd, HTTP_STACK, HTTP_MAX_SOCKETS, NUM_URIS_HTTP);
+        }
         return server;
     }
 
@@ -317,226 +1447,2764 @@ static httpd_handle_t start_webserver(void)
     return NULL;
 }
 
-/*---Essa função concatena a página web como um vetor char e a envia como resposta da requisição req---*/
-static void print_webpage(httpd_req_t *req,struct parametros_pwm *pwm)
+/*--Respostas grandes: a saida_html (saida_html.c) junta os fragmentos e as tasks de envio os escrevem--*/
+static esp_err_t responde_por_task_envio(httpd_req_t *req, const char *tipo, void (*escreve)(struct saida_html *saida))
 {
+    struct envio_http envio = {
+        .server    = req->handle,
+        .fd        = httpd_req_to_sockfd(req),
+        .tipo      = tipo,
+        .escreve   = escreve,
+        .inicio_us = esp_timer_get_time(),
+    };
+    xSemaphoreTake(mutex_envios_http, portMAX_DELAY);
+    bool cabe = num_envios_http < HTTP_FILA_ENVIOS;
+    if (cabe)
+        fila_envios_http[(inicio_fila_envios_http + num_envios_http++) % HTTP_FILA_ENVIOS] = envio;
+    xSemaphoreGive(mutex_envios_http);
 
-    char *buffer;
-    buffer = (char *) malloc(4000);
-    
-    const char *index_html_part1= "<!DOCTYPE html><html><head><meta content=\"text/html;charset=utf-8\" http-equiv=\"Content-Type\"> <meta content=\"utf-8\" http-equiv=\"encoding\"><meta name=\"viewport\" content=\"width=device-width, initial-scale=1\"><link rel=\"icon\" href=\"data:,\"> <title>Projeto 10 - Gerador PWM controlado via Wireless</title><style>html{color: #ffffff;font-family: Verdana;text-align: center;background-color:#272727fd}.wrap {padding-top: 2.5%;padding-right: 2.5%;padding-left: 2.5%;width: 95%;overflow:auto;}.fleft {border-style: solid;border-radius: 1px;border-width: 2px;border-color: #bdbdbd;float:left; width: 47.5%;background: rgb(95, 95, 95);height:fit-content;padding-bottom: 3%;}.fright {border-style: solid;border-radius: 1px;border-width: 2px;border-color: #bdbdbd;float: right;width: 47.5%;background:rgb(95, 95, 95);height:fit-content;padding-bottom: 3%; } .fcenter {float: center;width: 5%; background:#272727fd;height:fit-content; padding-bottom: 3%;}.formulario{padding: 0px 0px;float: center;width: 95%;text-align:center;}.campo_freq{width: 30%;text-align: center;font-family:sans-serif;font-size: 14px;font-weight: bold;border-style: solid;border-radius: 1px;border-width: 3px;border-color: #000000;}.campo_duty{-webkit-appearance: none;width: 28%;height: 5px;background: #ffffff;outline: none;opacity: 1;-webkit-transition: .2s;transition: opacity .2s;    }.campo_duty::-webkit-slider-thumb{-webkit-appearance: none;appearance: none;background: #04AA6D;}.btn_submit{text-align: center;background-color: #02500f;font-size: 20px;font-family: sans-serif;font-weight: bold;color: #ffffff;border-style: solid; border-radius: 1px;border-width: 3px;border-color: #ffffff;} </style> </head> <body><h2>Projeto 10 - Gerador PWM controlado via Wireless</h2><div class=\"wrap\"><div class=\"fleft\"><h3>PWM 0</h3><form class=\"formulario\" method=\"post\"><label>Frequência: </label><input class=\"campo_freq\" type=\"text\" id=\"freq\" name=\"freq\" value=";
+    if (!cabe) {
+        __atomic_fetch_add(&envios_http[ENVIO_HTTP_FILA_CHEIA], 1, __ATOMIC_RELAXED);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        return httpd_resp_send(req, "Servidor ocupado, tente de novo", HTTPD_RESP_USE_STRLEN);
+    }
+    //quem estiver livre pega; uma task presa num cliente lento não segura a fila
+    for (int t = 0; t < HTTP_TASKS_ENVIO; t++)
+        xTaskNotifyGive(tasks_envio_http[t]);
+    return ESP_OK;
+}
 
-    char pwm0frequencia[10];
-    sprintf(pwm0frequencia, "\"%d\"", pwm[0].frequencia);
 
-    const char *index_html_part2= "autocomplete=\"off\"><label>  Hz </label><br><br> <label>Duty Cicle:&#160; </label><input class=\"campo_duty\" type=\"range\" min=\"0\" max=\"100\"  value=";
+static bool retira_envio_http(int slot, struct envio_http *envio)
+{
+    xSemaphoreTake(mutex_envios_http, portMAX_DELAY);
+    bool retirou = num_envios_http > 0;
+    if (retirou) {
+        *envio = fila_envios_http[inicio_fila_envios_http];
+        inicio_fila_envios_http = (inicio_fila_envios_http + 1) % HTTP_FILA_ENVIOS;
+        num_envios_http--;
+        envios_em_curso[slot].fd      = envio->fd;
+        envios_em_curso[slot].fechado = false;
+        //a conexão está em uso: o LRU fecha outra quando faltar socket
+        httpd_sess_update_lru_counter(envio->server, envio->fd);
+    }
+    xSemaphoreGive(mutex_envios_http);
+    return retirou;
+}
 
-    char pwm0percentual[6];
-    sprintf(pwm0percentual, "\"%d\"", pwm[0].percentual_duty);
-    
-    const char *index_html_part3="name=\"duty0\" id=\"duty0\"><label> <span id=\"demo\"></span>%</label><br><br><label>Output: </label><input name=\"estado\" id=\"1\" value=\"ligado\" class= \"campo_saida\" type=\"radio\" ";
 
-    const char *pwmchecked="checked=\"checked\"";
-    
-    const char *index_html_part4="><label>Ligado </label><input name=\"estado\" id=\"2\" value=\"desligado\"  class= \"campo_saida\" type=\"radio\"";
+static int escreve_socket_http(struct escrita_http *escrita, const char *dados, size_t tamanho)
+{
+    while (tamanho > 0) {
+        xSemaphoreTake(mutex_envios_http, portMAX_DELAY);
+        int enviados = envios_em_curso[escrita->slot].fechado ? HTTPD_SOCK_ERR_INVALID :
+                       httpd_socket_send(escrita->server, envios_em_curso[escrita->slot].fd, dados, tamanho,
+                                         MSG_DONTWAIT);
+        xSemaphoreGive(mutex_envios_http);
 
-    const char *index_html_part5="><label>Desligado </label><br><br><input class=\"btn_submit\" type=\"submit\" value=\"Atualizar\" name=\"pwm0\"></form>  </div><div class=\"fright\"><h3>PWM 1</h3><form class=\"formulario\" method=\"post\"><label>Frequência: </label><input class=\"campo_freq\" type=\"text\" id=\"freq\" name=\"freq\" value=";
-    
-    char pwm1frequencia[10];
-    sprintf(pwm1frequencia, "\"%d\"", pwm[1].frequencia);
-    
-    const char *index_html_part6="autocomplete=\"off\"><label>  Hz </label><br><br> <label>Duty Cicle:&#160; </label><input class=\"campo_duty\" type=\"range\" min=\"0\" max=\"100\" value=";
-    
-    char pwm1percentual[6];
-    sprintf(pwm1percentual, "\"%d\"", pwm[1].percentual_duty);
-    
-    const char *index_html_part7="name=\"duty1\"id=\"duty1\"><label> <span id=\"demo2\"></span>%</label><br><br><label>Output: </label>   <input name=\"estado\"id=\"2\" value=\"ligado\"class= \"campo_saida\" type=\"radio\"";
-    
-    const char *index_html_part8="><label>Desligado </label><br><br><input class=\"btn_submit\" type=\"submit\" value=\"Atualizar\" name=\"pwm1\"></form></div></div><script>var slider = document.getElementById(\"duty0\");var output = document.getElementById(\"demo\");output.innerHTML = slider.value;slider.oninput = function() {output.innerHTML = this.value;}; var slider2 = document.getElementById(\"duty1\");var output2 = document.getElementById(\"demo2\");output2.innerHTML = slider2.value;slider2.oninput = function() {output2.innerHTML = this.value;}</script></body></html>";
-   
-    strcpy(buffer, index_html_part1);
-    strcat(buffer, pwm0frequencia);
-    strcat(buffer, index_html_part2);
-    strcat(buffer, pwm0percentual);
-    strcat(buffer, index_html_part3);
-    if(pwm[0].estado)
-    {
-        strcat(buffer, pwmchecked);
+        if (enviados > 0) {
+            dados   += enviados;
+            tamanho -= enviados;
+        } else if (enviados != 0 && enviados != HTTPD_SOCK_ERR_TIMEOUT) {
+            return ESP_FAIL;
+        } else if (esp_timer_get_time() > escrita->prazo_us) {
+            return ESP_ERR_TIMEOUT;
+        } else {
+            vTaskDelay(1);          //o buffer de envio está cheio: o cliente ainda não leu
+        }
+    }
+    return ESP_OK;
+}
+
+
+static int envia_chunk_socket(void *escrita, const char *dados, size_t tamanho)
+{
+    if (tamanho == 0)
+        return escreve_socket_http(escrita, "0\r\n\r\n", 5);
+
+    char tamanho_chunk[12];
+    int n = snprintf(tamanho_chunk, sizeof(tamanho_chunk), "%x\r\n", (unsigned)tamanho);
+    int erro = escreve_socket_http(escrita, tamanho_chunk, n);
+    if (erro == ESP_OK)
+        erro = escreve_socket_http(escrita, dados, tamanho);
+    if (erro == ESP_OK)
+        erro = escreve_socket_http(escrita, "\r\n", 2);
+    return erro;
+}
+
+
+static void task_envio_http(void *pvParameter)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        //o slot desta task em envios_em_curso: quem a acordou já viu os handles guardados
+        int slot = 0;
+        while (slot < HTTP_TASKS_ENVIO - 1 && tasks_envio_http[slot] != xTaskGetCurrentTaskHandle())
+            slot++;
+
+        struct envio_http envio;
+        while (retira_envio_http(slot, &envio)) {
+            struct escrita_http escrita = {
+                .server   = envio.server,
+                .slot     = slot,
+                .prazo_us = esp_timer_get_time() + HTTP_PRAZO_ENVIO_MS * 1000,
+            };
+            char cabecalho[96];
+            int tamanho = snprintf(cabecalho, sizeof(cabecalho), "HTTP/1.1 200 OK\r\nContent-Type: %s\r\n"
+                                   "Transfer-Encoding: chunked\r\n\r\n", envio.tipo);
+            int erro = escreve_socket_http(&escrita, cabecalho, tamanho);
+            if (erro == ESP_OK) {
+                struct saida_html saida;
+                inicia_saida_html(&saida, envia_chunk_socket, &escrita);
+                envio.escreve(&saida);
+                erro = finaliza_saida_html(&saida);
+            }
+
+            //uma resposta pela metade deixa a conexão inútil; se o httpd já a fechou não há o que fazer
+            xSemaphoreTake(mutex_envios_http, portMAX_DELAY);
+            if (erro != ESP_OK && !envios_em_curso[slot].fechado)
+                httpd_sess_trigger_close(envio.server, envio.fd);
+            envios_em_curso[slot].fd = -1;
+            xSemaphoreGive(mutex_envios_http);
+
+            __atomic_fetch_add(&envios_http[erro == ESP_OK ? ENVIO_HTTP_ENVIADO : ENVIO_HTTP_FALHOU], 1,
+                               __ATOMIC_RELAXED);
+            registra_latencia(MET_HTTP_ENVIO, esp_timer_get_time() - envio.inicio_us);
+        }
+    }
+}
+
+
+static void fecha_socket_http(httpd_handle_t hd, int fd)
+{
+    xSemaphoreTake(mutex_envios_http, portMAX_DELAY);
+    for (int t = 0; t < HTTP_TASKS_ENVIO; t++) {
+        if (envios_em_curso[t].fd == fd)
+            envios_em_curso[t].fechado = true;
+    }
+    //os envios ainda na fila não têm mais para onde ir
+    int mantidos = 0;
+    for (int e = 0; e < num_envios_http; e++) {
+        struct envio_http envio = fila_envios_http[(inicio_fila_envios_http + e) % HTTP_FILA_ENVIOS];
+        if (envio.fd != fd)
+            fila_envios_http[(inicio_fila_envios_http + mantidos++) % HTTP_FILA_ENVIOS] = envio;
+        else
+            __atomic_fetch_add(&envios_http[ENVIO_HTTP_FALHOU], 1, __ATOMIC_RELAXED);
+    }
+    num_envios_http = mantidos;
+    close(fd);
+    xSemaphoreGive(mutex_envios_http);
+}
+
+/*------------------Página web: arquivos embutidos já comprimidos, revalidados pelo ETag---------------------*/
+
+static esp_err_t arquivo_estatico_get_handler(httpd_req_t *req)
+{
+    //ignora a query string, se houver
+    size_t tamanho_uri = strcspn(req->uri, "?");
+    const struct arquivo_estatico *arquivo = NULL;
+    for (int a = 0; a < NUM_ARQUIVOS_ESTATICOS && arquivo == NULL; a++) {
+        if (strlen(arquivos_estaticos[a].uri) == tamanho_uri &&
+            strncmp(arquivos_estaticos[a].uri, req->uri, tamanho_uri) == 0)
+            arquivo = &arquivos_estaticos[a];
+    }
+    if (arquivo == NULL)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Arquivo inexistente");
+
+    //o navegador pode guardar o arquivo, mas sempre confirma pelo ETag se ele ainda vale
+    httpd_resp_set_hdr(req, "ETag", arquivo->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    //o navegador já tem essa versão: responde só com o cabeçalho
+    char if_none_match[48];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strstr(if_none_match, arquivo->etag) != NULL) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    //todo navegador atual aceita gzip, então o arquivo vai direto da flash, sem descomprimir
+    httpd_resp_set_type(req, arquivo->tipo);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *)arquivo->inicio, arquivo->fim - arquivo->inicio);
+}
+
+
+static esp_err_t pwm_post_handler(httpd_req_t *req)
+{
+
+    ESP_LOGD(TAG,"pre pwm");
+
+    if (req->content_len > FORMULARIO_TAMANHO_MAXIMO)
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Formulario muito grande");
+
+    struct parametros_pwm pwm[NUM_CANAIS_PWM];
+    le_config_pwm(pwm);
+
+    struct parser_formulario parser;
+    parser_formulario_inicia(&parser, pwm);
+
+    //o corpo é lido e decodificado em pedaços, sem precisar caber inteiro na memória
+    char pedaco[FORMULARIO_PEDACO];
+    size_t restante = req->content_len;
+    int64_t parse_us = 0;           //só o tempo do parser, sem a espera pelos pacotes
+    int64_t prazo_us = esp_timer_get_time() + HTTP_PRAZO_CORPO_MS * 1000;
+    while (restante > 0) {
+        int ret = recebe_com_prazo(req, pedaco, MIN(restante, sizeof(pedaco)), prazo_us);
+        if (ret <= 0) {  /* 0 return value indicates connection closed */
+            /* Check if timeout occurred */
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                /* respond with an HTTP 408 (Request Timeout) error */
+                httpd_resp_send_408(req);
+            }
+            /* In case of error, returning ESP_FAIL will
+             * ensure that the underlying socket is closed */
+            return ESP_FAIL;
+        }
+        int64_t inicio_us = esp_timer_get_time();
+        parser_formulario_alimenta(&parser, pedaco, ret);
+        parse_us += esp_timer_get_time() - inicio_us;
+        restante -= ret;
+    }
+
+    int64_t inicio_us = esp_timer_get_time();
+    bool valido = parser_formulario_finaliza(&parser);
+    registra_latencia(MET_FASE_PARSE, parse_us + esp_timer_get_time() - inicio_us);
+    if (!valido || parser.mascara == 0)
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Formulario invalido");
+    //o formulário não troca o gerador, mas a frequência nova pode não ser possível no do canal
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        if ((parser.mascara & (1u << i)) && !parametros_validos(&pwm[i]))
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Frequencia impossivel para o gerador do canal");
+    }
+
+    ESP_LOGD(TAG,"formulario com os canais 0x%04x",parser.mascara);
+    //a task do PWM aplica em segundo plano. Se não houver timer livre para as frequências os canais ficam
+    //como estavam
+    if (publica_config_pwm(parser.mascara, pwm) != ESP_OK) {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_send(req, "Nenhum timer livre para essas frequencias", HTTPD_RESP_USE_STRLEN);
+    }
+
+    //volta para a página, que busca os valores novos pelo /api/pwm
+    ESP_LOGD(TAG,"post pwm");
+    httpd_resp_set_status(req, "303 See Other");
+    httpd_resp_set_hdr(req, "Location", "/");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+/*---------------------------------API REST: /api/pwm e /api/pwm/{n}---------------------------------------*/
+//As respostas são JSONs de ~100 bytes com os valores aplicados, em vez de re-renderizar a página inteira
+
+static int api_indice_canal(const char *uri, const char *prefixo)
+{
+    const char *resto = uri + strlen(prefixo);
+
+    //ignora a query string, se houver
+    size_t tamanho = strcspn(resto, "?");
+
+    if (tamanho == 0 || (tamanho == 1 && resto[0] == '/'))
+        return -1;
+
+    if (resto[0] != '/' || tamanho > 3)
+        return -2;
+
+    int indice = 0;
+    for (size_t i = 1; i < tamanho; i++) {
+        if (resto[i] < '0' || resto[i] > '9')
+            return -2;
+        indice = indice * 10 + (resto[i] - '0');
+    }
+
+    if (indice >= NUM_CANAIS_PWM)
+        return -2;
+    return indice;
+}
+
+
+static esp_err_t api_pwm_get_handler(httpd_req_t *req)
+{
+    int indice = api_indice_canal(req->uri, "/api/pwm");
+    if (indice == -2)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Canal inexistente");
+
+    struct parametros_pwm pedido[NUM_CANAIS_PWM];
+    struct pwm_aplicado   aplicado[NUM_CANAIS_PWM];
+    le_estado_publicado(pedido, aplicado);
+
+    char json[JSON_CANAL_TAMANHO];
+    httpd_resp_set_type(req, "application/json");
+
+    if (indice >= 0) {
+        int tamanho = json_canal_formata(json, sizeof(json), indice, pinos_pwm[indice], &pedido[indice],
+                                         &aplicado[indice]);
+        return httpd_resp_send(req, json, tamanho);
+    }
+
+    //sem índice: devolve a lista de todos os canais
+    esp_err_t erro = httpd_resp_send_chunk(req, "[", 1);
+    for (int i = 0; erro == ESP_OK && i < NUM_CANAIS_PWM; i++) {
+        int tamanho = json_canal_formata(json + 1, sizeof(json) - 1, i, pinos_pwm[i], &pedido[i], &aplicado[i]);
+        json[0] = ',';
+        erro = (i == 0) ? httpd_resp_send_chunk(req, json + 1, tamanho)
+                        : httpd_resp_send_chunk(req, json, tamanho + 1);
+    }
+    if (erro == ESP_OK)
+        erro = httpd_resp_send_chunk(req, "]", 1);
+    if (erro == ESP_OK)
+        erro = httpd_resp_send_chunk(req, NULL, 0);
+    return erro;
+}
+
+
+static esp_err_t api_ledc_get_handler(httpd_req_t *req)
+{
+    char json[384];
+    int tamanho = 0;
+
+    json[tamanho++] = '{';
+    for (int op = 0; op < NUM_OPS_LEDC; op++) {
+        tamanho += snprintf(json + tamanho, sizeof(json) - tamanho,
+                            "%s\"%s\":{\"aplicadas\":%u,\"evitadas\":%u,\"falhas\":%u}",
+                            op ? "," : "", nomes_ops_ledc[op],
+                            ops_ledc_aplicadas[op], ops_ledc_evitadas[op], ops_ledc_falhas[op]);
+    }
+    tamanho += snprintf(json + tamanho, sizeof(json) - tamanho, "}");
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, tamanho);
+}
+
+
+static esp_err_t api_ledc_trace_get_handler(httpd_req_t *req)
+{
+    char json[128];
+    uint32_t total = trace_ledc_total;
+    uint32_t inicio = (total > TRACE_LEDC_TAMANHO) ? total - TRACE_LEDC_TAMANHO : 0;
+
+    //da operação mais antiga para a mais nova
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t erro = httpd_resp_send_chunk(req, "[", 1);
+    for (uint32_t i = inicio; erro == ESP_OK && i < total; i++) {
+        const struct registro_op_ledc *registro = &trace_ledc[i % TRACE_LEDC_TAMANHO];
+        int tamanho = snprintf(json, sizeof(json),
+                               "%s{\"us\":%lld,\"op\":\"%s\",\"modo\":%u,\"indice\":%u,\"valor\":%u,\"falhou\":%s}",
+                               (i == inicio) ? "" : ",",
+                               registro->instante_us,
+                               nomes_ops_ledc[registro->op % NUM_OPS_LEDC],
+                               registro->modo,
+                               registro->indice,
+                               registro->valor,
+                               registro->falhou ? "true" : "false");
+        erro = httpd_resp_send_chunk(req, json, tamanho);
+    }
+    if (erro == ESP_OK)
+        erro = httpd_resp_send_chunk(req, "]", 1);
+    if (erro == ESP_OK)
+        erro = httpd_resp_send_chunk(req, NULL, 0);
+    return erro;
+}
+
+
+/*---------------Métricas: histogramas de latência, /metrics (texto do Prometheus) e nível de log--------------*/
+
+static esp_err_t executa_handler_medido(httpd_req_t *req)
+{
+    const struct handler_medido *medido = req->user_ctx;
+    int64_t inicio_us = esp_timer_get_time();
+    esp_err_t erro = medido->handler(req);
+    registra_latencia(medido->metrica, esp_timer_get_time() - inicio_us);
+    return erro;
+}
+
+
+static void registra_latencia(enum metrica_latencia metrica, int64_t duracao_us)
+{
+    metricas_registra(&histogramas[xPortGetCoreID()][metrica], duracao_us);
+}
+
+
+static void monitora_task(TaskHandle_t handle)
+{
+    if (handle != NULL && num_tasks_monitoradas < NUM_TASKS_MONITORADAS)
+        tasks_monitoradas[num_tasks_monitoradas++] = handle;
+}
+
+
+static TaskHandle_t cria_task(TaskFunction_t funcao, const char *nome, StackType_t *pilha, uint32_t tamanho,
+                              StaticTask_t *tcb, UBaseType_t prioridade, BaseType_t core)
+{
+    TaskHandle_t handle = xTaskCreateStaticPinnedToCore(funcao, nome, tamanho, NULL, prioridade, pilha, tcb, core);
+    monitora_task(handle);
+    return handle;
+}
+
+
+static void relata_memoria(void)
+{
+    uint32_t data = (uint32_t)((uintptr_t)&_data_end - (uintptr_t)&_data_start);
+    uint32_t bss  = (uint32_t)((uintptr_t)&_bss_end - (uintptr_t)&_bss_start);
+    ESP_LOGI(TAG, "Memoria estatica: .data %u bytes, .bss %u bytes (firmware inteiro, com o ESP-IDF)", data, bss);
+
+    size_t projeto = 0;
+    for (int a = 0; a < NUM_AREAS_MEMORIA; a++) {
+        size_t bytes = (areas_memoria[a].bytes + MEMORIA_ALINHAMENTO - 1) & ~(size_t)(MEMORIA_ALINHAMENTO - 1);
+        projeto += bytes;
+        ESP_LOGI(TAG, "  %-16s %6u bytes", areas_memoria[a].nome, (unsigned)bytes);
+    }
+    ESP_LOGI(TAG, "  %-16s %6u bytes", "total", (unsigned)projeto);
+
+    //a pilha do server vem do heap quando ele sobe; o resto do heap é do wireless e do lwip
+    ESP_LOGI(TAG, "Pilhas: %u bytes estaticos nas tasks do projeto, %d do server http (heap)",
+             (unsigned)areas_memoria[0].bytes, HTTP_STACK);
+    ESP_LOGI(TAG, "Heap: %u bytes livres, minimo %u, maior bloco %u", esp_get_free_heap_size(),
+             esp_get_minimum_free_heap_size(), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
+
+
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+    //uns 30 KB, bem mais que o buffer de envio do TCP: sai por uma task de envio
+    task_server_http = xTaskGetCurrentTaskHandle();
+    return responde_por_task_envio(req, "text/plain; version=0.0.4", escreve_metricas);
+}
+
+
+static void escreve_metricas(struct saida_html *saida)
+{
+    //histogramas: soma os cores e acumula as faixas
+    metricas_envia_histogramas(saida, metricas_latencia, &histogramas[0][0], portNUM_PROCESSORS,
+                               NUM_METRICAS_LATENCIA);
+
+    //operações no LEDC e canais que a task não conseguiu aplicar
+    envia_html_formatado(saida, "# TYPE pwm_ledc_operacoes_total counter\n");
+    for (int op = 0; op < NUM_OPS_LEDC; op++) {
+        envia_html_formatado(saida, "pwm_ledc_operacoes_total{op=\"%s\",resultado=\"aplicada\"} %u\n",
+                             nomes_ops_ledc[op], ops_ledc_aplicadas[op]);
+        envia_html_formatado(saida, "pwm_ledc_operacoes_total{op=\"%s\",resultado=\"evitada\"} %u\n",
+                             nomes_ops_ledc[op], ops_ledc_evitadas[op]);
+        envia_html_formatado(saida, "pwm_ledc_operacoes_total{op=\"%s\",resultado=\"falha\"} %u\n",
+                             nomes_ops_ledc[op], ops_ledc_falhas[op]);
+    }
+    envia_html_formatado(saida, "# TYPE pwm_udp_pacotes_total counter\n");
+    for (int s = 0; s < NUM_STATUS_UDP; s++) {
+        envia_html_formatado(saida, "pwm_udp_pacotes_total{status=\"%s\"} %u\n",
+                             nomes_status_udp[s], pacotes_udp[s]);
+    }
+    envia_html_formatado(saida, "# TYPE pwm_sequencia_passos_total counter\n"
+                                 "pwm_sequencia_passos_total %u\n", passos_sequencia);
+    envia_html_formatado(saida, "# TYPE pwm_sequencias_interrompidas_total counter\n"
+                                 "pwm_sequencias_interrompidas_total %u\n", sequencias_interrompidas);
+    envia_html_formatado(saida, "# TYPE pwm_agenda_comandos_total counter\n"
+                                 "pwm_agenda_comandos_total{resultado=\"executado\"} %u\n",
+                         comandos_agendados_executados);
+    envia_html_formatado(saida, "pwm_agenda_comandos_total{resultado=\"recusado\"} %u\n",
+                         comandos_agendados_recusados);
+    envia_html_formatado(saida, "# TYPE pwm_preset_trocas_total counter\n"
+                                 "pwm_preset_trocas_total{resultado=\"executada\"} %u\n", trocas_preset);
+    envia_html_formatado(saida, "pwm_preset_trocas_total{resultado=\"recusada\"} %u\n", trocas_preset_recusadas);
+    envia_html_formatado(saida, "# TYPE pwm_ledc_lotes_total counter\npwm_ledc_lotes_total %u\n", lotes_ledc);
+    envia_html_formatado(saida, "# TYPE pwm_ws_assinantes gauge\npwm_ws_assinantes %d\n", num_assinantes_ws);
+    envia_html_formatado(saida, "# TYPE pwm_ws_mensagens_total counter\npwm_ws_mensagens_total %u\n", mensagens_ws);
+    envia_html_formatado(saida, "# TYPE pwm_ws_quadros_total counter\npwm_ws_quadros_total %u\n", quadros_ws);
+    envia_html_formatado(saida, "# TYPE pwm_ws_bytes_total counter\npwm_ws_bytes_total %llu\n", bytes_ws);
+    envia_html_formatado(saida, "# TYPE pwm_ws_assinantes_removidos_total counter\n"
+                                 "pwm_ws_assinantes_removidos_total %u\n", assinantes_ws_removidos);
+
+    //canais ligados em cada gerador segundo o último estado publicado, e as escritas no MCPWM e no RMT
+    struct parametros_pwm pedido[NUM_CANAIS_PWM];
+    struct pwm_aplicado   aplicado[NUM_CANAIS_PWM];
+    le_estado_publicado(pedido, aplicado);
+    int canais_gerador[NUM_GERADORES] = {0};
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        if (aplicado[i].estado && aplicado[i].gerador >= 0 && aplicado[i].gerador < NUM_GERADORES)
+            canais_gerador[aplicado[i].gerador]++;
+    }
+    envia_html_formatado(saida, "# TYPE pwm_gerador_canais gauge\n");
+    for (int g = 0; g < NUM_GERADORES; g++)
+        envia_html_formatado(saida, "pwm_gerador_canais{gerador=\"%s\"} %d\n", gerador_nome(g), canais_gerador[g]);
+    envia_html_formatado(saida, "# TYPE pwm_gerador_escritas_total counter\n");
+    for (int g = GERADOR_MCPWM; g < NUM_GERADORES; g++) {
+        envia_html_formatado(saida, "pwm_gerador_escritas_total{gerador=\"%s\",resultado=\"aplicada\"} %u\n",
+                             gerador_nome(g), escritas_gerador[g]);
+        envia_html_formatado(saida, "pwm_gerador_escritas_total{gerador=\"%s\",resultado=\"falha\"} %u\n",
+                             gerador_nome(g), falhas_gerador[g]);
+    }
+    envia_html_formatado(saida, "# TYPE pwm_gerador_trocas_total counter\npwm_gerador_trocas_total %u\n",
+                         trocas_gerador);
+    envia_html_formatado(saida, "# TYPE pwm_ledc_lote_janela_maxima_segundos gauge\n"
+                                 "pwm_ledc_lote_janela_maxima_segundos %u.%09u\n",
+                         janela_lote_maxima_ns / 1000000000, janela_lote_maxima_ns % 1000000000);
+    envia_html_formatado(saida, "# TYPE pwm_medicoes_total counter\npwm_medicoes_total %u\n", medicoes_feitas);
+    envia_html_formatado(saida, "# TYPE pwm_medicao_erro_ppm gauge\n");
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        portENTER_CRITICAL(&mux_medicao);
+        struct medicao_canal medicao = medicoes[i];
+        portEXIT_CRITICAL(&mux_medicao);
+        if (medicao.instante_us != 0)
+            envia_html_formatado(saida, "pwm_medicao_erro_ppm{canal=\"%d\"} %d\n", i, medicao.erro_ppm);
+    }
+    envia_html_formatado(saida, "# TYPE pwm_http_corpos_expirados_total counter\n"
+                                 "pwm_http_corpos_expirados_total %u\n", corpos_expirados);
+    envia_html_formatado(saida, "# TYPE pwm_http_envios_total counter\n");
+    for (int r = 0; r < NUM_RESULTADOS_ENVIO_HTTP; r++) {
+        envia_html_formatado(saida, "pwm_http_envios_total{resultado=\"%s\"} %u\n", nomes_envios_http[r],
+                             __atomic_load_n(&envios_http[r], __ATOMIC_RELAXED));
     }
-    strcat(buffer, index_html_part4);
-    if(!pwm[0].estado)
-    {
-        strcat(buffer, pwmchecked);
+    envia_html_formatado(saida, "# TYPE pwm_canais_nao_aplicados_total counter\n"
+                                 "pwm_canais_nao_aplicados_total %u\n", canais_nao_aplicados);
+
+    //heap: livre agora, o mínimo desde o boot e o maior bloco contíguo (mostra a fragmentação)
+    envia_html_formatado(saida, "# TYPE pwm_heap_livre_bytes gauge\npwm_heap_livre_bytes %u\n",
+                         esp_get_free_heap_size());
+    envia_html_formatado(saida, "# TYPE pwm_heap_livre_minimo_bytes gauge\npwm_heap_livre_minimo_bytes %u\n",
+                         esp_get_minimum_free_heap_size());
+    envia_html_formatado(saida, "# TYPE pwm_heap_maior_bloco_bytes gauge\npwm_heap_maior_bloco_bytes %u\n",
+                         heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    envia_html_formatado(saida, "# TYPE pwm_heap_httpd_bytes gauge\npwm_heap_httpd_bytes %u\n", heap_httpd);
+
+    //memória estática: as áreas do projeto e o .data/.bss do firmware inteiro
+    envia_html_formatado(saida, "# TYPE pwm_memoria_estatica_bytes gauge\n");
+    for (int a = 0; a < NUM_AREAS_MEMORIA; a++) {
+        envia_html_formatado(saida, "pwm_memoria_estatica_bytes{area=\"%s\"} %u\n", areas_memoria[a].nome,
+                             (unsigned)areas_memoria[a].bytes);
+    }
+    envia_html_formatado(saida, "pwm_memoria_estatica_bytes{area=\"data\"} %u\n",
+                         (unsigned)((uintptr_t)&_data_end - (uintptr_t)&_data_start));
+    envia_html_formatado(saida, "pwm_memoria_estatica_bytes{area=\"bss\"} %u\n",
+                         (unsigned)((uintptr_t)&_bss_end - (uintptr_t)&_bss_start));
+
+    //menor folga que a pilha de cada task já teve (no ESP-IDF a pilha é contada em bytes)
+    envia_html_formatado(saida, "# TYPE pwm_task_pilha_livre_minima_bytes gauge\n");
+    envia_html_formatado(saida, "pwm_task_pilha_livre_minima_bytes{task=\"%s\"} %u\n",
+                         pcTaskGetTaskName(task_server_http), uxTaskGetStackHighWaterMark(task_server_http));
+    for (int t = 0; t < num_tasks_monitoradas; t++) {
+        envia_html_formatado(saida, "pwm_task_pilha_livre_minima_bytes{task=\"%s\"} %u\n",
+                             pcTaskGetTaskName(tasks_monitoradas[t]),
+                             uxTaskGetStackHighWaterMark(tasks_monitoradas[t]));
+    }
+
+    //gravações da configuração na NVS, para acompanhar o desgaste da flash
+    envia_html_formatado(saida, "# TYPE pwm_nvs_gravacoes_total counter\n");
+    envia_html_formatado(saida, "pwm_nvs_gravacoes_total{resultado=\"gravada\"} %u\n", gravacoes_nvs);
+    envia_html_formatado(saida, "pwm_nvs_gravacoes_total{resultado=\"evitada\"} %u\n", gravacoes_nvs_evitadas);
+    envia_html_formatado(saida, "pwm_nvs_gravacoes_total{resultado=\"falha\"} %u\n", falhas_nvs);
+    envia_html_formatado(saida, "# TYPE pwm_nvs_gravacoes_ultima_hora gauge\npwm_nvs_gravacoes_ultima_hora %u\n",
+                         gravacoes_nvs_ultima_hora());
+    envia_html_formatado(saida, "# TYPE pwm_nvs_geracao gauge\npwm_nvs_geracao %u\n", geracao_config_salva);
+
+    //boot e conexão: quando as saídas ficaram válidas, quando o server passou a responder (0 enquanto não
+    //aconteceu) e quantas vezes o wireless obteve um IP
+    envia_html_formatado(saida, "# TYPE pwm_boot_saidas_validas_segundos gauge\npwm_boot_saidas_validas_segundos %lld.%06lld\n",
+                         instante_primeira_saida_us / 1000000, instante_primeira_saida_us % 1000000);
+    envia_html_formatado(saida, "# TYPE pwm_boot_servindo_segundos gauge\npwm_boot_servindo_segundos %lld.%06lld\n",
+                         instante_servindo_us / 1000000, instante_servindo_us % 1000000);
+    envia_html_formatado(saida, "# TYPE pwm_wifi_conexoes_total counter\npwm_wifi_conexoes_total %u\n", conexoes_wifi);
+
+    envia_html_formatado(saida, "# TYPE pwm_nivel_log gauge\npwm_nivel_log{nivel=\"%s\"} %d\n",
+                         nomes_niveis_log[nivel_log], nivel_log);
+
+}
+
+
+static esp_err_t api_log_put_handler(httpd_req_t *req)
+{
+    char query[32];
+    char nivel[12];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "nivel", nivel, sizeof(nivel)) != ESP_OK)
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Use /api/log?nivel=nenhum|erro|aviso|info|debug|verbose");
+
+    for (int n = ESP_LOG_NONE; n <= ESP_LOG_VERBOSE; n++) {
+        if (strcmp(nivel, nomes_niveis_log[n]) == 0) {
+            nivel_log = (esp_log_level_t)n;
+            esp_log_level_set(TAG, nivel_log);
+
+            char json[32];
+            int tamanho = snprintf(json, sizeof(json), "{\"nivel\":\"%s\"}", nomes_niveis_log[n]);
+            httpd_resp_set_type(req, "application/json");
+            return httpd_resp_send(req, json, tamanho);
+        }
     }
-    strcat(buffer, index_html_part5);
-    strcat(buffer, pwm1frequencia);
-    strcat(buffer, index_html_part6);
-    strcat(buffer, pwm1percentual);
-    strcat(buffer, index_html_part7);
-    if(pwm[1].estado)
-    {
-        strcat(buffer, pwmchecked);
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Nivel de log desconhecido");
+}
+
+
+static esp_err_t api_pwm_put_handler(httpd_req_t *req)
+{
+    int indice = api_indice_canal(req->uri, "/api/pwm");
+    if (indice < 0)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Canal inexistente");
+
+    char content[256];
+    if (req->content_len >= sizeof(content))
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Corpo muito grande");
+
+    //o corpo pode chegar em mais de um pedaço
+    size_t recebido = 0;
+    int64_t prazo_us = esp_timer_get_time() + HTTP_PRAZO_CORPO_MS * 1000;
+    while (recebido < req->content_len) {
+        int ret = recebe_com_prazo(req, content + recebido, req->content_len - recebido, prazo_us);
+        if (ret <= 0) {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+                httpd_resp_send_408(req);
+            return ESP_FAIL;
+        }
+        recebido += ret;
     }
-    strcat(buffer, index_html_part4);
-    if(!pwm[1].estado)
-    {
-        strcat(buffer, pwmchecked);
+    content[recebido] = '\0';
+
+    //só os campos presentes no JSON são alterados
+    struct parametros_pwm pwm[NUM_CANAIS_PWM];
+    le_config_pwm(pwm);
+    struct parametros_pwm novo = pwm[indice];
+    int valor;
+    int64_t inicio_us = esp_timer_get_time();
+    if (parser_json_campo(content, "estado", &valor))
+        novo.estado = (valor != 0);
+    if (parser_json_campo(content, "frequencia", &valor))
+        novo.frequencia = valor;
+    //o duty pode vir em percentual ou em unidades finas
+    if (parser_json_campo(content, "percentual_duty", &valor))
+        novo.duty_fino = (valor >= 0 && valor <= 100) ? PERCENTUAL_PARA_DUTY_FINO(valor) : -1;
+    if (parser_json_campo(content, "duty_fino", &valor))
+        novo.duty_fino = valor;
+    if (parser_json_campo(content, "fase", &valor))
+        novo.fase = valor;
+    parser_json_gerador(content, "gerador", &novo.gerador);
+    if (parser_json_campo(content, "complementar", &valor))
+        novo.complementar = (valor != 0);
+    if (parser_json_campo(content, "tempo_morto_ns", &valor))
+        novo.tempo_morto_ns = valor;
+    if (parser_json_campo(content, "pulsos", &valor))
+        novo.pulsos = valor;
+    registra_latencia(MET_FASE_PARSE, esp_timer_get_time() - inicio_us);
+
+    //as faixas e, no MCPWM e no RMT, se o gerador consegue a frequência com esse duty e esses pulsos
+    if (!parametros_validos(&novo))
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Valores fora da faixa ou impossiveis para o gerador");
+
+    pwm[indice] = novo;
+    if (publica_config_pwm(1u << indice, pwm) != ESP_OK) {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_send(req, "Nenhum timer, operador ou canal livre para essa configuracao",
+                               HTTPD_RESP_USE_STRLEN);
     }
-    strcat(buffer, index_html_part8);
 
+    //a task do PWM aplica em segundo plano, a resposta leva os valores que o hardware vai ter (o
+    //cálculo é o mesmo que a task faz) e o timer atual do canal
+    struct parametros_pwm pedido_publicado[NUM_CANAIS_PWM];
+    struct pwm_aplicado   aplicado[NUM_CANAIS_PWM];
+    le_estado_publicado(pedido_publicado, aplicado);
+    int8_t timer = aplicado[indice].timer;
+    bool mesmo_gerador = (aplicado[indice].gerador == novo.gerador);
+    calcula_saida(&novo, &aplicado[indice]);
+    aplicado[indice].timer = (novo.estado && mesmo_gerador) ? timer : -1;
+
+    char json[JSON_CANAL_TAMANHO];
+    int tamanho = json_canal_formata(json, sizeof(json), indice, pinos_pwm[indice], &novo, &aplicado[indice]);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, tamanho);
+}
 
-    httpd_resp_send(req, buffer, strlen(buffer)); //envia via http o buffer que contém a página html completa
 
-    vTaskDelay(3000 / portTICK_RATE_MS);
-    free(buffer);
+/*----------------------Parser do formulário html, lido em pedaços numa única passada-----------------------*/
 
+//Um cliente que manda o corpo aos poucos (cada pedaço antes do timeout do socket) seguraria a task do
+//server indefinidamente, então o corpo inteiro tem um prazo
+static int recebe_com_prazo(httpd_req_t *req, char *buffer, size_t tamanho, int64_t prazo_us)
+{
+    if (esp_timer_get_time() > prazo_us) {
+        corpos_expirados++;
+        return HTTPD_SOCK_ERR_TIMEOUT;
+    }
+    int ret = httpd_req_recv(req, buffer, tamanho);
+    if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+        corpos_expirados++;
+    return ret;
 }
 
 
-/*--------------handler do Get da Página Principal html-------------------*/
-static esp_err_t main_page_get_handler(httpd_req_t *req)
+/*---------------------Alocador dos timers do LEDC entre os canais de cada grupo---------------------------*/
+//Canais do mesmo grupo com a mesma frequência dividem um timer. Quando a frequência de um canal muda ele
+//deixa o timer antigo (que fica livre se ninguém mais o usa) e vai para um timer com a nova frequência,
+//reconfigura o próprio timer se for o único usuário dele, ou ocupa um timer livre. Se nenhum dos 4 timers
+//do grupo servir o pedido é recusado, nunca se altera um timer que outro canal está usando.
+static esp_err_t aloca_timer_pwm(int pwm_index, uint32_t frequencia, const struct config_timer_pwm *config, int *timer)
 {
-    //imprime a página
-    print_webpage(req,pwm);
-    //retorna OK
+    ledc_mode_t modo = modo_do_canal(pwm_index);
+    struct timer_pwm *timers = timers_pwm[modo];
+    int atual = pwm_aplicado[pwm_index].timer;
+
+    //frequências diferentes podem dar o mesmo divisor e resolução, então a comparação é pela configuração
+    #define MESMA_CONFIG(t) (timers[t].config.divisor == config->divisor && \
+                             timers[t].config.resolucao_duty == config->resolucao_duty)
+
+    //já está num timer com essa configuração
+    if (atual >= 0 && MESMA_CONFIG(atual)) {
+        timers[atual].frequencia = frequencia;
+        ops_ledc_evitadas[OP_LEDC_TIMER]++;
+        *timer = atual;
+        return ESP_OK;
+    }
+
+    //outro canal já usa um timer com essa configuração: compartilha
+    for (int t = 0; t < NUM_TIMERS_POR_MODO; t++) {
+        if (timers[t].usuarios > 0 && MESMA_CONFIG(t)) {
+            libera_timer_pwm(pwm_index);
+            timers[t].usuarios++;
+            ops_ledc_evitadas[OP_LEDC_TIMER]++;
+            *timer = t;
+            return ESP_OK;
+        }
+    }
+    #undef MESMA_CONFIG
+
+    //o canal é o único no timer atual: reconfigura o timer no lugar
+    int escolhido = -1;
+    if (atual >= 0 && timers[atual].usuarios == 1) {
+        escolhido = atual;
+    } else {
+        for (int t = 0; t < NUM_TIMERS_POR_MODO && escolhido < 0; t++) {
+            if (timers[t].usuarios == 0)
+                escolhido = t;
+        }
+        if (escolhido < 0) {
+            ESP_LOGE(TAG,"Canal %d: os %d timers do grupo estao ocupados com outras frequencias",
+                     pwm_index, NUM_TIMERS_POR_MODO);
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+
+    esp_err_t erro = conta_op_ledc(OP_LEDC_TIMER, modo, escolhido, config->divisor,
+                                   ledc_timer_set(modo, escolhido, config->divisor, config->resolucao_duty, LEDC_APB_CLK));
+    if (erro != ESP_OK)
+        return erro;
+
+    if (escolhido != atual) {
+        libera_timer_pwm(pwm_index);
+        timers[escolhido].usuarios = 1;
+    }
+    timers[escolhido].frequencia = frequencia;
+    timers[escolhido].config     = *config;
+    *timer = escolhido;
     return ESP_OK;
 }
 
-static esp_err_t pwm_post_handler(httpd_req_t *req)
+
+static void libera_timer_pwm(int pwm_index)
 {
+    int atual = pwm_aplicado[pwm_index].timer;
+    if (atual < 0)
+        return;
 
-     /* Destination buffer for content of HTTP POST request.
-     * httpd_req_recv() accepts char* only, but content could
-     * as well be any binary data (needs type casting).
-     * In case of string data, null termination will be absent, and
-     * content length would give length of string */
-    char content[100];
-    ESP_LOGI(TAG,"pre pwm");
-    ESP_LOGI(TAG,"pwm parametros %d %d %d",pwm[1].estado,pwm[1].frequencia,pwm[1].percentual_duty);
-
-    /* Truncate if content length larger than the buffer */
-    size_t recv_size = MIN(req->content_len, sizeof(content));
-
-    int ret = httpd_req_recv(req, content, recv_size);
-    if (ret <= 0) {  /* 0 return value indicates connection closed */
-        /* Check if timeout occurred */
-        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
-            /* In case of timeout one can choose to retry calling
-             * httpd_req_recv(), but to keep it simple, here we
-             * respond with an HTTP 408 (Request Timeout) error */
-            httpd_resp_send_408(req);
-        }
-        /* In case of error, returning ESP_FAIL will
-         * ensure that the underlying socket is closed */
-        return ESP_FAIL;
+    timers_pwm[modo_do_canal(pwm_index)][atual].usuarios--;
+    pwm_aplicado[pwm_index].timer = -1;
+}
+
+
+static esp_err_t calcula_timer_calibrado(uint32_t frequencia, struct config_timer_pwm *timer)
+{
+    //80 MHz é a velocidade do clock APB. Se quiser usar outro clock, troque também o LEDC_APB_CLK do
+    //alocador de timers
+    portENTER_CRITICAL(&mux_calibracao);
+    uint32_t timer_clk_freq = calibracao_clock_efetivo(&calibracao, frequencia, PWM_CLK_APB);
+    portEXIT_CRITICAL(&mux_calibracao);
+
+    //perto de 40 MHz um clock corrigido para baixo deixaria a frequência impossível: fica o nominal
+    if (timer_pwm_calcula(frequencia, timer_clk_freq, timer))
+        return ESP_OK;
+    return timer_pwm_calcula(frequencia, PWM_CLK_APB, timer) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+static esp_err_t calcula_pwm_aplicado(const struct parametros_pwm *parametros, struct pwm_aplicado *aplicado)
+{
+    struct config_timer_pwm config;
+    esp_err_t erro = calcula_timer_calibrado(parametros->frequencia, &config);
+    if (erro != ESP_OK)
+        return erro;
+
+    aplicado->estado         = parametros->estado;
+    aplicado->frequencia     = (uint32_t)((config.frequencia_mhz + 500) / 1000);
+    aplicado->resolucao_duty = config.resolucao_duty;
+    //transforma o duty e a fase de unidades finas para bits, 100% vira 2^resolucao (saída sempre alta)
+    timer_pwm_duty((uint32_t)parametros->duty_fino, (uint32_t)parametros->fase, config.resolucao_duty,
+                   &aplicado->duty, &aplicado->hpoint);
+    aplicado->erro_ppm       = config.erro_ppm;
+    aplicado->gerador        = GERADOR_LEDC;
+    return ESP_OK;
+}
+
+
+//Atualiza o sinal PWM baseado no canal selecionado, na frequência pedida e na porcentagem do duty. Com
+//rampa_ms > 0 uma mudança só de duty é feita pelo fade do hardware nesse tempo. O ledc_update_duty e o
+//ledc_stop ficam no lote, para o aplica_lote_ledc fazer junto com os outros canais
+static esp_err_t atualiza_PWM(int pwm_index,const struct parametros_pwm *parametros, uint32_t rampa_ms,
+                              struct lote_ledc *lote){
+
+    ledc_mode_t    modo  = modo_do_canal(pwm_index);
+    ledc_channel_t canal = canal_ledc(pwm_index);
+
+    struct config_timer_pwm config;
+    if (calcula_timer_calibrado(parametros->frequencia, &config) != ESP_OK) {
+        ESP_LOGE(TAG,"Frequencia impossivel para o LEDC: %d Hz", parametros->frequencia);
+        return ESP_ERR_INVALID_ARG;
     }
-    ESP_LOGI(TAG,"Vetor resposta: %s",content);
-    processa_post_request(pwm,content);
-    ESP_LOGI(TAG,"pwm parametros %d %d %d",pwm[0].estado,pwm[0].frequencia,pwm[0].percentual_duty);
-    ESP_LOGI(TAG,"pwm parametros %d %d %d",pwm[1].estado,pwm[1].frequencia,pwm[1].percentual_duty);
-    atualiza_PWM(pwm[0].estado,pwm[0].frequencia, pwm[0].percentual_duty);
-    atualiza_PWM(pwm[1].estado,pwm[1].frequencia, pwm[1].percentual_duty);
-    /* Send a simple response */
-    ESP_LOGI(TAG,"post pwm");
-    print_webpage(req,pwm);
+
+    struct pwm_aplicado aplicado;
+    calcula_pwm_aplicado(parametros, &aplicado);
+
+    ESP_LOGD(TAG,"Atualizar PWM%d: Freq: %d, Duty: %d/65535, Resolução: %u, Divisor: %u/256, Erro: %d ppm",
+            pwm_index,
+            parametros->frequencia,
+            parametros->duty_fino,
+            config.resolucao_duty,
+            config.divisor,
+            config.erro_ppm);
+
+    //o que está no hardware agora, para só escrever nos registradores o que mudou
+    const struct pwm_aplicado *anterior = &pwm_aplicado[pwm_index];
+
+    if (parametros->estado) {
+        //escolhe (e se preciso configura) o timer com a frequência pedida e liga o canal nele
+        int timer;
+        esp_err_t erro = aloca_timer_pwm(pwm_index, parametros->frequencia, &config, &timer);
+        if (erro != ESP_OK)
+            return erro;
+        pwm_aplicado[pwm_index].timer = timer;
+
+        bool trocou_timer = (timer_vinculado[pwm_index] != timer);
+        if (trocou_timer) {
+            erro = conta_op_ledc(OP_LEDC_VINCULO, modo, canal, timer, ledc_bind_channel_timer(modo,canal,timer));
+            if (erro != ESP_OK)
+                return erro;
+            timer_vinculado[pwm_index] = timer;
+        } else {
+            ops_ledc_evitadas[OP_LEDC_VINCULO]++;
+        }
+
+        /* O duty só é escrito se mudou, se o timer mudou ou se a saída estava parada (o ledc_update_duty
+         * é o que religa a saída). O LEDC só troca o duty no fim do período em andamento, então uma
+         * mudança só de duty não gera glitch e não mexe no timer nem nos outros canais */
+        if (rampa_ms > 0 && anterior->estado && anterior->duty != aplicado.duty &&
+            anterior->hpoint == aplicado.hpoint && !trocou_timer) {
+            //o LEDC anda o duty sozinho a cada ciclo, sem trabalho da CPU durante a rampa
+            erro = ledc_set_fade_with_time(modo,canal,aplicado.duty,rampa_ms);
+            if (erro == ESP_OK)
+                erro = ledc_fade_start(modo,canal,LEDC_FADE_NO_WAIT);
+            if (conta_op_ledc(OP_LEDC_RAMPA, modo, canal, aplicado.duty, erro) != ESP_OK)
+                return erro;
+        } else if (!anterior->estado || anterior->duty != aplicado.duty || anterior->hpoint != aplicado.hpoint ||
+                   trocou_timer) {
+            erro = ledc_set_duty_with_hpoint(modo,canal,aplicado.duty,aplicado.hpoint);
+            if (conta_op_ledc(OP_LEDC_DUTY, modo, canal, aplicado.duty, erro) != ESP_OK)
+                return erro;
+            lote->atualizar |= 1u << pwm_index;
+        } else {
+            ops_ledc_evitadas[OP_LEDC_DUTY]++;
+        }
+    } else {
+        // Saída desligada: para o canal em nível baixo (se ainda não estava) e libera o timer
+        if (anterior->estado) {
+            lote->parar |= 1u << pwm_index;
+            lote->atualizar &= ~(1u << pwm_index);
+        } else {
+            ops_ledc_evitadas[OP_LEDC_PARADA]++;
+        }
+        libera_timer_pwm(pwm_index);
+    }
+
+    //guarda o que de fato ficou no hardware para a API informar
+    aplicado.timer = pwm_aplicado[pwm_index].timer;
+    pwm_aplicado[pwm_index] = aplicado;
     return ESP_OK;
 }
 
-static void processa_post_request(struct parametros_pwm *pwm,char *content)
+
+
+static uint32_t aplica_lote_ledc(struct lote_ledc *lote)
 {
-    int index;
-    if (strstr(content, "pwm0"))
-         index=0;
-    else 
-         index=1;
+    esp_err_t erros[NUM_CANAIS_PWM];
+
+    /* Só escritas de registrador aqui dentro: o set_duty_with_hpoint (que pode esperar um fade) já foi
+     * feito. Os timers são reiniciados antes para os canais travarem os valores novos já alinhados. Um
+     * timer liberado por um canal do lote pode ter sido reconfigurado para outro antes do ledc_stop, o
+     * canal que está sendo desligado fica com o timer novo só durante a passada */
+    portENTER_CRITICAL(&mux_lote_ledc);
+
+    /* Um lote agendado espera o instante aqui, onde nada interrompe a task entre ele e as escritas. O
+     * comando só sai da agenda AGENDA_ANTECEDENCIA_US antes do instante, então a espera com as interrupções
+     * desligadas nunca passa disso; se a task atrasou e o instante já passou, não espera nada */
+    while (esp_timer_get_time() < lote->instante_us)
+        ;
+    uint32_t inicio = xthal_get_ccount();
+    for (int modo = 0; modo < LEDC_SPEED_MODE_MAX; modo++) {
+        for (int t = 0; t < NUM_TIMERS_POR_MODO; t++) {
+            if (lote->reiniciar[modo] & (1u << t))
+                ledc_timer_rst(modo, t);
+        }
+    }
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        if (lote->parar & (1u << i))
+            erros[i] = ledc_stop(modo_do_canal(i), canal_ledc(i), 0);
+        else if (lote->atualizar & (1u << i))
+            erros[i] = ledc_update_duty(modo_do_canal(i), canal_ledc(i));
+    }
+    uint32_t ciclos = xthal_get_ccount() - inicio;
+    portEXIT_CRITICAL(&mux_lote_ledc);
+
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        if (lote->parar & (1u << i))
+            conta_op_ledc(OP_LEDC_PARADA, modo_do_canal(i), canal_ledc(i), 0, erros[i]);
+        else if ((lote->atualizar & (1u << i)) && erros[i] != ESP_OK)
+            ESP_LOGE(TAG, "Canal %d: ledc_update_duty falhou", i);
+    }
+    return ciclos * 1000 / CPU_MHZ;
+}
+
 
-    if (strstr(content, "desligado"))
-        pwm[index].estado=0;
+static esp_err_t conta_op_ledc(enum op_ledc op, ledc_mode_t modo, int indice, uint32_t valor, esp_err_t erro)
+{
+    if (erro == ESP_OK)
+        ops_ledc_aplicadas[op]++;
     else
-        pwm[index].estado=1;
-     
-    //O numero de dígitos que a variável frequência possui
-    int tamanho_freq=strchr(strstr(content, "freq"), '&')- strchr(strstr(content, "freq"), '=')-1;
-    //variavel para armazenar a string da frequencia
-    char frequencia[10];
-    //copia a frequencia que chegou no vetor 'content' para a string
-    strncpy(frequencia, (strchr(strstr(content, "freq"), '=')+1), tamanho_freq);
-    //converte a string frequencia em int e salva
-    pwm[index].frequencia=atoi(frequencia);
+        ops_ledc_falhas[op]++;
 
-    //O numero de dígitos que a variável percentual_duty possui
-    int tamanho_duty=strchr(strstr(content, "duty"), '&')- strchr(strstr(content, "duty"), '=')-1;
-    //variavel para armazenar a string do duty
-    char duty[10];
-    //copia o duty que chegou no vetor 'content' para a string
-    strncpy(duty, (strchr(strstr(content, "duty"), '=')+1), tamanho_duty);
-    //converte a string duty em int e salva
-    pwm[index].percentual_duty=atoi(duty);
+    struct registro_op_ledc *registro = &trace_ledc[trace_ledc_total % TRACE_LEDC_TAMANHO];
+    registro->instante_us = esp_timer_get_time();
+    registro->valor       = valor;
+    registro->op          = op;
+    registro->modo        = modo;
+    registro->indice      = indice;
+    registro->falhou      = (erro != ESP_OK);
+    trace_ledc_total++;
+    return erro;
 }
 
 
-//retorna o log na base 2 do valor recebido
-static int calc_resolucao_duty(long double pwm_freq,long double timer_clk_freq)
 
 
-    //PWM duty Resolution(bits)= |log2 (   PWMFreq      )|
-    //                           |      --------------   |
-    //                           |      timer_clk_freq   |
+/*---------------------------Geradores de sinal dos canais: LEDC, MCPWM e RMT---------------------------------*/
+
+static esp_err_t calcula_saida(const struct parametros_pwm *parametros, struct pwm_aplicado *aplicado)
 {
-    long double frac = pwm_freq/timer_clk_freq;
-    long double retorno= (logl(frac)/logl(2));
-    return (uint32_t)abs((int)retorno);
+    if (parametros->gerador < 0 || parametros->gerador >= NUM_GERADORES)
+        return ESP_ERR_INVALID_ARG;
+    return geradores_pwm[parametros->gerador].calcula(parametros, aplicado);
 }
 
 
-//Atualiza o sinal PWM baseado no canal selecionado, na frequência pedida e na porcentagem do duty
-static void atualiza_PWM(int pwm_index,uint32_t frequencia, uint32_t percentual_duty){
+static bool parametros_validos(const struct parametros_pwm *parametros)
+{
+    if (parametros->frequencia < 1 || parametros->frequencia > PWM_FREQUENCIA_MAXIMA ||
+        parametros->duty_fino < 0 || parametros->duty_fino > DUTY_FINO_MAXIMO ||
+        parametros->fase < 0 || parametros->fase > DUTY_FINO_MAXIMO ||
+        parametros->gerador < 0 || parametros->gerador >= NUM_GERADORES ||
+        parametros->tempo_morto_ns < 0 || parametros->tempo_morto_ns > GERADOR_TEMPO_MORTO_MAXIMO_NS ||
+        parametros->pulsos < 0 || parametros->pulsos > GERADOR_RMT_PULSOS_MAXIMOS)
+        return false;
+
+    //o LEDC faz qualquer frequência da faixa; no MCPWM e no RMT depende da frequência, do duty e dos pulsos
+    struct pwm_aplicado aplicado;
+    return parametros->gerador == GERADOR_LEDC || calcula_saida(parametros, &aplicado) == ESP_OK;
+}
 
 
-    int timer_clk_freq;                 // 80 MHz é a velocidade do clock APB. Na função 
-                                        // "inicializa variaveis", se quiser usar outro clock, usando
-                                        // um valor diferente de LEDC_USE_APB_CLK terá que adaptar
-                                        // a variavel "timer_clk_freq" com a frequência do clock
-                                        // selecionado que achar no datasheet
-    
-    timer_clk_freq=80000000;
+static esp_err_t atualiza_saida(int pwm_index, const struct parametros_pwm *parametros, uint32_t rampa_ms,
+                                struct lote_ledc *lote)
+{
+    //desligado, o canal fica com o LEDC parado, como no boot
+    int gerador = parametros->estado ? parametros->gerador : GERADOR_LEDC;
+    if (gerador != gerador_ativo[pwm_index]) {
+        geradores_pwm[gerador_ativo[pwm_index]].libera(pwm_index);
+        gerador_ativo[pwm_index] = (uint8_t)gerador;
+        trocas_gerador++;
+    }
+    return geradores_pwm[gerador].aplica(pwm_index, parametros, rampa_ms, lote);
+}
 
 
-   // uint32_t resolucao_duty= calc_resolucao_duty(frequencia,timer_clk_freq);
-    uint32_t resolucao_duty=4;
+static void libera_saida_ledc(int pwm_index)
+{
+    //o canal para agora e não no lote: o outro gerador pode começar ainda nesta passada
+    if (pwm_aplicado[pwm_index].estado)
+        conta_op_ledc(OP_LEDC_PARADA, modo_do_canal(pwm_index), canal_ledc(pwm_index), 0,
+                      ledc_stop(modo_do_canal(pwm_index), canal_ledc(pwm_index), 0));
+    libera_timer_pwm(pwm_index);
+    pwm_aplicado[pwm_index] = (struct pwm_aplicado){ .timer = -1 };
+}
 
-    ESP_LOGI(TAG,"Atualizar PWM: Freq: %d, Duty: %d, Resolução: %d",
-            frequencia,
-            percentual_duty,
-            resolucao_duty);
 
-    //aplica a Resolução do Duty(bits) no timer correto  
-    ESP_ERROR_CHECK(ledc_timer_set(LEDC_HIGH_SPEED_MODE,pwm_index,1,resolucao_duty,LEDC_USE_APB_CLK));
+static void devolve_pino_ledc(int pwm_index)
+{
+    int vizinho = pwm_index ^ 1;
+    if (gerador_ativo[vizinho] == GERADOR_MCPWM && complementar_ativo[vizinho])
+        return;
+    //o canal do LEDC já está parado em nível baixo, o pino só volta para a saída dele na matriz
+    ledc_set_pin(pinos_pwm[pwm_index], modo_do_canal(pwm_index), canal_ledc(pwm_index));
+}
 
-    //Atualiza Frequência no timer correto
-    ESP_ERROR_CHECK(ledc_set_freq(LEDC_HIGH_SPEED_MODE,pwm_index,frequencia));
 
-    //transforma o valor do duty de percentual para bits
-    double duty_double = (pow(2.0,(double)resolucao_duty)*((double)percentual_duty/100.0));
-    uint32_t duty = (uint32_t)duty_double;
+static esp_err_t conta_escrita_gerador(enum gerador gerador, esp_err_t erro)
+{
+    if (erro == ESP_OK)
+        escritas_gerador[gerador]++;
+    else
+        falhas_gerador[gerador]++;
+    return erro;
+}
 
-    ESP_LOGE(TAG, "Duty: %zu",duty);
-    // Atualiza o duty cicle do canal
-    ESP_ERROR_CHECK(ledc_set_duty(LEDC_HIGH_SPEED_MODE,pwm_index,duty));
 
-    // Aplica as configurações
-    ESP_ERROR_CHECK(ledc_update_duty(LEDC_HIGH_SPEED_MODE,pwm_index));
+static esp_err_t calcula_saida_mcpwm(const struct parametros_pwm *parametros, struct pwm_aplicado *aplicado)
+{
+    struct config_mcpwm config;
+    uint32_t tempo_morto_ns = parametros->complementar ? (uint32_t)parametros->tempo_morto_ns : 0;
+    if (!gerador_calcula_mcpwm(parametros->frequencia, parametros->duty_fino, tempo_morto_ns, &config))
+        return ESP_ERR_INVALID_ARG;
 
-    ESP_LOGE(TAG, " duty retornado: %d",ledc_get_duty(LEDC_HIGH_SPEED_MODE,pwm_index));
+    //sem fase: o pulso começa no início do período
+    *aplicado = (struct pwm_aplicado){
+        .estado         = parametros->estado,
+        .frequencia     = (uint32_t)((config.frequencia_mhz + 500) / 1000),
+        .resolucao_duty = 31 - __builtin_clz(config.periodo),
+        .duty           = config.comparador,
+        .hpoint         = 0,
+        .erro_ppm       = config.erro_ppm,
+        .timer          = -1,
+        .gerador        = GERADOR_MCPWM,
+    };
+    return ESP_OK;
 }
 
 
-
-static void cria_delay(void *pvParameter)
+/* Um operador do MCPWM é o timer n da unidade (operador / 3) com as saídas A e B do mesmo número. O duty é
+ * escrito em percentual (float) porque é o que o driver aceita: meio tick a mais faz a conta dele, que
+ * trunca, cair no comparador calculado aqui. A rampa do sequenciador não existe no MCPWM e o valor final é
+ * escrito direto */
+static esp_err_t atualiza_saida_mcpwm(int pwm_index, const struct parametros_pwm *parametros, uint32_t rampa_ms,
+                                      struct lote_ledc *lote)
 {
-    while(1)
-    {
-        vTaskDelay(100 / portTICK_RATE_MS);
+    struct config_mcpwm config;
+    uint32_t tempo_morto_ns = parametros->complementar ? (uint32_t)parametros->tempo_morto_ns : 0;
+    if (!gerador_calcula_mcpwm(parametros->frequencia, parametros->duty_fino, tempo_morto_ns, &config)) {
+        ESP_LOGE(TAG, "Frequencia impossivel para o MCPWM: %d Hz", parametros->frequencia);
+        return ESP_ERR_INVALID_ARG;
     }
-    
-}
\ No newline at end of file
+
+    int operador = pwm_aplicado[pwm_index].timer;
+    bool novo = (operador < 0);
+    if (novo) {
+        operador = 0;
+        while (operador < GERADOR_MCPWM_OPERADORES && canal_do_operador_mcpwm[operador] >= 0)
+            operador++;
+        if (operador == GERADOR_MCPWM_OPERADORES)
+            return ESP_ERR_NOT_FOUND;       //outro canal ainda vai liberar um nesta passada
+    }
+    mcpwm_unit_t  unidade = (mcpwm_unit_t)(operador / 3);
+    mcpwm_timer_t timer   = (mcpwm_timer_t)(operador % 3);
+    const struct config_mcpwm *anterior = &config_operador_mcpwm[operador];
+    float percentual = (config.comparador + 0.5f) * 100.0f / config.periodo;
+    esp_err_t erro = ESP_OK;
+
+    //um prescaler novo ou a saída complementar mudando pedem o timer configurado de novo
+    bool configura = novo || anterior->prescaler != config.prescaler ||
+                     complementar_ativo[pwm_index] != parametros->complementar;
+    if (configura) {
+        if (!novo)
+            mcpwm_stop(unidade, timer);
+        mcpwm_config_t mcpwm = {
+            .frequency    = (uint32_t)parametros->frequencia,
+            .cmpr_a       = percentual,
+            .cmpr_b       = 0,
+            .duty_mode    = MCPWM_DUTY_MODE_0,
+            .counter_mode = MCPWM_UP_COUNTER,
+        };
+        erro = mcpwm_timer_set_resolution(unidade, timer, GERADOR_MCPWM_CLOCK_HZ / config.prescaler);
+        if (erro == ESP_OK)
+            erro = mcpwm_init(unidade, timer, &mcpwm);
+        if (erro == ESP_OK)
+            erro = mcpwm_gpio_init(unidade, (mcpwm_io_signals_t)(MCPWM0A + 2 * timer), pinos_pwm[pwm_index]);
+        if (erro == ESP_OK && parametros->complementar)
+            erro = mcpwm_gpio_init(unidade, (mcpwm_io_signals_t)(MCPWM0B + 2 * timer), pinos_pwm[pwm_index ^ 1]);
+    } else if (anterior->periodo != config.periodo || anterior->comparador != config.comparador) {
+        //o período e o comparador novos valem a partir do próximo período, sem glitch
+        if (anterior->periodo != config.periodo)
+            erro = mcpwm_set_frequency(unidade, timer, (uint32_t)parametros->frequencia);
+        if (erro == ESP_OK)
+            erro = mcpwm_set_duty(unidade, timer, MCPWM_GEN_A, percentual);
+    }
+    if (erro == ESP_OK && (configura || anterior->tempo_morto != config.tempo_morto)) {
+        //no modo complementar a saída B é a A invertida, as duas com a borda de subida atrasada
+        erro = parametros->complementar
+             ? mcpwm_deadtime_enable(unidade, timer, MCPWM_ACTIVE_HIGH_COMPLIMENT_MODE,
+                                     config.tempo_morto, config.tempo_morto)
+             : mcpwm_deadtime_disable(unidade, timer);
+    }
+    if (conta_escrita_gerador(GERADOR_MCPWM, erro) != ESP_OK) {
+        ESP_LOGE(TAG, "Canal %d: falha no operador %d do MCPWM: %s", pwm_index, operador, esp_err_to_name(erro));
+        if (novo) {
+            //o operador continua livre e os pinos voltam para o LEDC
+            mcpwm_stop(unidade, timer);
+            devolve_pino_ledc(pwm_index);
+            if (parametros->complementar && gerador_ativo[pwm_index ^ 1] == GERADOR_LEDC)
+                devolve_pino_ledc(pwm_index ^ 1);
+        }
+        return erro;
+    }
+
+    canal_do_operador_mcpwm[operador] = (int8_t)pwm_index;
+    config_operador_mcpwm[operador]   = config;
+    bool devolve_vizinho = complementar_ativo[pwm_index] && !parametros->complementar;
+    complementar_ativo[pwm_index] = parametros->complementar;
+    if (devolve_vizinho && gerador_ativo[pwm_index ^ 1] == GERADOR_LEDC)
+        devolve_pino_ledc(pwm_index ^ 1);
+
+    calcula_saida_mcpwm(parametros, &pwm_aplicado[pwm_index]);
+    pwm_aplicado[pwm_index].timer = (int8_t)operador;
+    return ESP_OK;
+}
+
+
+static void libera_saida_mcpwm(int pwm_index)
+{
+    int operador = pwm_aplicado[pwm_index].timer;
+    if (operador >= 0) {
+        mcpwm_stop((mcpwm_unit_t)(operador / 3), (mcpwm_timer_t)(operador % 3));
+        canal_do_operador_mcpwm[operador] = -1;
+    }
+    bool complementar = complementar_ativo[pwm_index];
+    complementar_ativo[pwm_index] = false;
+    devolve_pino_ledc(pwm_index);
+    if (complementar && gerador_ativo[pwm_index ^ 1] == GERADOR_LEDC)
+        devolve_pino_ledc(pwm_index ^ 1);
+    pwm_aplicado[pwm_index] = (struct pwm_aplicado){ .timer = -1 };
+}
+
+
+static esp_err_t calcula_saida_rmt(const struct parametros_pwm *parametros, struct pwm_aplicado *aplicado)
+{
+    struct config_rmt config;
+    if (!gerador_calcula_rmt(parametros->frequencia, parametros->duty_fino, parametros->pulsos, &config))
+        return ESP_ERR_INVALID_ARG;
+
+    uint32_t periodo = config.ticks_alto + config.ticks_baixo;
+    *aplicado = (struct pwm_aplicado){
+        .estado         = parametros->estado,
+        .frequencia     = (uint32_t)((config.frequencia_mhz + 500) / 1000),
+        .resolucao_duty = 31 - __builtin_clz(periodo),
+        .duty           = config.ticks_alto,
+        .hpoint         = 0,
+        .erro_ppm       = config.erro_ppm,
+        .timer          = -1,
+        .gerador        = GERADOR_RMT,
+    };
+    return ESP_OK;
+}
+
+
+/* O RMT lê o bloco de itens do canal: com pulsos = 0 o modo de laço repete o período para sempre, com
+ * pulsos > 0 a rajada sai uma vez e a saída fica baixa. Reaplicar os mesmos valores não repete a rajada,
+ * para isso o canal é desligado e ligado de novo (ou os pulsos mudam) */
+static esp_err_t atualiza_saida_rmt(int pwm_index, const struct parametros_pwm *parametros, uint32_t rampa_ms,
+                                    struct lote_ledc *lote)
+{
+    struct config_rmt config;
+    if (!gerador_calcula_rmt(parametros->frequencia, parametros->duty_fino, parametros->pulsos, &config)) {
+        ESP_LOGE(TAG, "Sinal impossivel para o RMT: %d Hz com %d pulsos", parametros->frequencia, parametros->pulsos);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int canal = pwm_aplicado[pwm_index].timer;
+    bool novo = (canal < 0);
+    esp_err_t erro = ESP_OK;
+    if (novo) {
+        canal = 0;
+        while (canal < GERADOR_RMT_CANAIS && canal_do_rmt[canal] >= 0)
+            canal++;
+        if (canal == GERADOR_RMT_CANAIS)
+            return ESP_ERR_NOT_FOUND;       //outro canal ainda vai liberar um nesta passada
+
+        rmt_config_t rmt = RMT_DEFAULT_CONFIG_TX(pinos_pwm[pwm_index], (rmt_channel_t)canal);
+        rmt.clk_div                  = (uint8_t)config.divisor;
+        rmt.tx_config.loop_en        = (parametros->pulsos == 0);
+        rmt.tx_config.idle_level     = RMT_IDLE_LEVEL_LOW;
+        rmt.tx_config.idle_output_en = true;
+        erro = rmt_config(&rmt);
+        if (erro != ESP_OK) {
+            conta_escrita_gerador(GERADOR_RMT, erro);
+            ESP_LOGE(TAG, "Canal %d: falha no canal %d do RMT: %s", pwm_index, canal, esp_err_to_name(erro));
+            devolve_pino_ledc(pwm_index);
+            return erro;
+        }
+    } else if (config_canal_rmt[canal].divisor == config.divisor &&
+               config_canal_rmt[canal].ticks_alto == config.ticks_alto &&
+               config_canal_rmt[canal].ticks_baixo == config.ticks_baixo &&
+               pulsos_canal_rmt[canal] == (uint32_t)parametros->pulsos) {
+        calcula_saida_rmt(parametros, &pwm_aplicado[pwm_index]);
+        pwm_aplicado[pwm_index].timer = (int8_t)canal;
+        return ESP_OK;
+    } else {
+        rmt_tx_stop((rmt_channel_t)canal);
+        erro = rmt_set_clk_div((rmt_channel_t)canal, (uint8_t)config.divisor);
+        if (erro == ESP_OK)
+            erro = rmt_set_tx_loop_mode((rmt_channel_t)canal, parametros->pulsos == 0);
+    }
+
+    int itens = gerador_monta_itens_rmt(&config, parametros->pulsos, itens_rmt[canal], GERADOR_RMT_ITENS_MAXIMOS);
+    if (erro == ESP_OK)
+        erro = rmt_write_items((rmt_channel_t)canal, (const rmt_item32_t *)itens_rmt[canal], itens, false);
+    if (conta_escrita_gerador(GERADOR_RMT, erro) != ESP_OK) {
+        ESP_LOGE(TAG, "Canal %d: falha ao escrever no RMT: %s", pwm_index, esp_err_to_name(erro));
+        if (novo)
+            devolve_pino_ledc(pwm_index);
+        return erro;
+    }
+
+    canal_do_rmt[canal]     = (int8_t)pwm_index;
+    config_canal_rmt[canal] = config;
+    pulsos_canal_rmt[canal] = (uint32_t)parametros->pulsos;
+    calcula_saida_rmt(parametros, &pwm_aplicado[pwm_index]);
+    pwm_aplicado[pwm_index].timer = (int8_t)canal;
+    return ESP_OK;
+}
+
+
+static void libera_saida_rmt(int pwm_index)
+{
+    int canal = pwm_aplicado[pwm_index].timer;
+    if (canal >= 0) {
+        rmt_tx_stop((rmt_channel_t)canal);     //o driver continua instalado para o próximo canal que usar
+        canal_do_rmt[canal] = -1;
+    }
+    devolve_pino_ledc(pwm_index);
+    pwm_aplicado[pwm_index] = (struct pwm_aplicado){ .timer = -1 };
+}
+
+
+static esp_err_t calcula_frequencia_prevista(const struct parametros_pwm *parametros, uint64_t *frequencia_mhz)
+{
+    if (parametros->gerador == GERADOR_LEDC) {
+        struct config_timer_pwm config;
+        esp_err_t erro = calcula_timer_calibrado(parametros->frequencia, &config);
+        *frequencia_mhz = config.frequencia_mhz;
+        return erro;
+    }
+    if (parametros->gerador == GERADOR_MCPWM) {
+        struct config_mcpwm config;
+        if (!gerador_calcula_mcpwm(parametros->frequencia, parametros->duty_fino, 0, &config))
+            return ESP_ERR_INVALID_ARG;
+        *frequencia_mhz = config.frequencia_mhz;
+        return ESP_OK;
+    }
+    struct config_rmt config;
+    if (!gerador_calcula_rmt(parametros->frequencia, parametros->duty_fino, parametros->pulsos, &config))
+        return ESP_ERR_INVALID_ARG;
+    *frequencia_mhz = config.frequencia_mhz;
+    return ESP_OK;
+}
+
+/*-------------------Troca de configuração entre os handlers e a task do PWM (seqlocks)----------------------*/
+
+static bool config_cabe_no_hardware(const struct parametros_pwm *config)
+{
+    //só a contagem dos recursos: roda dentro da seção crítica da publicação. Se cada canal é possível no
+    //seu gerador é conferido antes, pelo parametros_validos de quem recebe o pedido
+    struct canal_gerador canais[NUM_CANAIS_PWM];
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        canais[i] = (struct canal_gerador){
+            .ligado       = config[i].estado,
+            .gerador      = (uint8_t)config[i].gerador,
+            .complementar = config[i].complementar,
+            .frequencia   = (uint32_t)config[i].frequencia,
+        };
+    }
+    return gerador_config_cabe(canais, NUM_CANAIS_PWM, NUM_CANAIS_POR_MODO, NUM_TIMERS_POR_MODO);
+}
+
+
+static esp_err_t publica_config_pwm(uint32_t mascara, const struct parametros_pwm *novos)
+{
+    esp_err_t erro = ESP_OK;
+    struct parametros_pwm proposta[NUM_CANAIS_PWM];
+
+    portENTER_CRITICAL(&mux_config_pwm);
+
+    //monta a configuração completa que ficaria valendo e só publica se ela couber nos timers
+    for (int i = 0; i < NUM_CANAIS_PWM; i++)
+        proposta[i] = (mascara & (1u << i)) ? novos[i] : config_pwm[i];
+
+    if (!config_cabe_no_hardware(proposta)) {
+        erro = ESP_ERR_NOT_FOUND;
+    } else {
+        seqlock_inicia_escrita(&seq_config_pwm);
+        memcpy(config_pwm, proposta, sizeof(config_pwm));
+        instante_publicacao_us = esp_timer_get_time();
+        seqlock_termina_escrita(&seq_config_pwm);
+    }
+
+    portEXIT_CRITICAL(&mux_config_pwm);
+
+    if (erro == ESP_OK && task_pwm_handle != NULL)
+        xTaskNotifyGive(task_pwm_handle);
+    if (erro == ESP_OK && task_nvs_handle != NULL)
+        xTaskNotifyGive(task_nvs_handle);
+    return erro;
+}
+
+
+//Lê a configuração pedida e o instante em que ela foi publicada
+static void le_config_pwm_com_instante(struct parametros_pwm *destino, int64_t *instante_us)
+{
+    uint32_t seq;
+    do {
+        seq = seqlock_inicia_leitura(&seq_config_pwm);
+        memcpy(destino, config_pwm, sizeof(config_pwm));
+        *instante_us = instante_publicacao_us;
+    } while (seqlock_repete_leitura(&seq_config_pwm, seq));
+}
+
+
+static void le_config_pwm(struct parametros_pwm *destino)
+{
+    int64_t instante_us;
+    le_config_pwm_com_instante(destino, &instante_us);
+}
+
+
+static void le_estado_publicado(struct parametros_pwm *pedido, struct pwm_aplicado *aplicado)
+{
+    uint32_t seq;
+    do {
+        seq = seqlock_inicia_leitura(&seq_estado_publicado);
+        memcpy(pedido, estado_publicado.pedido, sizeof(estado_publicado.pedido));
+        memcpy(aplicado, estado_publicado.aplicado, sizeof(estado_publicado.aplicado));
+    } while (seqlock_repete_leitura(&seq_estado_publicado, seq));
+}
+
+
+static void le_estado_sequencias(struct estado_sequencia *destino)
+{
+    uint32_t seq;
+    do {
+        seq = seqlock_inicia_leitura(&seq_estado_publicado);
+        memcpy(destino, estado_publicado.sequencias, sizeof(estado_publicado.sequencias));
+    } while (seqlock_repete_leitura(&seq_estado_publicado, seq));
+}
+
+
+/*-----------Task do PWM: espera uma nova configuração, aplica o que mudou e publica o resultado------------*/
+static void task_pwm(void *pvParameter)
+{
+    static struct parametros_pwm pedido[NUM_CANAIS_PWM];
+    static struct parametros_pwm alvo[NUM_CANAIS_PWM];
+    static struct parametros_pwm ultimo_aplicado[NUM_CANAIS_PWM];
+    uint32_t pendentes = 0;     //canais cujo pedido ainda não foi aplicado
+    int64_t  instante_us;
+    int64_t  ultimo_instante_us = -1;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        //troca de preset: todos os canais são publicados juntos e aplicados nesta mesma passada, num lote
+        //só. O preset vale para todos os canais, então os programas do sequenciador param. Ele cabia nos
+        //timers quando foi salvo, mas a calibração pode ter mudado desde então: uma troca recusada não
+        //muda o preset atual nem conta na latência
+        static struct parametros_pwm canais_preset[NUM_CANAIS_PWM];
+        uint32_t pedido_preset_us = 0;
+        int indice_preset = recebe_troca_preset(canais_preset, &pedido_preset_us);
+        bool trocou_preset = false;
+        if (indice_preset >= 0) {
+            if (publica_config_pwm(UINT32_MAX, canais_preset) == ESP_OK) {
+                for (int i = 0; i < NUM_CANAIS_PWM; i++)
+                    sequencias[i].executando = false;
+                preset_atual  = indice_preset;
+                trocou_preset = true;
+            } else {
+                ESP_LOGW(TAG, "Preset %d nao cabe nos timers", indice_preset);
+                trocas_preset_recusadas++;
+            }
+        }
+
+        //programas novos e passos vencidos do sequenciador. Uma sequência que termina publica os valores
+        //finais como a configuração do canal, por isso isso vem antes de ler a configuração
+        uint32_t vencidos;
+        recebe_programa_sequencia();
+        uint32_t sequenciados = executa_sequencias(esp_timer_get_time(), &vencidos);
+
+        //comando agendado que está para vencer (o timer acorda a task um pouco antes): publica já, a
+        //aplicação abaixo vai num lote só e o aplica_lote_ledc espera o instante para fazer as escritas
+        static struct comando_agendado comando;
+        bool agendado = retira_comando_agendado(esp_timer_get_time() + AGENDA_ANTECEDENCIA_US, &comando);
+        if (agendado) {
+            if (publica_config_pwm(comando.mascara, comando.canais) != ESP_OK) {
+                ESP_LOGW(TAG, "Comando agendado para os canais 0x%04x nao cabe nos timers", comando.mascara);
+                comandos_agendados_recusados++;
+                agendado = false;
+            }
+        }
+
+        //uma calibração nova muda o divisor das frequências da faixa: todos os canais passam de novo pelo
+        //atualiza_saida, que só escreve nos registradores o que mudou
+        if (__atomic_exchange_n(&calibracao_alterada, false, __ATOMIC_ACQ_REL))
+            pendentes = (1u << NUM_CANAIS_PWM) - 1;
+
+        //os canais com uma sequência seguem a sequência, os outros a configuração publicada
+        le_config_pwm_com_instante(pedido, &instante_us);
+        for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+            alvo[i] = (sequenciados & (1u << i)) ? sequencias[i].saida : pedido[i];
+            if (!parametros_iguais(&alvo[i], &ultimo_aplicado[i]))
+                pendentes |= 1u << i;
+        }
+
+        /* Um canal pode precisar do timer (ou do operador do MCPWM, ou do canal do RMT) que outro ainda
+         * vai liberar (duas trocas na mesma publicação), então os que falham são tentados de novo enquanto
+         * houver progresso. A publicação já garantiu que a configuração final cabe no hardware */
+        int64_t inicio_aplicacao_us = esp_timer_get_time();
+        uint32_t nao_aplicados = 0;
+        struct lote_ledc lote = {.instante_us = agendado ? comando.instante_us : 0};
+        while (pendentes) {
+            uint32_t falhas = 0;
+            for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+                if (!(pendentes & (1u << i)))
+                    continue;
+                uint32_t rampa_ms = (sequenciados & (1u << i)) ? sequencias[i].rampa_ms : 0;
+                if (atualiza_saida(i, &alvo[i], rampa_ms, &lote) == ESP_OK)
+                    ultimo_aplicado[i] = alvo[i];
+                else
+                    falhas |= 1u << i;
+            }
+            if (falhas == pendentes) {
+                ESP_LOGE(TAG, "Nao foi possivel aplicar os canais 0x%04x", falhas);
+                canais_nao_aplicados += __builtin_popcount(falhas);
+                nao_aplicados = falhas;
+                pendentes = 0;
+                break;
+            }
+            pendentes = falhas;
+        }
+
+        //todos os canais desta passada mudam juntos. O comando agendado pode pedir os timers dos seus
+        //canais reiniciados, para as fases (hpoint) de timers diferentes ficarem alinhadas
+        if (agendado && comando.sincroniza) {
+            for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+                if ((comando.mascara & (1u << i)) && pwm_aplicado[i].gerador == GERADOR_LEDC &&
+                    pwm_aplicado[i].timer >= 0)
+                    lote.reiniciar[modo_do_canal(i)] |= 1u << pwm_aplicado[i].timer;
+            }
+        }
+        if (lote.atualizar || lote.parar || lote.reiniciar[0] || lote.reiniciar[1]) {
+            janela_lote_ultima_ns = aplica_lote_ledc(&lote);
+            if (janela_lote_ultima_ns > janela_lote_maxima_ns)
+                janela_lote_maxima_ns = janela_lote_ultima_ns;
+            lotes_ledc++;
+        }
+
+        int64_t agora_us = esp_timer_get_time();
+        if (agendado) {
+            int64_t atraso_us = agora_us - comando.instante_us;
+            registra_latencia(MET_AGENDA_ATRASO, atraso_us);
+            if (atraso_us > atraso_maximo_agenda_us)
+                atraso_maximo_agenda_us = (uint32_t)atraso_us;
+            comandos_agendados_executados++;
+        }
+        if (trocou_preset) {
+            registra_latencia(MET_PRESET_TROCA, (uint32_t)agora_us - pedido_preset_us);   //dá a volta em 71 min
+            trocas_preset++;
+        }
+        for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+            struct execucao_sequencia *s = &sequencias[i];
+            s->rampa_ms = 0;
+            if (vencidos & (1u << i)) {
+                //atraso do passo: do prazo até a saída estar escrita no LEDC
+                int64_t atraso_us = agora_us - s->prazo_vencido_us;
+                registra_latencia(MET_SEQUENCIA_ATRASO, atraso_us);
+                if (atraso_us > s->atraso_maximo_us)
+                    s->atraso_maximo_us = (uint32_t)atraso_us;
+            }
+            //uma sequência que pede o que o LEDC não consegue fazer (nenhum timer livre para a
+            //frequência) é interrompida e o canal volta para a configuração
+            if ((sequenciados & nao_aplicados & (1u << i)) && s->executando) {
+                ESP_LOGW(TAG, "Sequencia do canal %d interrompida no passo %d", i, s->passo);
+                s->executando = false;
+                sequencias_interrompidas++;
+                xTaskNotifyGive(task_pwm_handle);
+            }
+        }
+
+        //os tempos da publicação só contam quando houve uma publicação nova (a task também acorda
+        //pelo timer do sequenciador)
+        int64_t latencia_us = agora_us - instante_us;
+        if (instante_us != ultimo_instante_us) {
+            registra_latencia(MET_FASE_APLICACAO, agora_us - inicio_aplicacao_us);
+            registra_latencia(MET_PUBLICACAO_APLICACAO, latencia_us);
+            ultimo_instante_us = instante_us;
+        }
+        if (instante_primeira_saida_us == 0) {
+            instante_primeira_saida_us = agora_us;
+            ESP_LOGI(TAG, "Saidas do PWM validas em %lld ms desde o boot", agora_us / 1000);
+        }
+
+        //publica o estado aplicado para os handlers (esta task é a única que escreve)
+        seqlock_inicia_escrita(&seq_estado_publicado);
+        memcpy(estado_publicado.pedido, ultimo_aplicado, sizeof(estado_publicado.pedido));
+        memcpy(estado_publicado.aplicado, pwm_aplicado, sizeof(estado_publicado.aplicado));
+        for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+            estado_publicado.sequencias[i] = (struct estado_sequencia){
+                .executando        = sequencias[i].executando,
+                .passo             = sequencias[i].passo,
+                .num_passos        = sequencias[i].num_passos,
+                .passos_executados = sequencias[i].passos_executados,
+                .atraso_maximo_us  = sequencias[i].atraso_maximo_us,
+            };
+        }
+        seqlock_termina_escrita(&seq_estado_publicado);
+        if (num_assinantes_ws > 0)
+            xTaskNotifyGive(task_ws_handle);       //ela descobre o que mudou e junta as mudanças próximas
+
+        //arma o timer para o próximo passo ou comando agendado. Um prazo que já passou é atendido na
+        //próxima volta
+        int64_t proximo_us = proximo_prazo_sequencias();
+        int64_t proximo_comando_us = proximo_comando_agendado();
+        if (proximo_comando_us != INT64_MAX && proximo_comando_us - AGENDA_ANTECEDENCIA_US < proximo_us)
+            proximo_us = proximo_comando_us - AGENDA_ANTECEDENCIA_US;
+        if (proximo_us != INT64_MAX) {
+            int64_t espera_us = proximo_us - esp_timer_get_time();
+            esp_timer_stop(timer_sequencia);            //pode não estar rodando, o erro não importa
+            if (espera_us > 0)
+                esp_timer_start_once(timer_sequencia, (uint64_t)espera_us);
+            else
+                xTaskNotifyGive(task_pwm_handle);
+        }
+
+        ESP_LOGD(TAG, "Configuracao aplicada em %lld us", latencia_us);
+    }
+}
+
+
+
+/*----------------Sequenciador: programas de rampas, varreduras e rajadas executados pela task do PWM---------------*/
+
+static esp_err_t entrega_programa_sequencia(int canal, const struct passo_sequencia *passos, int num_passos)
+{
+    esp_err_t erro = ESP_OK;
+
+    portENTER_CRITICAL(&mux_sequencia);
+    if (sequencia_recebida.canal >= 0) {
+        erro = ESP_ERR_INVALID_STATE;           //a task ainda não pegou o programa anterior
+    } else {
+        memcpy(sequencia_recebida.passos, passos, num_passos * sizeof(passos[0]));
+        sequencia_recebida.num_passos = num_passos;
+        sequencia_recebida.canal      = canal;
+    }
+    portEXIT_CRITICAL(&mux_sequencia);
+
+    if (erro == ESP_OK && task_pwm_handle != NULL)
+        xTaskNotifyGive(task_pwm_handle);
+    return erro;
+}
+
+
+static void recebe_programa_sequencia(void)
+{
+    static struct programa_sequencia programa;
+    bool recebido = false;
+
+    portENTER_CRITICAL(&mux_sequencia);
+    if (sequencia_recebida.canal >= 0) {
+        programa = sequencia_recebida;
+        sequencia_recebida.canal = -1;
+        recebido = true;
+    }
+    portEXIT_CRITICAL(&mux_sequencia);
+    if (!recebido)
+        return;
+
+    struct execucao_sequencia *s = &sequencias[programa.canal];
+    struct parametros_pwm pwm[NUM_CANAIS_PWM];
+    le_config_pwm(pwm);
+    sequencia_inicia(s, programa.passos, programa.num_passos, &pwm[programa.canal], esp_timer_get_time());
+    ESP_LOGI(TAG, "Canal %d: %s", programa.canal,
+             s->executando ? "sequencia iniciada" : "sequencia parada");
+}
+
+
+static uint32_t executa_sequencias(int64_t agora_us, uint32_t *vencidos)
+{
+    uint32_t sequenciados = 0;
+
+    *vencidos = 0;
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        struct execucao_sequencia *s = &sequencias[i];
+        if (s->executando && s->prazo_us <= agora_us) {
+            s->prazo_vencido_us = s->prazo_us;
+            *vencidos |= 1u << i;
+            bool terminou;
+            passos_sequencia += sequencia_avanca(s, agora_us, &terminou);
+            if (terminou) {
+                //os valores finais viram a configuração do canal (e vão para a NVS). Se não couberem nos
+                //timers o canal volta para a configuração que já estava publicada
+                struct parametros_pwm pwm[NUM_CANAIS_PWM];
+                le_config_pwm(pwm);
+                pwm[i] = s->saida;
+                if (publica_config_pwm(1u << i, pwm) != ESP_OK)
+                    ESP_LOGW(TAG, "Canal %d: o fim da sequencia nao cabe nos timers", i);
+                ESP_LOGI(TAG, "Canal %d: sequencia terminada", i);
+            }
+        }
+        if (sequencia_segura_canal(s, agora_us))
+            sequenciados |= 1u << i;
+    }
+    return sequenciados;
+}
+
+
+static int64_t proximo_prazo_sequencias(void)
+{
+    int64_t agora_us   = esp_timer_get_time();
+    int64_t proximo_us = INT64_MAX;
+
+    for (int i = 0; i < NUM_CANAIS_PWM; i++)
+        proximo_us = MIN(proximo_us, sequencia_proximo_prazo(&sequencias[i], agora_us));
+    return proximo_us;
+}
+
+
+static void acorda_task_pwm(void *arg)
+{
+    xTaskNotifyGive(task_pwm_handle);
+}
+
+
+static esp_err_t api_seq_get_handler(httpd_req_t *req)
+{
+    int indice = api_indice_canal(req->uri, "/api/seq");
+    if (indice == -2)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Canal inexistente");
+
+    struct estado_sequencia estado[NUM_CANAIS_PWM];
+    le_estado_sequencias(estado);
+
+    //com índice só o canal, sem índice a lista de todos
+    char json[160];
+    int primeiro = (indice >= 0) ? indice : 0;
+    int ultimo   = (indice >= 0) ? indice : NUM_CANAIS_PWM - 1;
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t erro = (indice >= 0) ? ESP_OK : httpd_resp_send_chunk(req, "[", 1);
+    for (int i = primeiro; erro == ESP_OK && i <= ultimo; i++) {
+        int tamanho = snprintf(json, sizeof(json),
+                               "%s{\"canal\":%d,\"executando\":%s,\"passo\":%u,\"passos\":%u,"
+                               "\"passos_executados\":%u,\"atraso_maximo_us\":%u}",
+                               (i == primeiro) ? "" : ",", i,
+                               estado[i].executando ? "true" : "false",
+                               estado[i].passo, estado[i].num_passos,
+                               estado[i].passos_executados, estado[i].atraso_maximo_us);
+        erro = httpd_resp_send_chunk(req, json, tamanho);
+    }
+    if (erro == ESP_OK && indice < 0)
+        erro = httpd_resp_send_chunk(req, "]", 1);
+    if (erro == ESP_OK)
+        erro = httpd_resp_send_chunk(req, NULL, 0);
+    return erro;
+}
+
+
+static esp_err_t api_seq_put_handler(httpd_req_t *req)
+{
+    int indice = api_indice_canal(req->uri, "/api/seq");
+    if (indice < 0)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Canal inexistente");
+
+    char programa[SEQ_PROGRAMA_TAMANHO_MAXIMO + 1];
+    if (req->content_len > SEQ_PROGRAMA_TAMANHO_MAXIMO)
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Programa muito grande");
+
+    size_t recebido = 0;
+    int64_t prazo_us = esp_timer_get_time() + HTTP_PRAZO_CORPO_MS * 1000;
+    while (recebido < req->content_len) {
+        int ret = recebe_com_prazo(req, programa + recebido, req->content_len - recebido, prazo_us);
+        if (ret <= 0) {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+                httpd_resp_send_408(req);
+            return ESP_FAIL;
+        }
+        recebido += ret;
+    }
+    programa[recebido] = '\0';
+
+    struct passo_sequencia passos[SEQ_MAX_PASSOS];
+    int num_passos = 0;
+    char erro[64];
+    int64_t inicio_us = esp_timer_get_time();
+    bool valido = sequencia_interpreta(programa, passos, &num_passos, erro, sizeof(erro));
+    registra_latencia(MET_FASE_PARSE, esp_timer_get_time() - inicio_us);
+    if (!valido)
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, erro);
+
+    if (entrega_programa_sequencia(indice, passos, num_passos) != ESP_OK) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, "Outro programa sendo carregado", HTTPD_RESP_USE_STRLEN);
+    }
+
+    char json[48];
+    int tamanho = snprintf(json, sizeof(json), "{\"canal\":%d,\"passos\":%d}", indice, num_passos);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, tamanho);
+}
+
+
+static esp_err_t api_seq_delete_handler(httpd_req_t *req)
+{
+    int indice = api_indice_canal(req->uri, "/api/seq");
+    if (indice < 0)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Canal inexistente");
+
+    //sem passos a sequência para e o canal volta para a configuração publicada
+    if (entrega_programa_sequencia(indice, NULL, 0) != ESP_OK) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, "Outro programa sendo carregado", HTTPD_RESP_USE_STRLEN);
+    }
+    httpd_resp_set_status(req, "204 No Content");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+
+
+/*--------------Agenda: comandos com hora marcada, aplicados num lote só pela task do PWM------------------------*/
+
+static esp_err_t agenda_comando(const struct comando_agendado *comando)
+{
+    //recusa já na entrada o que não cabe nos timers com a configuração de agora (na hora de aplicar é
+    //verificado de novo)
+    if (!config_cabe_no_hardware(comando->canais))
+        return ESP_ERR_NOT_FOUND;
+
+    portENTER_CRITICAL(&mux_agenda);
+    esp_err_t erro = agenda_insere(&agenda, comando) ? ESP_OK : ESP_ERR_NO_MEM;
+    portEXIT_CRITICAL(&mux_agenda);
+
+    //a task recalcula quando acordar, com a agenda nova
+    if (erro == ESP_OK && task_pwm_handle != NULL)
+        xTaskNotifyGive(task_pwm_handle);
+    return erro;
+}
+
+
+static bool retira_comando_agendado(int64_t limite_us, struct comando_agendado *comando)
+{
+    portENTER_CRITICAL(&mux_agenda);
+    bool retirado = agenda_retira(&agenda, limite_us, comando);
+    portEXIT_CRITICAL(&mux_agenda);
+    return retirado;
+}
+
+
+static int64_t proximo_comando_agendado(void)
+{
+    portENTER_CRITICAL(&mux_agenda);
+    int64_t instante_us = agenda_proximo(&agenda);
+    portEXIT_CRITICAL(&mux_agenda);
+    return instante_us;
+}
+
+
+static esp_err_t api_agenda_get_handler(httpd_req_t *req)
+{
+    char json[256];
+    int tamanho = snprintf(json, sizeof(json),
+                           "{\"relogio_us\":%lld,\"pendentes\":%d,\"executados\":%u,\"recusados\":%u,"
+                           "\"atraso_maximo_us\":%u,\"lotes\":%u,\"janela_ultima_ns\":%u,\"janela_maxima_ns\":%u}",
+                           esp_timer_get_time(), agenda.num_comandos,
+                           comandos_agendados_executados, comandos_agendados_recusados,
+                           atraso_maximo_agenda_us, lotes_ledc, janela_lote_ultima_ns, janela_lote_maxima_ns);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, tamanho);
+}
+
+
+
+/*-----------Medição das saídas: loopback do pino no PCNT, erro medido e tabela de calibração por faixa-----------*/
+
+static void IRAM_ATTR conta_estouro_pcnt(void *arg)
+{
+    estouros_pcnt++;
+}
+
+
+static void le_contagem_pcnt(struct amostra_contagem *amostra, int64_t pulsos_anteriores)
+{
+    //se a interrupção contou um estouro no meio da leitura, o valor do contador pode ser de antes ou de
+    //depois dele: lê de novo. A conferência espera MEDICAO_ESPERA_ISR_US, para a interrupção de um estouro
+    //que aconteceu logo antes da leitura já ter rodado
+    uint32_t estouros;
+    int16_t contagem;
+    do {
+        estouros = estouros_pcnt;
+        pcnt_get_counter_value(MEDICAO_UNIDADE_PCNT, &contagem);
+        amostra->instante_us = esp_timer_get_time();
+        uint32_t inicio = xthal_get_ccount();
+        while (xthal_get_ccount() - inicio < MEDICAO_ESPERA_ISR_US * CPU_MHZ)
+            ;
+    } while (estouros != estouros_pcnt);
+
+    //se ainda assim a interrupção não rodou, o total fica menor que o da leitura anterior
+    amostra->pulsos = calibracao_pulsos_contados(estouros, contagem, MEDICAO_LIMITE_PCNT, pulsos_anteriores);
+}
+
+
+static esp_err_t mede_canal(int pwm_index, struct medicao_canal *medicao, struct amostra_contagem *amostras)
+{
+    struct parametros_pwm pedido[NUM_CANAIS_PWM];
+    struct pwm_aplicado   aplicado[NUM_CANAIS_PWM];
+    le_estado_publicado(pedido, aplicado);
+    if (!aplicado[pwm_index].estado)
+        return ESP_ERR_INVALID_STATE;
+
+    uint32_t frequencia = pedido[pwm_index].frequencia;
+    uint64_t prevista_mhz;
+    if (calcula_frequencia_prevista(&pedido[pwm_index], &prevista_mhz) != ESP_OK)
+        return ESP_ERR_INVALID_ARG;
+
+    //o pino continua sendo a saída do gerador: só o buffer de entrada dele é ligado e o sinal vai para o
+    //PCNT pela matriz, sem glitch na saída
+    int pino = pinos_pwm[pwm_index];
+    PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[pino]);
+    gpio_matrix_in(pino, PCNT_SIG_CH0_IN0_IDX, false);
+    pcnt_counter_pause(MEDICAO_UNIDADE_PCNT);
+    pcnt_counter_clear(MEDICAO_UNIDADE_PCNT);
+    estouros_pcnt = 0;
+    pcnt_counter_resume(MEDICAO_UNIDADE_PCNT);
+
+    //porta longa o bastante para contar MEDICAO_PULSOS_MINIMOS, lida em MEDICAO_AMOSTRAS pontos
+    TickType_t intervalo = MAX(pdMS_TO_TICKS(medicao_porta_ms(frequencia)) / (MEDICAO_AMOSTRAS - 1), 1);
+    for (int a = 0; a < MEDICAO_AMOSTRAS; a++) {
+        if (a > 0)
+            vTaskDelay(intervalo);
+        le_contagem_pcnt(&amostras[a], (a > 0) ? amostras[a - 1].pulsos : -1);
+    }
+    uint64_t medida_mhz = calibracao_frequencia_medida_mhz(amostras, MEDICAO_AMOSTRAS);
+
+    //duty: lê o pino sem parar durante um número inteiro de períodos. A task tem a menor prioridade do
+    //core, então só a task do PWM e as interrupções interrompem a janela
+    int32_t duty_medido = -1;
+    uint32_t ciclos = calibracao_ciclos_janela_duty(medida_mhz, MEDICAO_JANELA_DUTY_US, CPU_MHZ);
+    if (ciclos > 0) {
+        uint32_t altas = 0, total = 0;
+        uint32_t inicio = xthal_get_ccount();
+        while (xthal_get_ccount() - inicio < ciclos) {
+            altas += gpio_get_level(pino);
+            total++;
+        }
+        duty_medido = calibracao_duty_medido(altas, total);
+    }
+
+    gpio_matrix_in(GPIO_FUNC_IN_LOW, PCNT_SIG_CH0_IN0_IDX, false);
+    PIN_INPUT_DISABLE(GPIO_PIN_MUX_REG[pino]);
+
+    medicao_resultado(medicao, esp_timer_get_time(), &pedido[pwm_index], prevista_mhz, medida_mhz, duty_medido,
+                      amostras);
+    ESP_LOGI(TAG, "Canal %d: pedido %u Hz, medido %llu mHz (erro %d ppm, desvio %d ppm), duty %d/65535 medido %d",
+             pwm_index, frequencia, medida_mhz, medicao->erro_ppm, medicao->desvio_ppm,
+             medicao->duty_pedido, duty_medido);
+    return ESP_OK;
+}
+
+
+static void task_medicao(void *pvParameter)
+{
+    static struct amostra_contagem amostras[MEDICAO_AMOSTRAS];
+
+    //só bordas de subida, sem filtro (o filtro cortaria as frequências mais altas). A entrada do canal é
+    //ligada a um pino de cada vez pelo mede_canal. A interrupção fica neste core, longe do wireless
+    pcnt_config_t pcnt = {
+        .pulse_gpio_num = PCNT_PIN_NOT_USED,
+        .ctrl_gpio_num  = PCNT_PIN_NOT_USED,
+        .lctrl_mode     = PCNT_MODE_KEEP,
+        .hctrl_mode     = PCNT_MODE_KEEP,
+        .pos_mode       = PCNT_COUNT_INC,
+        .neg_mode       = PCNT_COUNT_DIS,
+        .counter_h_lim  = MEDICAO_LIMITE_PCNT,
+        .counter_l_lim  = 0,
+        .unit           = MEDICAO_UNIDADE_PCNT,
+        .channel        = PCNT_CHANNEL_0,
+    };
+    ESP_ERROR_CHECK(pcnt_unit_config(&pcnt));
+    pcnt_filter_disable(MEDICAO_UNIDADE_PCNT);
+    pcnt_event_enable(MEDICAO_UNIDADE_PCNT, PCNT_EVT_H_LIM);
+    ESP_ERROR_CHECK(pcnt_isr_service_install(0));
+    ESP_ERROR_CHECK(pcnt_isr_handler_add(MEDICAO_UNIDADE_PCNT, conta_estouro_pcnt, NULL));
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint32_t calibrar = __atomic_exchange_n(&calibracoes_pedidas, 0, __ATOMIC_ACQ_REL);
+        uint32_t pedidos  = __atomic_exchange_n(&medicoes_pedidas, 0, __ATOMIC_ACQ_REL);
+        bool alterou = false;
+
+        for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+            if (!(pedidos & (1u << i)))
+                continue;
+            struct medicao_canal medicao;
+            if (mede_canal(i, &medicao, amostras) != ESP_OK) {
+                ESP_LOGW(TAG, "Canal %d desligado ou invalido, nao foi medido", i);
+                continue;
+            }
+
+            /* A tabela guarda o desvio contra a conta com o clock nominal (o divisor é o mesmo, só muda o
+             * clock suposto), assim a média não depende da correção que já estava valendo. Ela corrige só
+             * o divisor do LEDC, os outros geradores são medidos mas não calibram */
+            if ((calibrar & (1u << i)) && medicao.gerador == GERADOR_LEDC) {
+                struct config_timer_pwm config;
+                calcula_timer_calibrado(medicao.frequencia_pedida, &config);
+                uint64_t nominal_mhz = calibracao_frequencia_timer_mhz(PWM_CLK_APB, config.divisor,
+                                                                       config.resolucao_duty);
+                int32_t desvio_nominal = calibracao_erro_ppm(medicao.frequencia_medida_mhz, nominal_mhz);
+                portENTER_CRITICAL(&mux_calibracao);
+                medicao.calibrou = calibracao_registra(&calibracao, medicao.frequencia_pedida, desvio_nominal);
+                portEXIT_CRITICAL(&mux_calibracao);
+                if (!medicao.calibrou)
+                    ESP_LOGW(TAG, "Canal %d: desvio de %d ppm fora do plausivel, calibracao ignorada",
+                             i, desvio_nominal);
+                alterou |= medicao.calibrou;
+            }
+
+            portENTER_CRITICAL(&mux_medicao);
+            medicoes[i] = medicao;
+            memcpy(captura, amostras, sizeof(captura));
+            canal_captura = i;
+            portEXIT_CRITICAL(&mux_medicao);
+            medicoes_feitas++;
+        }
+
+        if (alterou) {
+            struct tabela_calibracao tabela;
+            portENTER_CRITICAL(&mux_calibracao);
+            tabela = calibracao;
+            portEXIT_CRITICAL(&mux_calibracao);
+            grava_calibracao(&tabela);
+            __atomic_store_n(&calibracao_alterada, true, __ATOMIC_RELEASE);
+            xTaskNotifyGive(task_pwm_handle);
+        }
+    }
+}
+
+
+static esp_err_t api_medicao_get_handler(httpd_req_t *req)
+{
+    //com os 16 canais medidos passa do buffer de envio do TCP: sai por uma task de envio
+    return responde_por_task_envio(req, "application/json", escreve_medicao);
+}
+
+
+static void escreve_medicao(struct saida_html *saida)
+{
+    //na pilha: as duas tasks de envio podem montar esta resposta ao mesmo tempo
+    struct medicao_canal copia[NUM_CANAIS_PWM];
+    struct amostra_contagem amostras[MEDICAO_AMOSTRAS];
+    struct tabela_calibracao tabela;
+    portENTER_CRITICAL(&mux_medicao);
+    memcpy(copia, medicoes, sizeof(copia));
+    memcpy(amostras, captura, sizeof(amostras));
+    int canal = canal_captura;
+    portEXIT_CRITICAL(&mux_medicao);
+    portENTER_CRITICAL(&mux_calibracao);
+    tabela = calibracao;
+    portEXIT_CRITICAL(&mux_calibracao);
+
+    medicao_envia_json(saida, copia, pinos_pwm, &tabela, canal, amostras);
+}
+
+
+static esp_err_t api_medicao_put_handler(httpd_req_t *req)
+{
+    int indice = api_indice_canal(req->uri, "/api/medicao");
+    if (indice == -2)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Canal inexistente");
+
+    //com índice só o canal, sem índice todos os canais ligados
+    struct parametros_pwm pedido[NUM_CANAIS_PWM];
+    struct pwm_aplicado   aplicado[NUM_CANAIS_PWM];
+    le_estado_publicado(pedido, aplicado);
+    uint32_t mascara = 0;
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        if (aplicado[i].estado && (indice < 0 || indice == i))
+            mascara |= 1u << i;
+    }
+    if (mascara == 0) {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_send(req, "Nenhum canal ligado para medir", HTTPD_RESP_USE_STRLEN);
+    }
+
+    //?calibra=1 junta as medidas na tabela de calibração
+    char query[32];
+    char valor[4];
+    bool calibra = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                   httpd_query_key_value(query, "calibra", valor, sizeof(valor)) == ESP_OK &&
+                   strcmp(valor, "1") == 0;
+    if (calibra)
+        __atomic_fetch_or(&calibracoes_pedidas, mascara, __ATOMIC_RELEASE);
+    __atomic_fetch_or(&medicoes_pedidas, mascara, __ATOMIC_RELEASE);
+    if (task_medicao_handle != NULL)
+        xTaskNotifyGive(task_medicao_handle);
+
+    //a medição leva de 0,1 a 2 s por canal: o resultado sai depois no GET /api/medicao
+    char json[48];
+    int tamanho = snprintf(json, sizeof(json), "{\"canais\":%u,\"calibra\":%s}",
+                           mascara, calibra ? "true" : "false");
+    httpd_resp_set_status(req, "202 Accepted");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, tamanho);
+}
+
+
+static esp_err_t api_medicao_delete_handler(httpd_req_t *req)
+{
+    struct tabela_calibracao vazia;
+    memset(&vazia, 0, sizeof(vazia));
+    portENTER_CRITICAL(&mux_calibracao);
+    calibracao = vazia;
+    portEXIT_CRITICAL(&mux_calibracao);
+
+    esp_err_t erro = grava_calibracao(&vazia);
+    __atomic_store_n(&calibracao_alterada, true, __ATOMIC_RELEASE);
+    xTaskNotifyGive(task_pwm_handle);
+    if (erro != ESP_OK)
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Falha ao gravar na NVS");
+    httpd_resp_set_status(req, "204 No Content");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+
+
+/*--------------Presets: configurações completas com nome, trocadas num lote só pela task do PWM-----------------*/
+
+static esp_err_t pede_preset(int indice)
+{
+    if (indice < 0 || indice >= PRESET_MAXIMO)
+        return ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&mux_presets);
+    bool ocupado = presets[indice].ocupado;
+    portEXIT_CRITICAL(&mux_presets);
+    if (!ocupado)
+        return ESP_ERR_NOT_FOUND;
+
+    __atomic_store_n(&instante_pedido_preset_us, (uint32_t)esp_timer_get_time(), __ATOMIC_RELAXED);
+    __atomic_store_n(&preset_pedido, indice, __ATOMIC_RELEASE);
+    xTaskNotifyGive(task_pwm_handle);
+    return ESP_OK;
+}
+
+
+static esp_err_t pede_preset_vizinho(int passo)
+{
+    if (passo < -PRESET_PASSO_MAXIMO || passo > PRESET_PASSO_MAXIMO)
+        return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&mux_presets);
+    bool algum = preset_algum_ocupado(presets);
+    portEXIT_CRITICAL(&mux_presets);
+    if (!algum || passo == 0)
+        return ESP_ERR_NOT_FOUND;
+
+    __atomic_store_n(&instante_pedido_preset_us, (uint32_t)esp_timer_get_time(), __ATOMIC_RELAXED);
+    __atomic_fetch_add(&passos_preset, passo, __ATOMIC_RELEASE);
+    xTaskNotifyGive(task_pwm_handle);
+    return ESP_OK;
+}
+
+
+//Nada de spinlock nem de cópia aqui: a task do PWM acha o preset e publica os canais
+static void IRAM_ATTR pede_preset_vizinho_isr(int passo)
+{
+    BaseType_t acordou = pdFALSE;
+    __atomic_store_n(&instante_pedido_preset_us, (uint32_t)esp_timer_get_time(), __ATOMIC_RELAXED);
+    __atomic_fetch_add(&passos_preset, passo, __ATOMIC_RELEASE);
+    if (task_pwm_handle != NULL)
+        vTaskNotifyGiveFromISR(task_pwm_handle, &acordou);
+    if (acordou)
+        portYIELD_FROM_ISR();
+}
+
+
+static void IRAM_ATTR botao_preset_isr(void *arg)
+{
+    //o contato do botão repica: bordas logo depois da anterior são ignoradas
+    int64_t agora_us = esp_timer_get_time();
+    if (agora_us - ultimo_botao_preset_us < PRESET_DEBOUNCE_US)
+        return;
+    ultimo_botao_preset_us = agora_us;
+    pede_preset_vizinho_isr((int)(intptr_t)arg);
+}
+
+
+static void setup_botoes_preset(void)
+{
+    const int pinos[2]  = {PRESET_PINO_PROXIMO, PRESET_PINO_ANTERIOR};
+    const int passos[2] = {1, -1};
+
+    //botões para o GND, com o pull-up interno: a borda de descida é o aperto
+    for (int b = 0; b < 2; b++) {
+        if (pinos[b] < 0)
+            continue;
+        gpio_config_t botao = {
+            .pin_bit_mask = 1ULL << pinos[b],
+            .mode         = GPIO_MODE_INPUT,
+            .pull_up_en   = GPIO_PULLUP_ENABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type    = GPIO_INTR_NEGEDGE,
+        };
+        ESP_ERROR_CHECK(gpio_config(&botao));
+        esp_err_t erro = gpio_install_isr_service(0);
+        if (erro != ESP_OK && erro != ESP_ERR_INVALID_STATE)    //INVALID_STATE: já instalado pelo outro botão
+            ESP_ERROR_CHECK(erro);
+        ESP_ERROR_CHECK(gpio_isr_handler_add(pinos[b], botao_preset_isr, (void *)(intptr_t)passos[b]));
+    }
+}
+
+
+static int recebe_troca_preset(struct parametros_pwm *canais, uint32_t *instante_pedido_us)
+{
+    int pedido = __atomic_exchange_n(&preset_pedido, -1, __ATOMIC_ACQ_REL);
+    int passos = __atomic_exchange_n(&passos_preset, 0, __ATOMIC_ACQ_REL);
+    if (pedido < 0 && passos == 0)
+        return -1;
+    *instante_pedido_us = __atomic_load_n(&instante_pedido_preset_us, __ATOMIC_RELAXED);
+
+    //um índice pedido vale mais que os passos. Cada passo anda até o próximo preset ocupado, dando a volta
+    portENTER_CRITICAL(&mux_presets);
+    int indice = (pedido >= 0) ? pedido : preset_vizinho(presets, preset_atual, passos);
+    bool achou = (indice >= 0 && indice < PRESET_MAXIMO && presets[indice].ocupado);
+    if (achou)
+        memcpy(canais, presets[indice].canais, sizeof(presets[indice].canais));
+    portEXIT_CRITICAL(&mux_presets);
+    return achou ? indice : -1;
+}
+
+
+static esp_err_t salva_preset(int indice, const char *nome, const struct parametros_pwm *canais)
+{
+    if (!config_cabe_no_hardware(canais))
+        return ESP_ERR_NOT_FOUND;
+
+    struct preset_salvo blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.versao = NVS_VERSAO_PRESET;
+    snprintf(blob.nome, sizeof(blob.nome), "%.*s", PRESET_NOME_TAMANHO - 1, nome);     //já validado pelo handler
+    config_salva_empacota(canais, blob.canais);
+    blob.crc = crc32_le(0, (const uint8_t *)&blob, offsetof(struct preset_salvo, crc));
+
+    char chave[12];
+    snprintf(chave, sizeof(chave), "preset%d", indice);
+    nvs_handle_t nvs;
+    esp_err_t erro = nvs_open(NVS_NAMESPACE_PWM, NVS_READWRITE, &nvs);
+    if (erro == ESP_OK) {
+        erro = nvs_set_blob(nvs, chave, &blob, sizeof(blob));
+        if (erro == ESP_OK)
+            erro = nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    if (erro != ESP_OK) {
+        falhas_nvs++;
+        ESP_LOGE(TAG, "Falha ao gravar o preset %d na NVS: %s", indice, esp_err_to_name(erro));
+        return erro;
+    }
+
+    portENTER_CRITICAL(&mux_presets);
+    presets[indice].ocupado = true;
+    memcpy(presets[indice].nome, blob.nome, sizeof(blob.nome));
+    memcpy(presets[indice].canais, canais, sizeof(presets[indice].canais));
+    portEXIT_CRITICAL(&mux_presets);
+    return ESP_OK;
+}
+
+
+static esp_err_t apaga_preset(int indice)
+{
+    portENTER_CRITICAL(&mux_presets);
+    bool ocupado = presets[indice].ocupado;
+    presets[indice].ocupado = false;
+    portEXIT_CRITICAL(&mux_presets);
+    if (!ocupado)
+        return ESP_ERR_NOT_FOUND;
+
+    char chave[12];
+    snprintf(chave, sizeof(chave), "preset%d", indice);
+    nvs_handle_t nvs;
+    esp_err_t erro = nvs_open(NVS_NAMESPACE_PWM, NVS_READWRITE, &nvs);
+    if (erro == ESP_OK) {
+        erro = nvs_erase_key(nvs, chave);
+        if (erro == ESP_OK)
+            erro = nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    if (erro != ESP_OK)
+        falhas_nvs++;
+    return erro;
+}
+
+
+static void carrega_presets(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE_PWM, NVS_READONLY, &nvs) != ESP_OK)
+        return;
+
+    int carregados = 0;
+    for (int p = 0; p < PRESET_MAXIMO; p++) {
+        struct preset_salvo blob;
+        size_t tamanho = sizeof(blob);
+        char chave[12];
+        snprintf(chave, sizeof(chave), "preset%d", p);
+        if (nvs_get_blob(nvs, chave, &blob, &tamanho) != ESP_OK)
+            continue;
+        if (tamanho != sizeof(blob) || blob.versao != NVS_VERSAO_PRESET ||
+            blob.crc != crc32_le(0, (const uint8_t *)&blob, offsetof(struct preset_salvo, crc))) {
+            ESP_LOGW(TAG, "Preset %d salvo na NVS invalido", p);
+            continue;
+        }
+
+        //como na configuração salva, só aceita o que a API aceitaria
+        struct preset_pwm *preset = &presets[p];
+        bool valido = config_salva_desempacota(blob.canais, preset->canais, parametros_validos);
+        blob.nome[PRESET_NOME_TAMANHO - 1] = '\0';
+        memcpy(preset->nome, blob.nome, sizeof(preset->nome));
+        preset->ocupado = valido && config_cabe_no_hardware(preset->canais);
+        carregados += preset->ocupado;
+    }
+    nvs_close(nvs);
+    ESP_LOGI(TAG, "%d presets carregados da NVS", carregados);
+}
+
+
+static esp_err_t api_preset_get_handler(httpd_req_t *req)
+{
+    //com o spinlock só copia o que a resposta mostra, não os canais de todos os presets
+    struct {
+        bool     ocupado;
+        char     nome[PRESET_NOME_TAMANHO];
+        uint32_t ligados;
+    } copia[PRESET_MAXIMO];
+    portENTER_CRITICAL(&mux_presets);
+    for (int p = 0; p < PRESET_MAXIMO; p++) {
+        copia[p].ocupado = presets[p].ocupado;
+        if (!copia[p].ocupado)
+            continue;
+        memcpy(copia[p].nome, presets[p].nome, sizeof(copia[p].nome));
+        copia[p].ligados = preset_ligados(&presets[p]);
+    }
+    portEXIT_CRITICAL(&mux_presets);
+
+    char json[96];
+    int tamanho = snprintf(json, sizeof(json), "{\"atual\":%d,\"trocas\":%u,\"presets\":[",
+                           preset_atual, trocas_preset);
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t erro = httpd_resp_send_chunk(req, json, tamanho);
+    const char *separador = "";
+    for (int p = 0; erro == ESP_OK && p < PRESET_MAXIMO; p++) {
+        if (!copia[p].ocupado)
+            continue;
+        tamanho = snprintf(json, sizeof(json), "%s{\"indice\":%d,\"nome\":\"%s\",\"ligados\":%u}",
+                           separador, p, copia[p].nome, copia[p].ligados);
+        erro = httpd_resp_send_chunk(req, json, tamanho);
+        separador = ",";
+    }
+    if (erro == ESP_OK)
+        erro = httpd_resp_send_chunk(req, "]}", 2);
+    if (erro == ESP_OK)
+        erro = httpd_resp_send_chunk(req, NULL, 0);
+    return erro;
+}
+
+
+static esp_err_t api_preset_put_handler(httpd_req_t *req)
+{
+    int indice = api_indice_canal(req->uri, "/api/preset");
+    if (indice < 0 || indice >= PRESET_MAXIMO)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Preset inexistente");
+
+    char query[48];
+    char nome[PRESET_NOME_TAMANHO + 1];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "nome", nome, sizeof(nome)) != ESP_OK || !preset_nome_valido(nome))
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Use ?nome= com ate 15 letras, digitos, - _ ou .");
+
+    //guarda a configuração publicada agora
+    struct parametros_pwm canais[NUM_CANAIS_PWM];
+    le_config_pwm(canais);
+    esp_err_t erro = salva_preset(indice, nome, canais);
+    if (erro == ESP_ERR_NOT_FOUND) {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_send(req, "A configuracao nao cabe nos timers", HTTPD_RESP_USE_STRLEN);
+    }
+    if (erro != ESP_OK)
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Falha ao gravar na NVS");
+
+    char json[64];
+    int tamanho = snprintf(json, sizeof(json), "{\"indice\":%d,\"nome\":\"%s\"}", indice, nome);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, tamanho);
+}
+
+
+static esp_err_t api_preset_post_handler(httpd_req_t *req)
+{
+    int indice = api_indice_canal(req->uri, "/api/preset");
+    if (indice == -2 || indice >= PRESET_MAXIMO)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Preset inexistente");
+
+    //sem índice o preset vem pelo ?nome= ou pelo ?passo= (1 próximo, -1 anterior)
+    char query[48];
+    char valor[PRESET_NOME_TAMANHO + 1];
+    esp_err_t erro = ESP_ERR_NOT_FOUND;
+    if (indice >= 0) {
+        erro = pede_preset(indice);
+    } else if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Use /api/preset/{n}, ?nome= ou ?passo=");
+    } else if (httpd_query_key_value(query, "nome", valor, sizeof(valor)) == ESP_OK) {
+        portENTER_CRITICAL(&mux_presets);
+        indice = preset_procura_nome(presets, valor);
+        portEXIT_CRITICAL(&mux_presets);
+        erro = pede_preset(indice);
+    } else if ((erro = httpd_query_key_value(query, "passo", valor, sizeof(valor))) != ESP_ERR_NOT_FOUND) {
+        //um passo que nem coube no buffer (RESULT_TRUNC) também é inválido
+        char *fim;
+        long passo = strtol(valor, &fim, 10);
+        if (erro != ESP_OK || fim == valor || *fim != '\0' || passo == 0 || passo < -PRESET_PASSO_MAXIMO ||
+            passo > PRESET_PASSO_MAXIMO)
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Use ?passo= de -8 a 8, sem o 0");
+        erro = pede_preset_vizinho((int)passo);
+    }
+    if (erro != ESP_OK)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Preset inexistente");
+
+    //a task do PWM troca todos os canais na próxima passada, o tempo fica no pwm_preset_troca_segundos
+    httpd_resp_set_status(req, "202 Accepted");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+
+static esp_err_t api_preset_delete_handler(httpd_req_t *req)
+{
+    int indice = api_indice_canal(req->uri, "/api/preset");
+    if (indice < 0 || indice >= PRESET_MAXIMO)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Preset inexistente");
+
+    esp_err_t erro = apaga_preset(indice);
+    if (erro == ESP_ERR_NOT_FOUND)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Preset inexistente");
+    if (erro != ESP_OK)
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Falha ao gravar na NVS");
+    httpd_resp_set_status(req, "204 No Content");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+
+
+/*------------WebSocket: estado aplicado empurrado para a página, só os canais que mudaram, a todos de uma vez------------*/
+//As mensagens têm o mesmo JSON de canal do /api/pwm: {"us":<instante>,"canais":[<canais que mudaram>]}
+
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    //o handshake chega como GET: a partir daí a conexão recebe as mensagens
+    if (req->method == HTTP_GET) {
+        int fd = httpd_req_to_sockfd(req);
+        int i = 0;
+        while (i < num_assinantes_ws && assinantes_ws[i] != fd)
+            i++;
+        if (i == num_assinantes_ws) {
+            if (num_assinantes_ws >= WS_MAX_ASSINANTES) {
+                ESP_LOGW(TAG, "WebSocket recusado: ja ha %d assinantes", num_assinantes_ws);
+                return ESP_FAIL;
+            }
+            assinantes_ws[num_assinantes_ws++] = fd;
+        }
+        //o assinante novo precisa de todos os canais; os outros recebem a mesma mensagem, só maior
+        __atomic_store_n(&assinante_ws_novo, true, __ATOMIC_RELEASE);
+        xTaskNotifyGive(task_ws_handle);
+        ESP_LOGI(TAG, "WebSocket %d inscrito, %d assinantes", fd, num_assinantes_ws);
+        return ESP_OK;
+    }
+
+    //o cliente não manda comandos: os quadros de dados são lidos e descartados (ping e close o server trata)
+    uint8_t descarte[WS_QUADRO_RECEBIDO_MAXIMO];
+    httpd_ws_frame_t quadro = {0};
+    esp_err_t erro = httpd_ws_recv_frame(req, &quadro, 0);
+    if (erro != ESP_OK || quadro.len > sizeof(descarte))
+        return ESP_FAIL;
+    quadro.payload = descarte;
+    return (quadro.len > 0) ? httpd_ws_recv_frame(req, &quadro, quadro.len) : ESP_OK;
+}
+
+
+static void envia_mensagem_ws(void *arg)
+{
+    httpd_handle_t s = server;
+    int64_t inicio_us = esp_timer_get_time();
+    httpd_ws_frame_t quadro = {
+        .final   = true,
+        .type    = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)mensagem_ws,
+        .len     = tamanho_mensagem_ws,
+    };
+
+    for (int i = 0; s != NULL && i < num_assinantes_ws; ) {
+        int fd = assinantes_ws[i];
+        //o fd de uma conexão que fechou pode já ser de outra conexão, que não é um WebSocket
+        bool websocket = (httpd_ws_get_fd_info(s, fd) == HTTPD_WS_CLIENT_WEBSOCKET);
+        if (websocket && httpd_ws_send_frame_async(s, fd, &quadro) == ESP_OK) {
+            quadros_ws++;
+            bytes_ws += quadro.len;
+            i++;
+            continue;
+        }
+        //um assinante que não aceitou o envio dentro do HTTP_ESPERA_SOCKET_S é desconectado
+        if (websocket)
+            httpd_sess_trigger_close(s, fd);
+        assinantes_ws[i] = assinantes_ws[--num_assinantes_ws];
+        assinantes_ws_removidos++;
+        ESP_LOGI(TAG, "WebSocket %d removido, %d assinantes", fd, num_assinantes_ws);
+    }
+
+    registra_latencia(MET_WS_ENVIO, esp_timer_get_time() - inicio_us);
+    __atomic_store_n(&envio_ws_pendente, false, __ATOMIC_RELEASE);
+}
+
+
+static void task_ws(void *pvParameter)
+{
+    static struct parametros_pwm pedido[NUM_CANAIS_PWM];
+    static struct pwm_aplicado   aplicado[NUM_CANAIS_PWM];
+    static struct parametros_pwm pedido_enviado[NUM_CANAIS_PWM];
+    static struct pwm_aplicado   aplicado_enviado[NUM_CANAIS_PWM];
+    const int64_t intervalo_us = 1000000 / WS_TAXA_MAXIMA_HZ;
+    const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+    int64_t ultimo_envio_us = 0;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        //espera completar o intervalo desde a última mensagem: o que mudar até lá vai junto
+        int64_t espera_us = ultimo_envio_us + intervalo_us - esp_timer_get_time();
+        if (espera_us > 0)
+            vTaskDelay((espera_us + tick_us - 1) / tick_us);
+
+        httpd_handle_t s = server;
+        if (s == NULL || num_assinantes_ws == 0)
+            continue;
+
+        //um assinante lento ainda está recebendo a mensagem anterior
+        while (__atomic_load_n(&envio_ws_pendente, __ATOMIC_ACQUIRE))
+            vTaskDelay(1);
+
+        bool todos = __atomic_exchange_n(&assinante_ws_novo, false, __ATOMIC_ACQ_REL);
+        le_estado_publicado(pedido, aplicado);
+        int64_t agora_us = esp_timer_get_time();
+        int mudaram;
+        size_t tamanho = json_canal_mensagem_ws(mensagem_ws, sizeof(mensagem_ws), agora_us, pinos_pwm, pedido,
+                                                aplicado, pedido_enviado, aplicado_enviado, todos, &mudaram);
+        if (tamanho == 0)
+            continue;
+
+        //o envio roda na task do server, a mesma que usa os sockets
+        tamanho_mensagem_ws = tamanho;
+        __atomic_store_n(&envio_ws_pendente, true, __ATOMIC_RELEASE);
+        if (httpd_queue_work(s, envia_mensagem_ws, NULL) != ESP_OK) {
+            //a mensagem se perdeu: a próxima leva todos os canais
+            __atomic_store_n(&envio_ws_pendente, false, __ATOMIC_RELEASE);
+            __atomic_store_n(&assinante_ws_novo, true, __ATOMIC_RELEASE);
+            continue;
+        }
+        mensagens_ws++;
+        ultimo_envio_us = agora_us;
+        ESP_LOGD(TAG, "WebSocket: %d canais, %u bytes para %d assinantes", mudaram, tamanho, num_assinantes_ws);
+    }
+}
+
+
+
+/*----------------Configuração dos canais salva na NVS: blob com geração e CRC, gravações agrupadas------------*/
+
+static uint32_t crc_config_salva(const struct config_salva *blob)
+{
+    return crc32_le(0, (const uint8_t *)blob, offsetof(struct config_salva, crc));
+}
+
+
+static esp_err_t carrega_config_salva(struct parametros_pwm *destino)
+{
+    struct config_salva blob;
+    size_t tamanho = sizeof(blob);
+    nvs_handle_t nvs;
+
+    esp_err_t erro = nvs_open(NVS_NAMESPACE_PWM, NVS_READONLY, &nvs);
+    if (erro != ESP_OK)
+        return erro;            //no primeiro boot o namespace ainda não existe
+    erro = nvs_get_blob(nvs, NVS_CHAVE_CANAIS, &blob, &tamanho);
+    nvs_close(nvs);
+    if (erro != ESP_OK)
+        return erro;
+
+    if (tamanho != sizeof(blob) || blob.versao != NVS_VERSAO_CANAIS || blob.crc != crc_config_salva(&blob)) {
+        ESP_LOGW(TAG, "Configuracao salva na NVS invalida (tamanho %u, versao %u)", (unsigned)tamanho, blob.versao);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    struct parametros_pwm canais[NUM_CANAIS_PWM];
+    if (!config_salva_desempacota(blob.canais, canais, parametros_validos) || !config_cabe_no_hardware(canais))
+        return ESP_ERR_INVALID_ARG;
+
+    memcpy(destino, canais, sizeof(canais));
+    geracao_config_salva = blob.geracao;
+    ESP_LOGI(TAG, "Configuracao restaurada da NVS (geracao %u)", blob.geracao);
+    return ESP_OK;
+}
+
+
+static esp_err_t grava_config_salva(const struct parametros_pwm *config)
+{
+    struct config_salva blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.versao  = NVS_VERSAO_CANAIS;
+    blob.geracao = geracao_config_salva + 1;
+    config_salva_empacota(config, blob.canais);
+    blob.crc     = crc_config_salva(&blob);
+
+    nvs_handle_t nvs;
+    esp_err_t erro = nvs_open(NVS_NAMESPACE_PWM, NVS_READWRITE, &nvs);
+    if (erro == ESP_OK) {
+        erro = nvs_set_blob(nvs, NVS_CHAVE_CANAIS, &blob, sizeof(blob));
+        if (erro == ESP_OK)
+            erro = nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    if (erro != ESP_OK) {
+        falhas_nvs++;
+        ESP_LOGE(TAG, "Falha ao gravar a configuracao na NVS: %s", esp_err_to_name(erro));
+        return erro;
+    }
+
+    geracao_config_salva = blob.geracao;
+    gravacoes_nvs++;
+
+    config_salva_conta_gravacao(&gravacoes_nvs_por_minuto, (uint32_t)(esp_timer_get_time() / 60000000));
+    return ESP_OK;
+}
+
+
+//A tabela de calibração é gravada raramente (só quando uma medição pede), sem geração nem agrupamento
+static esp_err_t carrega_calibracao(struct tabela_calibracao *destino)
+{
+    struct calibracao_salva blob;
+    size_t tamanho = sizeof(blob);
+    nvs_handle_t nvs;
+
+    esp_err_t erro = nvs_open(NVS_NAMESPACE_PWM, NVS_READONLY, &nvs);
+    if (erro != ESP_OK)
+        return erro;
+    erro = nvs_get_blob(nvs, NVS_CHAVE_CALIBRACAO, &blob, &tamanho);
+    nvs_close(nvs);
+    if (erro != ESP_OK)
+        return erro;
+
+    if (tamanho != sizeof(blob) || blob.versao != NVS_VERSAO_CALIBRACAO ||
+        blob.crc != crc32_le(0, (const uint8_t *)&blob, offsetof(struct calibracao_salva, crc))) {
+        ESP_LOGW(TAG, "Calibracao salva na NVS invalida (tamanho %u, versao %u)", (unsigned)tamanho, blob.versao);
+        return ESP_ERR_INVALID_CRC;
+    }
+    for (int f = 0; f < CALIBRACAO_NUM_FAIXAS; f++) {
+        if (blob.tabela.faixas[f].desvio_ppm > CALIBRACAO_DESVIO_MAXIMO_PPM ||
+            blob.tabela.faixas[f].desvio_ppm < -CALIBRACAO_DESVIO_MAXIMO_PPM)
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    *destino = blob.tabela;
+    ESP_LOGI(TAG, "Calibracao restaurada da NVS");
+    return ESP_OK;
+}
+
+
+static esp_err_t grava_calibracao(const struct tabela_calibracao *tabela)
+{
+    struct calibracao_salva blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.versao = NVS_VERSAO_CALIBRACAO;
+    blob.tabela = *tabela;
+    blob.crc    = crc32_le(0, (const uint8_t *)&blob, offsetof(struct calibracao_salva, crc));
+
+    nvs_handle_t nvs;
+    esp_err_t erro = nvs_open(NVS_NAMESPACE_PWM, NVS_READWRITE, &nvs);
+    if (erro == ESP_OK) {
+        erro = nvs_set_blob(nvs, NVS_CHAVE_CALIBRACAO, &blob, sizeof(blob));
+        if (erro == ESP_OK)
+            erro = nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    if (erro != ESP_OK) {
+        falhas_nvs++;
+        ESP_LOGE(TAG, "Falha ao gravar a calibracao na NVS: %s", esp_err_to_name(erro));
+    }
+    return erro;
+}
+
+
+static uint32_t gravacoes_nvs_ultima_hora(void)
+{
+    //leitura só para diagnóstico: pode pegar um contador no meio da troca de minuto
+    return config_salva_gravacoes_ultima_hora(&gravacoes_nvs_por_minuto,
+                                              (uint32_t)(esp_timer_get_time() / 60000000));
+}
+
+
+static void task_nvs(void *pvParameter)
+{
+    static struct parametros_pwm atual[NUM_CANAIS_PWM];
+    static struct canal_salvo salvos[NUM_CANAIS_PWM];       //o que está na NVS agora, sem padding para o memcmp
+    static struct canal_salvo novos[NUM_CANAIS_PWM];
+    TickType_t ultima_gravacao = 0;
+    bool gravou = false;
+
+    //a task começa logo depois do boot, com a configuração carregada (ou a padrão)
+    le_config_pwm(atual);
+    config_salva_empacota(atual, salvos);
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        //debounce: cada publicação recomeça a espera, até passar NVS_ATRASO_GRAVACAO_MS sem nenhuma (ou
+        //NVS_ESPERA_MAXIMA_MS desde a primeira). Só o estado final é gravado
+        TickType_t inicio = xTaskGetTickCount();
+        while (xTaskGetTickCount() - inicio < pdMS_TO_TICKS(NVS_ESPERA_MAXIMA_MS) &&
+               ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NVS_ATRASO_GRAVACAO_MS)) != 0)
+            ;
+
+        //e não grava antes de NVS_INTERVALO_MINIMO_MS da gravação anterior
+        TickType_t desde_ultima = xTaskGetTickCount() - ultima_gravacao;
+        if (gravou && desde_ultima < pdMS_TO_TICKS(NVS_INTERVALO_MINIMO_MS)) {
+            vTaskDelay(pdMS_TO_TICKS(NVS_INTERVALO_MINIMO_MS) - desde_ultima);
+            ulTaskNotifyTake(pdTRUE, 0);
+        }
+
+        le_config_pwm(atual);
+        config_salva_empacota(atual, novos);
+        if (memcmp(novos, salvos, sizeof(novos)) == 0) {
+            gravacoes_nvs_evitadas++;
+            continue;
+        }
+        if (grava_config_salva(atual) == ESP_OK) {
+            memcpy(salvos, novos, sizeof(salvos));
+            ultima_gravacao = xTaskGetTickCount();
+            gravou = true;
+        }
+    }
+}
+
+
+
+/*-----------------Controle por UDP: pacotes binários que seguem o mesmo caminho da API até o LEDC--------------*/
+
+static size_t processa_pacote_udp(const uint8_t *pacote, size_t tamanho, int64_t chegada_us,
+                                  uint32_t *ultima_sequencia, struct udp_resposta_agendada *resposta)
+{
+    struct pedido_udp pedido;
+    size_t tamanho_resposta;
+
+    if (!udp_decodifica(pacote, tamanho, chegada_us, &pedido, resposta, &tamanho_resposta))
+        return tamanho_resposta;
+
+    //um comando que chegou depois de um mais novo não pode desfazê-lo
+    if (udp_atrasado(&pedido, *ultima_sequencia)) {
+        resposta->base.status = UDP_ATRASADO;
+    } else if (pedido.preset) {
+        //a troca é feita pela task do PWM logo depois; aceitos leva todos os canais, que o preset define
+        esp_err_t erro = (pedido.troca.indice == UDP_PRESET_VIZINHO) ? pede_preset_vizinho(pedido.troca.passo)
+                                                                     : pede_preset(pedido.troca.indice);
+        if (erro == ESP_OK) {
+            resposta->base.status  = UDP_OK;
+            resposta->base.aceitos = (1u << NUM_CANAIS_PWM) - 1;
+            *ultima_sequencia      = pedido.cabecalho.sequencia;
+        } else {
+            resposta->base.status  = UDP_FORA_DA_FAIXA;
+        }
+    } else if (pedido.cabecalho.quantidade > 0) {
+        //todos os comandos do pacote são validados e publicados (ou agendados) juntos
+        static struct comando_agendado comando;     //só a task do UDP usa
+        uint32_t mascara;
+        le_config_pwm(comando.canais);
+
+        resposta->base.status = udp_le_comandos(&pedido, comando.canais, &mascara, parametros_validos);
+        if (resposta->base.status == UDP_OK && !pedido.agendado) {
+            if (publica_config_pwm(mascara, comando.canais) != ESP_OK)
+                resposta->base.status = UDP_SEM_TIMER;
+        } else if (resposta->base.status == UDP_OK) {
+            comando.mascara     = mascara;
+            comando.sincroniza  = pedido.sincroniza;
+            comando.instante_us = pedido.instante_us;
+            esp_err_t erro = agenda_comando(&comando);
+            if (erro == ESP_ERR_NO_MEM)
+                resposta->base.status = UDP_AGENDA_CHEIA;
+            else if (erro != ESP_OK)
+                resposta->base.status = UDP_SEM_TIMER;
+        }
+        if (resposta->base.status == UDP_OK) {
+            resposta->base.aceitos = mascara;
+            *ultima_sequencia      = pedido.cabecalho.sequencia;
+        }
+    } else {
+        resposta->base.status = UDP_OK;     //só consulta
+    }
+
+    //canais ligados no hardware segundo o último estado publicado pela task do PWM
+    struct parametros_pwm publicado[NUM_CANAIS_PWM];
+    struct pwm_aplicado   aplicado[NUM_CANAIS_PWM];
+    le_estado_publicado(publicado, aplicado);
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        if (aplicado[i].estado)
+            resposta->base.ligados |= 1u << i;
+    }
+    return tamanho_resposta;
+}
+
+
+static void task_udp(void *pvParameter)
+{
+    static uint8_t pacote[UDP_PACOTE_MAXIMO + 1];
+    uint32_t ultima_sequencia = 0;
+
+    struct sockaddr_in local = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(UDP_PORTA_CONTROLE),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        ESP_LOGE(TAG, "Nao foi possivel abrir a porta UDP %d", UDP_PORTA_CONTROLE);
+        if (sock >= 0)
+            close(sock);
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "Controle por UDP na porta %d", UDP_PORTA_CONTROLE);
+
+    while (1) {
+        struct sockaddr_in origem;
+        socklen_t tamanho_origem = sizeof(origem);
+        //o buffer tem um byte a mais que o maior pacote válido, assim um pacote maior não passa como válido
+        int tamanho = recvfrom(sock, pacote, sizeof(pacote), 0, (struct sockaddr *)&origem, &tamanho_origem);
+        if (tamanho < 0) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+
+        int64_t inicio_us = esp_timer_get_time();
+        struct udp_resposta_agendada resposta;
+        size_t tamanho_resposta = processa_pacote_udp(pacote, tamanho, inicio_us, &ultima_sequencia, &resposta);
+        pacotes_udp[resposta.base.status]++;
+        resposta.base.processamento_us = (uint32_t)(esp_timer_get_time() - inicio_us);
+
+        sendto(sock, &resposta, tamanho_resposta, 0, (struct sockaddr *)&origem, tamanho_origem);
+        registra_latencia(MET_UDP_COMANDO, esp_timer_get_time() - inicio_us);
+    }
+}
@@ -0,0 +1,80 @@
+#include "medicao.h"
+#include "geradores.h"
+
+
+uint32_t medicao_porta_ms(uint32_t frequencia)
+{
+    uint32_t porta_ms = (frequencia > 0) ? (uint32_t)((uint64_t)MEDICAO_PULSOS_MINIMOS * 1000 / frequencia)
+                                         : MEDICAO_PORTA_MAXIMA_MS;
+    if (porta_ms < MEDICAO_PORTA_MINIMA_MS)
+        return MEDICAO_PORTA_MINIMA_MS;
+    if (porta_ms > MEDICAO_PORTA_MAXIMA_MS)
+        return MEDICAO_PORTA_MAXIMA_MS;
+    return porta_ms;
+}
+
+
+void medicao_resultado(struct medicao_canal *medicao, int64_t instante_us, const struct parametros_pwm *pedido,
+                       uint64_t prevista_mhz, uint64_t medida_mhz, int32_t duty_medido,
+                       const struct amostra_contagem *amostras)
+{
+    *medicao = (struct medicao_canal){
+        .instante_us             = instante_us,
+        .frequencia_prevista_mhz = prevista_mhz,
+        .frequencia_medida_mhz   = medida_mhz,
+        .frequencia_pedida       = (uint32_t)pedido->frequencia,
+        .erro_ppm                = calibracao_erro_ppm(medida_mhz, (uint64_t)pedido->frequencia * 1000),
+        .desvio_ppm              = calibracao_erro_ppm(medida_mhz, prevista_mhz),
+        .duty_pedido             = pedido->duty_fino,
+        .duty_medido             = duty_medido,
+        .porta_ms                = (uint32_t)((amostras[MEDICAO_AMOSTRAS - 1].instante_us - amostras[0].instante_us) / 1000),
+        .gerador                 = (uint8_t)pedido->gerador,
+    };
+}
+
+
+void medicao_envia_json(struct saida_html *saida, const struct medicao_canal *medicoes, const int *pinos,
+                        const struct tabela_calibracao *tabela, int canal_captura,
+                        const struct amostra_contagem *captura)
+{
+    //as frequências vão em mHz, inteiras, para não perder a resolução da medida
+    envia_html_formatado(saida, "{\"medicoes\":[");
+    const char *separador = "";
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        const struct medicao_canal *m = &medicoes[i];
+        if (m->instante_us == 0)
+            continue;
+        //em três partes, cada uma cabe no buffer do envia_html_formatado mesmo com os números mais longos
+        envia_html_formatado(saida,
+                             "%s{\"canal\":%d,\"gpio\":%d,\"gerador\":\"%s\",\"instante_us\":%lld,\"frequencia\":%u,"
+                             "\"frequencia_prevista_mhz\":%llu,",
+                             separador, i, pinos[i], gerador_nome(m->gerador), (long long)m->instante_us,
+                             (unsigned)m->frequencia_pedida, (unsigned long long)m->frequencia_prevista_mhz);
+        envia_html_formatado(saida, "\"frequencia_medida_mhz\":%llu,\"erro_ppm\":%d,\"desvio_ppm\":%d,",
+                             (unsigned long long)m->frequencia_medida_mhz, (int)m->erro_ppm, (int)m->desvio_ppm);
+        envia_html_formatado(saida, "\"duty_fino\":%d,\"duty_fino_medido\":%d,\"porta_ms\":%u,\"calibrou\":%s}",
+                             (int)m->duty_pedido, (int)m->duty_medido, (unsigned)m->porta_ms,
+                             m->calibrou ? "true" : "false");
+        separador = ",";
+    }
+
+    //só as faixas que já têm medidas, cada uma com a frequência onde começa
+    envia_html_formatado(saida, "],\"calibracao\":[");
+    separador = "";
+    for (int f = 0; f < CALIBRACAO_NUM_FAIXAS; f++) {
+        if (tabela->faixas[f].medidas == 0)
+            continue;
+        envia_html_formatado(saida, "%s{\"faixa_hz\":%u,\"desvio_ppm\":%d,\"medidas\":%u}",
+                             separador, 1u << f, (int)tabela->faixas[f].desvio_ppm,
+                             (unsigned)tabela->faixas[f].medidas);
+        separador = ",";
+    }
+
+    //leituras do contador da última medição, para conferir as contas fora do ESP32
+    envia_html_formatado(saida, "],\"captura\":{\"canal\":%d,\"amostras\":[", canal_captura);
+    for (int a = 0; canal_captura >= 0 && a < MEDICAO_AMOSTRAS; a++) {
+        envia_html_formatado(saida, "%s[%lld,%lld]", a ? "," : "",
+                             (long long)captura[a].instante_us, (long long)captura[a].pulsos);
+    }
+    envia_html_formatado(saida, "]}}");
+}
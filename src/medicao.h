@@ -0,0 +1,53 @@
+/*Medição das saídas pelo contador de pulsos: a porta de contagem, o resultado de um canal a partir das
+leituras e o JSON do GET /api/medicao. O PCNT, a matriz de GPIO e a amostragem do pino ficam no main.c; como
+em calibracao.h, aqui só tem aritmética e texto, nada do ESP-IDF, para dar para compilar e conferir no PC*/
+#ifndef MEDICAO_H
+#define MEDICAO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "canais.h"
+#include "calibracao.h"
+#include "saida_html.h"
+
+//A frequência sai das bordas de subida contadas durante uma porta longa o bastante para MEDICAO_PULSOS_MINIMOS
+//(lidas MEDICAO_AMOSTRAS vezes) e o duty da fração de leituras do pino em nível alto numa janela de períodos
+//inteiros de até MEDICAO_JANELA_DUTY_US
+#define MEDICAO_PULSOS_MINIMOS      2000
+#define MEDICAO_PORTA_MINIMA_MS     100
+#define MEDICAO_PORTA_MAXIMA_MS     2000
+#define MEDICAO_AMOSTRAS            16
+#define MEDICAO_JANELA_DUTY_US      20000
+
+//Resultado da medição de um canal. A frequência pedida é a que estava aplicada quando a medição começou
+struct medicao_canal{
+    int64_t  instante_us;               //fim da medição, 0 se o canal ainda não foi medido
+    uint64_t frequencia_prevista_mhz;   //o que o gerador deveria gerar (no LEDC, já com a calibração)
+    uint64_t frequencia_medida_mhz;
+    uint32_t frequencia_pedida;
+    int32_t  erro_ppm;                  //medida contra a pedida
+    int32_t  desvio_ppm;                //medida contra a prevista, o que a calibração ainda não corrige
+    int32_t  duty_pedido;               //unidades finas
+    int32_t  duty_medido;               //unidades finas, -1 se o período não cabe na janela
+    uint32_t porta_ms;
+    bool     calibrou;                  //a medida entrou na tabela de calibração
+    uint8_t  gerador;                   //enum gerador; só o LEDC é calibrado
+};
+
+//Porta de contagem de uma frequência: a que conta MEDICAO_PULSOS_MINIMOS, dentro dos limites
+uint32_t medicao_porta_ms(uint32_t frequencia);
+
+//Resultado de um canal com as MEDICAO_AMOSTRAS leituras do contador, a frequência medida por elas, a prevista
+//e o duty medido (-1 sem medida). 'pedido' é a configuração do canal quando a medição começou
+void medicao_resultado(struct medicao_canal *medicao, int64_t instante_us, const struct parametros_pwm *pedido,
+                       uint64_t prevista_mhz, uint64_t medida_mhz, int32_t duty_medido,
+                       const struct amostra_contagem *amostras);
+
+//Envia o JSON do GET /api/medicao: as medidas dos canais já medidos, as faixas da calibração que têm medidas
+//e as MEDICAO_AMOSTRAS leituras da última medição ('canal_captura' -1 se nenhuma)
+void medicao_envia_json(struct saida_html *saida, const struct medicao_canal *medicoes, const int *pinos,
+                        const struct tabela_calibracao *tabela, int canal_captura,
+                        const struct amostra_contagem *captura);
+
+#endif
@@ -0,0 +1,60 @@
+#include <string.h>
+
+#include "metricas.h"
+
+
+//Limites das faixas em us e como eles aparecem no /metrics, em segundos
+static const uint32_t limites_faixas_us[NUM_FAIXAS_LATENCIA] = {
+    100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000,
+};
+static const char *limites_faixas_texto[NUM_FAIXAS_LATENCIA] = {
+    "0.0001", "0.0005", "0.001", "0.005", "0.01", "0.05", "0.1", "0.5", "1",
+};
+
+
+int metricas_faixa(int64_t duracao_us)
+{
+    int faixa = 0;
+    while (faixa < NUM_FAIXAS_LATENCIA && duracao_us > limites_faixas_us[faixa])
+        faixa++;
+    return faixa;
+}
+
+
+void metricas_registra(struct histograma_latencia *histograma, int64_t duracao_us)
+{
+    __atomic_fetch_add(&histograma->faixas[metricas_faixa(duracao_us)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histograma->soma_us, (uint32_t)duracao_us, __ATOMIC_RELAXED);
+}
+
+
+void metricas_envia_histogramas(struct saida_html *saida, const struct nome_metrica *nomes,
+                                const struct histograma_latencia *histogramas, int num_cores, int num_metricas)
+{
+    const char *familia = NULL;
+    for (int m = 0; m < num_metricas; m++) {
+        const char *nome      = nomes[m].nome;
+        const char *rotulos   = nomes[m].rotulos;
+        const char *separador = rotulos[0] ? "," : "";
+
+        if (familia == NULL || strcmp(familia, nome) != 0) {
+            envia_html_formatado(saida, "# TYPE %s histogram\n", nome);
+            familia = nome;
+        }
+
+        //no formato do Prometheus cada faixa conta tudo até o seu limite
+        uint32_t acumulado = 0;
+        uint64_t soma_us   = 0;
+        for (int f = 0; f <= NUM_FAIXAS_LATENCIA; f++) {
+            for (int core = 0; core < num_cores; core++)
+                acumulado += __atomic_load_n(&histogramas[core * num_metricas + m].faixas[f], __ATOMIC_RELAXED);
+            envia_html_formatado(saida, "%s_bucket{%s%sle=\"%s\"} %u\n", nome, rotulos, separador,
+                                 (f < NUM_FAIXAS_LATENCIA) ? limites_faixas_texto[f] : "+Inf", acumulado);
+        }
+        for (int core = 0; core < num_cores; core++)
+            soma_us += __atomic_load_n(&histogramas[core * num_metricas + m].soma_us, __ATOMIC_RELAXED);
+        envia_html_formatado(saida, "%s_sum{%s} %llu.%06llu\n", nome, rotulos,
+                             (unsigned long long)(soma_us / 1000000), (unsigned long long)(soma_us % 1000000));
+        envia_html_formatado(saida, "%s_count{%s} %u\n", nome, rotulos, acumulado);
+    }
+}
@@ -0,0 +1,41 @@
+/*Histogramas de latência do /metrics: a escolha da faixa, a contagem sem lock e o texto do Prometheus com os
+cores somados. Quais métricas existem, o core de cada registro e o envio pelo httpd ficam no main.c; como em
+calibracao.h, aqui só tem aritmética e texto, nada do ESP-IDF, para dar para compilar e conferir no PC*/
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stdint.h>
+
+#include "saida_html.h"
+
+//Faixas dos histogramas (a faixa +Inf fica implícita)
+#define NUM_FAIXAS_LATENCIA         9
+
+//Histograma de uma latência. Cada core tem o seu e quem mede só faz somas atômicas, sem lock; a soma
+//precisa ser atômica porque a task pode trocar de core entre o xPortGetCoreID() e o incremento. Tudo em
+//32 bits: uma soma atômica de 64 bits no Xtensa passa pelo spinlock único da libatomic e serializaria os
+//dois cores. A soma dá a volta a cada 2^32 us (71 min de latência somada), o que o Prometheus trata como
+//um contador que reiniciou
+struct histograma_latencia{
+    uint32_t faixas[NUM_FAIXAS_LATENCIA + 1];   //contagem de cada faixa (não acumulada), a última é +Inf
+    uint32_t soma_us;
+};
+
+//Nome e rótulos de um histograma no /metrics. Os de uma mesma família ficam em sequência na tabela
+struct nome_metrica{
+    const char *nome;
+    const char *rotulos;
+};
+
+//Faixa de uma duração: a primeira cujo limite ela não passa, NUM_FAIXAS_LATENCIA para a +Inf
+int metricas_faixa(int64_t duracao_us);
+
+//Conta uma duração no histograma (o do core atual, escolhido por quem chama)
+void metricas_registra(struct histograma_latencia *histograma, int64_t duracao_us);
+
+//Envia os histogramas no formato de texto do Prometheus, com as faixas acumuladas e os cores somados.
+//'histogramas' tem num_cores linhas de num_metricas histogramas, na ordem da tabela 'nomes'
+void metricas_envia_histogramas(struct saida_html *saida, const struct nome_metrica *nomes,
+                                const struct histograma_latencia *histogramas, int num_cores, int num_metricas);
+
+#endif
@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+#include "timer_pwm.h"              //PWM_FREQUENCIA_MAXIMA
+#include "geradores.h"              //nomes dos geradores
+
+
+void parser_formulario_inicia(struct parser_formulario *parser, struct parametros_pwm *canais)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->canais = canais;
+}
+
+
+//Acrescenta um caractere já decodificado à chave ou ao valor do par atual
+static void acrescenta_caractere_formulario(struct parser_formulario *parser, char c)
+{
+    if (parser->lendo_valor) {
+        if (parser->tamanho_valor < sizeof(parser->valor) - 1)
+            parser->valor[parser->tamanho_valor++] = c;
+        else
+            parser->valor_estourou = true;
+    } else {
+        if (parser->tamanho_chave < sizeof(parser->chave) - 1)
+            parser->chave[parser->tamanho_chave++] = c;
+        else
+            parser->chave_estourou = true;
+    }
+}
+
+
+static int valor_hex(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+
+//Interpreta o par chave=valor que acabou de ser lido
+static void processa_campo_formulario(struct parser_formulario *parser)
+{
+    parser->chave[parser->tamanho_chave] = '\0';
+    parser->valor[parser->tamanho_valor] = '\0';
+
+    //separa o nome do campo do número do canal no fim da chave (ex: "duty12" -> "duty" e 12)
+    size_t tamanho_nome = strcspn(parser->chave, "0123456789");
+    const char *nome = parser->chave;
+    uint32_t canal = 0;
+    bool tem_canal = parser_converte_numero(parser->chave + tamanho_nome, NUM_CANAIS_PWM - 1, &canal);
+
+    enum { CAMPO_OUTRO, CAMPO_FREQ, CAMPO_DUTY, CAMPO_ESTADO, CAMPO_BOTAO } campo = CAMPO_OUTRO;
+    if (tamanho_nome == 4 && strncmp(nome, "freq", 4) == 0)
+        campo = CAMPO_FREQ;
+    else if (tamanho_nome == 4 && strncmp(nome, "duty", 4) == 0)
+        campo = CAMPO_DUTY;
+    else if (tamanho_nome == 6 && strncmp(nome, "estado", 6) == 0)
+        campo = CAMPO_ESTADO;
+    else if (tamanho_nome == 3 && strncmp(nome, "pwm", 3) == 0)
+        campo = CAMPO_BOTAO;
+
+    //campos desconhecidos (ou com nomes grandes demais) são ignorados, os conhecidos precisam ser válidos. O
+    //valor do botão é o texto dele, que não importa e pode ser maior que o buffer
+    bool valor_estourou = parser->valor_estourou && campo != CAMPO_BOTAO;
+    if (campo != CAMPO_OUTRO && (parser->chave_estourou || valor_estourou || !tem_canal)) {
+        parser->invalido = true;
+    } else if (campo != CAMPO_OUTRO) {
+        struct parametros_pwm *p = &parser->canais[canal];
+        uint32_t numero;
+
+        if (campo == CAMPO_FREQ) {
+            if (parser_converte_numero(parser->valor, PWM_FREQUENCIA_MAXIMA, &numero) && numero >= 1)
+                p->frequencia = numero;
+            else
+                parser->invalido = true;
+        } else if (campo == CAMPO_DUTY) {
+            if (parser_converte_numero(parser->valor, 100, &numero))
+                p->duty_fino = PERCENTUAL_PARA_DUTY_FINO(numero);
+            else
+                parser->invalido = true;
+        } else if (campo == CAMPO_ESTADO) {
+            if (strcmp(parser->valor, "ligado") == 0 || strcmp(parser->valor, "1") == 0)
+                p->estado = 1;
+            else if (strcmp(parser->valor, "desligado") == 0 || strcmp(parser->valor, "0") == 0)
+                p->estado = 0;
+            else
+                parser->invalido = true;
+        }
+        parser->mascara |= 1u << canal;
+    }
+
+    //prepara o próximo par
+    parser->tamanho_chave = 0;
+    parser->tamanho_valor = 0;
+    parser->lendo_valor    = false;
+    parser->chave_estourou = false;
+    parser->valor_estourou = false;
+}
+
+
+void parser_formulario_alimenta(struct parser_formulario *parser, const char *dados, size_t tamanho)
+{
+    for (size_t i = 0; i < tamanho && !parser->invalido; i++) {
+        char c = dados[i];
+
+        //no meio de um %XX
+        if (parser->hex_restantes > 0) {
+            int digito = valor_hex(c);
+            if (digito < 0) {
+                parser->invalido = true;
+                return;
+            }
+            parser->hex = (parser->hex << 4) | digito;
+            if (--parser->hex_restantes == 0)
+                acrescenta_caractere_formulario(parser, (char)parser->hex);
+            continue;
+        }
+
+        switch (c) {
+        case '&':
+            processa_campo_formulario(parser);
+            break;
+        case '=':
+            if (parser->lendo_valor)
+                acrescenta_caractere_formulario(parser, c);
+            else
+                parser->lendo_valor = true;
+            break;
+        case '+':
+            acrescenta_caractere_formulario(parser, ' ');
+            break;
+        case '%':
+            parser->hex_restantes = 2;
+            parser->hex = 0;
+            break;
+        default:
+            acrescenta_caractere_formulario(parser, c);
+            break;
+        }
+    }
+}
+
+
+bool parser_formulario_finaliza(struct parser_formulario *parser)
+{
+    if (!parser->invalido && parser->hex_restantes > 0)
+        parser->invalido = true;                    //terminou no meio de um %XX
+    if (!parser->invalido)
+        processa_campo_formulario(parser);
+    return !parser->invalido;
+}
+
+
+bool parser_converte_numero(const char *texto, uint32_t maximo, uint32_t *valor)
+{
+    uint32_t numero = 0;
+
+    if (*texto == '\0')
+        return false;
+    for (; *texto; texto++) {
+        if (*texto < '0' || *texto > '9')
+            return false;
+        uint32_t digito = *texto - '0';
+        if (numero > (maximo - digito) / 10)
+            return false;
+        numero = numero * 10 + digito;
+    }
+    *valor = numero;
+    return true;
+}
+
+
+const char *parser_json_valor(const char *json, const char *chave)
+{
+    size_t tamanho_chave = strlen(chave);
+    const char *p = json;
+
+    while ((p = strchr(p, '"')) != NULL) {
+        p++;
+        if (strncmp(p, chave, tamanho_chave) == 0 && p[tamanho_chave] == '"') {
+            p += tamanho_chave + 1;
+            while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+                p++;
+            if (*p != ':')
+                continue;   //era um valor string igual à chave, não a chave
+            p++;
+            while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+                p++;
+            return p;
+        }
+        //pula o resto da string que não era a chave procurada
+        p = strchr(p, '"');
+        if (p == NULL)
+            return NULL;
+        p++;
+    }
+    return NULL;
+}
+
+
+bool parser_json_campo(const char *json, const char *chave, int *valor)
+{
+    const char *p = parser_json_valor(json, chave);
+    if (p == NULL)
+        return false;
+
+    if (strncmp(p, "true", 4) == 0) {
+        *valor = 1;
+        return true;
+    }
+    if (strncmp(p, "false", 5) == 0) {
+        *valor = 0;
+        return true;
+    }
+
+    char *fim;
+    long numero = strtol(p, &fim, 10);
+    if (fim == p || numero < INT32_MIN || numero > INT32_MAX)
+        return false;
+    *valor = (int)numero;
+    return true;
+}
+
+
+bool parser_json_gerador(const char *json, const char *chave, int *gerador)
+{
+    const char *p = parser_json_valor(json, chave);
+    if (p == NULL)
+        return false;
+
+    *gerador = -1;
+    if (*p++ != '"')
+        return true;
+    for (int g = 0; g < NUM_GERADORES; g++) {
+        size_t tamanho = strlen(gerador_nome(g));
+        if (strncmp(p, gerador_nome(g), tamanho) == 0 && p[tamanho] == '"')
+            *gerador = g;
+    }
+    return true;
+}
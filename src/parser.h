@@ -0,0 +1,53 @@
+/*Leitura do corpo das requisições: o formulário html (application/x-www-form-urlencoded), consumido em
+pedaços, e os campos do JSON do PUT /api/pwm. É a entrada que vem da rede, então fica aqui, sem nada do
+ESP-IDF, para compilar no PC com os testes e o fuzzer de test/*/
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "canais.h"
+
+/*Estado do parser do formulário. O corpo chega em pedaços do httpd_req_recv() e cada par chave=valor é
+decodificado (%XX e '+') e interpretado assim que termina, com memória fixa, qualquer que seja o tamanho do
+corpo. Os campos são freqN, dutyN, estadoN e pwmN (o botão), N é o canal, e um mesmo formulário pode trazer
+quantos canais quiser*/
+struct parser_formulario{
+    char     chave[12];
+    char     valor[12];
+    uint8_t  tamanho_chave;
+    uint8_t  tamanho_valor;
+    bool     lendo_valor;           //já passou do '=' do par atual
+    bool     chave_estourou;        //a chave não coube no buffer
+    bool     valor_estourou;        //o valor não coube no buffer
+    uint8_t  hex_restantes;         //dígitos que ainda faltam de um %XX
+    uint8_t  hex;
+    bool     invalido;              //um campo conhecido veio com valor inválido, o resto é ignorado
+    uint32_t mascara;               //canais que apareceram no formulário
+    struct parametros_pwm *canais;  //configuração que o formulário altera
+};
+
+//Prepara o parser para alterar a configuração 'canais' com os campos do formulário
+void parser_formulario_inicia(struct parser_formulario *parser, struct parametros_pwm *canais);
+
+//Consome mais um pedaço do corpo do formulário
+void parser_formulario_alimenta(struct parser_formulario *parser, const char *dados, size_t tamanho);
+
+//Processa o último par do formulário e retorna true se todos os campos eram válidos
+bool parser_formulario_finaliza(struct parser_formulario *parser);
+
+//Converte um texto só com dígitos decimais, retorna false se estiver vazio, tiver outro caractere ou passar do máximo
+bool parser_converte_numero(const char *texto, uint32_t maximo, uint32_t *valor);
+
+//Posição logo depois de "chave": no JSON (já sem espaços), NULL se a chave não está lá
+const char *parser_json_valor(const char *json, const char *chave);
+
+//Procura "chave": valor no JSON recebido, aceitando números e true/false
+bool parser_json_campo(const char *json, const char *chave, int *valor);
+
+//Procura "chave": "nome" no JSON recebido com o nome de um gerador. O número é -1 se o nome não é de um
+bool parser_json_gerador(const char *json, const char *chave, int *gerador);
+
+#endif
@@ -0,0 +1,64 @@
+#include <string.h>
+
+#include "presets.h"
+
+
+int preset_vizinho(const struct preset_pwm *presets, int atual, int passos)
+{
+    if (passos == 0)
+        return (atual >= 0 && atual < PRESET_MAXIMO && presets[atual].ocupado) ? atual : -1;
+
+    int direcao = (passos > 0) ? 1 : -1;
+    int indice  = (atual >= 0) ? atual : ((direcao > 0) ? -1 : PRESET_MAXIMO);
+    for (int p = passos; p != 0; p -= direcao) {
+        for (int k = 0; k < PRESET_MAXIMO; k++) {
+            indice = (indice + direcao + PRESET_MAXIMO) % PRESET_MAXIMO;
+            if (presets[indice].ocupado)
+                break;
+        }
+    }
+    return presets[indice].ocupado ? indice : -1;
+}
+
+
+int preset_procura_nome(const struct preset_pwm *presets, const char *nome)
+{
+    for (int p = 0; p < PRESET_MAXIMO; p++) {
+        if (presets[p].ocupado && strcmp(presets[p].nome, nome) == 0)
+            return p;
+    }
+    return -1;
+}
+
+
+bool preset_algum_ocupado(const struct preset_pwm *presets)
+{
+    bool algum = false;
+    for (int p = 0; p < PRESET_MAXIMO; p++)
+        algum |= presets[p].ocupado;
+    return algum;
+}
+
+
+uint32_t preset_ligados(const struct preset_pwm *preset)
+{
+    uint32_t ligados = 0;
+    for (int i = 0; i < NUM_CANAIS_PWM; i++)
+        ligados |= preset->canais[i].estado ? (1u << i) : 0;
+    return ligados;
+}
+
+
+bool preset_nome_valido(const char *nome)
+{
+    size_t tamanho = strlen(nome);
+    if (tamanho == 0 || tamanho >= PRESET_NOME_TAMANHO)
+        return false;
+    for (size_t i = 0; i < tamanho; i++) {
+        char c = nome[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+              c == '-' || c == '_' || c == '.'))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+/*Presets dos canais: a tabela na RAM, a procura pelo nome, o passo para o próximo ou o anterior ocupado e o
+nome aceito pela API. Quem trava a tabela (handlers e task do PWM, com um spinlock), grava na NVS e publica
+é o main.c; como em calibracao.h, aqui só tem aritmética, nada do ESP-IDF, para dar para compilar e conferir
+no PC*/
+#ifndef PRESETS_H
+#define PRESETS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "canais.h"
+
+#define PRESET_MAXIMO               8
+#define PRESET_NOME_TAMANHO         16      //com o '\0'
+#define PRESET_PASSO_MAXIMO         PRESET_MAXIMO   //um pedido anda no máximo uma volta, com o spinlock preso
+
+//Preset na RAM, já no formato que a task do PWM publica
+struct preset_pwm{
+    bool ocupado;
+    char nome[PRESET_NOME_TAMANHO];
+    struct parametros_pwm canais[NUM_CANAIS_PWM];
+};
+
+//Anda 'passos' presets ocupados a partir de 'atual' (-1 se nenhum foi aplicado ainda), dando a volta. Cada
+//passo vai até o próximo ocupado. Retorna o índice, -1 se nenhum está ocupado
+int preset_vizinho(const struct preset_pwm *presets, int atual, int passos);
+
+//Índice do preset ocupado com esse nome, -1 se não há
+int preset_procura_nome(const struct preset_pwm *presets, const char *nome);
+
+//Algum preset está ocupado
+bool preset_algum_ocupado(const struct preset_pwm *presets);
+
+//Máscara dos canais que o preset liga
+uint32_t preset_ligados(const struct preset_pwm *preset);
+
+//O nome vai no JSON sem escape, então só letras, dígitos, '-', '_' e '.', com 1 a PRESET_NOME_TAMANHO-1 letras
+bool preset_nome_valido(const char *nome);
+
+#endif
@@ -0,0 +1,88 @@
+#include <string.h>
+
+#include "protocolo_udp.h"
+#include "timer_pwm.h"              //PWM_FREQUENCIA_MAXIMA
+
+
+bool udp_decodifica(const uint8_t *pacote, size_t tamanho, int64_t chegada_us, struct pedido_udp *pedido,
+                    struct udp_resposta_agendada *resposta, size_t *tamanho_resposta)
+{
+    struct udp_cabecalho *cabecalho = &pedido->cabecalho;
+
+    memset(pedido, 0, sizeof(*pedido));
+    memset(resposta, 0, sizeof(*resposta));
+    resposta->base.magico = UDP_MAGICO;
+    resposta->base.versao = UDP_VERSAO;
+    resposta->base.status = UDP_INVALIDO;
+    resposta->relogio_us  = chegada_us;
+    *tamanho_resposta     = sizeof(resposta->base);
+
+    if (tamanho < sizeof(*cabecalho))
+        return false;
+    memcpy(cabecalho, pacote, sizeof(*cabecalho));
+    resposta->base.sequencia = cabecalho->sequencia;
+
+    //a versão 2 tem o agendamento depois do cabeçalho, a fase em cada comando e o relógio na resposta
+    //a versão 3 não tem comandos, só o preset depois do cabeçalho
+    pedido->agendado        = (cabecalho->versao == UDP_VERSAO_AGENDADA);
+    pedido->preset          = (cabecalho->versao == UDP_VERSAO_PRESET);
+    size_t extensao         = pedido->agendado ? sizeof(struct udp_agendamento) :
+                              pedido->preset   ? sizeof(struct udp_preset) : 0;
+    pedido->tamanho_comando = pedido->agendado ? sizeof(struct udp_comando_fase) : sizeof(struct udp_comando);
+    pedido->comandos        = pacote + sizeof(*cabecalho) + extensao;
+    if (pedido->agendado) {
+        resposta->base.versao = UDP_VERSAO_AGENDADA;
+        *tamanho_resposta     = sizeof(*resposta);
+    } else if (pedido->preset) {
+        resposta->base.versao = UDP_VERSAO_PRESET;
+    }
+
+    if (cabecalho->magico != UDP_MAGICO ||
+        (cabecalho->versao != UDP_VERSAO && !pedido->agendado && !pedido->preset) ||
+        cabecalho->quantidade > NUM_CANAIS_PWM || (pedido->preset && cabecalho->quantidade != 0) ||
+        tamanho != sizeof(*cabecalho) + extensao + cabecalho->quantidade * pedido->tamanho_comando)
+        return false;
+
+    if (pedido->agendado) {
+        struct udp_agendamento agendamento;
+        memcpy(&agendamento, pacote + sizeof(*cabecalho), sizeof(agendamento));
+        pedido->sincroniza  = (agendamento.opcoes & UDP_AGENDA_SINCRONIZA) != 0;
+        pedido->instante_us = (agendamento.opcoes & UDP_AGENDA_RELATIVO) ? chegada_us + agendamento.instante_us
+                                                                          : agendamento.instante_us;
+    } else if (pedido->preset) {
+        memcpy(&pedido->troca, pacote + sizeof(*cabecalho), sizeof(pedido->troca));
+    }
+    return true;
+}
+
+
+bool udp_atrasado(const struct pedido_udp *pedido, uint32_t ultima_sequencia)
+{
+    return (pedido->cabecalho.quantidade > 0 || pedido->preset) && pedido->cabecalho.sequencia != 0 &&
+           (int32_t)(pedido->cabecalho.sequencia - ultima_sequencia) <= 0;
+}
+
+
+enum status_udp udp_le_comandos(const struct pedido_udp *pedido, struct parametros_pwm *canais, uint32_t *mascara,
+                                bool (*valida)(const struct parametros_pwm *parametros))
+{
+    *mascara = 0;
+    for (int i = 0; i < pedido->cabecalho.quantidade; i++) {
+        struct udp_comando_fase lido = {0};
+        memcpy(&lido, pedido->comandos + i * pedido->tamanho_comando, pedido->tamanho_comando);
+        const struct udp_comando *c = &lido.comando;
+        if (c->canal >= NUM_CANAIS_PWM || c->frequencia < 1 || c->frequencia > PWM_FREQUENCIA_MAXIMA)
+            return UDP_FORA_DA_FAIXA;
+
+        canais[c->canal].estado     = (c->ligado != 0);
+        canais[c->canal].frequencia = c->frequencia;
+        canais[c->canal].duty_fino  = c->duty_fino;
+        if (pedido->agendado)
+            canais[c->canal].fase   = lido.fase;        //a versão 1 mantém a fase configurada
+        //o gerador do canal continua o configurado, que pode não conseguir a frequência nova
+        if (!valida(&canais[c->canal]))
+            return UDP_FORA_DA_FAIXA;
+        *mascara |= 1u << c->canal;
+    }
+    return UDP_OK;
+}
@@ -0,0 +1,123 @@
+/*Protocolo do controle por UDP: o formato dos pacotes (little-endian, como o ESP32), a conferência do cabeçalho
+e do tamanho, a ordem das sequências e a leitura dos comandos para a configuração dos canais. Quem publica,
+agenda e troca o preset é o main.c; como em calibracao.h, aqui só tem aritmética, nada do ESP-IDF, para dar
+para compilar e conferir no PC*/
+#ifndef PROTOCOLO_UDP_H
+#define PROTOCOLO_UDP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "canais.h"
+
+#define UDP_MAGICO                  0x5750  //"PW" em little-endian
+#define UDP_VERSAO                  1
+#define UDP_VERSAO_AGENDADA         2       //com o instante de aplicação e a fase de cada canal
+#define UDP_AGENDA_RELATIVO         0x01    //instante_us conta a partir da chegada do pacote
+#define UDP_AGENDA_SINCRONIZA       0x02    //reinicia juntos os timers dos canais do comando
+#define UDP_VERSAO_PRESET           3       //troca de preset, sem comandos
+#define UDP_PRESET_VIZINHO          0xFF    //anda 'passo' presets a partir do atual
+
+//Pacote de controle por UDP: o cabeçalho seguido de 'quantidade' comandos (0 só consulta o status).
+//A sequência é devolvida na resposta; pacotes com sequência menor que a última aceita chegaram fora de
+//ordem e são descartados, a sequência 0 reinicia a contagem
+struct __attribute__((packed)) udp_cabecalho{
+    uint16_t magico;            //UDP_MAGICO
+    uint8_t  versao;            //UDP_VERSAO
+    uint8_t  quantidade;        //comandos que vêm a seguir
+    uint32_t sequencia;
+};
+
+struct __attribute__((packed)) udp_comando{
+    uint8_t  canal;
+    uint8_t  ligado;
+    uint16_t duty_fino;         //65535 = 100%
+    uint32_t frequencia;        //Hz
+};
+
+enum status_udp{
+    UDP_OK,
+    UDP_INVALIDO,               //tamanho, mágico ou versão errados
+    UDP_FORA_DA_FAIXA,          //canal ou frequência inválidos, nada é aplicado
+    UDP_ATRASADO,               //sequência antiga
+    UDP_SEM_TIMER,              //as frequências pedidas não cabem nos timers
+    UDP_AGENDA_CHEIA,           //já há AGENDA_TAMANHO comandos esperando a hora
+    NUM_STATUS_UDP
+};
+
+struct __attribute__((packed)) udp_resposta{
+    uint16_t magico;
+    uint8_t  versao;
+    uint8_t  status;            //enum status_udp
+    uint32_t sequencia;         //a do pacote respondido
+    uint16_t aceitos;           //canais alterados por este pacote
+    uint16_t ligados;           //canais ligados no hardware
+    uint32_t processamento_us;  //da chegada do pacote até a publicação
+};
+
+//Versão 2: depois do cabeçalho vem o agendamento, e cada comando leva a fase
+struct __attribute__((packed)) udp_agendamento{
+    int64_t  instante_us;       //esp_timer_get_time() do ESP32 (0 = já), ou relativo com UDP_AGENDA_RELATIVO
+    uint8_t  opcoes;            //UDP_AGENDA_*
+    uint8_t  reservado[3];
+};
+
+struct __attribute__((packed)) udp_comando_fase{
+    struct udp_comando comando;
+    uint16_t fase;              //65535 = um período
+    uint16_t reservado;
+};
+
+//A resposta da versão 2 leva o relógio do ESP32 na chegada do pacote, para o cliente marcar instantes
+struct __attribute__((packed)) udp_resposta_agendada{
+    struct udp_resposta base;
+    int64_t  relogio_us;
+};
+
+//Versão 3: o cabeçalho vem com quantidade 0 e é seguido do preset a aplicar
+struct __attribute__((packed)) udp_preset{
+    uint8_t  indice;            //0 a PRESET_MAXIMO-1, ou UDP_PRESET_VIZINHO
+    int8_t   passo;             //com UDP_PRESET_VIZINHO: 1 próximo, -1 anterior
+    uint16_t reservado;
+};
+
+_Static_assert(sizeof(struct udp_cabecalho) == 8,  "formato do pacote UDP mudou");
+_Static_assert(sizeof(struct udp_preset) == 4, "formato do pacote UDP mudou");
+_Static_assert(sizeof(struct udp_agendamento) == 12, "formato do pacote UDP mudou");
+_Static_assert(sizeof(struct udp_comando_fase) == 12, "formato do pacote UDP mudou");
+_Static_assert(sizeof(struct udp_resposta_agendada) == 24, "formato do pacote UDP mudou");
+_Static_assert(sizeof(struct udp_comando)   == 8,  "formato do pacote UDP mudou");
+_Static_assert(sizeof(struct udp_resposta)  == 16, "formato do pacote UDP mudou");
+
+//O maior pacote válido: a versão 2 com um comando para cada canal
+#define UDP_PACOTE_MAXIMO   (sizeof(struct udp_cabecalho) + sizeof(struct udp_agendamento) + \
+                             NUM_CANAIS_PWM * sizeof(struct udp_comando_fase))
+
+//Pacote que passou pela conferência do cabeçalho e do tamanho
+struct pedido_udp{
+    struct udp_cabecalho cabecalho;
+    bool     agendado;          //versão 2
+    bool     preset;            //versão 3
+    struct udp_preset troca;    //o preset pedido pela versão 3
+    int64_t  instante_us;       //versão 2: instante absoluto do comando, já somado à chegada se relativo
+    bool     sincroniza;
+    const uint8_t *comandos;    //o primeiro comando, dentro do pacote
+    size_t   tamanho_comando;
+};
+
+//Confere o pacote e prepara a resposta para ele: versão, sequência, relógio e o tamanho dela em
+//'tamanho_resposta'. Retorna false com o status UDP_INVALIDO se o tamanho, o mágico ou a versão estão errados
+bool udp_decodifica(const uint8_t *pacote, size_t tamanho, int64_t chegada_us, struct pedido_udp *pedido,
+                    struct udp_resposta_agendada *resposta, size_t *tamanho_resposta);
+
+//Um pacote que muda algo chegou depois de um mais novo e não pode desfazê-lo. A sequência 0 sempre passa
+bool udp_atrasado(const struct pedido_udp *pedido, uint32_t ultima_sequencia);
+
+//Aplica os comandos do pacote sobre 'canais' (a configuração atual) e marca em 'mascara' os canais que eles
+//mudam. Cada canal alterado passa pelo 'valida' (o gerador configurado tem que conseguir gerar); retorna
+//UDP_FORA_DA_FAIXA no primeiro canal ou valor inválido, e aí 'canais' não deve ser usado
+enum status_udp udp_le_comandos(const struct pedido_udp *pedido, struct parametros_pwm *canais, uint32_t *mascara,
+                                bool (*valida)(const struct parametros_pwm *parametros));
+
+#endif
@@ -0,0 +1,68 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "saida_html.h"
+
+
+void inicia_saida_html(struct saida_html *saida, envia_chunk_t envia, void *destino)
+{
+    saida->envia   = envia;
+    saida->destino = destino;
+    saida->usado   = 0;
+    saida->erro    = 0;
+}
+
+
+void envia_html(struct saida_html *saida, const char *dados, size_t tamanho)
+{
+    if (saida->erro != 0)
+        return;
+
+    //se não couber no que resta do buffer, esvazia o buffer primeiro
+    if (saida->usado + tamanho > sizeof(saida->buffer) && saida->usado > 0) {
+        saida->erro = saida->envia(saida->destino, saida->buffer, saida->usado);
+        saida->usado = 0;
+        if (saida->erro != 0)
+            return;
+    }
+
+    //fragmentos maiores que o buffer vão direto da flash para o socket, sem cópia
+    if (tamanho > sizeof(saida->buffer)) {
+        saida->erro = saida->envia(saida->destino, dados, tamanho);
+        return;
+    }
+
+    memcpy(saida->buffer + saida->usado, dados, tamanho);
+    saida->usado += tamanho;
+}
+
+
+//Formata um campo dinâmico (printf) direto no buffer de saída
+void envia_html_formatado(struct saida_html *saida, const char *formato, ...)
+{
+    char campo[128];
+    va_list args;
+
+    va_start(args, formato);
+    int tamanho = vsnprintf(campo, sizeof(campo), formato, args);
+    va_end(args);
+
+    if (tamanho < 0 || tamanho >= (int)sizeof(campo)) {
+        saida->erro = SAIDA_HTML_CAMPO_GRANDE;
+        return;
+    }
+    envia_html(saida, campo, tamanho);
+}
+
+
+int finaliza_saida_html(struct saida_html *saida)
+{
+    //envia o que sobrou no buffer e o chunk vazio que encerra a resposta
+    if (saida->erro == 0 && saida->usado > 0)
+        saida->erro = saida->envia(saida->destino, saida->buffer, saida->usado);
+    if (saida->erro == 0)
+        saida->erro = saida->envia(saida->destino, NULL, 0);
+    saida->usado = 0;
+    return saida->erro;
+}
@@ -0,0 +1,35 @@
+/*Saída das respostas em chunks: junta fragmentos pequenos (trechos fixos e campos formatados) num buffer na
+pilha e só chama a função de envio quando ele enche, sem heap. O envio é uma função dada por quem usa (no
+firmware o chunk escrito no socket pelas tasks de envio http), assim isto compila no PC sem nada do ESP-IDF*/
+#ifndef SAIDA_HTML_H
+#define SAIDA_HTML_H
+
+#include <stddef.h>
+
+//Um campo formatado maior que o buffer de formatação. O mesmo valor do ESP_ERR_INVALID_SIZE
+#define SAIDA_HTML_CAMPO_GRANDE     0x104
+
+//Envia um chunk (tamanho 0 encerra a resposta) e retorna 0 ou o erro, que interrompe a saída
+typedef int (*envia_chunk_t)(void *destino, const char *dados, size_t tamanho);
+
+struct saida_html{
+    envia_chunk_t envia;
+    void   *destino;                //a requisição, passada para o envia
+    char    buffer[512];
+    size_t  usado;
+    int     erro;                   //o primeiro erro do envio, os fragmentos seguintes são descartados
+};
+
+//Prepara a saída para enviar pela função 'envia' para o 'destino'
+void inicia_saida_html(struct saida_html *saida, envia_chunk_t envia, void *destino);
+
+//Acumula um trecho da resposta no buffer de saída, enviando um chunk quando ele enche
+void envia_html(struct saida_html *saida, const char *dados, size_t tamanho);
+
+//Formata um valor dinâmico da resposta e o acumula no buffer de saída
+void envia_html_formatado(struct saida_html *saida, const char *formato, ...);
+
+//Envia o que sobrou no buffer de saída e encerra a resposta em chunks
+int finaliza_saida_html(struct saida_html *saida);
+
+#endif
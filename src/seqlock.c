@@ -0,0 +1,32 @@
+#include "seqlock.h"
+
+
+/*As barreiras completas separam a cópia dos dados dos acessos à sequência. Com uma função por ponto do
+protocolo, a chamada também impede o compilador de mover a cópia (que é um memcpy comum) para fora deles*/
+void seqlock_inicia_escrita(uint32_t *sequencia)
+{
+    __atomic_store_n(sequencia, *sequencia + 1, __ATOMIC_RELAXED);      //só um escritor por vez altera
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+
+void seqlock_termina_escrita(uint32_t *sequencia)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    __atomic_store_n(sequencia, *sequencia + 1, __ATOMIC_RELAXED);
+}
+
+
+uint32_t seqlock_inicia_leitura(const uint32_t *sequencia)
+{
+    uint32_t inicio = __atomic_load_n(sequencia, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return inicio;
+}
+
+
+bool seqlock_repete_leitura(const uint32_t *sequencia, uint32_t inicio)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return (inicio & 1) || inicio != __atomic_load_n(sequencia, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,24 @@
+/*Seqlock: um escritor por vez altera os dados entre seqlock_inicia_escrita() e seqlock_termina_escrita(),
+que deixam a sequência ímpar durante a escrita, e os leitores copiam os dados entre seqlock_inicia_leitura()
+e seqlock_repete_leitura(), repetindo a cópia até pegar a mesma sequência par antes e depois. A leitura
+nunca trava e nunca vê os dados pela metade. Quem usa garante que os escritores se revezam (no firmware, com
+um spinlock). Só tem as barreiras do gcc, nada do ESP-IDF, para o teste de estresse rodar no PC*/
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//Marca o começo de uma escrita (sequência ímpar)
+void seqlock_inicia_escrita(uint32_t *sequencia);
+
+//Marca o fim de uma escrita (sequência par)
+void seqlock_termina_escrita(uint32_t *sequencia);
+
+//Sequência antes da cópia dos dados, para o seqlock_repete_leitura
+uint32_t seqlock_inicia_leitura(const uint32_t *sequencia);
+
+//Retorna true se a cópia que começou na sequência 'inicio' pode estar pela metade e deve ser repetida
+bool seqlock_repete_leitura(const uint32_t *sequencia, uint32_t inicio);
+
+#endif
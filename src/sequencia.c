@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "sequencia.h"
+#include "timer_pwm.h"              //PWM_FREQUENCIA_MAXIMA
+
+
+bool sequencia_interpreta(const char *texto, struct passo_sequencia *passos, int *num_passos,
+                          char *erro, size_t tamanho_erro)
+{
+    const char *separadores = " \t\r\n;";
+    const char *p = texto;
+    int n = 0;
+
+    while (1) {
+        p += strspn(p, separadores);
+        if (*p == '\0')
+            break;
+        if (n == SEQ_MAX_PASSOS) {
+            snprintf(erro, tamanho_erro, "Mais de %d passos", SEQ_MAX_PASSOS);
+            return false;
+        }
+
+        char letra = *p++;
+        if (letra >= 'a' && letra <= 'z')
+            letra -= 'a' - 'A';
+
+        //números do passo, separados por vírgula
+        uint32_t args[3] = {0};
+        int num_args = 0;
+        bool numero_valido = true;
+        do {
+            if (num_args == 3 || *p < '0' || *p > '9') {
+                numero_valido = false;
+                break;
+            }
+            uint32_t numero = 0;
+            for (; *p >= '0' && *p <= '9'; p++) {
+                uint32_t digito = *p - '0';
+                if (numero > (UINT32_MAX - digito) / 10)
+                    numero_valido = false;
+                numero = numero * 10 + digito;
+            }
+            args[num_args++] = numero;
+        } while (*p == ',' && ++p);
+        if (!numero_valido || (*p != '\0' && strchr(separadores, *p) == NULL)) {
+            snprintf(erro, tamanho_erro, "Passo %d: numero invalido", n);
+            return false;
+        }
+
+        struct passo_sequencia *passo = &passos[n];
+        const char *formato = NULL;       //preenchido quando o passo é inválido, vai na mensagem de erro
+        memset(passo, 0, sizeof(*passo));
+        switch (letra) {
+        case 'E':
+            passo->op    = SEQ_ESTADO;
+            passo->valor = args[0];
+            if (num_args != 1 || args[0] > 1)
+                formato = "E<0|1>";
+            break;
+        case 'F':
+            passo->op    = SEQ_FREQUENCIA;
+            passo->valor = args[0];
+            if (num_args != 1 || args[0] < 1 || args[0] > PWM_FREQUENCIA_MAXIMA)
+                formato = "F<hz>";
+            break;
+        case 'D':
+            passo->op    = SEQ_DUTY;
+            passo->valor = args[0];
+            if (num_args != 1 || args[0] > DUTY_FINO_MAXIMO)
+                formato = "D<duty de 0 a 65535>";
+            break;
+        case 'R':
+            passo->op    = SEQ_RAMPA;
+            passo->valor = args[0];
+            passo->ms    = args[1];
+            if (num_args != 2 || args[0] > DUTY_FINO_MAXIMO || args[1] < 1 || args[1] > SEQ_TEMPO_MAXIMO_MS)
+                formato = "R<duty de 0 a 65535>,<ms>";
+            break;
+        case 'W':
+            passo->op = SEQ_ESPERA;
+            passo->ms = args[0];
+            if (num_args != 1 || args[0] > SEQ_TEMPO_MAXIMO_MS)
+                formato = "W<ms>";
+            break;
+        case 'S':
+            passo->op    = SEQ_VARREDURA;
+            passo->valor = args[0];
+            passo->ms    = args[1];
+            passo->n     = args[2];
+            //cada degrau reprograma o timer, então pelo menos 1 ms por degrau
+            if (num_args != 3 || args[0] < 1 || args[0] > PWM_FREQUENCIA_MAXIMA || args[1] > SEQ_TEMPO_MAXIMO_MS ||
+                args[2] < 1 || args[2] > SEQ_DEGRAUS_MAXIMOS || args[1] < args[2])
+                formato = "S<hz>,<ms>,<degraus>";
+            break;
+        case 'B':
+            passo->op    = SEQ_RAJADA;
+            passo->n     = args[0];
+            passo->ms    = args[1];
+            passo->valor = args[2];
+            if (num_args != 3 || args[0] < 1 || args[0] > UINT16_MAX || args[1] < 1 || args[1] > SEQ_TEMPO_MAXIMO_MS ||
+                args[2] < 1 || args[2] > SEQ_TEMPO_MAXIMO_MS)
+                formato = "B<pulsos>,<ms ligado>,<ms desligado>";
+            break;
+        case 'L':
+            passo->op    = SEQ_LACO;
+            passo->valor = args[0];
+            passo->n     = args[1];
+            if (num_args != 2 || args[0] >= (uint32_t)n || args[1] > UINT16_MAX) {
+                formato = "L<passo anterior>,<vezes>";
+            } else {
+                //um laço sem nenhum passo que espere travaria a task do PWM
+                bool espera = false;
+                for (int i = args[0]; i < n; i++) {
+                    if (passos[i].op == SEQ_RAMPA || passos[i].op == SEQ_VARREDURA || passos[i].op == SEQ_RAJADA ||
+                        (passos[i].op == SEQ_ESPERA && passos[i].ms > 0))
+                        espera = true;
+                }
+                if (!espera)
+                    formato = "L precisa de uma espera no trecho repetido";
+            }
+            break;
+        default:
+            formato = "passo desconhecido, use E F D R W S B ou L";
+            break;
+        }
+        if (formato != NULL) {
+            snprintf(erro, tamanho_erro, "Passo %d: %s", n, formato);
+            return false;
+        }
+        n++;
+    }
+
+    *num_passos = n;
+    return true;
+}
+
+
+void sequencia_inicia(struct execucao_sequencia *s, const struct passo_sequencia *passos, int num_passos,
+                      const struct parametros_pwm *atual, int64_t agora_us)
+{
+    if (!s->executando) {
+        s->saida       = *atual;
+        s->duty_rajada = s->saida.duty_fino;
+    }
+
+    memcpy(s->passos, passos, num_passos * sizeof(passos[0]));
+    memset(s->repeticoes, 0, sizeof(s->repeticoes));
+    s->num_passos        = num_passos;
+    s->passo             = 0;
+    s->degrau            = 0;
+    s->prazo_us          = agora_us;
+    s->passos_executados = 0;
+    s->atraso_maximo_us  = 0;
+    s->executando        = (num_passos > 0);
+}
+
+
+//Se a task atrasou, os passos vencidos são executados em seguida e os prazos continuam os do programa. O
+//interpretador garante que todo laço tem uma espera, então isso sempre termina
+uint32_t sequencia_avanca(struct execucao_sequencia *s, int64_t agora_us, bool *terminou)
+{
+    uint32_t executados = 0;
+
+    *terminou = false;
+    while (s->executando && s->prazo_us <= agora_us) {
+        if (s->passo >= s->num_passos) {
+            s->executando = false;
+            *terminou     = true;
+            break;
+        }
+
+        const struct passo_sequencia *p = &s->passos[s->passo];
+        s->passos_executados++;
+        executados++;
+
+        switch (p->op) {
+        case SEQ_ESTADO:
+            s->saida.estado = (p->valor != 0);
+            s->passo++;
+            break;
+        case SEQ_FREQUENCIA:
+            s->saida.frequencia = p->valor;
+            s->passo++;
+            break;
+        case SEQ_DUTY:
+            s->saida.duty_fino = p->valor;
+            s->duty_rajada     = p->valor;
+            s->passo++;
+            break;
+        case SEQ_RAMPA:
+            s->saida.duty_fino = p->valor;
+            s->duty_rajada     = p->valor;
+            s->rampa_ms        = p->ms;
+            s->fim_rampa_us    = s->prazo_us + (int64_t)p->ms * 1000;
+            s->prazo_us        = s->fim_rampa_us;
+            s->passo++;
+            break;
+        case SEQ_ESPERA:
+            s->prazo_us += (int64_t)p->ms * 1000;
+            s->passo++;
+            break;
+        case SEQ_VARREDURA:
+            //degraus iguais entre a frequência atual e a final, o último degrau já é a frequência final
+            if (s->degrau == 0) {
+                s->valor_inicial   = s->saida.frequencia;
+                s->inicio_passo_us = s->prazo_us;
+            }
+            s->degrau++;
+            s->saida.frequencia = s->valor_inicial +
+                                  (int32_t)(((int64_t)p->valor - s->valor_inicial) * s->degrau / p->n);
+            s->prazo_us = s->inicio_passo_us + (int64_t)p->ms * 1000 * s->degrau / p->n;
+            if (s->degrau == p->n) {
+                s->degrau = 0;
+                s->passo++;
+            }
+            break;
+        case SEQ_RAJADA:
+            //degraus pares ligam o duty, ímpares zeram. O timer não é tocado, a troca de duty só acontece
+            //no fim do período do PWM. A rajada termina com o duty zerado
+            s->saida.duty_fino = (s->degrau & 1) ? 0 : s->duty_rajada;
+            s->prazo_us += (int64_t)((s->degrau & 1) ? p->valor : p->ms) * 1000;
+            if (++s->degrau == 2u * p->n) {
+                s->degrau = 0;
+                s->passo++;
+            }
+            break;
+        case SEQ_LACO:
+            if (p->n == 0) {
+                s->passo = p->valor;                        //para sempre
+            } else {
+                if (s->repeticoes[s->passo] == 0)
+                    s->repeticoes[s->passo] = p->n;        //o trecho roda 'n' vezes ao todo
+                if (--s->repeticoes[s->passo] > 0)
+                    s->passo = p->valor;
+                else
+                    s->passo++;
+            }
+            break;
+        }
+    }
+    return executados;
+}
+
+
+bool sequencia_segura_canal(const struct execucao_sequencia *s, int64_t agora_us)
+{
+    return s->executando || agora_us < s->fim_rampa_us;
+}
+
+
+int64_t sequencia_proximo_prazo(const struct execucao_sequencia *s, int64_t agora_us)
+{
+    if (s->executando)
+        return s->prazo_us;
+    if (s->fim_rampa_us > agora_us)
+        return s->fim_rampa_us;
+    return INT64_MAX;
+}
@@ -0,0 +1,81 @@
+/*Sequenciador dos canais: o interpretador do texto dos programas (PUT /api/seq/{n}) e a máquina de passos que
+calcula o que o canal deve ter a cada prazo. Quem aplica no LEDC, publica e acorda a task é o main.c; como em
+calibracao.h, aqui só tem aritmética, nada do ESP-IDF, para dar para compilar e conferir no PC*/
+#ifndef SEQUENCIA_H
+#define SEQUENCIA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "canais.h"
+
+//Cada canal pode executar um programa de até SEQ_MAX_PASSOS passos (rampas, varreduras, rajadas e laços),
+//enviado como texto em PUT /api/seq/{n}
+#define SEQ_MAX_PASSOS              16
+#define SEQ_PROGRAMA_TAMANHO_MAXIMO 512
+#define SEQ_TEMPO_MAXIMO_MS         3600000     //tempo máximo de um passo
+#define SEQ_DEGRAUS_MAXIMOS         1000        //degraus de uma varredura de frequência
+
+//Passos de um programa do sequenciador. No texto do programa cada passo é uma letra seguida dos números
+//separados por vírgula, e os passos são separados por espaço, quebra de linha ou ';'
+enum op_sequencia{
+    SEQ_ESTADO,                 //E<0|1>                          desliga/liga a saída
+    SEQ_FREQUENCIA,             //F<hz>                           troca a frequência
+    SEQ_DUTY,                   //D<duty>                         troca o duty (0 a 65535)
+    SEQ_RAMPA,                  //R<duty>,<ms>                    rampa de duty no hardware (fade do LEDC)
+    SEQ_ESPERA,                 //W<ms>                           espera
+    SEQ_VARREDURA,              //S<hz>,<ms>,<degraus>            varre a frequência até hz em degraus
+    SEQ_RAJADA,                 //B<pulsos>,<ms ligado>,<ms desligado>  liga e desliga o duty 'pulsos' vezes
+    SEQ_LACO,                   //L<passo>,<vezes>                repete desde o passo (0 = para sempre)
+};
+
+struct passo_sequencia{
+    uint8_t  op;                //enum op_sequencia
+    uint16_t n;                 //degraus, pulsos ou vezes
+    uint32_t valor;             //estado, frequência, duty, passo do laço ou ms desligado da rajada
+    uint32_t ms;
+};
+
+//Execução de um programa num canal, de uso exclusivo da task do PWM. Os prazos são absolutos, então um
+//atraso num passo não se acumula nos seguintes
+struct execucao_sequencia{
+    struct passo_sequencia passos[SEQ_MAX_PASSOS];
+    uint16_t repeticoes[SEQ_MAX_PASSOS];    //quantas vezes cada laço ainda vai repetir, 0 = não começou
+    uint8_t  num_passos;
+    uint8_t  passo;             //próximo passo a executar
+    bool     executando;
+    uint32_t degrau;            //progresso dentro de uma varredura ou rajada
+    int32_t  valor_inicial;     //frequência no começo da varredura
+    int32_t  duty_rajada;       //duty dos pulsos da rajada: o último pedido por D ou R
+    uint32_t rampa_ms;          //rampa a usar na próxima aplicação do duty, 0 = troca direta
+    int64_t  prazo_us;          //quando o próximo passo deve ser executado
+    int64_t  inicio_passo_us;   //começo da varredura em andamento
+    int64_t  prazo_vencido_us;  //prazo que acordou a task, para medir o atraso
+    int64_t  fim_rampa_us;      //o canal fica com a sequência até a rampa do hardware terminar
+    struct parametros_pwm saida;//o que a sequência está pedindo para o canal agora
+    uint32_t passos_executados;
+    uint32_t atraso_maximo_us;
+};
+
+//Interpreta o texto de um programa. Retorna false com o motivo em 'erro' se o programa é inválido
+bool sequencia_interpreta(const char *texto, struct passo_sequencia *passos, int *num_passos,
+                          char *erro, size_t tamanho_erro);
+
+//Começa um programa no canal (num_passos 0 para a sequência). Um programa novo continua de onde o anterior
+//parou; sem sequência rodando parte de 'atual', a configuração publicada do canal
+void sequencia_inicia(struct execucao_sequencia *s, const struct passo_sequencia *passos, int num_passos,
+                      const struct parametros_pwm *atual, int64_t agora_us);
+
+//Executa os passos vencidos até um que precise esperar e retorna quantos foram executados. 'terminou' fica
+//true quando o programa chega ao fim: s->saida tem então os valores finais, que viram a configuração do canal
+uint32_t sequencia_avanca(struct execucao_sequencia *s, int64_t agora_us, bool *terminou);
+
+//O canal fica com a sequência enquanto ela roda e, parada no meio de uma rampa, até o fade terminar (o driver
+//não troca o duty durante o fade)
+bool sequencia_segura_canal(const struct execucao_sequencia *s, int64_t agora_us);
+
+//Próximo instante em que o canal precisa da task: o prazo do passo ou o fim da rampa, INT64_MAX se nenhum
+int64_t sequencia_proximo_prazo(const struct execucao_sequencia *s, int64_t agora_us);
+
+#endif
@@ -0,0 +1,54 @@
+#include "timer_pwm.h"
+#include "canais.h"                 //DUTY_FINO_MAXIMO
+
+
+/*Pela documentação do LEDC:
+
+    frequencia = timer_clk_freq / (divisor * 2^resolucao_duty),  com 1 <= divisor < 1024
+
+A maior resolução possível é então floor(log2(timer_clk_freq / frequencia)), limitada a PWM_RESOLUCAO_MAXIMA, pois
+ela deixa o divisor o mais próximo de 1. O log2 inteiro sai de uma contagem de zeros à esquerda (uma
+instrução no Xtensa) e o resto é aritmética inteira, sem ponto flutuante no caminho da requisição*/
+bool timer_pwm_calcula(uint32_t frequencia, uint32_t timer_clk_freq, struct config_timer_pwm *timer)
+{
+    if (frequencia == 0 || frequencia > timer_clk_freq / 2)
+        return false;
+
+    uint32_t razao = timer_clk_freq / frequencia;               //>= 2 pelo teste acima
+    uint32_t resolucao = 31 - __builtin_clz(razao);             //floor(log2(razao))
+    if (resolucao > PWM_RESOLUCAO_MAXIMA)
+        resolucao = PWM_RESOLUCAO_MAXIMA;
+
+    //divisor = timer_clk_freq * 256 / (frequencia * 2^resolucao), arredondado
+    uint64_t numerador   = (uint64_t)timer_clk_freq << PWM_DIVISOR_BITS_FRACAO;
+    uint64_t denominador = (uint64_t)frequencia << resolucao;
+    uint64_t divisor     = (numerador + denominador / 2) / denominador;
+
+    if (divisor < PWM_DIVISOR_MINIMO)
+        divisor = PWM_DIVISOR_MINIMO;
+    if (divisor > PWM_DIVISOR_MAXIMO)
+        return false;                                           //frequência baixa demais para este clock
+
+    //o erro sai da razão exata e não da frequência em mHz, que abaixo de 1 kHz já tem mais de 1 ppm de passo
+    uint64_t periodo    = divisor << resolucao;                 //em 1/256 de ciclo do clock
+    uint64_t obtida_mhz = (numerador * 1000 + periodo / 2) / periodo;
+    int64_t  pedida     = (int64_t)(frequencia * periodo);      //numerador se a frequência fosse exata
+
+    timer->divisor        = (uint32_t)divisor;
+    timer->resolucao_duty = resolucao;
+    timer->frequencia_mhz = obtida_mhz;
+    timer->erro_ppm       = (int32_t)((((int64_t)numerador - pedida) * 1000000) / pedida);
+    return true;
+}
+
+
+//A fase é onde o pulso começa. O LEDC não dá a volta no fim do período (o pulso ficaria alto para sempre),
+//então o duty é limitado para o pulso terminar até o fim do período
+void timer_pwm_duty(uint32_t duty_fino, uint32_t fase, uint32_t resolucao, uint32_t *duty, uint32_t *hpoint)
+{
+    uint32_t periodo = 1u << resolucao;
+    *duty   = (uint32_t)(((uint64_t)duty_fino << resolucao) / DUTY_FINO_MAXIMO);
+    *hpoint = (uint32_t)(((uint64_t)fase << resolucao) / (DUTY_FINO_MAXIMO + 1));
+    if (*hpoint + *duty > periodo)
+        *duty = periodo - *hpoint;
+}
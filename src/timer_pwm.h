@@ -0,0 +1,35 @@
+/*Cálculo do timer do LEDC para uma frequência: a maior resolução do duty e o divisor do clock. Como em
+calibracao.h, aqui só tem aritmética, nada do ESP-IDF, para dar para compilar e conferir no PC*/
+#ifndef TIMER_PWM_H
+#define TIMER_PWM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Limites do periférico LEDC do ESP32 usados pelo cálculo do timer. O divisor do clock é um número de
+ponto fixo 10.8 (10 bits inteiros e 8 fracionários), logo vai de 1.0 (256) até 1023.996 (0x3FFFF)*/
+#define PWM_CLK_APB               80000000  //clock APB, fonte LEDC_APB_CLK
+#define PWM_CLK_REF_TICK          1000000   //clock REF_TICK, fonte LEDC_REF_TICK (não muda com o DFS)
+#define PWM_RESOLUCAO_MAXIMA      19        //o LEDC tem 20 bits, mas neles o duty 2^20 (100%) não cabe e a saída vai a 0
+#define PWM_DIVISOR_BITS_FRACAO   8
+#define PWM_DIVISOR_MINIMO        (1 << PWM_DIVISOR_BITS_FRACAO)
+#define PWM_DIVISOR_MAXIMO        0x3FFFF
+#define PWM_FREQUENCIA_MAXIMA     (PWM_CLK_APB / 2)   //1 bit de resolução com divisor 1
+
+//Configuração de um timer do LEDC para uma frequência
+struct config_timer_pwm{
+    uint32_t divisor;           //divisor do clock em ponto fixo 10.8
+    uint32_t resolucao_duty;    //bits de resolução do duty
+    uint64_t frequencia_mhz;    //frequência que o timer realmente gera, em mHz
+    int32_t  erro_ppm;          //erro da frequência obtida em relação à pedida, em partes por milhão
+};
+
+//Maior resolução do duty e divisor do timer que geram a frequência pedida com o clock dado. Devolve false
+//se a frequência não é possível com esse clock (0, acima da metade do clock ou baixa demais para o divisor)
+bool timer_pwm_calcula(uint32_t frequencia, uint32_t timer_clk_freq, struct config_timer_pwm *timer);
+
+//Duty e hpoint do LEDC para um duty e uma fase em unidades finas (DUTY_FINO_MAXIMO = 100%). 100% vira
+//2^resolucao (saída sempre alta) e o duty é limitado para o pulso terminar até o fim do período
+void timer_pwm_duty(uint32_t duty_fino, uint32_t fase, uint32_t resolucao, uint32_t *duty, uint32_t *hpoint);
+
+#endif
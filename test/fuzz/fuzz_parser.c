@@ -0,0 +1,139 @@
+/*Fuzzer do parser do corpo das requisições (src/parser.c), para o libFuzzer ou o AFL. Cada entrada é usada
+como formulário e como JSON. Além dos erros de memória que o sanitizer pega, o fuzzer confere que:
+
+  - o resultado do formulário não depende dos pedaços em que ele chega (o primeiro byte escolhe o tamanho);
+  - um formulário aceito só deixa nos canais valores que a task do PWM aceita, e um recusado não altera canais
+    fora dos que já tinham aparecido nele;
+  - o valor achado no JSON fica dentro do texto.
+
+Com o libFuzzer (clang), da raiz do projeto:
+
+    clang -g -O1 -fsanitize=fuzzer,address,undefined -I src src/parser.c src/geradores.c src/timer_pwm.c \
+        test/fuzz/fuzz_parser.c -o fuzz_parser
+    ./fuzz_parser -max_len=2048 test/fuzz/corpus
+
+Com o AFL ou só para repetir as entradas de um diretório, sem o libFuzzer (a main do fim do arquivo lê cada
+arquivo passado, ou o stdin):
+
+    afl-clang-fast -g -DFUZZ_MAIN -I src src/parser.c src/geradores.c src/timer_pwm.c test/fuzz/fuzz_parser.c \
+        -o fuzz_parser_afl
+    afl-fuzz -i test/fuzz/corpus -o saida_afl -- ./fuzz_parser_afl @@*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+#include "geradores.h"
+#include "timer_pwm.h"
+
+#define FUZZ_TAMANHO_MAXIMO     2048        //FORMULARIO_TAMANHO_MAXIMO do main.c
+
+int LLVMFuzzerTestOneInput(const uint8_t *dados, size_t tamanho);
+
+
+//Os canais no estado que o parser recebe: valores válidos e diferentes em cada canal
+static void canais_iniciais(struct parametros_pwm *canais)
+{
+    memset(canais, 0, sizeof(*canais) * NUM_CANAIS_PWM);
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        canais[i].frequencia = 1000 + i;
+        canais[i].duty_fino  = i * 1000;
+        canais[i].estado     = i & 1;
+    }
+}
+
+static bool le_formulario(const char *corpo, size_t tamanho, size_t pedaco, struct parametros_pwm *canais,
+                          uint32_t *mascara)
+{
+    struct parser_formulario parser;
+    canais_iniciais(canais);
+    parser_formulario_inicia(&parser, canais);
+    for (size_t i = 0; i < tamanho; i += pedaco)
+        parser_formulario_alimenta(&parser, corpo + i, (tamanho - i < pedaco) ? tamanho - i : pedaco);
+    bool valido = parser_formulario_finaliza(&parser);
+    *mascara = parser.mascara;
+    return valido;
+}
+
+static void confere_formulario(const char *corpo, size_t tamanho, size_t pedaco)
+{
+    struct parametros_pwm inteiro[NUM_CANAIS_PWM], em_pedacos[NUM_CANAIS_PWM], inicial[NUM_CANAIS_PWM];
+    uint32_t mascara_inteiro, mascara_pedacos;
+
+    bool valido = le_formulario(corpo, tamanho, tamanho > 0 ? tamanho : 1, inteiro, &mascara_inteiro);
+    if (le_formulario(corpo, tamanho, pedaco, em_pedacos, &mascara_pedacos) != valido ||
+        mascara_pedacos != mascara_inteiro || memcmp(inteiro, em_pedacos, sizeof(inteiro)) != 0)
+        abort();                                    //o resultado dependeu dos pedaços
+
+    canais_iniciais(inicial);
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        const struct parametros_pwm *p = &inteiro[i];
+        if (!(mascara_inteiro & (1u << i)) && memcmp(p, &inicial[i], sizeof(*p)) != 0)
+            abort();                                //alterou um canal que não estava no formulário
+        if (valido && (p->frequencia < 1 || p->frequencia > PWM_FREQUENCIA_MAXIMA || p->duty_fino < 0 ||
+                       p->duty_fino > DUTY_FINO_MAXIMO))
+            abort();                                //aceitou um valor fora da faixa
+    }
+    if (mascara_inteiro >> NUM_CANAIS_PWM)
+        abort();
+}
+
+static void confere_json(const char *json, size_t tamanho)
+{
+    static const char *const chaves[] = {"estado", "gerador", "frequencia", "percentual_duty", "duty_fino", "fase",
+                                         "complementar", "tempo_morto_ns", "pulsos", ""};
+    for (size_t c = 0; c < sizeof(chaves) / sizeof(chaves[0]); c++) {
+        const char *valor = parser_json_valor(json, chaves[c]);
+        if (valor != NULL && (valor < json || valor > json + tamanho))
+            abort();
+        int numero, gerador;
+        parser_json_campo(json, chaves[c], &numero);
+        if (parser_json_gerador(json, chaves[c], &gerador) && (gerador < -1 || gerador >= NUM_GERADORES))
+            abort();
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *dados, size_t tamanho)
+{
+    static char texto[FUZZ_TAMANHO_MAXIMO + 1];
+    if (tamanho < 1 || tamanho > FUZZ_TAMANHO_MAXIMO + 1)
+        return 0;
+
+    //o primeiro byte é o tamanho dos pedaços, o resto é o corpo (sem o '\0' no fim, como vem do socket)
+    size_t pedaco = 1 + dados[0] % 64;
+    tamanho--;
+    memcpy(texto, dados + 1, tamanho);
+    texto[tamanho] = '\0';
+
+    confere_formulario(texto, tamanho, pedaco);
+    confere_json(texto, strlen(texto));           //o handler do PUT para no primeiro '\0'
+    return 0;
+}
+
+
+#ifdef FUZZ_MAIN
+//Roda cada arquivo passado como uma entrada do fuzzer, ou o stdin se não há arquivos
+static void roda_arquivo(FILE *arquivo)
+{
+    static uint8_t dados[FUZZ_TAMANHO_MAXIMO + 1];
+    size_t tamanho = fread(dados, 1, sizeof(dados), arquivo);
+    LLVMFuzzerTestOneInput(dados, tamanho);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+        roda_arquivo(stdin);
+    for (int i = 1; i < argc; i++) {
+        FILE *arquivo = fopen(argv[i], "rb");
+        if (arquivo == NULL) {
+            perror(argv[i]);
+            return 1;
+        }
+        roda_arquivo(arquivo);
+        fclose(arquivo);
+    }
+    return 0;
+}
+#endif
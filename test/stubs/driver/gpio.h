@@ -0,0 +1,103 @@
+/*driver/gpio.h da simulação: o teste escolhe o nível de cada pino (sim_gpio_nivel) e dispara as interrupções
+dos botões (sim_gpio_interrupcao)*/
+#ifndef DRIVER_GPIO_H
+#define DRIVER_GPIO_H
+
+#include "simulacao.h"
+
+#define SIM_GPIO_PINOS  40
+
+typedef enum {
+    GPIO_MODE_DISABLE = 0,
+    GPIO_MODE_INPUT   = 1,
+    GPIO_MODE_OUTPUT  = 2,
+} gpio_mode_t;
+
+typedef enum {
+    GPIO_PULLUP_DISABLE,
+    GPIO_PULLUP_ENABLE,
+} gpio_pullup_t;
+
+typedef enum {
+    GPIO_PULLDOWN_DISABLE,
+    GPIO_PULLDOWN_ENABLE,
+} gpio_pulldown_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE,
+    GPIO_INTR_POSEDGE,
+    GPIO_INTR_NEGEDGE,
+    GPIO_INTR_ANYEDGE,
+} gpio_int_type_t;
+
+typedef struct {
+    uint64_t        pin_bit_mask;
+    gpio_mode_t     mode;
+    gpio_pullup_t   pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+typedef void (*gpio_isr_t)(void *arg);
+
+struct sim_gpio{
+    int        niveis[SIM_GPIO_PINOS];
+    bool       servico_isr;
+    gpio_isr_t isr[SIM_GPIO_PINOS];
+    void      *arg[SIM_GPIO_PINOS];
+};
+
+static inline struct sim_gpio *sim_gpio(void)
+{
+    static struct sim_gpio gpio;
+    return &gpio;
+}
+
+static inline esp_err_t gpio_config(const gpio_config_t *config)
+{
+    esp_err_t erro = (config->pin_bit_mask >> SIM_GPIO_PINOS) == 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+    return sim_registra("gpio_config", (int32_t)(config->pin_bit_mask & 0x7FFFFFFF),
+                        (int32_t)(config->pin_bit_mask >> 31), config->mode, config->intr_type, erro);
+}
+
+static inline int gpio_get_level(int pino)
+{
+    return (pino >= 0 && pino < SIM_GPIO_PINOS) ? __atomic_load_n(&sim_gpio()->niveis[pino], __ATOMIC_RELAXED) : 0;
+}
+
+static inline esp_err_t gpio_install_isr_service(int flags)
+{
+    struct sim_gpio *gpio = sim_gpio();
+    esp_err_t erro = gpio->servico_isr ? ESP_ERR_INVALID_STATE : ESP_OK;
+    gpio->servico_isr = true;
+    return sim_registra("gpio_install_isr_service", flags, 0, 0, 0, erro);
+}
+
+static inline esp_err_t gpio_isr_handler_add(int pino, gpio_isr_t isr, void *arg)
+{
+    struct sim_gpio *gpio = sim_gpio();
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (!gpio->servico_isr) {
+        erro = ESP_ERR_INVALID_STATE;
+    } else if (pino >= 0 && pino < SIM_GPIO_PINOS) {
+        gpio->isr[pino] = isr;
+        gpio->arg[pino] = arg;
+        erro = ESP_OK;
+    }
+    return sim_registra("gpio_isr_handler_add", pino, 0, 0, 0, erro);
+}
+
+static inline void sim_gpio_nivel(int pino, int nivel)
+{
+    __atomic_store_n(&sim_gpio()->niveis[pino], nivel, __ATOMIC_RELAXED);
+}
+
+//Chama o handler de interrupção do pino, como uma borda nele
+static inline void sim_gpio_interrupcao(int pino)
+{
+    struct sim_gpio *gpio = sim_gpio();
+    if (gpio->isr[pino] != NULL)
+        gpio->isr[pino](gpio->arg[pino]);
+}
+
+#endif
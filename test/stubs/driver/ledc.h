@@ -0,0 +1,292 @@
+/*driver/ledc.h da simulação: cada chamada fica no registro (simulacao.h) com o instante em que foi feita, e os
+registradores de cada timer e canal ficam em sim_ledc() com as mesmas regras do ESP32: o duty e o hpoint
+escritos só valem depois do ledc_update_duty, o divisor tem 18 bits (10.8) e a resolução vai até 20 bits*/
+#ifndef DRIVER_LEDC_H
+#define DRIVER_LEDC_H
+
+#include "simulacao.h"
+
+typedef enum {
+    LEDC_HIGH_SPEED_MODE,
+    LEDC_LOW_SPEED_MODE,
+    LEDC_SPEED_MODE_MAX,
+} ledc_mode_t;
+
+typedef enum {
+    LEDC_TIMER_0,
+    LEDC_TIMER_1,
+    LEDC_TIMER_2,
+    LEDC_TIMER_3,
+    LEDC_TIMER_MAX,
+} ledc_timer_t;
+
+typedef enum {
+    LEDC_CHANNEL_0,
+    LEDC_CHANNEL_1,
+    LEDC_CHANNEL_2,
+    LEDC_CHANNEL_3,
+    LEDC_CHANNEL_4,
+    LEDC_CHANNEL_5,
+    LEDC_CHANNEL_6,
+    LEDC_CHANNEL_7,
+    LEDC_CHANNEL_MAX,
+} ledc_channel_t;
+
+typedef enum {
+    LEDC_TIMER_1_BIT = 1,
+    LEDC_TIMER_4_BIT = 4,
+    LEDC_TIMER_10_BIT = 10,
+    LEDC_TIMER_20_BIT = 20,
+    LEDC_TIMER_BIT_MAX,
+} ledc_timer_bit_t;
+
+typedef enum {
+    LEDC_AUTO_CLK,
+    LEDC_USE_REF_TICK,
+    LEDC_USE_APB_CLK,
+    LEDC_USE_RTC8M_CLK,
+} ledc_clk_cfg_t;
+
+typedef enum {
+    LEDC_REF_TICK,
+    LEDC_APB_CLK,
+} ledc_clk_src_t;
+
+typedef enum {
+    LEDC_INTR_DISABLE,
+    LEDC_INTR_FADE_END,
+} ledc_intr_type_t;
+
+typedef enum {
+    LEDC_FADE_NO_WAIT,
+    LEDC_FADE_WAIT_DONE,
+} ledc_fade_mode_t;
+
+typedef struct {
+    ledc_mode_t speed_mode;
+    union {
+        ledc_timer_bit_t duty_resolution;
+        ledc_timer_bit_t bit_num;
+    };
+    ledc_timer_t   timer_num;
+    uint32_t       freq_hz;
+    ledc_clk_cfg_t clk_cfg;
+} ledc_timer_config_t;
+
+typedef struct {
+    int              gpio_num;
+    ledc_mode_t      speed_mode;
+    ledc_channel_t   channel;
+    ledc_intr_type_t intr_type;
+    ledc_timer_t     timer_sel;
+    uint32_t         duty;
+    int              hpoint;
+    struct {
+        unsigned int output_invert: 1;
+    } flags;
+} ledc_channel_config_t;
+
+//Os registradores simulados do LEDC
+struct sim_ledc{
+    pthread_mutex_t mutex;
+    struct {
+        uint32_t divisor;               //10.8 bits
+        uint32_t resolucao;
+        bool     pausado;
+    } timers[LEDC_SPEED_MODE_MAX][LEDC_TIMER_MAX];
+    struct {
+        int      gpio;
+        int      timer;
+        uint32_t duty, hpoint;          //os que valem na saída
+        uint32_t duty_escrito, hpoint_escrito;
+        bool     parado;
+        uint32_t nivel_parado;
+        int64_t  atualizado_ns;         //último ledc_update_duty
+    } canais[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX];
+    bool fade_instalado;
+};
+
+static inline struct sim_ledc *sim_ledc(void)
+{
+    static struct sim_ledc ledc = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+    return &ledc;
+}
+
+static inline bool sim_ledc_valido(ledc_mode_t modo, int canal, int limite)
+{
+    return (unsigned)modo < LEDC_SPEED_MODE_MAX && canal >= 0 && canal < limite;
+}
+
+static inline esp_err_t ledc_timer_set(ledc_mode_t modo, ledc_timer_t timer, uint32_t divisor, uint32_t resolucao,
+                                       ledc_clk_src_t clock)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_ledc_valido(modo, timer, LEDC_TIMER_MAX) && divisor >= 256 && divisor <= 0x3FFFF &&
+        resolucao >= 1 && resolucao <= 20) {
+        struct sim_ledc *ledc = sim_ledc();
+        pthread_mutex_lock(&ledc->mutex);
+        ledc->timers[modo][timer].divisor   = divisor;
+        ledc->timers[modo][timer].resolucao = resolucao;
+        pthread_mutex_unlock(&ledc->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("ledc_timer_set", modo, timer, (int32_t)divisor, (int32_t)(resolucao | (clock << 8)), erro);
+}
+
+//Como no driver: o divisor sai da frequência pedida e da resolução, com o clock APB de 80 MHz
+static inline esp_err_t ledc_timer_config(const ledc_timer_config_t *config)
+{
+    if (config->freq_hz == 0)
+        return sim_registra("ledc_timer_config", config->speed_mode, config->timer_num, 0, 0, ESP_ERR_INVALID_ARG);
+    uint64_t divisor = ((uint64_t)80000000 << 8) / ((uint64_t)config->freq_hz << config->duty_resolution);
+    esp_err_t erro = ledc_timer_set(config->speed_mode, config->timer_num, (uint32_t)divisor,
+                                    config->duty_resolution, LEDC_APB_CLK);
+    return sim_registra("ledc_timer_config", config->speed_mode, config->timer_num, (int32_t)config->freq_hz,
+                        config->duty_resolution, erro);
+}
+
+static inline esp_err_t ledc_channel_config(const ledc_channel_config_t *config)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_ledc_valido(config->speed_mode, config->channel, LEDC_CHANNEL_MAX) &&
+        (unsigned)config->timer_sel < LEDC_TIMER_MAX) {
+        struct sim_ledc *ledc = sim_ledc();
+        pthread_mutex_lock(&ledc->mutex);
+        ledc->canais[config->speed_mode][config->channel].gpio   = config->gpio_num;
+        ledc->canais[config->speed_mode][config->channel].timer  = config->timer_sel;
+        ledc->canais[config->speed_mode][config->channel].duty   = config->duty;
+        ledc->canais[config->speed_mode][config->channel].hpoint = (uint32_t)config->hpoint;
+        ledc->canais[config->speed_mode][config->channel].parado = false;
+        pthread_mutex_unlock(&ledc->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("ledc_channel_config", config->speed_mode, config->channel, config->gpio_num,
+                        config->timer_sel, erro);
+}
+
+static inline esp_err_t ledc_bind_channel_timer(ledc_mode_t modo, ledc_channel_t canal, ledc_timer_t timer)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_ledc_valido(modo, canal, LEDC_CHANNEL_MAX) && (unsigned)timer < LEDC_TIMER_MAX) {
+        struct sim_ledc *ledc = sim_ledc();
+        pthread_mutex_lock(&ledc->mutex);
+        ledc->canais[modo][canal].timer = timer;
+        pthread_mutex_unlock(&ledc->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("ledc_bind_channel_timer", modo, canal, timer, 0, erro);
+}
+
+static inline esp_err_t ledc_set_duty_with_hpoint(ledc_mode_t modo, ledc_channel_t canal, uint32_t duty, uint32_t hpoint)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_ledc_valido(modo, canal, LEDC_CHANNEL_MAX) && hpoint <= 0xFFFFF) {
+        struct sim_ledc *ledc = sim_ledc();
+        pthread_mutex_lock(&ledc->mutex);
+        ledc->canais[modo][canal].duty_escrito   = duty;
+        ledc->canais[modo][canal].hpoint_escrito = hpoint;
+        pthread_mutex_unlock(&ledc->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("ledc_set_duty_with_hpoint", modo, canal, (int32_t)duty, (int32_t)hpoint, erro);
+}
+
+static inline esp_err_t ledc_set_duty(ledc_mode_t modo, ledc_channel_t canal, uint32_t duty)
+{
+    return ledc_set_duty_with_hpoint(modo, canal, duty, 0);
+}
+
+//Trava o duty e o hpoint escritos, e religa a saída se ela estava parada
+static inline esp_err_t ledc_update_duty(ledc_mode_t modo, ledc_channel_t canal)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    uint32_t duty = 0;
+    if (sim_ledc_valido(modo, canal, LEDC_CHANNEL_MAX)) {
+        struct sim_ledc *ledc = sim_ledc();
+        pthread_mutex_lock(&ledc->mutex);
+        ledc->canais[modo][canal].duty          = ledc->canais[modo][canal].duty_escrito;
+        ledc->canais[modo][canal].hpoint        = ledc->canais[modo][canal].hpoint_escrito;
+        ledc->canais[modo][canal].parado        = false;
+        ledc->canais[modo][canal].atualizado_ns = sim_agora_ns();
+        duty = ledc->canais[modo][canal].duty;
+        pthread_mutex_unlock(&ledc->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("ledc_update_duty", modo, canal, (int32_t)duty, 0, erro);
+}
+
+static inline esp_err_t ledc_stop(ledc_mode_t modo, ledc_channel_t canal, uint32_t nivel)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_ledc_valido(modo, canal, LEDC_CHANNEL_MAX)) {
+        struct sim_ledc *ledc = sim_ledc();
+        pthread_mutex_lock(&ledc->mutex);
+        ledc->canais[modo][canal].parado       = true;
+        ledc->canais[modo][canal].nivel_parado = nivel;
+        pthread_mutex_unlock(&ledc->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("ledc_stop", modo, canal, (int32_t)nivel, 0, erro);
+}
+
+static inline esp_err_t ledc_timer_rst(ledc_mode_t modo, ledc_timer_t timer)
+{
+    esp_err_t erro = sim_ledc_valido(modo, timer, LEDC_TIMER_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+    return sim_registra("ledc_timer_rst", modo, timer, 0, 0, erro);
+}
+
+static inline esp_err_t ledc_set_pin(int gpio, ledc_mode_t modo, ledc_channel_t canal)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_ledc_valido(modo, canal, LEDC_CHANNEL_MAX) && gpio >= 0 && gpio < 40) {
+        struct sim_ledc *ledc = sim_ledc();
+        pthread_mutex_lock(&ledc->mutex);
+        ledc->canais[modo][canal].gpio = gpio;
+        pthread_mutex_unlock(&ledc->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("ledc_set_pin", modo, canal, gpio, 0, erro);
+}
+
+static inline esp_err_t ledc_fade_func_install(int flags)
+{
+    struct sim_ledc *ledc = sim_ledc();
+    esp_err_t erro = ledc->fade_instalado ? ESP_ERR_INVALID_STATE : ESP_OK;
+    ledc->fade_instalado = true;
+    return sim_registra("ledc_fade_func_install", flags, 0, 0, 0, erro);
+}
+
+//A rampa simulada termina na hora: o duty final já fica escrito e o ledc_fade_start o aplica
+static inline esp_err_t ledc_set_fade_with_time(ledc_mode_t modo, ledc_channel_t canal, uint32_t duty, int tempo_ms)
+{
+    struct sim_ledc *ledc = sim_ledc();
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (!ledc->fade_instalado) {
+        erro = ESP_ERR_INVALID_STATE;
+    } else if (sim_ledc_valido(modo, canal, LEDC_CHANNEL_MAX)) {
+        pthread_mutex_lock(&ledc->mutex);
+        ledc->canais[modo][canal].duty_escrito = duty;
+        pthread_mutex_unlock(&ledc->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("ledc_set_fade_with_time", modo, canal, (int32_t)duty, tempo_ms, erro);
+}
+
+static inline esp_err_t ledc_fade_start(ledc_mode_t modo, ledc_channel_t canal, ledc_fade_mode_t espera)
+{
+    struct sim_ledc *ledc = sim_ledc();
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (!ledc->fade_instalado) {
+        erro = ESP_ERR_INVALID_STATE;
+    } else if (sim_ledc_valido(modo, canal, LEDC_CHANNEL_MAX)) {
+        pthread_mutex_lock(&ledc->mutex);
+        ledc->canais[modo][canal].duty          = ledc->canais[modo][canal].duty_escrito;
+        ledc->canais[modo][canal].parado        = false;
+        ledc->canais[modo][canal].atualizado_ns = sim_agora_ns();
+        pthread_mutex_unlock(&ledc->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("ledc_fade_start", modo, canal, espera, 0, erro);
+}
+
+#endif
@@ -0,0 +1,181 @@
+/*driver/mcpwm.h da simulação: as chamadas ficam no registro (o duty em centésimos de ponto percentual) e o
+estado de cada operador em sim_mcpwm()*/
+#ifndef DRIVER_MCPWM_H
+#define DRIVER_MCPWM_H
+
+#include "simulacao.h"
+
+typedef enum {
+    MCPWM_UNIT_0,
+    MCPWM_UNIT_1,
+    MCPWM_UNIT_MAX,
+} mcpwm_unit_t;
+
+typedef enum {
+    MCPWM_TIMER_0,
+    MCPWM_TIMER_1,
+    MCPWM_TIMER_2,
+    MCPWM_TIMER_MAX,
+} mcpwm_timer_t;
+
+typedef enum {
+    MCPWM_GEN_A,
+    MCPWM_GEN_B,
+    MCPWM_GEN_MAX,
+} mcpwm_generator_t;
+
+typedef enum {
+    MCPWM0A = 0,
+    MCPWM0B,
+    MCPWM1A,
+    MCPWM1B,
+    MCPWM2A,
+    MCPWM2B,
+} mcpwm_io_signals_t;
+
+typedef enum {
+    MCPWM_DUTY_MODE_0,
+    MCPWM_DUTY_MODE_1,
+} mcpwm_duty_type_t;
+
+typedef enum {
+    MCPWM_FREEZE_COUNTER,
+    MCPWM_UP_COUNTER,
+    MCPWM_DOWN_COUNTER,
+    MCPWM_UP_DOWN_COUNTER,
+} mcpwm_counter_type_t;
+
+typedef enum {
+    MCPWM_DEADTIME_BYPASS,
+    MCPWM_BYPASS_RED,
+    MCPWM_BYPASS_FED,
+    MCPWM_ACTIVE_HIGH_MODE,
+    MCPWM_ACTIVE_LOW_MODE,
+    MCPWM_ACTIVE_HIGH_COMPLIMENT_MODE,
+} mcpwm_deadtime_type_t;
+
+typedef struct {
+    uint32_t             frequency;
+    float                cmpr_a;
+    float                cmpr_b;
+    mcpwm_duty_type_t    duty_mode;
+    mcpwm_counter_type_t counter_mode;
+} mcpwm_config_t;
+
+struct sim_mcpwm{
+    pthread_mutex_t mutex;
+    uint32_t        resolucao_grupo[MCPWM_UNIT_MAX];
+    struct {
+        uint32_t resolucao;
+        uint32_t frequencia;
+        float    duty_a;
+        bool     rodando;
+        bool     tempo_morto;
+    } operadores[MCPWM_UNIT_MAX][MCPWM_TIMER_MAX];
+};
+
+static inline struct sim_mcpwm *sim_mcpwm(void)
+{
+    static struct sim_mcpwm mcpwm = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+    return &mcpwm;
+}
+
+static inline bool sim_mcpwm_valido(mcpwm_unit_t unidade, mcpwm_timer_t timer)
+{
+    return (unsigned)unidade < MCPWM_UNIT_MAX && (unsigned)timer < MCPWM_TIMER_MAX;
+}
+
+static inline esp_err_t mcpwm_group_set_resolution(mcpwm_unit_t unidade, unsigned long resolucao)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if ((unsigned)unidade < MCPWM_UNIT_MAX && resolucao > 0 && resolucao <= 160000000) {
+        sim_mcpwm()->resolucao_grupo[unidade] = (uint32_t)resolucao;
+        erro = ESP_OK;
+    }
+    return sim_registra("mcpwm_group_set_resolution", unidade, 0, (int32_t)resolucao, 0, erro);
+}
+
+static inline esp_err_t mcpwm_timer_set_resolution(mcpwm_unit_t unidade, mcpwm_timer_t timer, unsigned long resolucao)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_mcpwm_valido(unidade, timer) && resolucao > 0 && resolucao <= sim_mcpwm()->resolucao_grupo[unidade]) {
+        sim_mcpwm()->operadores[unidade][timer].resolucao = (uint32_t)resolucao;
+        erro = ESP_OK;
+    }
+    return sim_registra("mcpwm_timer_set_resolution", unidade, timer, (int32_t)resolucao, 0, erro);
+}
+
+static inline esp_err_t mcpwm_init(mcpwm_unit_t unidade, mcpwm_timer_t timer, const mcpwm_config_t *config)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_mcpwm_valido(unidade, timer)) {
+        struct sim_mcpwm *mcpwm = sim_mcpwm();
+        pthread_mutex_lock(&mcpwm->mutex);
+        mcpwm->operadores[unidade][timer].frequencia = config->frequency;
+        mcpwm->operadores[unidade][timer].duty_a     = config->cmpr_a;
+        mcpwm->operadores[unidade][timer].rodando    = true;
+        pthread_mutex_unlock(&mcpwm->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("mcpwm_init", unidade, timer, (int32_t)config->frequency, (int32_t)(config->cmpr_a * 100), erro);
+}
+
+static inline esp_err_t mcpwm_gpio_init(mcpwm_unit_t unidade, mcpwm_io_signals_t sinal, int gpio)
+{
+    esp_err_t erro = ((unsigned)unidade < MCPWM_UNIT_MAX && gpio >= 0 && gpio < 40) ? ESP_OK : ESP_ERR_INVALID_ARG;
+    return sim_registra("mcpwm_gpio_init", unidade, sinal, gpio, 0, erro);
+}
+
+static inline esp_err_t mcpwm_set_frequency(mcpwm_unit_t unidade, mcpwm_timer_t timer, uint32_t frequencia)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_mcpwm_valido(unidade, timer) && frequencia > 0) {
+        sim_mcpwm()->operadores[unidade][timer].frequencia = frequencia;
+        erro = ESP_OK;
+    }
+    return sim_registra("mcpwm_set_frequency", unidade, timer, (int32_t)frequencia, 0, erro);
+}
+
+static inline esp_err_t mcpwm_set_duty(mcpwm_unit_t unidade, mcpwm_timer_t timer, mcpwm_generator_t gerador, float duty)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_mcpwm_valido(unidade, timer) && (unsigned)gerador < MCPWM_GEN_MAX && duty >= 0 && duty <= 100) {
+        if (gerador == MCPWM_GEN_A)
+            sim_mcpwm()->operadores[unidade][timer].duty_a = duty;
+        erro = ESP_OK;
+    }
+    return sim_registra("mcpwm_set_duty", unidade, timer, gerador, (int32_t)(duty * 100), erro);
+}
+
+static inline esp_err_t mcpwm_deadtime_enable(mcpwm_unit_t unidade, mcpwm_timer_t timer, mcpwm_deadtime_type_t tipo,
+                                              uint32_t subida, uint32_t descida)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_mcpwm_valido(unidade, timer) && subida <= 0xFFFF && descida <= 0xFFFF) {
+        sim_mcpwm()->operadores[unidade][timer].tempo_morto = true;
+        erro = ESP_OK;
+    }
+    return sim_registra("mcpwm_deadtime_enable", unidade, timer, (int32_t)subida, (int32_t)(descida | (tipo << 16)), erro);
+}
+
+static inline esp_err_t mcpwm_deadtime_disable(mcpwm_unit_t unidade, mcpwm_timer_t timer)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_mcpwm_valido(unidade, timer)) {
+        sim_mcpwm()->operadores[unidade][timer].tempo_morto = false;
+        erro = ESP_OK;
+    }
+    return sim_registra("mcpwm_deadtime_disable", unidade, timer, 0, 0, erro);
+}
+
+static inline esp_err_t mcpwm_stop(mcpwm_unit_t unidade, mcpwm_timer_t timer)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if (sim_mcpwm_valido(unidade, timer)) {
+        sim_mcpwm()->operadores[unidade][timer].rodando = false;
+        erro = ESP_OK;
+    }
+    return sim_registra("mcpwm_stop", unidade, timer, 0, 0, erro);
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*driver/pcnt.h da simulação: o teste escolhe a contagem (sim_pcnt_conta) e o contador chama o handler do
+evento de limite alto quando passa dele e volta a zero, como o PCNT do ESP32*/
+#ifndef DRIVER_PCNT_H
+#define DRIVER_PCNT_H
+
+#include "simulacao.h"
+
+#define PCNT_PIN_NOT_USED   (-1)
+
+typedef enum {
+    PCNT_UNIT_0,
+    PCNT_UNIT_1,
+    PCNT_UNIT_2,
+    PCNT_UNIT_3,
+    PCNT_UNIT_4,
+    PCNT_UNIT_5,
+    PCNT_UNIT_6,
+    PCNT_UNIT_7,
+    PCNT_UNIT_MAX,
+} pcnt_unit_t;
+
+typedef enum {
+    PCNT_CHANNEL_0,
+    PCNT_CHANNEL_1,
+    PCNT_CHANNEL_MAX,
+} pcnt_channel_t;
+
+typedef enum {
+    PCNT_MODE_KEEP,
+    PCNT_MODE_REVERSE,
+    PCNT_MODE_DISABLE,
+} pcnt_ctrl_mode_t;
+
+typedef enum {
+    PCNT_COUNT_DIS,
+    PCNT_COUNT_INC,
+    PCNT_COUNT_DEC,
+} pcnt_count_mode_t;
+
+typedef enum {
+    PCNT_EVT_THRES_1 = 1 << 2,
+    PCNT_EVT_THRES_0 = 1 << 3,
+    PCNT_EVT_L_LIM   = 1 << 4,
+    PCNT_EVT_H_LIM   = 1 << 5,
+    PCNT_EVT_ZERO    = 1 << 6,
+} pcnt_evt_type_t;
+
+typedef struct {
+    int               pulse_gpio_num;
+    int               ctrl_gpio_num;
+    pcnt_ctrl_mode_t  lctrl_mode;
+    pcnt_ctrl_mode_t  hctrl_mode;
+    pcnt_count_mode_t pos_mode;
+    pcnt_count_mode_t neg_mode;
+    int16_t           counter_h_lim;
+    int16_t           counter_l_lim;
+    pcnt_unit_t       unit;
+    pcnt_channel_t    channel;
+} pcnt_config_t;
+
+struct sim_pcnt{
+    pthread_mutex_t mutex;
+    struct {
+        int16_t  contagem;
+        int16_t  limite_alto;
+        bool     pausado;
+        uint32_t eventos;
+        void   (*isr)(void *arg);
+        void    *arg;
+    } unidades[PCNT_UNIT_MAX];
+};
+
+static inline struct sim_pcnt *sim_pcnt(void)
+{
+    static struct sim_pcnt pcnt = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+    return &pcnt;
+}
+
+static inline esp_err_t pcnt_unit_config(const pcnt_config_t *config)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if ((unsigned)config->unit < PCNT_UNIT_MAX && config->counter_h_lim > 0) {
+        sim_pcnt()->unidades[config->unit].limite_alto = config->counter_h_lim;
+        erro = ESP_OK;
+    }
+    return sim_registra("pcnt_unit_config", config->unit, config->pulse_gpio_num, config->counter_h_lim, 0, erro);
+}
+
+static inline esp_err_t pcnt_filter_disable(pcnt_unit_t unidade)
+{
+    return sim_registra("pcnt_filter_disable", unidade, 0, 0, 0, ESP_OK);
+}
+
+static inline esp_err_t pcnt_event_enable(pcnt_unit_t unidade, pcnt_evt_type_t evento)
+{
+    if ((unsigned)unidade < PCNT_UNIT_MAX)
+        sim_pcnt()->unidades[unidade].eventos |= evento;
+    return sim_registra("pcnt_event_enable", unidade, evento, 0, 0, ESP_OK);
+}
+
+static inline esp_err_t pcnt_isr_service_install(int flags)
+{
+    return sim_registra("pcnt_isr_service_install", flags, 0, 0, 0, ESP_OK);
+}
+
+static inline esp_err_t pcnt_isr_handler_add(pcnt_unit_t unidade, void (*isr)(void *arg), void *arg)
+{
+    if ((unsigned)unidade >= PCNT_UNIT_MAX)
+        return ESP_ERR_INVALID_ARG;
+    sim_pcnt()->unidades[unidade].isr = isr;
+    sim_pcnt()->unidades[unidade].arg = arg;
+    return sim_registra("pcnt_isr_handler_add", unidade, 0, 0, 0, ESP_OK);
+}
+
+static inline esp_err_t pcnt_get_counter_value(pcnt_unit_t unidade, int16_t *contagem)
+{
+    struct sim_pcnt *pcnt = sim_pcnt();
+    pthread_mutex_lock(&pcnt->mutex);
+    *contagem = pcnt->unidades[unidade].contagem;
+    pthread_mutex_unlock(&pcnt->mutex);
+    return ESP_OK;
+}
+
+static inline esp_err_t pcnt_counter_pause(pcnt_unit_t unidade)
+{
+    sim_pcnt()->unidades[unidade].pausado = true;
+    return sim_registra("pcnt_counter_pause", unidade, 0, 0, 0, ESP_OK);
+}
+
+static inline esp_err_t pcnt_counter_resume(pcnt_unit_t unidade)
+{
+    sim_pcnt()->unidades[unidade].pausado = false;
+    return sim_registra("pcnt_counter_resume", unidade, 0, 0, 0, ESP_OK);
+}
+
+static inline esp_err_t pcnt_counter_clear(pcnt_unit_t unidade)
+{
+    struct sim_pcnt *pcnt = sim_pcnt();
+    pthread_mutex_lock(&pcnt->mutex);
+    pcnt->unidades[unidade].contagem = 0;
+    pthread_mutex_unlock(&pcnt->mutex);
+    return sim_registra("pcnt_counter_clear", unidade, 0, 0, 0, ESP_OK);
+}
+
+//Conta 'pulsos' bordas na unidade. Cada vez que chega ao limite alto o contador zera e, com o evento ligado,
+//o handler é chamado ali mesmo, como a interrupção. Com 'atrasa_isr' o handler da última volta não é chamado
+//e fica para o sim_pcnt_entrega_isr: é a janela entre o contador zerar e a interrupção rodar
+static inline void sim_pcnt_conta(pcnt_unit_t unidade, uint32_t pulsos, bool atrasa_isr)
+{
+    struct sim_pcnt *pcnt = sim_pcnt();
+    while (pulsos > 0) {
+        pthread_mutex_lock(&pcnt->mutex);
+        uint32_t ate_limite = (uint32_t)(pcnt->unidades[unidade].limite_alto - pcnt->unidades[unidade].contagem);
+        uint32_t passo = pulsos < ate_limite ? pulsos : ate_limite;
+        pcnt->unidades[unidade].contagem += (int16_t)passo;
+        pulsos -= passo;
+        bool estourou = pcnt->unidades[unidade].contagem >= pcnt->unidades[unidade].limite_alto;
+        if (estourou)
+            pcnt->unidades[unidade].contagem = 0;
+        pthread_mutex_unlock(&pcnt->mutex);
+        if (estourou && (pcnt->unidades[unidade].eventos & PCNT_EVT_H_LIM) && pcnt->unidades[unidade].isr != NULL &&
+            !(atrasa_isr && pulsos == 0))
+            pcnt->unidades[unidade].isr(pcnt->unidades[unidade].arg);
+    }
+}
+
+//Chama o handler que o sim_pcnt_conta deixou pendente
+static inline void sim_pcnt_entrega_isr(pcnt_unit_t unidade)
+{
+    struct sim_pcnt *pcnt = sim_pcnt();
+    if (pcnt->unidades[unidade].isr != NULL)
+        pcnt->unidades[unidade].isr(pcnt->unidades[unidade].arg);
+}
+
+#endif
@@ -0,0 +1,195 @@
+/*driver/rmt.h da simulação: as chamadas ficam no registro e cada canal lembra se o driver está instalado,
+como no ESP-IDF (instalar duas vezes é ESP_ERR_INVALID_STATE, escrever sem o driver é ESP_FAIL)*/
+#ifndef DRIVER_RMT_H
+#define DRIVER_RMT_H
+
+#include "simulacao.h"
+
+typedef enum {
+    RMT_CHANNEL_0,
+    RMT_CHANNEL_1,
+    RMT_CHANNEL_2,
+    RMT_CHANNEL_3,
+    RMT_CHANNEL_4,
+    RMT_CHANNEL_5,
+    RMT_CHANNEL_6,
+    RMT_CHANNEL_7,
+    RMT_CHANNEL_MAX,
+} rmt_channel_t;
+
+typedef enum {
+    RMT_MODE_TX,
+    RMT_MODE_RX,
+} rmt_mode_t;
+
+typedef enum {
+    RMT_IDLE_LEVEL_LOW,
+    RMT_IDLE_LEVEL_HIGH,
+} rmt_idle_level_t;
+
+typedef enum {
+    RMT_CARRIER_LEVEL_LOW,
+    RMT_CARRIER_LEVEL_HIGH,
+} rmt_carrier_level_t;
+
+typedef struct {
+    uint32_t            carrier_freq_hz;
+    rmt_carrier_level_t carrier_level;
+    rmt_idle_level_t    idle_level;
+    uint8_t             carrier_duty_percent;
+    uint32_t            loop_count;
+    bool                carrier_en;
+    bool                loop_en;
+    bool                idle_output_en;
+} rmt_tx_config_t;
+
+typedef struct {
+    rmt_mode_t    rmt_mode;
+    rmt_channel_t channel;
+    int           gpio_num;
+    uint8_t       clk_div;
+    uint8_t       mem_block_num;
+    uint32_t      flags;
+    union {
+        rmt_tx_config_t tx_config;
+    };
+} rmt_config_t;
+
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0    : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1    : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+#define RMT_DEFAULT_CONFIG_TX(gpio, channel_id) {       \
+        .rmt_mode      = RMT_MODE_TX,                   \
+        .channel       = channel_id,                    \
+        .gpio_num      = gpio,                          \
+        .clk_div       = 80,                            \
+        .mem_block_num = 1,                             \
+        .flags         = 0,                             \
+        .tx_config = {                                  \
+            .carrier_freq_hz      = 38000,              \
+            .carrier_level        = RMT_CARRIER_LEVEL_HIGH, \
+            .idle_level           = RMT_IDLE_LEVEL_LOW, \
+            .carrier_duty_percent = 33,                 \
+            .carrier_en           = false,              \
+            .loop_en              = false,              \
+            .idle_output_en       = true,               \
+        }                                               \
+    }
+
+struct sim_rmt{
+    pthread_mutex_t mutex;
+    struct {
+        bool     configurado;
+        bool     instalado;
+        bool     transmitindo;
+        bool     repete;
+        uint8_t  divisor;
+        int      gpio;
+        int      itens;
+    } canais[RMT_CHANNEL_MAX];
+};
+
+static inline struct sim_rmt *sim_rmt(void)
+{
+    static struct sim_rmt rmt = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+    return &rmt;
+}
+
+static inline esp_err_t rmt_config(const rmt_config_t *config)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if ((unsigned)config->channel < RMT_CHANNEL_MAX && config->clk_div > 0 &&
+        config->channel + config->mem_block_num <= RMT_CHANNEL_MAX) {
+        struct sim_rmt *rmt = sim_rmt();
+        pthread_mutex_lock(&rmt->mutex);
+        rmt->canais[config->channel].configurado = true;
+        rmt->canais[config->channel].divisor     = config->clk_div;
+        rmt->canais[config->channel].gpio        = config->gpio_num;
+        rmt->canais[config->channel].repete      = config->tx_config.loop_en;
+        pthread_mutex_unlock(&rmt->mutex);
+        erro = ESP_OK;
+    }
+    return sim_registra("rmt_config", config->channel, config->gpio_num, config->clk_div, config->mem_block_num, erro);
+}
+
+static inline esp_err_t rmt_driver_install(rmt_channel_t canal, size_t buffer_rx, int flags)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if ((unsigned)canal < RMT_CHANNEL_MAX) {
+        struct sim_rmt *rmt = sim_rmt();
+        pthread_mutex_lock(&rmt->mutex);
+        erro = rmt->canais[canal].instalado ? ESP_ERR_INVALID_STATE : ESP_OK;
+        rmt->canais[canal].instalado = true;
+        pthread_mutex_unlock(&rmt->mutex);
+    }
+    return sim_registra("rmt_driver_install", canal, (int32_t)buffer_rx, flags, 0, erro);
+}
+
+static inline esp_err_t rmt_driver_uninstall(rmt_channel_t canal)
+{
+    esp_err_t erro = ESP_ERR_INVALID_STATE;
+    if ((unsigned)canal < RMT_CHANNEL_MAX && sim_rmt()->canais[canal].instalado) {
+        sim_rmt()->canais[canal].instalado = false;
+        erro = ESP_OK;
+    }
+    return sim_registra("rmt_driver_uninstall", canal, 0, 0, 0, erro);
+}
+
+static inline esp_err_t rmt_set_clk_div(rmt_channel_t canal, uint8_t divisor)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if ((unsigned)canal < RMT_CHANNEL_MAX && divisor > 0) {
+        sim_rmt()->canais[canal].divisor = divisor;
+        erro = ESP_OK;
+    }
+    return sim_registra("rmt_set_clk_div", canal, divisor, 0, 0, erro);
+}
+
+static inline esp_err_t rmt_set_tx_loop_mode(rmt_channel_t canal, bool repete)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if ((unsigned)canal < RMT_CHANNEL_MAX) {
+        sim_rmt()->canais[canal].repete = repete;
+        erro = ESP_OK;
+    }
+    return sim_registra("rmt_set_tx_loop_mode", canal, repete, 0, 0, erro);
+}
+
+static inline esp_err_t rmt_tx_stop(rmt_channel_t canal)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if ((unsigned)canal < RMT_CHANNEL_MAX) {
+        sim_rmt()->canais[canal].transmitindo = false;
+        erro = ESP_OK;
+    }
+    return sim_registra("rmt_tx_stop", canal, 0, 0, 0, erro);
+}
+
+static inline esp_err_t rmt_write_items(rmt_channel_t canal, const rmt_item32_t *itens, int quantidade, bool espera)
+{
+    esp_err_t erro = ESP_ERR_INVALID_ARG;
+    if ((unsigned)canal < RMT_CHANNEL_MAX && itens != NULL && quantidade > 0) {
+        struct sim_rmt *rmt = sim_rmt();
+        pthread_mutex_lock(&rmt->mutex);
+        if (!rmt->canais[canal].instalado) {
+            erro = ESP_FAIL;
+        } else {
+            rmt->canais[canal].itens        = quantidade;
+            rmt->canais[canal].transmitindo = true;
+            erro = ESP_OK;
+        }
+        pthread_mutex_unlock(&rmt->mutex);
+    }
+    return sim_registra("rmt_write_items", canal, quantidade, espera, 0, erro);
+}
+
+#endif
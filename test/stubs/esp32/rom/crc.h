@@ -0,0 +1,18 @@
+/*esp32/rom/crc.h da simulação: o mesmo CRC-32 (polinômio 0xEDB88320, refletido) da ROM do ESP32*/
+#ifndef ROM_CRC_H
+#define ROM_CRC_H
+
+#include <stdint.h>
+
+static inline uint32_t crc32_le(uint32_t crc, const uint8_t *dados, uint32_t tamanho)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < tamanho; i++) {
+        crc ^= dados[i];
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+#endif
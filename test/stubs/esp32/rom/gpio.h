@@ -0,0 +1,15 @@
+/*esp32/rom/gpio.h da simulação: a matriz de GPIO só registra as ligações*/
+#ifndef ROM_GPIO_H
+#define ROM_GPIO_H
+
+#include "simulacao.h"
+
+#define GPIO_FUNC_IN_LOW    0x30
+#define GPIO_FUNC_IN_HIGH   0x38
+
+static inline void gpio_matrix_in(uint32_t gpio, uint32_t sinal, bool inverte)
+{
+    sim_registra("gpio_matrix_in", (int32_t)gpio, (int32_t)sinal, inverte, 0, ESP_OK);
+}
+
+#endif
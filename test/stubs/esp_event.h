@@ -0,0 +1,64 @@
+/*esp_event.h da simulação: os handlers registrados são chamados pelo sim_posta_evento, na thread de quem
+postou (no firmware é a task de eventos do sistema)*/
+#ifndef ESP_EVENT_H
+#define ESP_EVENT_H
+
+#include "simulacao.h"
+
+#define ESP_EVENT_ANY_ID        -1
+#define SIM_MAXIMO_HANDLERS     8
+
+typedef const char *esp_event_base_t;
+typedef void       *esp_event_handler_instance_t;
+typedef void (*esp_event_handler_t)(void *arg, esp_event_base_t base, int32_t id, void *dados);
+
+struct sim_eventos{
+    struct {
+        esp_event_base_t    base;
+        int32_t             id;
+        esp_event_handler_t handler;
+        void               *arg;
+    } handlers[SIM_MAXIMO_HANDLERS];
+    int quantidade;
+};
+
+static inline struct sim_eventos *sim_eventos(void)
+{
+    static struct sim_eventos eventos;
+    return &eventos;
+}
+
+static inline esp_err_t esp_event_loop_create_default(void)
+{
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id,
+                                                            esp_event_handler_t handler, void *arg,
+                                                            esp_event_handler_instance_t *instancia)
+{
+    struct sim_eventos *eventos = sim_eventos();
+    if (eventos->quantidade >= SIM_MAXIMO_HANDLERS)
+        return ESP_ERR_NO_MEM;
+    int h = eventos->quantidade++;
+    eventos->handlers[h].base    = base;
+    eventos->handlers[h].id      = id;
+    eventos->handlers[h].handler = handler;
+    eventos->handlers[h].arg     = arg;
+    if (instancia != NULL)
+        *instancia = &eventos->handlers[h];
+    return ESP_OK;
+}
+
+//Entrega o evento a todos os handlers registrados para ele
+static inline void sim_posta_evento(esp_event_base_t base, int32_t id, void *dados)
+{
+    struct sim_eventos *eventos = sim_eventos();
+    for (int h = 0; h < eventos->quantidade; h++) {
+        if (eventos->handlers[h].base == base &&
+            (eventos->handlers[h].id == ESP_EVENT_ANY_ID || eventos->handlers[h].id == id))
+            eventos->handlers[h].handler(eventos->handlers[h].arg, base, id, dados);
+    }
+}
+
+#endif
@@ -0,0 +1,22 @@
+/*esp_heap_caps.h da simulação: um heap só, sem fragmentação*/
+#ifndef ESP_HEAP_CAPS_H
+#define ESP_HEAP_CAPS_H
+
+#include "esp_system.h"
+
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+
+static inline size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return esp_get_free_heap_size();
+}
+
+static inline size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    (void)caps;
+    return esp_get_free_heap_size();
+}
+
+#endif
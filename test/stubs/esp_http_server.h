@@ -0,0 +1,733 @@
+/*esp_http_server.h da simulação: não abre sockets. O teste faz as requisições com sim_http(), que escolhe o
+handler como o httpd (a primeira URI registrada que casa com o uri_match_fn e o método), chama o handler na
+thread do teste e guarda a resposta numa sim_resposta dada por ele, sem heap. O httpd_queue_work roda o
+trabalho na hora, com o mesmo mutex que as requisições seguram: como no firmware, um trabalho nunca roda junto
+com um handler. O httpd_query_key_value e o httpd_uri_match_wildcard são os do ESP-IDF.
+
+Uma resposta escrita por outra task com o httpd_socket_send (os bytes crus do HTTP, como no socket) vai para o
+buffer do fd; quando o handler volta sem ter respondido, o sim_http_fd espera esses bytes terminarem, já sem o
+mutex do server, e os interpreta na mesma sim_resposta. Um fd marcado com sim_http_socket_parado é um cliente
+que não lê: o httpd_socket_send nele dá HTTPD_SOCK_ERR_TIMEOUT, como o send com MSG_DONTWAIT com o buffer
+cheio. O close_fn nunca é chamado: os fds da simulação são só números, não sockets abertos do PC*/
+#ifndef ESP_HTTP_SERVER_H
+#define ESP_HTTP_SERVER_H
+
+#include "simulacao.h"
+#include "freertos/FreeRTOS.h"
+
+#define HTTPD_MAX_URI_LEN               512
+#define HTTPD_SOCK_ERR_FAIL             -1
+#define HTTPD_SOCK_ERR_INVALID          -2
+#define HTTPD_SOCK_ERR_TIMEOUT          -3
+#define HTTPD_RESP_USE_STRLEN           -1
+
+#define ESP_ERR_HTTPD_BASE              0xb000
+#define ESP_ERR_HTTPD_HANDLERS_FULL     (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_HANDLER_EXISTS    (ESP_ERR_HTTPD_BASE + 2)
+#define ESP_ERR_HTTPD_INVALID_REQ       (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESULT_TRUNC      (ESP_ERR_HTTPD_BASE + 4)
+#define ESP_ERR_HTTPD_RESP_HDR          (ESP_ERR_HTTPD_BASE + 5)
+#define ESP_ERR_HTTPD_RESP_SEND         (ESP_ERR_HTTPD_BASE + 6)
+#define ESP_ERR_HTTPD_ALLOC_MEM         (ESP_ERR_HTTPD_BASE + 7)
+#define ESP_ERR_HTTPD_TASK              (ESP_ERR_HTTPD_BASE + 8)
+
+#define SIM_HTTP_RESPOSTA_MAXIMA        (64 * 1024)
+#define SIM_HTTP_CABECALHOS_MAXIMO      8
+#define SIM_HTTP_SOCKETS                16
+#define SIM_HTTP_ESPERA_ENVIO_US        (3 * 1000000)   //quanto o sim_http_fd espera uma resposta de outra task
+
+typedef void *httpd_handle_t;
+
+typedef enum {
+    HTTP_DELETE = 0,
+    HTTP_GET    = 1,
+    HTTP_HEAD   = 2,
+    HTTP_POST   = 3,
+    HTTP_PUT    = 4,
+} httpd_method_t;
+
+typedef enum {
+    HTTPD_500_INTERNAL_SERVER_ERROR = 0,
+    HTTPD_501_METHOD_NOT_IMPLEMENTED,
+    HTTPD_505_VERSION_NOT_SUPPORTED,
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_401_UNAUTHORIZED,
+    HTTPD_403_FORBIDDEN,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_405_METHOD_NOT_ALLOWED,
+    HTTPD_408_REQ_TIMEOUT,
+    HTTPD_411_LENGTH_REQUIRED,
+    HTTPD_414_URI_TOO_LONG,
+    HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE,
+} httpd_err_code_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int            method;
+    const char     uri[HTTPD_MAX_URI_LEN + 1];
+    size_t         content_len;
+    void          *aux;
+    void          *user_ctx;
+    void          *sess_ctx;
+    void         (*free_ctx)(void *ctx);
+    bool           ignore_sess_ctx_changes;
+} httpd_req_t;
+
+typedef struct httpd_uri {
+    const char     *uri;
+    httpd_method_t  method;
+    esp_err_t     (*handler)(httpd_req_t *req);
+    void           *user_ctx;
+    bool            is_websocket;
+    bool            handle_ws_control_frames;
+    const char     *supported_subprotocol;
+} httpd_uri_t;
+
+typedef bool (*httpd_uri_match_func_t)(const char *uri_template, const char *uri_to_match, size_t match_upto);
+typedef void (*httpd_close_func_t)(httpd_handle_t hd, int sockfd);
+
+typedef struct httpd_config {
+    unsigned               task_priority;
+    size_t                 stack_size;
+    BaseType_t             core_id;
+    uint16_t               server_port;
+    uint16_t               ctrl_port;
+    uint16_t               max_open_sockets;
+    uint16_t               max_uri_handlers;
+    uint16_t               max_resp_headers;
+    uint16_t               backlog_conn;
+    bool                   lru_purge_enable;
+    uint16_t               recv_wait_timeout;
+    uint16_t               send_wait_timeout;
+    void                  *global_user_ctx;
+    httpd_close_func_t     close_fn;
+    httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {                \
+        .task_priority      = 5,                \
+        .stack_size         = 4096,             \
+        .core_id            = tskNO_AFFINITY,   \
+        .server_port        = 80,               \
+        .ctrl_port          = 32768,            \
+        .max_open_sockets   = 7,                \
+        .max_uri_handlers   = 8,                \
+        .max_resp_headers   = 8,                \
+        .backlog_conn       = 5,                \
+        .lru_purge_enable   = false,            \
+        .recv_wait_timeout  = 5,                \
+        .send_wait_timeout  = 5,                \
+        .global_user_ctx    = NULL,             \
+        .close_fn           = NULL,             \
+        .uri_match_fn       = NULL,             \
+}
+
+typedef enum {
+    HTTPD_WS_TYPE_CONTINUE = 0x0,
+    HTTPD_WS_TYPE_TEXT     = 0x1,
+    HTTPD_WS_TYPE_BINARY   = 0x2,
+    HTTPD_WS_TYPE_CLOSE    = 0x8,
+    HTTPD_WS_TYPE_PING     = 0x9,
+    HTTPD_WS_TYPE_PONG     = 0xA,
+} httpd_ws_type_t;
+
+typedef struct httpd_ws_frame {
+    bool            final;
+    bool            fragmented;
+    httpd_ws_type_t type;
+    uint8_t        *payload;
+    size_t          len;
+} httpd_ws_frame_t;
+
+typedef enum {
+    HTTPD_WS_CLIENT_INVALID   = 0x0,
+    HTTPD_WS_CLIENT_HTTP      = 0x1,
+    HTTPD_WS_CLIENT_WEBSOCKET = 0x2,
+} httpd_ws_client_info_t;
+
+typedef void (*httpd_work_fn_t)(void *arg);
+
+
+/*------------------------------------Estado do server simulado-----------------------------------------------*/
+//A resposta de uma requisição, como o cliente a veria
+struct sim_resposta{
+    char        status[40];
+    const char *tipo;
+    char        tipo_texto[64];                         //o Content-Type de uma resposta escrita no socket
+    char        cabecalhos_texto[512];                  //os campos e valores dela, para onde 'cabecalhos' aponta
+    struct {
+        const char *campo;
+        const char *valor;
+    } cabecalhos[SIM_HTTP_CABECALHOS_MAXIMO];
+    int         num_cabecalhos;
+    char        corpo[SIM_HTTP_RESPOSTA_MAXIMA + 1];   //termina em '\0'
+    size_t      tamanho;
+    int         chunks;
+    bool        terminou;                               //mandou o último chunk ou a resposta inteira
+    esp_err_t   retorno;                                //o que o handler retornou
+};
+
+//O que o handler lê da requisição, no req->aux
+struct sim_requisicao{
+    const char          *corpo;
+    size_t               lido;
+    const char          *cabecalhos;                    //"Campo: valor\r\n..." do pedido
+    int                  fd;
+    struct sim_resposta *resposta;
+};
+
+struct sim_httpd{
+    pthread_mutex_t mutex;                              //a "task" do server: handlers e trabalhos em fila
+    bool            rodando;
+    httpd_config_t  config;
+    httpd_uri_t    *uris;                               //do heap, como no httpd
+    int             num_uris;
+    void           *pilha;                              //a pilha da task do server, que no firmware vem do heap
+    bool            websocket[SIM_HTTP_SOCKETS];        //os fds que viraram WebSocket
+    uint32_t        quadros_ws[SIM_HTTP_SOCKETS];       //quadros enviados para cada fd
+    char            ultimo_quadro_ws[1024];
+};
+
+//Os bytes escritos com o httpd_socket_send em cada fd, desde a última requisição feita nele
+struct sim_sockets_http{
+    pthread_mutex_t mutex;
+    pthread_cond_t  escreveu;
+    bool            iniciado;
+    struct {
+        char   dados[SIM_HTTP_RESPOSTA_MAXIMA + 4096];  //a resposta com os cabeçalhos e o tamanho dos chunks
+        size_t tamanho;
+        bool   parado;                                  //o cliente não lê mais nada
+    } fds[SIM_HTTP_SOCKETS];
+};
+
+static inline struct sim_httpd *sim_httpd(void)
+{
+    static struct sim_httpd httpd = {.mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP};
+    return &httpd;
+}
+
+static inline struct sim_sockets_http *sim_sockets_http(void)
+{
+    static struct sim_sockets_http sockets = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+    pthread_mutex_lock(&sockets.mutex);
+    if (!sockets.iniciado) {
+        sim_inicia_cond(&sockets.escreveu);
+        sockets.iniciado = true;
+    }
+    pthread_mutex_unlock(&sockets.mutex);
+    return &sockets;
+}
+
+static inline struct sim_requisicao *sim_requisicao(httpd_req_t *req)
+{
+    return (struct sim_requisicao *)req->aux;
+}
+
+static inline void sim_acrescenta_resposta(httpd_req_t *req, const char *dados, size_t tamanho)
+{
+    struct sim_resposta *resposta = sim_requisicao(req)->resposta;
+    size_t cabe = SIM_HTTP_RESPOSTA_MAXIMA - resposta->tamanho;
+    if (tamanho > cabe)
+        tamanho = cabe;
+    memcpy(resposta->corpo + resposta->tamanho, dados, tamanho);
+    resposta->tamanho += tamanho;
+    resposta->corpo[resposta->tamanho] = '\0';
+}
+
+
+/*------------------------------------------Server e URIs-----------------------------------------------------*/
+static inline esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    struct sim_httpd *httpd = sim_httpd();
+    if (httpd->rodando)
+        return ESP_ERR_HTTPD_TASK;
+    httpd->uris  = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+    httpd->pilha = malloc(config->stack_size);
+    if (httpd->uris == NULL || httpd->pilha == NULL) {
+        free(httpd->uris);
+        free(httpd->pilha);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    httpd->config   = *config;
+    httpd->num_uris = 0;
+    httpd->rodando  = true;
+    memset(httpd->websocket, 0, sizeof(httpd->websocket));
+    *handle = httpd;
+    return ESP_OK;
+}
+
+static inline esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    struct sim_httpd *httpd = handle;
+    if (httpd == NULL || !httpd->rodando)
+        return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&httpd->mutex);
+    httpd->rodando = false;
+    free(httpd->uris);
+    free(httpd->pilha);
+    httpd->uris  = NULL;
+    httpd->pilha = NULL;
+    pthread_mutex_unlock(&httpd->mutex);
+    return ESP_OK;
+}
+
+static inline esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri)
+{
+    struct sim_httpd *httpd = handle;
+    for (int u = 0; u < httpd->num_uris; u++) {
+        if (httpd->uris[u].method == uri->method && strcmp(httpd->uris[u].uri, uri->uri) == 0)
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+    }
+    if (httpd->num_uris >= httpd->config.max_uri_handlers)
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    httpd->uris[httpd->num_uris++] = *uri;
+    return ESP_OK;
+}
+
+static inline bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t tamanho)
+{
+    const size_t tamanho_template = strlen(template);
+    size_t exatos = tamanho_template;
+
+    //'*' no fim aceita qualquer resto, '?' torna opcional o caractere anterior
+    const char ultimo    = (const char)(tamanho_template > 0 ? template[tamanho_template - 1] : 0);
+    const char penultimo = (const char)(tamanho_template > 1 ? template[tamanho_template - 2] : 0);
+    const bool asterisco = ultimo == '*' || (penultimo == '*' && ultimo == '?');
+    const bool opcional  = ultimo == '?' || (penultimo == '?' && ultimo == '*');
+
+    if (exatos < (size_t)(asterisco + opcional * 2))
+        return false;
+    exatos -= asterisco + opcional * 2;
+    if (tamanho < exatos)
+        return false;
+
+    if (!opcional) {
+        if (!asterisco && tamanho != exatos)
+            return false;
+    } else {
+        if (tamanho > exatos && template[exatos] != uri[exatos])
+            return false;
+        if (strncmp(template, uri, exatos) != 0)
+            return false;
+        return asterisco || tamanho <= exatos + 1;
+    }
+    return strncmp(template, uri, exatos) == 0;
+}
+
+static inline esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t trabalho, void *arg)
+{
+    struct sim_httpd *httpd = handle;
+    if (httpd == NULL || !httpd->rodando)
+        return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&httpd->mutex);
+    trabalho(arg);
+    pthread_mutex_unlock(&httpd->mutex);
+    return ESP_OK;
+}
+
+static inline esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int fd)
+{
+    struct sim_httpd *httpd = handle;
+    if (fd >= 0 && fd < SIM_HTTP_SOCKETS)
+        httpd->websocket[fd] = false;
+    return sim_registra("httpd_sess_trigger_close", fd, 0, 0, 0, ESP_OK);
+}
+
+static inline esp_err_t httpd_sess_update_lru_counter(httpd_handle_t handle, int fd)
+{
+    return (fd >= 0 && fd < SIM_HTTP_SOCKETS) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+//Escreve no buffer do fd, sem esperar: num cliente parado não cabe nada
+static inline int httpd_socket_send(httpd_handle_t handle, int fd, const char *dados, size_t tamanho, int flags)
+{
+    struct sim_sockets_http *sockets = sim_sockets_http();
+    if (fd < 0 || fd >= SIM_HTTP_SOCKETS || dados == NULL)
+        return HTTPD_SOCK_ERR_INVALID;
+    pthread_mutex_lock(&sockets->mutex);
+    int retorno = HTTPD_SOCK_ERR_TIMEOUT;
+    if (!sockets->fds[fd].parado) {
+        size_t cabe = sizeof(sockets->fds[fd].dados) - sockets->fds[fd].tamanho;
+        if (tamanho > cabe)
+            tamanho = cabe;
+        memcpy(sockets->fds[fd].dados + sockets->fds[fd].tamanho, dados, tamanho);
+        sockets->fds[fd].tamanho += tamanho;
+        retorno = (int)tamanho;
+        pthread_cond_broadcast(&sockets->escreveu);
+    }
+    pthread_mutex_unlock(&sockets->mutex);
+    return retorno;
+}
+
+
+/*-------------------------------------------Requisições------------------------------------------------------*/
+static inline int httpd_req_recv(httpd_req_t *req, char *buffer, size_t tamanho)
+{
+    struct sim_requisicao *requisicao = sim_requisicao(req);
+    size_t restante = req->content_len - requisicao->lido;
+    if (tamanho > restante)
+        tamanho = restante;
+    memcpy(buffer, requisicao->corpo + requisicao->lido, tamanho);
+    requisicao->lido += tamanho;
+    return (int)tamanho;
+}
+
+static inline esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *campo, char *valor, size_t tamanho)
+{
+    const char *linha = sim_requisicao(req)->cabecalhos;
+    size_t tamanho_campo = strlen(campo);
+    while (linha != NULL && *linha != '\0') {
+        const char *fim = strstr(linha, "\r\n");
+        if (fim == NULL)
+            fim = linha + strlen(linha);
+        if (strncasecmp(linha, campo, tamanho_campo) == 0 && linha[tamanho_campo] == ':') {
+            const char *inicio = linha + tamanho_campo + 1;
+            while (*inicio == ' ')
+                inicio++;
+            size_t tamanho_valor = (size_t)(fim - inicio);
+            size_t copia = tamanho_valor < tamanho - 1 ? tamanho_valor : tamanho - 1;
+            memcpy(valor, inicio, copia);
+            valor[copia] = '\0';
+            return copia < tamanho_valor ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+        }
+        linha = (*fim != '\0') ? fim + 2 : fim;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+static inline esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *query, size_t tamanho)
+{
+    const char *inicio = strchr(req->uri, '?');
+    if (inicio == NULL)
+        return ESP_ERR_NOT_FOUND;
+    inicio++;
+    size_t tamanho_query = strlen(inicio);
+    size_t copia = tamanho_query < tamanho - 1 ? tamanho_query : tamanho - 1;
+    memcpy(query, inicio, copia);
+    query[copia] = '\0';
+    return copia < tamanho_query ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+static inline esp_err_t httpd_query_key_value(const char *query, const char *chave, char *valor, size_t tamanho)
+{
+    if (query == NULL || chave == NULL || valor == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    const char *par = query;
+    size_t tamanho_chave = strlen(chave);
+    while (par != NULL && *par != '\0') {
+        const char *fim = strchr(par, '&');
+        if (fim == NULL)
+            fim = par + strlen(par);
+        const char *igual = memchr(par, '=', (size_t)(fim - par));
+        if (igual != NULL && (size_t)(igual - par) == tamanho_chave && strncmp(par, chave, tamanho_chave) == 0) {
+            size_t tamanho_valor = (size_t)(fim - igual - 1);
+            size_t copia = tamanho_valor < tamanho - 1 ? tamanho_valor : tamanho - 1;
+            memcpy(valor, igual + 1, copia);
+            valor[copia] = '\0';
+            return copia < tamanho_valor ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+        }
+        par = (*fim != '\0') ? fim + 1 : NULL;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+static inline int httpd_req_to_sockfd(httpd_req_t *req)
+{
+    return sim_requisicao(req)->fd;
+}
+
+
+/*---------------------------------------------Respostas------------------------------------------------------*/
+static inline esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status)
+{
+    struct sim_resposta *resposta = sim_requisicao(req)->resposta;
+    snprintf(resposta->status, sizeof(resposta->status), "%s", status);
+    return ESP_OK;
+}
+
+static inline esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *tipo)
+{
+    sim_requisicao(req)->resposta->tipo = tipo;
+    return ESP_OK;
+}
+
+static inline esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *campo, const char *valor)
+{
+    struct sim_resposta *resposta = sim_requisicao(req)->resposta;
+    if (resposta->num_cabecalhos >= SIM_HTTP_CABECALHOS_MAXIMO)
+        return ESP_ERR_HTTPD_RESP_HDR;
+    resposta->cabecalhos[resposta->num_cabecalhos].campo = campo;
+    resposta->cabecalhos[resposta->num_cabecalhos].valor = valor;
+    resposta->num_cabecalhos++;
+    return ESP_OK;
+}
+
+static inline esp_err_t httpd_resp_send(httpd_req_t *req, const char *dados, ssize_t tamanho)
+{
+    struct sim_resposta *resposta = sim_requisicao(req)->resposta;
+    if (resposta->terminou)
+        return ESP_ERR_HTTPD_RESP_SEND;
+    if (tamanho == HTTPD_RESP_USE_STRLEN)
+        tamanho = (dados != NULL) ? (ssize_t)strlen(dados) : 0;
+    if (dados != NULL)
+        sim_acrescenta_resposta(req, dados, (size_t)tamanho);
+    resposta->terminou = true;
+    return ESP_OK;
+}
+
+static inline esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *dados, ssize_t tamanho)
+{
+    struct sim_resposta *resposta = sim_requisicao(req)->resposta;
+    if (resposta->terminou)
+        return ESP_ERR_HTTPD_RESP_SEND;
+    if (tamanho == HTTPD_RESP_USE_STRLEN)
+        tamanho = (dados != NULL) ? (ssize_t)strlen(dados) : 0;
+    if (dados == NULL || tamanho == 0) {
+        resposta->terminou = true;
+        return ESP_OK;
+    }
+    sim_acrescenta_resposta(req, dados, (size_t)tamanho);
+    resposta->chunks++;
+    return ESP_OK;
+}
+
+static inline esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t erro, const char *mensagem)
+{
+    const char *status;
+    switch (erro) {
+    case HTTPD_400_BAD_REQUEST:         status = "400 Bad Request";           break;
+    case HTTPD_404_NOT_FOUND:           status = "404 Not Found";             break;
+    case HTTPD_405_METHOD_NOT_ALLOWED:  status = "405 Method Not Allowed";    break;
+    case HTTPD_408_REQ_TIMEOUT:         status = "408 Request Timeout";       break;
+    case HTTPD_411_LENGTH_REQUIRED:     status = "411 Length Required";       break;
+    default:                            status = "500 Internal Server Error"; break;
+    }
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, mensagem, HTTPD_RESP_USE_STRLEN);
+}
+
+static inline esp_err_t httpd_resp_send_408(httpd_req_t *req)
+{
+    return httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, NULL);
+}
+
+
+/*---------------------------------------------WebSocket------------------------------------------------------*/
+//O quadro recebido é o corpo da requisição feita pelo sim_http no fd do WebSocket
+static inline esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *quadro, size_t maximo)
+{
+    struct sim_requisicao *requisicao = sim_requisicao(req);
+    size_t tamanho = req->content_len;
+    quadro->type  = HTTPD_WS_TYPE_TEXT;
+    quadro->final = true;
+    if (maximo == 0) {
+        quadro->len = tamanho;
+        return ESP_OK;
+    }
+    if (maximo < tamanho)
+        return ESP_ERR_INVALID_SIZE;
+    memcpy(quadro->payload, requisicao->corpo, tamanho);
+    quadro->len = tamanho;
+    return ESP_OK;
+}
+
+static inline httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t handle, int fd)
+{
+    struct sim_httpd *httpd = handle;
+    if (fd < 0 || fd >= SIM_HTTP_SOCKETS)
+        return HTTPD_WS_CLIENT_INVALID;
+    return httpd->websocket[fd] ? HTTPD_WS_CLIENT_WEBSOCKET : HTTPD_WS_CLIENT_HTTP;
+}
+
+static inline esp_err_t httpd_ws_send_frame_async(httpd_handle_t handle, int fd, httpd_ws_frame_t *quadro)
+{
+    struct sim_httpd *httpd = handle;
+    if (fd < 0 || fd >= SIM_HTTP_SOCKETS || !httpd->websocket[fd])
+        return ESP_ERR_INVALID_ARG;
+    httpd->quadros_ws[fd]++;
+    size_t copia = quadro->len < sizeof(httpd->ultimo_quadro_ws) - 1 ? quadro->len : sizeof(httpd->ultimo_quadro_ws) - 1;
+    memcpy(httpd->ultimo_quadro_ws, quadro->payload, copia);
+    httpd->ultimo_quadro_ws[copia] = '\0';
+    return sim_registra("httpd_ws_send_frame_async", fd, (int32_t)quadro->len, 0, 0, ESP_OK);
+}
+
+
+/*---------------------------------------Requisições do teste-------------------------------------------------*/
+//Marca o fd como um cliente que parou de ler (ou volta a ler)
+static inline void sim_http_socket_parado(int fd, bool parado)
+{
+    struct sim_sockets_http *sockets = sim_sockets_http();
+    pthread_mutex_lock(&sockets->mutex);
+    sockets->fds[fd].parado = parado;
+    pthread_cond_broadcast(&sockets->escreveu);
+    pthread_mutex_unlock(&sockets->mutex);
+}
+
+//Interpreta a resposta escrita no socket (status, cabeçalhos e corpo em chunks) na sim_resposta. Retorna false
+//enquanto ela não terminou, com o chunk final
+static inline bool sim_interpreta_resposta_socket(const char *dados, size_t tamanho, struct sim_resposta *resposta)
+{
+    const char *fim_cabecalhos = memmem(dados, tamanho, "\r\n\r\n", 4);
+    if (fim_cabecalhos == NULL)
+        return false;
+
+    //"HTTP/1.1 200 OK\r\n" e depois um "Campo: valor\r\n" por linha
+    const char *linha   = dados;
+    const char *fim     = strstr(linha, "\r\n");
+    const char *espaco  = memchr(linha, ' ', (size_t)(fim - linha));
+    if (espaco != NULL)
+        snprintf(resposta->status, sizeof(resposta->status), "%.*s", (int)(fim - espaco - 1), espaco + 1);
+    size_t usado = 0;
+    resposta->num_cabecalhos = 0;
+    for (linha = fim + 2; linha < fim_cabecalhos + 2; linha = fim + 2) {
+        fim = strstr(linha, "\r\n");
+        const char *dois_pontos = memchr(linha, ':', (size_t)(fim - linha));
+        if (dois_pontos == NULL)
+            continue;
+        const char *valor = dois_pontos + 1;
+        while (*valor == ' ')
+            valor++;
+        int tamanho_campo = (int)(dois_pontos - linha), tamanho_valor = (int)(fim - valor);
+        if (tamanho_campo == 12 && strncasecmp(linha, "Content-Type", 12) == 0) {
+            snprintf(resposta->tipo_texto, sizeof(resposta->tipo_texto), "%.*s", tamanho_valor, valor);
+            resposta->tipo = resposta->tipo_texto;
+        } else if (resposta->num_cabecalhos < SIM_HTTP_CABECALHOS_MAXIMO &&
+                   usado + (size_t)tamanho_campo + (size_t)tamanho_valor + 2 <= sizeof(resposta->cabecalhos_texto)) {
+            char *campo = resposta->cabecalhos_texto + usado;
+            usado += (size_t)sprintf(campo, "%.*s", tamanho_campo, linha) + 1;
+            char *copia = resposta->cabecalhos_texto + usado;
+            usado += (size_t)sprintf(copia, "%.*s", tamanho_valor, valor) + 1;
+            resposta->cabecalhos[resposta->num_cabecalhos].campo = campo;
+            resposta->cabecalhos[resposta->num_cabecalhos].valor = copia;
+            resposta->num_cabecalhos++;
+        }
+    }
+
+    //o corpo, sempre em chunks: "<tamanho em hexa>\r\n<dados>\r\n" até o de tamanho 0
+    const char *chunk = fim_cabecalhos + 4, *fim_dados = dados + tamanho;
+    resposta->tamanho = 0;
+    resposta->chunks  = 0;
+    while (chunk < fim_dados) {
+        const char *fim_tamanho = memmem(chunk, (size_t)(fim_dados - chunk), "\r\n", 2);
+        if (fim_tamanho == NULL)
+            return false;
+        size_t tamanho_chunk = strtoul(chunk, NULL, 16);
+        if (tamanho_chunk == 0)
+            return resposta->terminou = (fim_dados - fim_tamanho >= 4);
+        if ((size_t)(fim_dados - fim_tamanho) < tamanho_chunk + 4)
+            return false;
+        size_t cabe = SIM_HTTP_RESPOSTA_MAXIMA - resposta->tamanho;
+        memcpy(resposta->corpo + resposta->tamanho, fim_tamanho + 2, tamanho_chunk < cabe ? tamanho_chunk : cabe);
+        resposta->tamanho += tamanho_chunk < cabe ? tamanho_chunk : cabe;
+        resposta->corpo[resposta->tamanho] = '\0';
+        resposta->chunks++;
+        chunk = fim_tamanho + 2 + tamanho_chunk + 2;
+    }
+    return false;
+}
+
+//Espera a resposta que outra task escreve no socket do fd, até SIM_HTTP_ESPERA_ENVIO_US. Num fd parado não
+//espera: nada vai chegar enquanto o teste não o soltar
+static inline void sim_espera_resposta_socket(int fd, struct sim_resposta *resposta)
+{
+    struct sim_sockets_http *sockets = sim_sockets_http();
+    struct timespec prazo = sim_prazo_us(SIM_HTTP_ESPERA_ENVIO_US);
+    pthread_mutex_lock(&sockets->mutex);
+    while (!sockets->fds[fd].parado &&
+           !sim_interpreta_resposta_socket(sockets->fds[fd].dados, sockets->fds[fd].tamanho, resposta)) {
+        if (pthread_cond_timedwait(&sockets->escreveu, &sockets->mutex, &prazo) != 0)
+            break;
+    }
+    pthread_mutex_unlock(&sockets->mutex);
+}
+
+//Faz a requisição 'metodo' 'uri' (com a query) no socket 'fd', com os cabecalhos "Campo: valor\r\n..." e o
+//corpo dados (NULL para nenhum). Retorna ESP_ERR_NOT_FOUND se nenhuma URI casar, como o 404 do httpd
+static inline esp_err_t sim_http_fd(int fd, httpd_method_t metodo, const char *uri, const char *cabecalhos,
+                                    const char *corpo, struct sim_resposta *resposta)
+{
+    struct sim_httpd *httpd = sim_httpd();
+    memset(resposta->status, 0, sizeof(resposta->status));
+    strcpy(resposta->status, "200 OK");
+    resposta->tipo           = "text/html";
+    resposta->num_cabecalhos = 0;
+    resposta->tamanho        = 0;
+    resposta->corpo[0]       = '\0';
+    resposta->chunks         = 0;
+    resposta->terminou       = false;
+    resposta->retorno        = ESP_OK;
+
+    //a resposta anterior já foi lida
+    if (fd >= 0 && fd < SIM_HTTP_SOCKETS) {
+        struct sim_sockets_http *sockets = sim_sockets_http();
+        pthread_mutex_lock(&sockets->mutex);
+        sockets->fds[fd].tamanho = 0;
+        pthread_mutex_unlock(&sockets->mutex);
+    }
+
+    pthread_mutex_lock(&httpd->mutex);
+    if (!httpd->rodando) {
+        pthread_mutex_unlock(&httpd->mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t tamanho_caminho = strcspn(uri, "?");
+    const httpd_uri_t *escolhida = NULL;
+    for (int u = 0; u < httpd->num_uris && escolhida == NULL; u++) {
+        bool casa = (httpd->config.uri_match_fn != NULL)
+                  ? httpd->config.uri_match_fn(httpd->uris[u].uri, uri, tamanho_caminho)
+                  : (strlen(httpd->uris[u].uri) == tamanho_caminho &&
+                     strncmp(httpd->uris[u].uri, uri, tamanho_caminho) == 0);
+        if (casa && (int)httpd->uris[u].method == (int)metodo)
+            escolhida = &httpd->uris[u];
+    }
+
+    struct sim_requisicao requisicao = {
+        .corpo      = corpo != NULL ? corpo : "",
+        .cabecalhos = cabecalhos,
+        .fd         = fd,
+        .resposta   = resposta,
+    };
+    httpd_req_t req = {
+        .handle      = httpd,
+        .method      = metodo,
+        .content_len = corpo != NULL ? strlen(corpo) : 0,
+        .aux         = &requisicao,
+    };
+    snprintf((char *)req.uri, sizeof(req.uri), "%s", uri);
+
+    if (escolhida == NULL) {
+        httpd_resp_send_err(&req, HTTPD_404_NOT_FOUND, "Nothing matches the given URI");
+        pthread_mutex_unlock(&httpd->mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    req.user_ctx = escolhida->user_ctx;
+    //o handshake do WebSocket é feito pelo httpd, o handler só é chamado depois dele
+    if (escolhida->is_websocket && metodo == HTTP_GET && fd >= 0 && fd < SIM_HTTP_SOCKETS &&
+        !httpd->websocket[fd]) {
+        httpd->websocket[fd] = true;
+        resposta->retorno = escolhida->handler(&req);
+        strcpy(resposta->status, "101 Switching Protocols");
+    } else {
+        resposta->retorno = escolhida->handler(&req);
+    }
+    pthread_mutex_unlock(&httpd->mutex);
+
+    //o handler deixou a resposta para outra task: o server já está livre para a próxima requisição
+    if (!resposta->terminou && resposta->retorno == ESP_OK && fd >= 0 && fd < SIM_HTTP_SOCKETS &&
+        !httpd->websocket[fd])
+        sim_espera_resposta_socket(fd, resposta);
+    return ESP_OK;
+}
+
+//sim_http_fd no socket 1, o das requisições comuns
+static inline esp_err_t sim_http(httpd_method_t metodo, const char *uri, const char *corpo,
+                                 struct sim_resposta *resposta)
+{
+    return sim_http_fd(1, metodo, uri, NULL, corpo, resposta);
+}
+
+#endif
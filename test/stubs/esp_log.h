@@ -0,0 +1,41 @@
+/*esp_log.h da simulação: o log vai para o stdout no formato do monitor serial, com um nível só para todas as
+tags (o esp_log_level_set troca o nível de todas)*/
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include "simulacao.h"
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+static inline esp_log_level_t *sim_nivel_log(void)
+{
+    static esp_log_level_t nivel = ESP_LOG_INFO;
+    return &nivel;
+}
+
+static inline void esp_log_level_set(const char *tag, esp_log_level_t nivel)
+{
+    (void)tag;
+    *sim_nivel_log() = nivel;
+}
+
+#define SIM_LOG(nivel, letra, tag, formato, ...) do {                                           \
+        if (*sim_nivel_log() >= (nivel))                                                    \
+            printf(letra " (%lld) %s: " formato "\n", (long long)(sim_agora_ns() / 1000000), \
+                   tag, ##__VA_ARGS__);                                                     \
+    } while (0)
+
+#define ESP_LOGE(tag, formato, ...) SIM_LOG(ESP_LOG_ERROR,   "E", tag, formato, ##__VA_ARGS__)
+#define ESP_LOGW(tag, formato, ...) SIM_LOG(ESP_LOG_WARN,    "W", tag, formato, ##__VA_ARGS__)
+#define ESP_LOGI(tag, formato, ...) SIM_LOG(ESP_LOG_INFO,    "I", tag, formato, ##__VA_ARGS__)
+#define ESP_LOGD(tag, formato, ...) SIM_LOG(ESP_LOG_DEBUG,   "D", tag, formato, ##__VA_ARGS__)
+#define ESP_LOGV(tag, formato, ...) SIM_LOG(ESP_LOG_VERBOSE, "V", tag, formato, ##__VA_ARGS__)
+
+#endif
@@ -0,0 +1,46 @@
+/*esp_netif.h da simulação: só os eventos de IP*/
+#ifndef ESP_NETIF_H
+#define ESP_NETIF_H
+
+#include "esp_event.h"
+
+static const esp_event_base_t IP_EVENT __attribute__((unused)) = "IP_EVENT";
+
+enum {
+    IP_EVENT_STA_GOT_IP,
+    IP_EVENT_STA_LOST_IP,
+};
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct {
+    int                 if_index;
+    void               *esp_netif;
+    esp_netif_ip_info_t ip_info;
+    bool                ip_changed;
+} ip_event_got_ip_t;
+
+#define IPSTR "%d.%d.%d.%d"
+#define IP2STR(ip) (int)((ip)->addr & 0xFF), (int)(((ip)->addr >> 8) & 0xFF), \
+                   (int)(((ip)->addr >> 16) & 0xFF), (int)(((ip)->addr >> 24) & 0xFF)
+
+static inline esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+static inline void *esp_netif_create_default_wifi_sta(void)
+{
+    static int netif;
+    return &netif;
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*esp_system.h da simulação: o heap livre sai da contagem do malloc de simulacao.h*/
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+#include "simulacao.h"
+
+static inline uint32_t esp_get_free_heap_size(void)
+{
+    size_t em_uso = sim_heap_em_uso();
+    return em_uso < SIM_HEAP_TOTAL ? (uint32_t)(SIM_HEAP_TOTAL - em_uso) : 0;
+}
+
+static inline uint32_t esp_get_minimum_free_heap_size(void)
+{
+    size_t pico = sim_heap_pico();
+    return pico < SIM_HEAP_TOTAL ? (uint32_t)(SIM_HEAP_TOTAL - pico) : 0;
+}
+
+static inline uint32_t esp_random(void)
+{
+    static __thread unsigned semente;
+    if (semente == 0)
+        semente = (unsigned)sim_agora_ns() | 1;
+    return ((uint32_t)rand_r(&semente) << 16) ^ (uint32_t)rand_r(&semente);
+}
+
+static inline void esp_restart(void)
+{
+    fflush(stdout);
+    exit(0);
+}
+
+#endif
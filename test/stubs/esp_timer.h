@@ -0,0 +1,134 @@
+/*esp_timer.h da simulação: o tempo desde o boot e timers de software, cada um com uma thread que chama o
+callback no prazo (como o ESP_TIMER_TASK, fora de qualquer task do firmware)*/
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include "simulacao.h"
+
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t       callback;
+    void                *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char          *name;
+    bool                 skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct sim_esp_timer{
+    esp_timer_cb_t  callback;
+    void           *arg;
+    const char     *nome;
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    bool            armado;
+    int64_t         prazo_us;
+    uint64_t        periodo_us;         //0 para o start_once
+};
+
+typedef struct sim_esp_timer *esp_timer_handle_t;
+
+static inline int64_t esp_timer_get_time(void)
+{
+    return sim_agora_ns() / 1000;
+}
+
+static inline void *sim_executa_esp_timer(void *argumento)
+{
+    struct sim_esp_timer *timer = argumento;
+    pthread_mutex_lock(&timer->mutex);
+    while (1) {
+        if (!timer->armado) {
+            pthread_cond_wait(&timer->cond, &timer->mutex);
+            continue;
+        }
+        int64_t falta_us = timer->prazo_us - esp_timer_get_time();
+        if (falta_us > 0) {
+            struct timespec prazo = sim_prazo_us(falta_us);
+            pthread_cond_timedwait(&timer->cond, &timer->mutex, &prazo);
+            continue;
+        }
+        if (timer->periodo_us > 0)
+            timer->prazo_us += timer->periodo_us;
+        else
+            timer->armado = false;
+        pthread_mutex_unlock(&timer->mutex);
+        timer->callback(timer->arg);
+        pthread_mutex_lock(&timer->mutex);
+    }
+    return NULL;
+}
+
+//Como no ESP-IDF, o timer vem do heap
+static inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+    if (args == NULL || args->callback == NULL || handle == NULL)
+        return ESP_ERR_INVALID_ARG;
+    struct sim_esp_timer *timer = calloc(1, sizeof(*timer));
+    if (timer == NULL)
+        return ESP_ERR_NO_MEM;
+    timer->callback = args->callback;
+    timer->arg      = args->arg;
+    timer->nome     = args->name;
+    pthread_mutex_init(&timer->mutex, NULL);
+    sim_inicia_cond(&timer->cond);
+
+    pthread_attr_t atributos;
+    pthread_attr_init(&atributos);
+    pthread_attr_setdetachstate(&atributos, PTHREAD_CREATE_DETACHED);
+    int erro = pthread_create(&timer->thread, &atributos, sim_executa_esp_timer, timer);
+    pthread_attr_destroy(&atributos);
+    if (erro != 0) {
+        free(timer);
+        return ESP_ERR_NO_MEM;
+    }
+    *handle = timer;
+    return ESP_OK;
+}
+
+static inline esp_err_t sim_arma_esp_timer(esp_timer_handle_t timer, uint64_t us, uint64_t periodo_us)
+{
+    if (timer == NULL)
+        return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&timer->mutex);
+    esp_err_t erro = ESP_ERR_INVALID_STATE;     //já armado, como no ESP-IDF
+    if (!timer->armado) {
+        timer->armado     = true;
+        timer->prazo_us   = esp_timer_get_time() + (int64_t)us;
+        timer->periodo_us = periodo_us;
+        pthread_cond_signal(&timer->cond);
+        erro = ESP_OK;
+    }
+    pthread_mutex_unlock(&timer->mutex);
+    return erro;
+}
+
+static inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t us)
+{
+    return sim_arma_esp_timer(timer, us, 0);
+}
+
+static inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodo_us)
+{
+    return sim_arma_esp_timer(timer, periodo_us, periodo_us);
+}
+
+static inline esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL)
+        return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&timer->mutex);
+    esp_err_t erro = timer->armado ? ESP_OK : ESP_ERR_INVALID_STATE;
+    timer->armado = false;
+    pthread_cond_signal(&timer->cond);
+    pthread_mutex_unlock(&timer->mutex);
+    return erro;
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*esp_wifi.h da simulação: não há rede, o teste decide quando o IP chega (sim_wifi_recebe_ip) e quando ele
+cai (sim_wifi_perde_ip)*/
+#ifndef ESP_WIFI_H
+#define ESP_WIFI_H
+
+#include "esp_event.h"
+#include "esp_netif.h"
+
+static const esp_event_base_t WIFI_EVENT __attribute__((unused)) = "WIFI_EVENT";
+
+enum {
+    WIFI_EVENT_WIFI_READY,
+    WIFI_EVENT_SCAN_DONE,
+    WIFI_EVENT_STA_START,
+    WIFI_EVENT_STA_STOP,
+    WIFI_EVENT_STA_CONNECTED,
+    WIFI_EVENT_STA_DISCONNECTED,
+};
+
+typedef enum {
+    WIFI_MODE_NULL,
+    WIFI_MODE_STA,
+} wifi_mode_t;
+
+typedef enum {
+    WIFI_IF_STA,
+} wifi_interface_t;
+
+#define ESP_IF_WIFI_STA WIFI_IF_STA
+
+typedef enum {
+    WIFI_AUTH_OPEN,
+    WIFI_AUTH_WEP,
+    WIFI_AUTH_WPA_PSK,
+    WIFI_AUTH_WPA2_PSK,
+} wifi_auth_mode_t;
+
+typedef struct {
+    bool capable;
+    bool required;
+} wifi_pmf_config_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t password[64];
+    struct {
+        int8_t           rssi;
+        wifi_auth_mode_t authmode;
+    } threshold;
+    wifi_pmf_config_t pmf_cfg;
+} wifi_sta_config_t;
+
+typedef union {
+    wifi_sta_config_t sta;
+} wifi_config_t;
+
+typedef struct {
+    int reservado;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT() { 0 }
+
+static inline esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_wifi_set_mode(wifi_mode_t modo)
+{
+    (void)modo;
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *config)
+{
+    (void)interface; (void)config;
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_wifi_start(void)
+{
+    sim_posta_evento(WIFI_EVENT, WIFI_EVENT_STA_START, NULL);
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_wifi_connect(void)
+{
+    return sim_registra("esp_wifi_connect", 0, 0, 0, 0, ESP_OK);
+}
+
+//A rede conectou e deu o IP 192.168.0.50
+static inline void sim_wifi_recebe_ip(void)
+{
+    ip_event_got_ip_t evento = {
+        .ip_info.ip.addr = 192 | (168 << 8) | (0 << 16) | (50u << 24),
+    };
+    sim_posta_evento(IP_EVENT, IP_EVENT_STA_GOT_IP, &evento);
+}
+
+static inline void sim_wifi_perde_ip(void)
+{
+    sim_posta_evento(IP_EVENT, IP_EVENT_STA_LOST_IP, NULL);
+}
+
+#endif
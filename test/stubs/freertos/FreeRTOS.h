@@ -0,0 +1,49 @@
+/*FreeRTOS.h da simulação: os tipos, os ticks (100 Hz como no sdkconfig) e as seções críticas, que são um mutex
+recursivo. No ESP32 o portENTER_CRITICAL também segura o outro core; aqui o mutex faz o mesmo com as threads*/
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include "simulacao.h"
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint8_t  StackType_t;
+
+#define configTICK_RATE_HZ          CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS          (1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS            portTICK_PERIOD_MS
+#define portMAX_DELAY               ((TickType_t)0xffffffffUL)
+#define portNUM_PROCESSORS          2
+#define pdMS_TO_TICKS(ms)           ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000))
+#define pdFALSE                     0
+#define pdTRUE                      1
+#define pdPASS                      pdTRUE
+#define pdFAIL                      pdFALSE
+#define tskNO_AFFINITY              0x7FFFFFFF
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+//O controle de uma task estática: do tamanho do do ESP32, a simulação guarda a task dela em outro lugar
+typedef struct { uint8_t reservado[344]; } StaticTask_t;
+
+typedef struct {
+    pthread_mutex_t mutex;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP }
+
+#define portENTER_CRITICAL(mux)         pthread_mutex_lock(&(mux)->mutex)
+#define portEXIT_CRITICAL(mux)          pthread_mutex_unlock(&(mux)->mutex)
+#define portENTER_CRITICAL_ISR(mux)     pthread_mutex_lock(&(mux)->mutex)
+#define portEXIT_CRITICAL_ISR(mux)      pthread_mutex_unlock(&(mux)->mutex)
+#define portYIELD_FROM_ISR()            sched_yield()
+
+static inline BaseType_t xPortGetCoreID(void)
+{
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : cpu % portNUM_PROCESSORS;
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*semphr.h da simulação: só o mutex estático, que é um pthread_mutex. Como no FreeRTOS, quem segura o mutex
+pode bloquear (ao contrário da seção crítica) e o xSemaphoreTake espera no máximo 'espera' ticks*/
+#ifndef SEMPHR_H
+#define SEMPHR_H
+
+#include "FreeRTOS.h"
+
+typedef struct {
+    pthread_mutex_t mutex;
+} StaticSemaphore_t;
+
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    pthread_mutex_init(&buffer->mutex, NULL);
+    return buffer;
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaforo, TickType_t espera)
+{
+    if (espera == portMAX_DELAY)
+        return pthread_mutex_lock(&semaforo->mutex) == 0 ? pdTRUE : pdFALSE;
+    struct timespec prazo = sim_prazo_us((int64_t)espera * portTICK_PERIOD_MS * 1000);
+    return pthread_mutex_clocklock(&semaforo->mutex, CLOCK_MONOTONIC, &prazo) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaforo)
+{
+    return pthread_mutex_unlock(&semaforo->mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+#endif
@@ -0,0 +1,164 @@
+/*task.h da simulação: cada task é uma thread e as notificações são um contador com mutex e condição, com a
+mesma semântica do ulTaskNotifyTake/xTaskNotifyGive do FreeRTOS. A prioridade e o core são ignorados*/
+#ifndef TASK_H
+#define TASK_H
+
+#include "FreeRTOS.h"
+
+#define SIM_MAXIMO_TASKS    16
+
+typedef void (*TaskFunction_t)(void *);
+
+struct sim_task{
+    pthread_t       thread;
+    const char     *nome;
+    TaskFunction_t  funcao;
+    void           *parametro;
+    uint32_t        pilha;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    uint32_t        notificacoes;
+};
+
+typedef struct sim_task *TaskHandle_t;
+
+struct sim_tasks{
+    pthread_mutex_t mutex;
+    struct sim_task tasks[SIM_MAXIMO_TASKS];
+    int             quantidade;
+    struct sim_task principal;      //quem chama as funções de task fora de uma task (o app_main, os testes)
+};
+
+static inline struct sim_tasks *sim_tasks(void)
+{
+    static struct sim_tasks tasks = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+    return &tasks;
+}
+
+static inline struct sim_task **sim_task_da_thread(void)
+{
+    static __thread struct sim_task *atual;
+    return &atual;
+}
+
+static inline void sim_inicia_task(struct sim_task *task, const char *nome, uint32_t pilha)
+{
+    task->nome         = nome;
+    task->pilha        = pilha;
+    task->notificacoes = 0;
+    pthread_mutex_init(&task->mutex, NULL);
+    sim_inicia_cond(&task->cond);
+}
+
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    struct sim_task *atual = *sim_task_da_thread();
+    if (atual != NULL)
+        return atual;
+
+    struct sim_tasks *tasks = sim_tasks();
+    pthread_mutex_lock(&tasks->mutex);
+    if (tasks->principal.nome == NULL)
+        sim_inicia_task(&tasks->principal, "main", 3584);
+    pthread_mutex_unlock(&tasks->mutex);
+    return &tasks->principal;
+}
+
+static inline void *sim_executa_task(void *argumento)
+{
+    struct sim_task *task = argumento;
+    *sim_task_da_thread() = task;
+    task->funcao(task->parametro);
+    return NULL;
+}
+
+static inline TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t funcao, const char *nome, uint32_t tamanho,
+                                                         void *parametro, UBaseType_t prioridade,
+                                                         StackType_t *pilha, StaticTask_t *tcb, BaseType_t core)
+{
+    (void)prioridade; (void)pilha; (void)tcb; (void)core;
+    struct sim_tasks *tasks = sim_tasks();
+    pthread_mutex_lock(&tasks->mutex);
+    if (tasks->quantidade >= SIM_MAXIMO_TASKS) {
+        pthread_mutex_unlock(&tasks->mutex);
+        return NULL;
+    }
+    struct sim_task *task = &tasks->tasks[tasks->quantidade++];
+    pthread_mutex_unlock(&tasks->mutex);
+
+    sim_inicia_task(task, nome, tamanho);
+    task->funcao    = funcao;
+    task->parametro = parametro;
+
+    pthread_attr_t atributos;
+    pthread_attr_init(&atributos);
+    pthread_attr_setdetachstate(&atributos, PTHREAD_CREATE_DETACHED);
+    int erro = pthread_create(&task->thread, &atributos, sim_executa_task, task);
+    pthread_attr_destroy(&atributos);
+    return (erro == 0) ? task : NULL;
+}
+
+static inline void vTaskDelay(TickType_t ticks)
+{
+    sim_dorme_us((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+static inline void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == *sim_task_da_thread())
+        pthread_exit(NULL);
+    pthread_cancel(task->thread);
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t zera, TickType_t espera)
+{
+    struct sim_task *task = xTaskGetCurrentTaskHandle();
+    pthread_mutex_lock(&task->mutex);
+    if (espera == portMAX_DELAY) {
+        while (task->notificacoes == 0)
+            pthread_cond_wait(&task->cond, &task->mutex);
+    } else if (espera > 0) {
+        struct timespec prazo = sim_prazo_us((int64_t)espera * portTICK_PERIOD_MS * 1000);
+        while (task->notificacoes == 0 && pthread_cond_timedwait(&task->cond, &task->mutex, &prazo) == 0)
+            ;
+    }
+    uint32_t valor = task->notificacoes;
+    if (valor > 0)
+        task->notificacoes = zera ? 0 : valor - 1;
+    pthread_mutex_unlock(&task->mutex);
+    return valor;
+}
+
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->mutex);
+    task->notificacoes++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->mutex);
+    return pdPASS;
+}
+
+static inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *acordou_maior_prioridade)
+{
+    xTaskNotifyGive(task);
+    if (acordou_maior_prioridade != NULL)
+        *acordou_maior_prioridade = pdFALSE;
+}
+
+static inline TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(sim_agora_ns() / (portTICK_PERIOD_MS * 1000000LL));
+}
+
+//No PC a pilha da thread não é a do firmware: informa a pilha inteira como folga
+static inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return (task != NULL ? task : xTaskGetCurrentTaskHandle())->pilha;
+}
+
+static inline const char *pcTaskGetTaskName(TaskHandle_t task)
+{
+    return (task != NULL ? task : xTaskGetCurrentTaskHandle())->nome;
+}
+
+#endif
@@ -0,0 +1,10 @@
+/*lwip/sockets.h da simulação: os sockets do próprio PC, então o controle por UDP responde de verdade*/
+#ifndef LWIP_SOCKETS_H
+#define LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif
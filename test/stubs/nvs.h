@@ -0,0 +1,165 @@
+/*nvs.h da simulação: os blobs ficam na memória e cada nvs_set_blob/nvs_commit fica no registro das chamadas,
+para os testes contarem as gravações na flash*/
+#ifndef NVS_H
+#define NVS_H
+
+#include "simulacao.h"
+
+#define ESP_ERR_NVS_BASE                0x1100
+#define ESP_ERR_NVS_NOT_INITIALIZED     (ESP_ERR_NVS_BASE + 0x01)
+#define ESP_ERR_NVS_NOT_FOUND           (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_READ_ONLY           (ESP_ERR_NVS_BASE + 0x04)
+#define ESP_ERR_NVS_NOT_ENOUGH_SPACE    (ESP_ERR_NVS_BASE + 0x05)
+#define ESP_ERR_NVS_INVALID_HANDLE      (ESP_ERR_NVS_BASE + 0x07)
+#define ESP_ERR_NVS_INVALID_LENGTH      (ESP_ERR_NVS_BASE + 0x0c)
+#define ESP_ERR_NVS_NO_FREE_PAGES       (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND   (ESP_ERR_NVS_BASE + 0x10)
+
+#define SIM_NVS_CHAVES                  24
+#define SIM_NVS_BLOB_MAXIMO             (8 * 1024)
+#define SIM_NVS_HANDLES                 8
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+struct sim_nvs{
+    pthread_mutex_t mutex;
+    bool            iniciada;
+    struct {
+        char    namespace_[16];
+        char    chave[16];
+        size_t  tamanho;
+        uint8_t dados[SIM_NVS_BLOB_MAXIMO];
+    } blobs[SIM_NVS_CHAVES];
+    int             num_blobs;
+    struct {
+        bool            aberto;
+        char            namespace_[16];
+        nvs_open_mode_t modo;
+    } handles[SIM_NVS_HANDLES];
+};
+
+static inline struct sim_nvs *sim_nvs(void)
+{
+    static struct sim_nvs nvs = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+    return &nvs;
+}
+
+//O blob 'chave' do namespace do handle, -1 se não existe
+static inline int sim_nvs_procura(struct sim_nvs *nvs, const char *namespace_, const char *chave)
+{
+    for (int b = 0; b < nvs->num_blobs; b++) {
+        if (strcmp(nvs->blobs[b].namespace_, namespace_) == 0 && strcmp(nvs->blobs[b].chave, chave) == 0)
+            return b;
+    }
+    return -1;
+}
+
+static inline esp_err_t nvs_open(const char *namespace_, nvs_open_mode_t modo, nvs_handle_t *handle)
+{
+    struct sim_nvs *nvs = sim_nvs();
+    esp_err_t erro = ESP_ERR_NVS_NOT_INITIALIZED;
+    pthread_mutex_lock(&nvs->mutex);
+    if (nvs->iniciada) {
+        erro = ESP_ERR_NO_MEM;
+        for (int h = 0; h < SIM_NVS_HANDLES; h++) {
+            if (!nvs->handles[h].aberto) {
+                nvs->handles[h].aberto = true;
+                nvs->handles[h].modo   = modo;
+                snprintf(nvs->handles[h].namespace_, sizeof(nvs->handles[h].namespace_), "%s", namespace_);
+                *handle = (nvs_handle_t)h + 1;
+                erro = ESP_OK;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&nvs->mutex);
+    return erro;
+}
+
+static inline void nvs_close(nvs_handle_t handle)
+{
+    struct sim_nvs *nvs = sim_nvs();
+    pthread_mutex_lock(&nvs->mutex);
+    if (handle >= 1 && handle <= SIM_NVS_HANDLES)
+        nvs->handles[handle - 1].aberto = false;
+    pthread_mutex_unlock(&nvs->mutex);
+}
+
+static inline esp_err_t nvs_get_blob(nvs_handle_t handle, const char *chave, void *dados, size_t *tamanho)
+{
+    struct sim_nvs *nvs = sim_nvs();
+    if (handle < 1 || handle > SIM_NVS_HANDLES)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    pthread_mutex_lock(&nvs->mutex);
+    esp_err_t erro = ESP_ERR_NVS_NOT_FOUND;
+    int b = sim_nvs_procura(nvs, nvs->handles[handle - 1].namespace_, chave);
+    if (b >= 0) {
+        if (dados == NULL) {
+            *tamanho = nvs->blobs[b].tamanho;
+            erro = ESP_OK;
+        } else if (*tamanho < nvs->blobs[b].tamanho) {
+            erro = ESP_ERR_NVS_INVALID_LENGTH;
+        } else {
+            memcpy(dados, nvs->blobs[b].dados, nvs->blobs[b].tamanho);
+            *tamanho = nvs->blobs[b].tamanho;
+            erro = ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&nvs->mutex);
+    return erro;
+}
+
+static inline esp_err_t nvs_set_blob(nvs_handle_t handle, const char *chave, const void *dados, size_t tamanho)
+{
+    struct sim_nvs *nvs = sim_nvs();
+    if (handle < 1 || handle > SIM_NVS_HANDLES)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    pthread_mutex_lock(&nvs->mutex);
+    esp_err_t erro = ESP_OK;
+    const char *namespace_ = nvs->handles[handle - 1].namespace_;
+    int b = sim_nvs_procura(nvs, namespace_, chave);
+    if (nvs->handles[handle - 1].modo == NVS_READONLY) {
+        erro = ESP_ERR_NVS_READ_ONLY;
+    } else if (tamanho > SIM_NVS_BLOB_MAXIMO || (b < 0 && nvs->num_blobs >= SIM_NVS_CHAVES)) {
+        erro = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    } else {
+        if (b < 0) {
+            b = nvs->num_blobs++;
+            //os dois namespace_ têm o mesmo tamanho e o do handle já termina em '\0'
+            memcpy(nvs->blobs[b].namespace_, nvs->handles[handle - 1].namespace_, sizeof(nvs->blobs[b].namespace_));
+            snprintf(nvs->blobs[b].chave, sizeof(nvs->blobs[b].chave), "%s", chave);
+        }
+        memcpy(nvs->blobs[b].dados, dados, tamanho);
+        nvs->blobs[b].tamanho = tamanho;
+    }
+    pthread_mutex_unlock(&nvs->mutex);
+    return sim_registra("nvs_set_blob", (int32_t)tamanho, 0, 0, 0, erro);
+}
+
+static inline esp_err_t nvs_erase_key(nvs_handle_t handle, const char *chave)
+{
+    struct sim_nvs *nvs = sim_nvs();
+    if (handle < 1 || handle > SIM_NVS_HANDLES)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    pthread_mutex_lock(&nvs->mutex);
+    esp_err_t erro = ESP_ERR_NVS_NOT_FOUND;
+    int b = sim_nvs_procura(nvs, nvs->handles[handle - 1].namespace_, chave);
+    if (b >= 0) {
+        nvs->blobs[b] = nvs->blobs[--nvs->num_blobs];
+        erro = ESP_OK;
+    }
+    pthread_mutex_unlock(&nvs->mutex);
+    return sim_registra("nvs_erase_key", 0, 0, 0, 0, erro);
+}
+
+static inline esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return sim_registra("nvs_commit", (int32_t)handle, 0, 0, 0, ESP_OK);
+}
+
+#endif
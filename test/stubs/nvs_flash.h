@@ -0,0 +1,22 @@
+/*nvs_flash.h da simulação: a partição começa vazia a cada execução*/
+#ifndef NVS_FLASH_H
+#define NVS_FLASH_H
+
+#include "nvs.h"
+
+static inline esp_err_t nvs_flash_init(void)
+{
+    sim_nvs()->iniciada = true;
+    return ESP_OK;
+}
+
+static inline esp_err_t nvs_flash_erase(void)
+{
+    struct sim_nvs *nvs = sim_nvs();
+    pthread_mutex_lock(&nvs->mutex);
+    nvs->num_blobs = 0;
+    pthread_mutex_unlock(&nvs->mutex);
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,9 @@
+/*sdkconfig.h da simulação: os valores do sdkconfig do projeto que o firmware usa*/
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+#define CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ   160
+#define CONFIG_FREERTOS_HZ                  100
+#define CONFIG_LWIP_MAX_SOCKETS             16
+
+#endif
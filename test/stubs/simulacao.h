@@ -0,0 +1,271 @@
+/*Simulação do ESP-IDF no PC, para o ambiente native do platformio.ini. Os cabeçalhos de test/stubs têm os
+nomes dos do ESP-IDF que o main.c inclui e implementam só o que ele usa, com o comportamento que os testes
+precisam: as tasks são threads, as seções críticas são um mutex, o tempo é o relógio monotônico e cada chamada
+aos periféricos (LEDC, MCPWM, RMT, PCNT, GPIO) e à NVS fica registrada com o instante em que foi feita.
+
+Tudo é static inline e o estado fica dentro de funções: só um arquivo de cada teste (o que inclui o main.c)
+inclui estes cabeçalhos. Este arquivo tem o que os outros dividem: o relógio, o registro das chamadas e a
+contagem do heap*/
+#ifndef SIMULACAO_H
+#define SIMULACAO_H
+
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#define SIM_CPU_MHZ             CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+#define SIM_HEAP_TOTAL          (280 * 1024) //heap livre de um ESP32 antes do wireless
+#define SIM_REGISTROS           8192        //chamadas guardadas, as mais antigas são sobrescritas
+
+
+/*---------------------------------------------Relógio--------------------------------------------------------*/
+//Nanossegundos desde a primeira chamada, que é o "boot" da simulação
+static inline int64_t sim_agora_ns(void)
+{
+    static int64_t boot_ns;
+    struct timespec agora;
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    int64_t ns = (int64_t)agora.tv_sec * 1000000000 + agora.tv_nsec;
+    if (boot_ns == 0)
+        boot_ns = ns - 1;
+    return ns - boot_ns;
+}
+
+//Espera 'us' microssegundos
+static inline void sim_dorme_us(int64_t us)
+{
+    struct timespec espera = {.tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000};
+    while (nanosleep(&espera, &espera) != 0)
+        ;
+}
+
+//Converte um instante do CLOCK_MONOTONIC 'us' microssegundos à frente, para os pthread_cond_timedwait
+static inline struct timespec sim_prazo_us(int64_t us)
+{
+    struct timespec prazo;
+    clock_gettime(CLOCK_MONOTONIC, &prazo);
+    int64_t ns = prazo.tv_nsec + (us % 1000000) * 1000;
+    prazo.tv_sec += us / 1000000 + ns / 1000000000;
+    prazo.tv_nsec = ns % 1000000000;
+    return prazo;
+}
+
+//Inicia uma variável de condição que usa o CLOCK_MONOTONIC nas esperas com prazo
+static inline void sim_inicia_cond(pthread_cond_t *cond)
+{
+    pthread_condattr_t atributos;
+    pthread_condattr_init(&atributos);
+    pthread_condattr_setclock(&atributos, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &atributos);
+    pthread_condattr_destroy(&atributos);
+}
+
+
+/*------------------------------Registro das chamadas aos periféricos-----------------------------------------*/
+//Uma chamada feita pelo firmware: o nome da função, até 4 argumentos inteiros e o retorno
+struct sim_registro{
+    int64_t     ns;                 //sim_agora_ns() da chamada
+    uint64_t    sequencia;          //número da chamada desde o boot
+    const char *funcao;
+    int32_t     arg[4];
+    esp_err_t   retorno;
+};
+
+struct sim_trace{
+    pthread_mutex_t    mutex;
+    struct sim_registro registros[SIM_REGISTROS];
+    uint64_t           total;
+};
+
+static inline struct sim_trace *sim_trace(void)
+{
+    static struct sim_trace trace = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+    return &trace;
+}
+
+//Registra a chamada e devolve o retorno, para os stubs terminarem com return sim_registra(...)
+static inline esp_err_t sim_registra(const char *funcao, int32_t a, int32_t b, int32_t c, int32_t d,
+                                     esp_err_t retorno)
+{
+    struct sim_trace *trace = sim_trace();
+    pthread_mutex_lock(&trace->mutex);
+    struct sim_registro *registro = &trace->registros[trace->total % SIM_REGISTROS];
+    registro->ns        = sim_agora_ns();
+    registro->sequencia = trace->total++;
+    registro->funcao    = funcao;
+    registro->arg[0]    = a;
+    registro->arg[1]    = b;
+    registro->arg[2]    = c;
+    registro->arg[3]    = d;
+    registro->retorno   = retorno;
+    pthread_mutex_unlock(&trace->mutex);
+    return retorno;
+}
+
+//Quantas chamadas foram registradas até agora, a marca para o sim_procura_registro
+static inline uint64_t sim_total_registros(void)
+{
+    struct sim_trace *trace = sim_trace();
+    pthread_mutex_lock(&trace->mutex);
+    uint64_t total = trace->total;
+    pthread_mutex_unlock(&trace->mutex);
+    return total;
+}
+
+//Procura a primeira chamada a 'funcao' a partir da marca 'desde' com os dois primeiros argumentos dados
+//(-1 aceita qualquer um). Retorna false se não houver ou se ela já foi sobrescrita
+static inline bool sim_procura_registro(const char *funcao, int32_t a, int32_t b, uint64_t desde,
+                                        struct sim_registro *achado)
+{
+    struct sim_trace *trace = sim_trace();
+    bool encontrou = false;
+    pthread_mutex_lock(&trace->mutex);
+    if (trace->total > SIM_REGISTROS && desde < trace->total - SIM_REGISTROS)
+        desde = trace->total - SIM_REGISTROS;
+    for (uint64_t s = desde; s < trace->total && !encontrou; s++) {
+        const struct sim_registro *registro = &trace->registros[s % SIM_REGISTROS];
+        if (strcmp(registro->funcao, funcao) == 0 && (a < 0 || registro->arg[0] == a) &&
+            (b < 0 || registro->arg[1] == b)) {
+            *achado = *registro;
+            encontrou = true;
+        }
+    }
+    pthread_mutex_unlock(&trace->mutex);
+    return encontrou;
+}
+
+//Conta as chamadas a 'funcao' a partir da marca 'desde'
+static inline int sim_conta_registros(const char *funcao, uint64_t desde)
+{
+    struct sim_trace *trace = sim_trace();
+    int quantidade = 0;
+    pthread_mutex_lock(&trace->mutex);
+    if (trace->total > SIM_REGISTROS && desde < trace->total - SIM_REGISTROS)
+        desde = trace->total - SIM_REGISTROS;
+    for (uint64_t s = desde; s < trace->total; s++) {
+        if (strcmp(trace->registros[s % SIM_REGISTROS].funcao, funcao) == 0)
+            quantidade++;
+    }
+    pthread_mutex_unlock(&trace->mutex);
+    return quantidade;
+}
+
+//Espera até 'prazo_ms' por uma chamada a 'funcao' depois da marca 'desde', como o sim_procura_registro
+static inline bool sim_espera_registro(const char *funcao, int32_t a, int32_t b, uint64_t desde, int prazo_ms,
+                                       struct sim_registro *achado)
+{
+    int64_t fim_ns = sim_agora_ns() + (int64_t)prazo_ms * 1000000;
+    while (!sim_procura_registro(funcao, a, b, desde, achado)) {
+        if (sim_agora_ns() > fim_ns)
+            return false;
+        sched_yield();
+    }
+    return true;
+}
+
+
+/*--------------------------------------------Heap contado----------------------------------------------------*/
+//O malloc da glibc é embrulhado para contar o que está em uso; esp_get_free_heap_size() é o total simulado
+//menos isso. Conta também o que a própria glibc aloca (o buffer do stdout, por exemplo), então os testes
+//comparam diferenças, nunca o valor absoluto. Com o AddressSanitizer o malloc é o dele e nada é contado
+struct sim_heap{
+    size_t em_uso;
+    size_t pico;
+    uint64_t alocacoes;
+};
+
+static inline struct sim_heap *sim_heap(void)
+{
+    static struct sim_heap heap;
+    return &heap;
+}
+
+static inline void sim_heap_conta(void *ponteiro, bool alocou)
+{
+    if (ponteiro == NULL)
+        return;
+    struct sim_heap *heap = sim_heap();
+    size_t tamanho = malloc_usable_size(ponteiro);
+    if (alocou) {
+        size_t em_uso = __atomic_add_fetch(&heap->em_uso, tamanho, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&heap->alocacoes, 1, __ATOMIC_RELAXED);
+        size_t pico = __atomic_load_n(&heap->pico, __ATOMIC_RELAXED);
+        while (em_uso > pico &&
+               !__atomic_compare_exchange_n(&heap->pico, &pico, em_uso, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            ;
+    } else {
+        __atomic_sub_fetch(&heap->em_uso, tamanho, __ATOMIC_RELAXED);
+    }
+}
+
+//Recomeça o pico do heap a partir do uso atual, para medir o pico de um trecho
+static inline void sim_heap_reinicia_pico(void)
+{
+    struct sim_heap *heap = sim_heap();
+    __atomic_store_n(&heap->pico, __atomic_load_n(&heap->em_uso, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+static inline size_t sim_heap_em_uso(void)
+{
+    return __atomic_load_n(&sim_heap()->em_uso, __ATOMIC_RELAXED);
+}
+
+static inline size_t sim_heap_pico(void)
+{
+    return __atomic_load_n(&sim_heap()->pico, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t sim_heap_alocacoes(void)
+{
+    return __atomic_load_n(&sim_heap()->alocacoes, __ATOMIC_RELAXED);
+}
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+extern void *__libc_malloc(size_t tamanho);
+extern void *__libc_calloc(size_t quantidade, size_t tamanho);
+extern void *__libc_realloc(void *ponteiro, size_t tamanho);
+extern void  __libc_free(void *ponteiro);
+
+void *malloc(size_t tamanho)
+{
+    void *ponteiro = __libc_malloc(tamanho);
+    sim_heap_conta(ponteiro, true);
+    return ponteiro;
+}
+
+void *calloc(size_t quantidade, size_t tamanho)
+{
+    void *ponteiro = __libc_calloc(quantidade, tamanho);
+    sim_heap_conta(ponteiro, true);
+    return ponteiro;
+}
+
+void *realloc(void *ponteiro, size_t tamanho)
+{
+    sim_heap_conta(ponteiro, false);
+    void *novo = __libc_realloc(ponteiro, tamanho);
+    sim_heap_conta(novo != NULL ? novo : (tamanho != 0 ? ponteiro : NULL), true);
+    return novo;
+}
+
+void free(void *ponteiro)
+{
+    sim_heap_conta(ponteiro, false);
+    __libc_free(ponteiro);
+}
+#endif
+
+#endif
@@ -0,0 +1,16 @@
+/*soc/gpio_periph.h da simulação: os registradores do IO_MUX são só números*/
+#ifndef SOC_GPIO_PERIPH_H
+#define SOC_GPIO_PERIPH_H
+
+#include "simulacao.h"
+
+//O endereço de cada registrador não importa aqui: fica o número do pino, que é o que aparece no registro
+static const uint32_t GPIO_PIN_MUX_REG[40] __attribute__((unused)) = {
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
+    20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39,
+};
+
+#define PIN_INPUT_ENABLE(registrador)   sim_registra("PIN_INPUT_ENABLE", (int32_t)(registrador), 0, 0, 0, ESP_OK)
+#define PIN_INPUT_DISABLE(registrador)  sim_registra("PIN_INPUT_DISABLE", (int32_t)(registrador), 0, 0, 0, ESP_OK)
+
+#endif
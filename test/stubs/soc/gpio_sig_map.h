@@ -0,0 +1,7 @@
+/*soc/gpio_sig_map.h da simulação: os sinais de periférico da matriz de GPIO que o firmware usa*/
+#ifndef SOC_GPIO_SIG_MAP_H
+#define SOC_GPIO_SIG_MAP_H
+
+#define PCNT_SIG_CH0_IN0_IDX    39
+
+#endif
@@ -0,0 +1,12 @@
+/*xtensa/hal.h da simulação: o contador de ciclos anda com o relógio, na frequência da CPU do sdkconfig*/
+#ifndef XTENSA_HAL_H
+#define XTENSA_HAL_H
+
+#include "simulacao.h"
+
+static inline unsigned xthal_get_ccount(void)
+{
+    return (unsigned)(sim_agora_ns() * SIM_CPU_MHZ / 1000);
+}
+
+#endif
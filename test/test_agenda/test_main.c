@@ -0,0 +1,134 @@
+/*Fila da agenda de comandos com hora marcada (src/agenda.c) no PC: a ordem por instante, a ordem de chegada
+entre comandos do mesmo instante, a agenda cheia e a retirada só do que já venceu.
+
+    pio test -e native -f test_agenda -v*/
+#include <string.h>
+
+#include <unity.h>
+
+#include "agenda.h"
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+//Comando para o instante, marcado pela máscara para conferir a ordem
+static struct comando_agendado comando(int64_t instante_us, uint32_t marca)
+{
+    struct comando_agendado c;
+    memset(&c, 0, sizeof(c));
+    c.instante_us = instante_us;
+    c.mascara     = marca;
+    return c;
+}
+
+
+static void test_agenda_vazia(void)
+{
+    struct agenda agenda = {.num_comandos = 0};
+    struct comando_agendado retirado;
+
+    TEST_ASSERT_EQUAL_INT64(INT64_MAX, agenda_proximo(&agenda));
+    TEST_ASSERT_FALSE(agenda_retira(&agenda, INT64_MAX, &retirado));
+}
+
+
+static void test_retira_em_ordem_de_instante(void)
+{
+    struct agenda agenda = {.num_comandos = 0};
+    struct comando_agendado retirado;
+    const int64_t instantes[] = {5000, 1000, 3000, 1000, 4000, 3000};
+
+    for (int i = 0; i < 6; i++) {
+        struct comando_agendado c = comando(instantes[i], i);
+        TEST_ASSERT_TRUE(agenda_insere(&agenda, &c));
+    }
+    TEST_ASSERT_EQUAL_INT64(1000, agenda_proximo(&agenda));
+
+    //os do mesmo instante saem na ordem em que chegaram
+    const uint32_t ordem[] = {1, 3, 2, 5, 4, 0};
+    for (int i = 0; i < 6; i++) {
+        TEST_ASSERT_TRUE(agenda_retira(&agenda, INT64_MAX, &retirado));
+        TEST_ASSERT_EQUAL_UINT32(ordem[i], retirado.mascara);
+    }
+    TEST_ASSERT_EQUAL_INT(0, agenda.num_comandos);
+}
+
+
+static void test_so_retira_o_que_venceu(void)
+{
+    struct agenda agenda = {.num_comandos = 0};
+    struct comando_agendado retirado;
+    struct comando_agendado primeiro = comando(2000, 1), segundo = comando(2500, 2);
+
+    agenda_insere(&agenda, &segundo);
+    agenda_insere(&agenda, &primeiro);
+
+    //a task pede com a antecedência: o limite é agora + AGENDA_ANTECEDENCIA_US
+    TEST_ASSERT_FALSE(agenda_retira(&agenda, 1999, &retirado));
+    TEST_ASSERT_TRUE(agenda_retira(&agenda, 2000, &retirado));
+    TEST_ASSERT_EQUAL_UINT32(1, retirado.mascara);
+    TEST_ASSERT_EQUAL_INT64(2500, agenda_proximo(&agenda));
+    TEST_ASSERT_FALSE(agenda_retira(&agenda, 2499, &retirado));
+    TEST_ASSERT_TRUE(agenda_retira(&agenda, 2500, &retirado));
+    TEST_ASSERT_EQUAL_UINT32(2, retirado.mascara);
+}
+
+
+static void test_agenda_cheia_recusa_sem_mexer_na_fila(void)
+{
+    struct agenda agenda = {.num_comandos = 0};
+    struct comando_agendado retirado;
+
+    for (int i = 0; i < AGENDA_TAMANHO; i++) {
+        struct comando_agendado c = comando(10000 - i, i);
+        TEST_ASSERT_TRUE(agenda_insere(&agenda, &c));
+    }
+
+    //um comando mais cedo que todos não passa na frente com a agenda cheia
+    struct comando_agendado urgente = comando(1, 99);
+    TEST_ASSERT_FALSE(agenda_insere(&agenda, &urgente));
+    TEST_ASSERT_EQUAL_INT(AGENDA_TAMANHO, agenda.num_comandos);
+    TEST_ASSERT_EQUAL_INT64(10000 - (AGENDA_TAMANHO - 1), agenda_proximo(&agenda));
+
+    //a vaga aberta volta a aceitar
+    TEST_ASSERT_TRUE(agenda_retira(&agenda, INT64_MAX, &retirado));
+    TEST_ASSERT_EQUAL_UINT32(AGENDA_TAMANHO - 1, retirado.mascara);
+    TEST_ASSERT_TRUE(agenda_insere(&agenda, &urgente));
+    TEST_ASSERT_EQUAL_INT64(1, agenda_proximo(&agenda));
+}
+
+
+static void test_comando_retirado_inteiro(void)
+{
+    struct agenda agenda = {.num_comandos = 0};
+    struct comando_agendado c = comando(100, 0x8001), retirado;
+
+    c.sincroniza = true;
+    c.canais[0]  = (struct parametros_pwm){.estado = true, .frequencia = 1000, .duty_fino = 12345, .fase = 777};
+    c.canais[15] = (struct parametros_pwm){.estado = true, .frequencia = 2000, .duty_fino = 65535, .gerador = 2};
+    agenda_insere(&agenda, &c);
+    TEST_ASSERT_TRUE(agenda_retira(&agenda, 100, &retirado));
+    TEST_ASSERT_EQUAL_UINT32(0x8001, retirado.mascara);
+    TEST_ASSERT_TRUE(retirado.sincroniza);
+    TEST_ASSERT_TRUE(parametros_iguais(&c.canais[0], &retirado.canais[0]));
+    TEST_ASSERT_TRUE(parametros_iguais(&c.canais[15], &retirado.canais[15]));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_agenda_vazia);
+    RUN_TEST(test_retira_em_ordem_de_instante);
+    RUN_TEST(test_so_retira_o_que_venceu);
+    RUN_TEST(test_agenda_cheia_recusa_sem_mexer_na_fila);
+    RUN_TEST(test_comando_retirado_inteiro);
+    return UNITY_END();
+}
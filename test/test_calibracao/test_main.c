@@ -0,0 +1,237 @@
+/*Contas da medição e da calibração (src/calibracao.c) no PC: a faixa de cada frequência, os pulsos de uma
+leitura do contador com um estouro que a interrupção ainda não contou, a reta pelas leituras, o erro em ppm,
+o duty pelas amostras do pino, a janela de amostragem e a média de cada faixa da tabela.
+
+    pio test -e native -f test_calibracao -v*/
+#include <string.h>
+
+#include <unity.h>
+
+#include "calibracao.h"
+
+#define LIMITE_PCNT             30000       //MEDICAO_LIMITE_PCNT do main.c
+#define NUM_AMOSTRAS            16          //MEDICAO_AMOSTRAS
+#define CLOCK_APB               80000000
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+//Leituras de um sinal de 'frequencia' Hz a cada 'intervalo_us', como o mede_canal: o contador zera a cada
+//LIMITE_PCNT pulsos e a interrupção conta o estouro. Com 'atrasa_isr', toda leitura logo depois de um estouro
+//pega o contador já zerado antes da interrupção rodar. Com 'corrige' as leituras passam pelo
+//calibracao_pulsos_contados, senão o total é só estouros * limite + contagem
+static void simula_leituras(uint32_t frequencia, int64_t intervalo_us, bool atrasa_isr, bool corrige,
+                            struct amostra_contagem *amostras)
+{
+    for (int a = 0; a < NUM_AMOSTRAS; a++) {
+        int64_t pulsos = (int64_t)frequencia * a * intervalo_us / 1000000;
+        uint32_t estouros = (uint32_t)(pulsos / LIMITE_PCNT);
+        int32_t contagem = (int32_t)(pulsos % LIMITE_PCNT);
+        if (atrasa_isr && a > 0 && estouros > (uint32_t)((int64_t)frequencia * (a - 1) * intervalo_us / 1000000 /
+                                                         LIMITE_PCNT))
+            estouros--;
+        amostras[a].instante_us = 1000000 + a * intervalo_us;
+        amostras[a].pulsos = corrige ? calibracao_pulsos_contados(estouros, contagem, LIMITE_PCNT,
+                                                                  (a > 0) ? amostras[a - 1].pulsos : -1)
+                                     : (int64_t)estouros * LIMITE_PCNT + contagem;
+    }
+}
+
+
+/*-----------------------------------------------Testes-------------------------------------------------------*/
+static void test_faixa_por_oitava(void)
+{
+    TEST_ASSERT_EQUAL_INT(-1, calibracao_faixa(0));
+    TEST_ASSERT_EQUAL_INT(0, calibracao_faixa(1));
+    TEST_ASSERT_EQUAL_INT(1, calibracao_faixa(2));
+    TEST_ASSERT_EQUAL_INT(1, calibracao_faixa(3));
+    TEST_ASSERT_EQUAL_INT(9, calibracao_faixa(1000));
+    TEST_ASSERT_EQUAL_INT(10, calibracao_faixa(1024));
+    TEST_ASSERT_EQUAL_INT(25, calibracao_faixa(40000000));
+    TEST_ASSERT_EQUAL_INT(CALIBRACAO_NUM_FAIXAS - 1, calibracao_faixa(UINT32_MAX));
+}
+
+static void test_pulsos_com_estouro_pendente(void)
+{
+    //sem estouro pendente o total é estouros * limite + contagem
+    TEST_ASSERT_EQUAL_INT64(100, calibracao_pulsos_contados(0, 100, LIMITE_PCNT, -1));
+    TEST_ASSERT_EQUAL_INT64(2 * LIMITE_PCNT + 7, calibracao_pulsos_contados(2, 7, LIMITE_PCNT, LIMITE_PCNT + 29990));
+
+    //o contador zerou e a interrupção não rodou: a contagem recomeçou com os estouros de antes
+    int64_t anterior = 2 * LIMITE_PCNT + 29950;
+    TEST_ASSERT_EQUAL_INT64(3 * LIMITE_PCNT + 50, calibracao_pulsos_contados(2, 50, LIMITE_PCNT, anterior));
+
+    //a leitura seguinte, com a interrupção já contada, dá o mesmo total sem correção
+    TEST_ASSERT_EQUAL_INT64(3 * LIMITE_PCNT + 50,
+                            calibracao_pulsos_contados(3, 50, LIMITE_PCNT, 3 * LIMITE_PCNT + 50));
+
+    //a primeira leitura da medição não tem anterior
+    TEST_ASSERT_EQUAL_INT64(0, calibracao_pulsos_contados(0, 0, LIMITE_PCNT, -1));
+}
+
+static void test_frequencia_pela_reta_das_leituras(void)
+{
+    struct amostra_contagem amostras[NUM_AMOSTRAS];
+
+    //100 kHz lido a cada 10 ms: a reta dá exatamente 100000000 mHz
+    simula_leituras(100000, 10000, false, true, amostras);
+    TEST_ASSERT_EQUAL_UINT64(100000000, calibracao_frequencia_medida_mhz(amostras, NUM_AMOSTRAS));
+
+    //±1 pulso de ruído em 1000 por intervalo mexe menos de 100 ppm na reta
+    for (int a = 0; a < NUM_AMOSTRAS; a++)
+        amostras[a].pulsos += (a & 1) ? 1 : -1;
+    TEST_ASSERT_UINT64_WITHIN(10000, 100000000, calibracao_frequencia_medida_mhz(amostras, NUM_AMOSTRAS));
+
+    //menos de 2 amostras ou todas no mesmo instante não dão uma reta
+    TEST_ASSERT_EQUAL_UINT64(0, calibracao_frequencia_medida_mhz(amostras, 1));
+    for (int a = 0; a < NUM_AMOSTRAS; a++)
+        amostras[a].instante_us = 5000;
+    TEST_ASSERT_EQUAL_UINT64(0, calibracao_frequencia_medida_mhz(amostras, NUM_AMOSTRAS));
+}
+
+static void test_estouro_pendente_nao_distorce_a_medida(void)
+{
+    struct amostra_contagem amostras[NUM_AMOSTRAS];
+
+    //100 kHz lido a cada 100 ms: 10000 pulsos por intervalo, um estouro a cada 3 leituras
+    simula_leituras(100000, 100000, false, false, amostras);
+    TEST_ASSERT_EQUAL_UINT64(100000000, calibracao_frequencia_medida_mhz(amostras, NUM_AMOSTRAS));
+
+    //com a interrupção sempre atrasada, as leituras depois de cada estouro ficam 30000 pulsos para trás
+    simula_leituras(100000, 100000, true, false, amostras);
+    TEST_ASSERT_NOT_EQUAL(100000000, calibracao_frequencia_medida_mhz(amostras, NUM_AMOSTRAS));
+
+    //a correção pela leitura anterior devolve os pulsos
+    simula_leituras(100000, 100000, true, true, amostras);
+    TEST_ASSERT_EQUAL_UINT64(100000000, calibracao_frequencia_medida_mhz(amostras, NUM_AMOSTRAS));
+    for (int a = 1; a < NUM_AMOSTRAS; a++)
+        TEST_ASSERT_EQUAL_INT64(10000, amostras[a].pulsos - amostras[a - 1].pulsos);
+
+    //a mesma coisa perto do limite: 29999 pulsos por intervalo, um estouro em quase toda leitura
+    simula_leituras(299990, 100000, true, true, amostras);
+    TEST_ASSERT_EQUAL_UINT64(299990000, calibracao_frequencia_medida_mhz(amostras, NUM_AMOSTRAS));
+}
+
+static void test_frequencia_do_timer(void)
+{
+    //divisor 1.0 (256 em 10.8) e 1 bit: 40 MHz
+    TEST_ASSERT_EQUAL_UINT64(40000000000ull, calibracao_frequencia_timer_mhz(CLOCK_APB, 256, 1));
+
+    //1 kHz com 14 bits: 80 MHz / (1000 * 16384) = divisor 4,8828125, 1250 em 10.8
+    TEST_ASSERT_EQUAL_UINT64(1000000, calibracao_frequencia_timer_mhz(CLOCK_APB, 1250, 14));
+
+    //arredonda para o mHz mais perto: 80 MHz / 3 = 26666666,667 Hz
+    TEST_ASSERT_EQUAL_UINT64(26666666667ull, calibracao_frequencia_timer_mhz(CLOCK_APB, 3 * 256, 0));
+    TEST_ASSERT_EQUAL_UINT64(0, calibracao_frequencia_timer_mhz(CLOCK_APB, 0, 10));
+}
+
+static void test_erro_em_ppm(void)
+{
+    TEST_ASSERT_EQUAL_INT32(100, calibracao_erro_ppm(1000100, 1000000));
+    TEST_ASSERT_EQUAL_INT32(-100, calibracao_erro_ppm(999900, 1000000));
+    TEST_ASSERT_EQUAL_INT32(0, calibracao_erro_ppm(1000000, 1000000));
+
+    //arredonda para o ppm mais perto, nos dois sentidos
+    TEST_ASSERT_EQUAL_INT32(1, calibracao_erro_ppm(2000001, 2000000));          //0,5 ppm
+    TEST_ASSERT_EQUAL_INT32(-1, calibracao_erro_ppm(1999999, 2000000));
+    TEST_ASSERT_EQUAL_INT32(0, calibracao_erro_ppm(3000001, 3000000));          //0,33 ppm
+
+    //referência zero não tem erro, e o erro satura no int32
+    TEST_ASSERT_EQUAL_INT32(0, calibracao_erro_ppm(1000, 0));
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, calibracao_erro_ppm(40000000000ull, 1));
+}
+
+static void test_duty_pelas_amostras_do_pino(void)
+{
+    TEST_ASSERT_EQUAL_INT32(-1, calibracao_duty_medido(0, 0));
+    TEST_ASSERT_EQUAL_INT32(-1, calibracao_duty_medido(5, 4));
+    TEST_ASSERT_EQUAL_INT32(0, calibracao_duty_medido(0, 1000));
+    TEST_ASSERT_EQUAL_INT32(65535, calibracao_duty_medido(1000, 1000));
+    TEST_ASSERT_EQUAL_INT32(32768, calibracao_duty_medido(1, 2));
+    TEST_ASSERT_EQUAL_INT32(16384, calibracao_duty_medido(250, 1000));
+}
+
+static void test_janela_com_periodos_inteiros(void)
+{
+    //1 kHz numa janela de 20 ms: 20 períodos de 240000 ciclos a 240 MHz
+    TEST_ASSERT_EQUAL_UINT32(20 * 240000, calibracao_ciclos_janela_duty(1000000, 20000, 240));
+
+    //3 kHz: 60 períodos, arredondados só no fim
+    TEST_ASSERT_EQUAL_UINT32(4800000, calibracao_ciclos_janela_duty(3000000, 20000, 240));
+
+    //7 Hz não tem nem um período em 20 ms, e sem frequência não há janela
+    TEST_ASSERT_EQUAL_UINT32(0, calibracao_ciclos_janela_duty(7000, 20000, 240));
+    TEST_ASSERT_EQUAL_UINT32(0, calibracao_ciclos_janela_duty(0, 20000, 240));
+}
+
+static void test_media_da_faixa(void)
+{
+    struct tabela_calibracao tabela;
+    memset(&tabela, 0, sizeof(tabela));
+    int faixa = calibracao_faixa(1000);
+
+    TEST_ASSERT_TRUE(calibracao_registra(&tabela, 1000, 100));
+    TEST_ASSERT_EQUAL_INT32(100, tabela.faixas[faixa].desvio_ppm);
+    TEST_ASSERT_EQUAL_UINT32(1, tabela.faixas[faixa].medidas);
+
+    TEST_ASSERT_TRUE(calibracao_registra(&tabela, 1023, 200));                  //mesma oitava
+    TEST_ASSERT_EQUAL_INT32(150, tabela.faixas[faixa].desvio_ppm);
+    TEST_ASSERT_EQUAL_UINT32(2, tabela.faixas[faixa].medidas);
+
+    //desvio implausível ou frequência sem faixa não alteram a tabela
+    TEST_ASSERT_FALSE(calibracao_registra(&tabela, 1000, CALIBRACAO_DESVIO_MAXIMO_PPM + 1));
+    TEST_ASSERT_FALSE(calibracao_registra(&tabela, 1000, -CALIBRACAO_DESVIO_MAXIMO_PPM - 1));
+    TEST_ASSERT_FALSE(calibracao_registra(&tabela, 0, 10));
+    TEST_ASSERT_EQUAL_INT32(150, tabela.faixas[faixa].desvio_ppm);
+    TEST_ASSERT_EQUAL_UINT32(2, tabela.faixas[faixa].medidas);
+
+    //depois de CALIBRACAO_PESO_MAXIMO medidas, cada medida nova ainda move a média 1/8 da diferença
+    memset(&tabela, 0, sizeof(tabela));
+    for (int m = 0; m < 20; m++)
+        calibracao_registra(&tabela, 1000, 0);
+    TEST_ASSERT_TRUE(calibracao_registra(&tabela, 1000, 800));
+    TEST_ASSERT_EQUAL_INT32(800 / CALIBRACAO_PESO_MAXIMO, tabela.faixas[faixa].desvio_ppm);
+    TEST_ASSERT_EQUAL_UINT32(21, tabela.faixas[faixa].medidas);
+}
+
+static void test_clock_corrigido_pela_faixa(void)
+{
+    struct tabela_calibracao tabela;
+    memset(&tabela, 0, sizeof(tabela));
+
+    //faixa sem medidas usa o clock nominal
+    TEST_ASSERT_EQUAL_UINT32(CLOCK_APB, calibracao_clock_efetivo(&tabela, 1000, CLOCK_APB));
+
+    //a saída ficou 100 ppm acima: o clock efetivo é 100 ppm maior, só naquela faixa
+    calibracao_registra(&tabela, 1000, 100);
+    TEST_ASSERT_EQUAL_UINT32(CLOCK_APB + 8000, calibracao_clock_efetivo(&tabela, 1000, CLOCK_APB));
+    TEST_ASSERT_EQUAL_UINT32(CLOCK_APB, calibracao_clock_efetivo(&tabela, 2000, CLOCK_APB));
+
+    calibracao_registra(&tabela, 2000, -250);
+    TEST_ASSERT_EQUAL_UINT32(CLOCK_APB - 20000, calibracao_clock_efetivo(&tabela, 2000, CLOCK_APB));
+    TEST_ASSERT_EQUAL_UINT32(CLOCK_APB, calibracao_clock_efetivo(&tabela, 0, CLOCK_APB));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_faixa_por_oitava);
+    RUN_TEST(test_pulsos_com_estouro_pendente);
+    RUN_TEST(test_frequencia_pela_reta_das_leituras);
+    RUN_TEST(test_estouro_pendente_nao_distorce_a_medida);
+    RUN_TEST(test_frequencia_do_timer);
+    RUN_TEST(test_erro_em_ppm);
+    RUN_TEST(test_duty_pelas_amostras_do_pino);
+    RUN_TEST(test_janela_com_periodos_inteiros);
+    RUN_TEST(test_media_da_faixa);
+    RUN_TEST(test_clock_corrigido_pela_faixa);
+    return UNITY_END();
+}
@@ -0,0 +1,145 @@
+/*Canais salvos na NVS e gravações por minuto (src/config_salva.c) no PC: a ida e a volta de todos os campos,
+o estado no bit de cima da frequência, um canal salvo que a API não aceitaria, a comparação sem padding que
+evita gravar o que já está salvo e a conta das gravações da última hora.
+
+    pio test -e native -f test_config_salva -v*/
+#include <string.h>
+
+#include <unity.h>
+
+#include "config_salva.h"
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+static bool aceita_tudo(const struct parametros_pwm *parametros)
+{
+    return true;
+}
+
+//Como o parametros_validos para o LEDC: duty e fase até 65535 e frequência até 40 MHz
+static bool como_a_api(const struct parametros_pwm *parametros)
+{
+    return parametros->frequencia >= 1 && parametros->frequencia <= 40000000 && parametros->gerador < 3;
+}
+
+
+static void test_ida_e_volta_de_todos_os_campos(void)
+{
+    struct parametros_pwm canais[NUM_CANAIS_PWM], lidos[NUM_CANAIS_PWM];
+    struct canal_salvo salvos[NUM_CANAIS_PWM];
+
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        canais[i] = (struct parametros_pwm){
+            .estado = (i % 2) != 0, .frequencia = 1 + i * 2500000, .duty_fino = 65535 - i, .fase = i * 4000,
+            .gerador = i % 3, .tempo_morto_ns = i * 100, .pulsos = i * 4, .complementar = (i % 4) == 1,
+        };
+    }
+    canais[15].frequencia = 40000000;       //a maior, ligada: o bit do estado não se mistura com ela
+    canais[15].estado     = true;
+
+    config_salva_empacota(canais, salvos);
+    TEST_ASSERT_EQUAL_HEX32(40000000u | CANAL_SALVO_BIT_ESTADO, salvos[15].frequencia_estado);
+    TEST_ASSERT_EQUAL_HEX32(1, salvos[0].frequencia_estado);
+
+    TEST_ASSERT_TRUE(config_salva_desempacota(salvos, lidos, aceita_tudo));
+    for (int i = 0; i < NUM_CANAIS_PWM; i++)
+        TEST_ASSERT_TRUE_MESSAGE(parametros_iguais(&canais[i], &lidos[i]), "canal diferente depois da volta");
+}
+
+
+static void test_canal_que_a_api_nao_aceitaria(void)
+{
+    struct parametros_pwm lidos[NUM_CANAIS_PWM];
+    struct canal_salvo salvos[NUM_CANAIS_PWM];
+
+    memset(salvos, 0, sizeof(salvos));
+    for (int i = 0; i < NUM_CANAIS_PWM; i++)
+        salvos[i].frequencia_estado = 1000;
+    TEST_ASSERT_TRUE(config_salva_desempacota(salvos, lidos, como_a_api));
+
+    //um gerador que não existe e uma frequência zerada, mesmo com o CRC certo
+    salvos[3].gerador = 7;
+    TEST_ASSERT_FALSE(config_salva_desempacota(salvos, lidos, como_a_api));
+    salvos[3].gerador = 0;
+    salvos[9].frequencia_estado = CANAL_SALVO_BIT_ESTADO;
+    TEST_ASSERT_FALSE(config_salva_desempacota(salvos, lidos, como_a_api));
+    TEST_ASSERT_TRUE(lidos[9].estado);
+    TEST_ASSERT_EQUAL_INT(0, lidos[9].frequencia);
+
+    //um tempo morto que não cabe no int é limitado, não vira negativo
+    salvos[9].frequencia_estado = 1000;
+    salvos[2].tempo_morto_ns    = 0xFFFFFFFFu;
+    config_salva_desempacota(salvos, lidos, aceita_tudo);
+    TEST_ASSERT_EQUAL_INT(INT32_MAX, lidos[2].tempo_morto_ns);
+}
+
+
+static void test_comparacao_sem_padding(void)
+{
+    struct parametros_pwm a[NUM_CANAIS_PWM], b[NUM_CANAIS_PWM];
+    struct canal_salvo salvos_a[NUM_CANAIS_PWM], salvos_b[NUM_CANAIS_PWM];
+
+    //a mesma configuração com lixo diferente no padding do struct parametros_pwm
+    memset(a, 0x55, sizeof(a));
+    memset(b, 0xAA, sizeof(b));
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        a[i] = (struct parametros_pwm){.estado = true, .frequencia = 1000 + i, .duty_fino = 100, .complementar = false};
+        b[i].estado = a[i].estado; b[i].frequencia = a[i].frequencia; b[i].duty_fino = a[i].duty_fino; b[i].fase = a[i].fase;
+        b[i].gerador = a[i].gerador; b[i].tempo_morto_ns = a[i].tempo_morto_ns; b[i].pulsos = a[i].pulsos;
+        b[i].complementar = a[i].complementar;
+    }
+    config_salva_empacota(a, salvos_a);
+    config_salva_empacota(b, salvos_b);
+    TEST_ASSERT_EQUAL_MEMORY(salvos_a, salvos_b, sizeof(salvos_a));
+
+    //e uma mudança em qualquer canal aparece
+    b[12].duty_fino++;
+    config_salva_empacota(b, salvos_b);
+    TEST_ASSERT_TRUE(memcmp(salvos_a, salvos_b, sizeof(salvos_a)) != 0);
+}
+
+
+static void test_gravacoes_da_ultima_hora(void)
+{
+    struct gravacoes_por_minuto gravacoes;
+    memset(&gravacoes, 0, sizeof(gravacoes));
+
+    TEST_ASSERT_EQUAL_UINT32(0, config_salva_gravacoes_ultima_hora(&gravacoes, 0));
+
+    //uma gravação por minuto durante 90 minutos: só as 60 últimas contam
+    for (uint32_t minuto = 0; minuto < 90; minuto++)
+        config_salva_conta_gravacao(&gravacoes, minuto);
+    TEST_ASSERT_EQUAL_UINT32(60, config_salva_gravacoes_ultima_hora(&gravacoes, 89));
+
+    //três no mesmo minuto
+    config_salva_conta_gravacao(&gravacoes, 89);
+    config_salva_conta_gravacao(&gravacoes, 89);
+    TEST_ASSERT_EQUAL_UINT32(62, config_salva_gravacoes_ultima_hora(&gravacoes, 89));
+
+    //meia hora sem gravar: as de mais de uma hora atrás saem da conta mesmo sem o contador ser zerado
+    TEST_ASSERT_EQUAL_UINT32(32, config_salva_gravacoes_ultima_hora(&gravacoes, 119));
+    TEST_ASSERT_EQUAL_UINT32(0, config_salva_gravacoes_ultima_hora(&gravacoes, 149));
+
+    //o contador de um minuto que voltou depois de uma hora recomeça do zero
+    config_salva_conta_gravacao(&gravacoes, 149);
+    TEST_ASSERT_EQUAL_UINT32(1, config_salva_gravacoes_ultima_hora(&gravacoes, 149));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ida_e_volta_de_todos_os_campos);
+    RUN_TEST(test_canal_que_a_api_nao_aceitaria);
+    RUN_TEST(test_comparacao_sem_padding);
+    RUN_TEST(test_gravacoes_da_ultima_hora);
+    return UNITY_END();
+}
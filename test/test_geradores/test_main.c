@@ -0,0 +1,336 @@
+/*Contas do MCPWM e do RMT (src/geradores.c) no PC: os limites do prescaler, do período e do tempo morto do
+MCPWM, a divisão das metades do RMT acima de 32767 ticks e as rajadas no limite de 63 itens, a posição do
+marcador de fim nos itens montados e a conferência dos recursos (o pino do vizinho de uma saída complementar
+e os timers do LEDC divididos entre os canais de um grupo).
+
+    pio test -e native -f test_geradores -v*/
+#include <string.h>
+
+#include <unity.h>
+
+#include "geradores.h"
+
+#define CANAIS_POR_GRUPO        8           //NUM_CANAIS_POR_MODO do main.c
+#define TIMERS_POR_GRUPO        4           //NUM_TIMERS_POR_MODO
+#define NUM_CANAIS              16
+#define NIVEL_ALTO              (1u << 15)
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+//Erro em ppm de clock / divisao em relação à frequência pedida, em double
+static double erro_ppm_double(double clock, double divisao, uint32_t frequencia)
+{
+    return (clock / divisao - frequencia) * 1e6 / frequencia;
+}
+
+//Canais desligados, todos no LEDC
+static void canais_desligados(struct canal_gerador *canais)
+{
+    memset(canais, 0, sizeof(*canais) * NUM_CANAIS);
+}
+
+static void liga(struct canal_gerador *canais, int i, enum gerador gerador, uint32_t frequencia)
+{
+    canais[i].ligado     = true;
+    canais[i].gerador    = (uint8_t)gerador;
+    canais[i].frequencia = frequencia;
+}
+
+
+/*-----------------------------------------------Testes-------------------------------------------------------*/
+static void test_mcpwm_limites_do_prescaler_e_do_periodo(void)
+{
+    struct config_mcpwm config;
+
+    //abaixo de 80 MHz / (256 * 65535) = 4,77 Hz o período não cabe nem com o maior prescaler
+    TEST_ASSERT_FALSE(gerador_calcula_mcpwm(4, 32768, 0, &config));
+    TEST_ASSERT_TRUE(gerador_calcula_mcpwm(5, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(245, config.prescaler);
+    TEST_ASSERT_EQUAL_UINT32(65306, config.periodo);
+
+    //80 MHz / 65535 = 1220,7 Hz: a primeira frequência que cabe com o prescaler 1
+    TEST_ASSERT_TRUE(gerador_calcula_mcpwm(1220, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(2, config.prescaler);
+    TEST_ASSERT_EQUAL_UINT32(32786, config.periodo);
+    TEST_ASSERT_TRUE(gerador_calcula_mcpwm(1221, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(1, config.prescaler);
+    TEST_ASSERT_EQUAL_UINT32(65520, config.periodo);
+
+    //40 MHz é o período mínimo de 2 ticks
+    TEST_ASSERT_TRUE(gerador_calcula_mcpwm(40000000, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(1, config.prescaler);
+    TEST_ASSERT_EQUAL_UINT32(2, config.periodo);
+    TEST_ASSERT_EQUAL_UINT32(1, config.comparador);
+    TEST_ASSERT_EQUAL_UINT64(40000000000ULL, config.frequencia_mhz);
+    TEST_ASSERT_EQUAL_INT32(0, config.erro_ppm);
+    TEST_ASSERT_FALSE(gerador_calcula_mcpwm(40000001, 32768, 0, &config));
+    TEST_ASSERT_FALSE(gerador_calcula_mcpwm(0, 32768, 0, &config));
+}
+
+static void test_mcpwm_comparador_nos_extremos_do_duty(void)
+{
+    struct config_mcpwm config;
+
+    TEST_ASSERT_TRUE(gerador_calcula_mcpwm(1000, 0, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(0, config.comparador);
+    TEST_ASSERT_TRUE(gerador_calcula_mcpwm(1000, 65535, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(config.periodo, config.comparador);
+    TEST_ASSERT_TRUE(gerador_calcula_mcpwm(1000, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(config.periodo / 2, config.comparador);
+}
+
+static void test_mcpwm_tempo_morto_no_limite_do_registrador(void)
+{
+    struct config_mcpwm config;
+
+    //12,5 ns por tick do clock do grupo, arredondado
+    TEST_ASSERT_TRUE(gerador_calcula_mcpwm(1000, 32768, 6, &config));
+    TEST_ASSERT_EQUAL_UINT32(0, config.tempo_morto);
+    TEST_ASSERT_TRUE(gerador_calcula_mcpwm(1000, 32768, 7, &config));
+    TEST_ASSERT_EQUAL_UINT32(1, config.tempo_morto);
+
+    //65535 ticks é o maior que cabe: 819193 ns arredonda para ele, 819194 ns já passa
+    TEST_ASSERT_TRUE(gerador_calcula_mcpwm(1000, 32768, 819193, &config));
+    TEST_ASSERT_EQUAL_UINT32(GERADOR_MCPWM_TEMPO_MORTO_MAXIMO, config.tempo_morto);
+    TEST_ASSERT_FALSE(gerador_calcula_mcpwm(1000, 32768, 819194, &config));
+    TEST_ASSERT_FALSE(gerador_calcula_mcpwm(1000, 32768, UINT32_MAX, &config));
+}
+
+static void test_mcpwm_erro_ppm_da_frequencia_gerada(void)
+{
+    struct config_mcpwm config;
+
+    for (uint32_t frequencia = 5; frequencia <= 40000000; frequencia += 1 + frequencia / 97) {
+        TEST_ASSERT_TRUE(gerador_calcula_mcpwm(frequencia, 32768, 0, &config));
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(GERADOR_MCPWM_PRESCALER_MAXIMO, config.prescaler);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(GERADOR_MCPWM_PERIODO_MAXIMO, config.periodo);
+        double erro = erro_ppm_double(GERADOR_MCPWM_CLOCK_HZ, (double)config.prescaler * config.periodo, frequencia);
+        TEST_ASSERT_INT_WITHIN(1, (int32_t)erro, config.erro_ppm);
+    }
+}
+
+static void test_rmt_metades_acima_de_32767_ticks(void)
+{
+    struct config_rmt config;
+
+    //1 kHz com o divisor 1: 80000 ticks, cada nível em duas metades
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(1000, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(1, config.divisor);
+    TEST_ASSERT_EQUAL_UINT32(40001, config.ticks_alto);
+    TEST_ASSERT_EQUAL_UINT32(39999, config.ticks_baixo);
+    TEST_ASSERT_EQUAL_UINT32(2, config.itens);
+
+    //20 Hz ainda cabe no divisor 1 (62 itens); 19 Hz passaria de 63 e vai para o divisor 2
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(20, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(1, config.divisor);
+    TEST_ASSERT_EQUAL_UINT32(62, config.itens);
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(19, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(2, config.divisor);
+    TEST_ASSERT_EQUAL_UINT32(33, config.itens);
+
+    //1 Hz precisa do divisor 20
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(1, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(20, config.divisor);
+    TEST_ASSERT_EQUAL_UINT32(62, config.itens);
+    TEST_ASSERT_EQUAL_UINT64(1000, config.frequencia_mhz);
+    TEST_ASSERT_EQUAL_INT32(0, config.erro_ppm);
+
+    //40 MHz: um tick em cada nível; acima disso não há 2 ticks por período
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(40000000, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_UINT32(1, config.ticks_alto);
+    TEST_ASSERT_EQUAL_UINT32(1, config.ticks_baixo);
+    TEST_ASSERT_FALSE(gerador_calcula_rmt(40000001, 32768, 0, &config));
+}
+
+static void test_rmt_rajadas_no_limite_de_63_itens(void)
+{
+    struct config_rmt config;
+
+    //um item por pulso: 63 pulsos enchem o bloco, 64 não cabem
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(1000000, 32768, GERADOR_RMT_PULSOS_MAXIMOS, &config));
+    TEST_ASSERT_EQUAL_UINT32(1, config.divisor);
+    TEST_ASSERT_EQUAL_UINT32(GERADOR_RMT_ITENS_MAXIMOS, config.itens);
+    TEST_ASSERT_FALSE(gerador_calcula_rmt(1000000, 32768, GERADOR_RMT_PULSOS_MAXIMOS + 1, &config));
+
+    //63 pulsos de 1 kHz: com o divisor 1 cada pulso usa dois itens, com o 2 volta a um
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(1000, 32768, 63, &config));
+    TEST_ASSERT_EQUAL_UINT32(2, config.divisor);
+    TEST_ASSERT_EQUAL_UINT32(63, config.itens);
+
+    //63 pulsos de 1 Hz não cabem nem com o divisor 255
+    TEST_ASSERT_FALSE(gerador_calcula_rmt(1, 32768, 63, &config));
+}
+
+static void test_rmt_erro_ppm_da_frequencia_gerada(void)
+{
+    struct config_rmt config;
+
+    for (uint32_t frequencia = 1; frequencia <= 40000000; frequencia += 1 + frequencia / 97) {
+        TEST_ASSERT_TRUE(gerador_calcula_rmt(frequencia, 32768, 0, &config));
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(GERADOR_RMT_ITENS_MAXIMOS, config.itens);
+        double ticks = (double)config.ticks_alto + config.ticks_baixo;
+        double erro = erro_ppm_double(GERADOR_RMT_CLOCK_HZ, config.divisor * ticks, frequencia);
+        TEST_ASSERT_INT_WITHIN(1, (int32_t)erro, config.erro_ppm);
+    }
+}
+
+static void test_itens_rmt_e_marcador_de_fim(void)
+{
+    struct config_rmt config;
+    uint32_t itens[GERADOR_RMT_ITENS_MAXIMOS + 1];
+
+    //4 metades: alto em 32767 + 7234, baixo em 32767 + 7232, nenhuma metade livre para o fim
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(1000, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_INT(2, gerador_monta_itens_rmt(&config, 0, itens, GERADOR_RMT_ITENS_MAXIMOS));
+    TEST_ASSERT_EQUAL_HEX32(32767 | NIVEL_ALTO | (7234 | NIVEL_ALTO) << 16, itens[0]);
+    TEST_ASSERT_EQUAL_HEX32(32767 | 7232u << 16, itens[1]);
+
+    //duty 0: só o nível baixo, em 3 metades; a segunda metade do último item fica zerada e marca o fim
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(1000, 0, 0, &config));
+    itens[1] = 0xFFFFFFFF;
+    TEST_ASSERT_EQUAL_INT(2, gerador_monta_itens_rmt(&config, 0, itens, GERADOR_RMT_ITENS_MAXIMOS));
+    TEST_ASSERT_EQUAL_HEX32(32767 | 32767u << 16, itens[0]);
+    TEST_ASSERT_EQUAL_HEX32(80000 - 2 * 32767, itens[1]);
+
+    //40 MHz: um item por pulso, alto primeiro
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(40000000, 32768, 3, &config));
+    TEST_ASSERT_EQUAL_INT(3, gerador_monta_itens_rmt(&config, 3, itens, GERADOR_RMT_ITENS_MAXIMOS));
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL_HEX32(1 | NIVEL_ALTO | 1u << 16, itens[i]);
+}
+
+static void test_itens_rmt_iguais_a_conta(void)
+{
+    struct config_rmt config;
+    uint32_t itens[GERADOR_RMT_ITENS_MAXIMOS];
+    static const uint32_t frequencias[] = {1, 7, 19, 20, 1000, 1221, 100000, 40000000};
+    static const uint32_t duties[]      = {0, 1, 32768, 65534, 65535};
+    static const uint32_t pulsos[]      = {0, 1, 2, 31, 63};
+
+    for (size_t f = 0; f < sizeof(frequencias) / sizeof(frequencias[0]); f++)
+        for (size_t d = 0; d < sizeof(duties) / sizeof(duties[0]); d++)
+            for (size_t p = 0; p < sizeof(pulsos) / sizeof(pulsos[0]); p++) {
+                if (!gerador_calcula_rmt(frequencias[f], duties[d], pulsos[p], &config))
+                    continue;
+                TEST_ASSERT_EQUAL_INT((int)config.itens,
+                                      gerador_monta_itens_rmt(&config, pulsos[p], itens, GERADOR_RMT_ITENS_MAXIMOS));
+            }
+
+    //um item a menos que o necessário não é escrito
+    TEST_ASSERT_TRUE(gerador_calcula_rmt(1000, 32768, 0, &config));
+    TEST_ASSERT_EQUAL_INT(-1, gerador_monta_itens_rmt(&config, 0, itens, 1));
+}
+
+static void test_complementar_precisa_do_vizinho_desligado(void)
+{
+    struct canal_gerador canais[NUM_CANAIS];
+
+    canais_desligados(canais);
+    liga(canais, 0, GERADOR_MCPWM, 1000);
+    canais[0].complementar = true;
+    TEST_ASSERT_TRUE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+
+    liga(canais, 1, GERADOR_LEDC, 1000);
+    TEST_ASSERT_FALSE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+
+    //o vizinho do canal ímpar é o par de baixo
+    canais_desligados(canais);
+    liga(canais, 2, GERADOR_LEDC, 1000);
+    liga(canais, 3, GERADOR_MCPWM, 1000);
+    canais[3].complementar = true;
+    TEST_ASSERT_FALSE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+    canais[2].ligado = false;
+    TEST_ASSERT_TRUE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+
+    //o último canal de uma quantidade ímpar não tem vizinho
+    canais_desligados(canais);
+    liga(canais, 2, GERADOR_MCPWM, 1000);
+    canais[2].complementar = true;
+    TEST_ASSERT_FALSE(gerador_config_cabe(canais, 3, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+
+    //complementar só vale no MCPWM
+    canais_desligados(canais);
+    liga(canais, 0, GERADOR_LEDC, 1000);
+    liga(canais, 1, GERADOR_LEDC, 1000);
+    canais[0].complementar = true;
+    TEST_ASSERT_TRUE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+}
+
+static void test_timers_do_ledc_divididos_no_grupo(void)
+{
+    struct canal_gerador canais[NUM_CANAIS];
+
+    //os 8 canais do grupo com 4 frequências: um timer para cada
+    canais_desligados(canais);
+    for (int i = 0; i < CANAIS_POR_GRUPO; i++)
+        liga(canais, i, GERADOR_LEDC, 1000 * (1 + i % TIMERS_POR_GRUPO));
+    TEST_ASSERT_TRUE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+
+    //a quinta frequência no mesmo grupo não tem timer
+    canais[7].frequencia = 5000;
+    TEST_ASSERT_FALSE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+
+    //desligado ou em outro gerador, o canal não ocupa timer do LEDC
+    canais[7].ligado = false;
+    TEST_ASSERT_TRUE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+    canais[7].ligado  = true;
+    canais[7].gerador = GERADOR_RMT;
+    TEST_ASSERT_TRUE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+
+    //o outro grupo tem os seus 4 timers, mesmo com frequências diferentes das do primeiro
+    for (int i = CANAIS_POR_GRUPO; i < NUM_CANAIS; i++)
+        liga(canais, i, GERADOR_LEDC, 10000 * (1 + i % TIMERS_POR_GRUPO));
+    TEST_ASSERT_TRUE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+    canais[NUM_CANAIS - 1].frequencia = 50000;
+    TEST_ASSERT_FALSE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+}
+
+static void test_operadores_do_mcpwm_e_canais_do_rmt(void)
+{
+    struct canal_gerador canais[NUM_CANAIS];
+
+    canais_desligados(canais);
+    for (int i = 0; i < GERADOR_MCPWM_OPERADORES; i++)
+        liga(canais, i, GERADOR_MCPWM, 1000 + i);
+    TEST_ASSERT_TRUE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+    liga(canais, GERADOR_MCPWM_OPERADORES, GERADOR_MCPWM, 1000);
+    TEST_ASSERT_FALSE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+
+    canais_desligados(canais);
+    for (int i = 0; i < GERADOR_RMT_CANAIS; i++)
+        liga(canais, i, GERADOR_RMT, 1000 + i);
+    TEST_ASSERT_TRUE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+    liga(canais, GERADOR_RMT_CANAIS, GERADOR_RMT, 1000);
+    TEST_ASSERT_FALSE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+
+    canais_desligados(canais);
+    liga(canais, 0, NUM_GERADORES, 1000);
+    TEST_ASSERT_FALSE(gerador_config_cabe(canais, NUM_CANAIS, CANAIS_POR_GRUPO, TIMERS_POR_GRUPO));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_mcpwm_limites_do_prescaler_e_do_periodo);
+    RUN_TEST(test_mcpwm_comparador_nos_extremos_do_duty);
+    RUN_TEST(test_mcpwm_tempo_morto_no_limite_do_registrador);
+    RUN_TEST(test_mcpwm_erro_ppm_da_frequencia_gerada);
+    RUN_TEST(test_rmt_metades_acima_de_32767_ticks);
+    RUN_TEST(test_rmt_rajadas_no_limite_de_63_itens);
+    RUN_TEST(test_rmt_erro_ppm_da_frequencia_gerada);
+    RUN_TEST(test_itens_rmt_e_marcador_de_fim);
+    RUN_TEST(test_itens_rmt_iguais_a_conta);
+    RUN_TEST(test_complementar_precisa_do_vizinho_desligado);
+    RUN_TEST(test_timers_do_ledc_divididos_no_grupo);
+    RUN_TEST(test_operadores_do_mcpwm_e_canais_do_rmt);
+    return UNITY_END();
+}
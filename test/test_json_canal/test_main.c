@@ -0,0 +1,153 @@
+/*JSON do estado dos canais (src/json_canal.c) no PC: o JSON de um canal com o pedido e o aplicado, e a
+mensagem do /ws, que leva só os canais que mudaram desde o último envio (todos para um assinante novo) e não
+sai quando nada mudou. A mensagem com os 16 canais no pior caso precisa caber no buffer da task.
+
+    pio test -e native -f test_json_canal -v*/
+#include <string.h>
+
+#include <unity.h>
+
+#include "json_canal.h"
+#include "geradores.h"
+
+
+static const int pinos[NUM_CANAIS_PWM] = {
+    2, 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 21, 22, 23, 25, 26,
+};
+
+static struct parametros_pwm pedido[NUM_CANAIS_PWM], pedido_enviado[NUM_CANAIS_PWM];
+static struct pwm_aplicado   aplicado[NUM_CANAIS_PWM], aplicado_enviado[NUM_CANAIS_PWM];
+static char mensagem[JSON_MENSAGEM_WS_TAMANHO];
+
+
+void setUp(void)
+{
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        pedido[i]   = (struct parametros_pwm){.estado = true, .frequencia = 1000 + i, .duty_fino = 32768};
+        aplicado[i] = (struct pwm_aplicado){.estado = true, .frequencia = 1000 + i, .resolucao_duty = 16,
+                                            .duty = 32768, .timer = (int8_t)(i % 4)};
+    }
+    memset(pedido_enviado, 0, sizeof(pedido_enviado));
+    memset(aplicado_enviado, 0, sizeof(aplicado_enviado));
+}
+
+void tearDown(void)
+{
+}
+
+
+//Quantos canais a mensagem leva
+static int conta_canais(const char *texto)
+{
+    int canais = 0;
+    for (const char *p = texto; (p = strstr(p, "\"canal\":")) != NULL; p++)
+        canais++;
+    return canais;
+}
+
+
+static void test_json_de_um_canal(void)
+{
+    char json[JSON_CANAL_TAMANHO];
+    struct parametros_pwm p = {.estado = true, .frequencia = 20000, .duty_fino = 16384, .fase = 100,
+                               .gerador = GERADOR_MCPWM, .tempo_morto_ns = 500, .complementar = true};
+    struct pwm_aplicado a = {.estado = true, .frequencia = 20000, .resolucao_duty = 0, .duty = 2000,
+                             .hpoint = 12, .erro_ppm = -3, .timer = 1, .gerador = GERADOR_MCPWM};
+
+    int tamanho = json_canal_formata(json, sizeof(json), 6, 27, &p, &a);
+    TEST_ASSERT_EQUAL_size_t(strlen(json), (size_t)tamanho);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"canal\":6,\"gpio\":27,\"estado\":true,\"frequencia\":20000,\"percentual_duty\":25,\"duty_fino\":16384,"
+        "\"fase\":100,\"frequencia_aplicada\":20000,\"erro_ppm\":-3,\"resolucao_duty\":0,\"duty\":2000,"
+        "\"hpoint\":12,\"timer\":1,\"gerador\":\"mcpwm\",\"complementar\":true,\"tempo_morto_ns\":500,"
+        "\"pulsos\":0}", json);
+}
+
+
+static void test_mensagem_so_com_o_que_mudou(void)
+{
+    int mudaram;
+
+    //a primeira leva todos (nada foi enviado ainda) e guarda o estado enviado
+    size_t tamanho = json_canal_mensagem_ws(mensagem, sizeof(mensagem), 1234, pinos, pedido, aplicado,
+                                            pedido_enviado, aplicado_enviado, false, &mudaram);
+    TEST_ASSERT_EQUAL_INT(NUM_CANAIS_PWM, mudaram);
+    TEST_ASSERT_EQUAL_size_t(strlen(mensagem), tamanho);
+    TEST_ASSERT_EQUAL_INT(0, strncmp(mensagem, "{\"us\":1234,\"canais\":[{\"canal\":0,", 32));
+    TEST_ASSERT_EQUAL_STRING("}]}", mensagem + tamanho - 3);
+
+    //nada mudou: sem mensagem
+    TEST_ASSERT_EQUAL_size_t(0, json_canal_mensagem_ws(mensagem, sizeof(mensagem), 2000, pinos, pedido, aplicado,
+                                                       pedido_enviado, aplicado_enviado, false, &mudaram));
+    TEST_ASSERT_EQUAL_INT(0, mudaram);
+
+    //um pedido e um aplicado diferentes, em canais diferentes
+    pedido[3].duty_fino = 100;
+    aplicado[11].hpoint = 7;
+    tamanho = json_canal_mensagem_ws(mensagem, sizeof(mensagem), 3000, pinos, pedido, aplicado, pedido_enviado,
+                                     aplicado_enviado, false, &mudaram);
+    TEST_ASSERT_EQUAL_INT(2, mudaram);
+    TEST_ASSERT_EQUAL_INT(2, conta_canais(mensagem));
+    TEST_ASSERT_NOT_NULL(strstr(mensagem, "[{\"canal\":3,"));
+    TEST_ASSERT_NOT_NULL(strstr(mensagem, "},{\"canal\":11,"));
+    TEST_ASSERT_EQUAL_STRING("}]}", mensagem + tamanho - 3);
+
+    //o assinante novo recebe todos mesmo sem mudança
+    json_canal_mensagem_ws(mensagem, sizeof(mensagem), 4000, pinos, pedido, aplicado, pedido_enviado,
+                           aplicado_enviado, true, &mudaram);
+    TEST_ASSERT_EQUAL_INT(NUM_CANAIS_PWM, mudaram);
+    TEST_ASSERT_EQUAL_INT(NUM_CANAIS_PWM, conta_canais(mensagem));
+}
+
+
+static void test_padding_nao_conta_como_mudanca(void)
+{
+    int mudaram;
+
+    json_canal_mensagem_ws(mensagem, sizeof(mensagem), 0, pinos, pedido, aplicado, pedido_enviado,
+                           aplicado_enviado, false, &mudaram);
+
+    //os mesmos valores com lixo no padding de cada struct
+    static struct pwm_aplicado outro[NUM_CANAIS_PWM];
+    memset(outro, 0xA5, sizeof(outro));
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        outro[i].estado = aplicado[i].estado; outro[i].frequencia = aplicado[i].frequencia;
+        outro[i].resolucao_duty = aplicado[i].resolucao_duty; outro[i].duty = aplicado[i].duty;
+        outro[i].hpoint = aplicado[i].hpoint; outro[i].erro_ppm = aplicado[i].erro_ppm;
+        outro[i].timer = aplicado[i].timer; outro[i].gerador = aplicado[i].gerador;
+    }
+    TEST_ASSERT_EQUAL_size_t(0, json_canal_mensagem_ws(mensagem, sizeof(mensagem), 1, pinos, pedido, outro,
+                                                       pedido_enviado, aplicado_enviado, false, &mudaram));
+}
+
+
+static void test_pior_caso_cabe_no_buffer(void)
+{
+    int mudaram;
+
+    //todos os campos com o maior texto possível
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        pedido[i] = (struct parametros_pwm){.estado = true, .frequencia = -2147483647 - 1, .duty_fino = -2147483647 - 1,
+                                            .fase = -2147483647 - 1, .gerador = 99, .tempo_morto_ns = -2147483647 - 1,
+                                            .pulsos = -2147483647 - 1, .complementar = false};
+        aplicado[i] = (struct pwm_aplicado){.estado = false, .frequencia = UINT32_MAX, .resolucao_duty = UINT32_MAX,
+                                            .duty = UINT32_MAX, .hpoint = UINT32_MAX, .erro_ppm = INT32_MIN,
+                                            .timer = -128, .gerador = -128};
+    }
+    size_t tamanho = json_canal_mensagem_ws(mensagem, sizeof(mensagem), INT64_MIN, pinos, pedido, aplicado,
+                                            pedido_enviado, aplicado_enviado, true, &mudaram);
+    TEST_ASSERT_EQUAL_size_t(strlen(mensagem), tamanho);
+    TEST_ASSERT_TRUE(tamanho < sizeof(mensagem));
+    TEST_ASSERT_EQUAL_STRING("}]}", mensagem + tamanho - 3);
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_json_de_um_canal);
+    RUN_TEST(test_mensagem_so_com_o_que_mudou);
+    RUN_TEST(test_padding_nao_conta_como_mudanca);
+    RUN_TEST(test_pior_caso_cabe_no_buffer);
+    return UNITY_END();
+}
@@ -0,0 +1,139 @@
+/*Medição das saídas (src/medicao.c) no PC: a porta de contagem nos limites, o resultado de um canal a partir
+de leituras simuladas do contador e o JSON do GET /api/medicao, só com os canais já medidos e as faixas da
+calibração que têm medidas.
+
+    pio test -e native -f test_medicao -v*/
+#include <string.h>
+
+#include <unity.h>
+
+#include "medicao.h"
+#include "geradores.h"
+
+
+static const int pinos[NUM_CANAIS_PWM] = {
+    2, 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 21, 22, 23, 25, 26,
+};
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+//Junta a resposta inteira num buffer, como o cliente que lê o /api/medicao
+static char resposta[8192];
+static size_t tamanho_resposta;
+
+static int guarda_chunk(void *destino, const char *dados, size_t tamanho)
+{
+    TEST_ASSERT_TRUE(tamanho_resposta + tamanho < sizeof(resposta));
+    memcpy(resposta + tamanho_resposta, dados, tamanho);
+    tamanho_resposta += tamanho;
+    resposta[tamanho_resposta] = '\0';
+    return 0;
+}
+
+
+//Leituras de um sinal de 'frequencia_mhz' mHz, espaçadas igualmente ao longo de 'porta_ms'
+static void simula_leituras(uint64_t frequencia_mhz, uint32_t porta_ms, struct amostra_contagem *amostras)
+{
+    for (int a = 0; a < MEDICAO_AMOSTRAS; a++) {
+        int64_t instante_us = 1000000 + (int64_t)a * porta_ms * 1000 / (MEDICAO_AMOSTRAS - 1);
+        amostras[a].instante_us = instante_us;
+        amostras[a].pulsos      = (int64_t)((instante_us - 1000000) * frequencia_mhz / 1000000000);
+    }
+}
+
+
+static void test_porta_nos_limites(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(MEDICAO_PORTA_MAXIMA_MS, medicao_porta_ms(1));
+    TEST_ASSERT_EQUAL_UINT32(MEDICAO_PORTA_MAXIMA_MS, medicao_porta_ms(0));     //sem divisão por zero
+    TEST_ASSERT_EQUAL_UINT32(MEDICAO_PORTA_MAXIMA_MS, medicao_porta_ms(1000));
+    TEST_ASSERT_EQUAL_UINT32(200, medicao_porta_ms(10000));
+    TEST_ASSERT_EQUAL_UINT32(MEDICAO_PORTA_MINIMA_MS, medicao_porta_ms(20000));
+    TEST_ASSERT_EQUAL_UINT32(MEDICAO_PORTA_MINIMA_MS, medicao_porta_ms(40000000));
+}
+
+
+static void test_resultado_de_um_canal(void)
+{
+    struct amostra_contagem amostras[MEDICAO_AMOSTRAS];
+    struct parametros_pwm pedido = {.estado = true, .frequencia = 10000, .duty_fino = 32768,
+                                    .gerador = GERADOR_LEDC};
+    struct medicao_canal medicao;
+
+    //o sinal saiu 100 ppm acima do pedido e 40 ppm acima do previsto
+    simula_leituras(10001000, medicao_porta_ms(10000), amostras);
+    uint64_t medida_mhz = calibracao_frequencia_medida_mhz(amostras, MEDICAO_AMOSTRAS);
+    medicao_resultado(&medicao, 5000000, &pedido, 10000600, medida_mhz, 32700, amostras);
+
+    TEST_ASSERT_EQUAL_INT64(5000000, medicao.instante_us);
+    TEST_ASSERT_EQUAL_UINT32(10000, medicao.frequencia_pedida);
+    //o erro contra a pedida e o desvio contra a prevista, com a medida pela reta das leituras (a contagem
+    //inteira de uma porta de 2000 pulsos deixa meio pulso, 250 ppm, de incerteza)
+    TEST_ASSERT_EQUAL_INT32(calibracao_erro_ppm(medida_mhz, 10000000), medicao.erro_ppm);
+    TEST_ASSERT_EQUAL_INT32(calibracao_erro_ppm(medida_mhz, 10000600), medicao.desvio_ppm);
+    TEST_ASSERT_INT32_WITHIN(250, 100, medicao.erro_ppm);
+    TEST_ASSERT_EQUAL_UINT64(medida_mhz, medicao.frequencia_medida_mhz);
+    TEST_ASSERT_EQUAL_UINT64(10000600, medicao.frequencia_prevista_mhz);
+    TEST_ASSERT_EQUAL_INT32(32768, medicao.duty_pedido);
+    TEST_ASSERT_EQUAL_INT32(32700, medicao.duty_medido);
+    TEST_ASSERT_EQUAL_UINT32(200, medicao.porta_ms);
+    TEST_ASSERT_FALSE(medicao.calibrou);
+    TEST_ASSERT_EQUAL_UINT8(GERADOR_LEDC, medicao.gerador);
+}
+
+
+static void test_json_da_medicao(void)
+{
+    static struct medicao_canal medicoes[NUM_CANAIS_PWM];
+    struct amostra_contagem amostras[MEDICAO_AMOSTRAS];
+    struct tabela_calibracao tabela;
+    struct saida_html saida;
+
+    memset(medicoes, 0, sizeof(medicoes));
+    memset(&tabela, 0, sizeof(tabela));
+    medicoes[4] = (struct medicao_canal){
+        .instante_us = 123, .frequencia_prevista_mhz = 1000000, .frequencia_medida_mhz = 1000050,
+        .frequencia_pedida = 1000, .erro_ppm = 50, .desvio_ppm = 50, .duty_pedido = 100, .duty_medido = -1,
+        .porta_ms = 2000, .calibrou = true, .gerador = GERADOR_RMT,
+    };
+    tabela.faixas[9] = (struct faixa_calibracao){.desvio_ppm = -12, .medidas = 3};
+
+    //sem captura: a lista de amostras sai vazia
+    tamanho_resposta = 0;
+    inicia_saida_html(&saida, guarda_chunk, NULL);
+    medicao_envia_json(&saida, medicoes, pinos, &tabela, -1, amostras);
+    TEST_ASSERT_EQUAL_INT(0, finaliza_saida_html(&saida));
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"medicoes\":[{\"canal\":4,\"gpio\":13,\"gerador\":\"rmt\",\"instante_us\":123,\"frequencia\":1000,"
+        "\"frequencia_prevista_mhz\":1000000,\"frequencia_medida_mhz\":1000050,\"erro_ppm\":50,\"desvio_ppm\":50,"
+        "\"duty_fino\":100,\"duty_fino_medido\":-1,\"porta_ms\":2000,\"calibrou\":true}],"
+        "\"calibracao\":[{\"faixa_hz\":512,\"desvio_ppm\":-12,\"medidas\":3}],"
+        "\"captura\":{\"canal\":-1,\"amostras\":[]}}", resposta);
+
+    //com captura: as MEDICAO_AMOSTRAS leituras, em ordem
+    simula_leituras(1000000, 2000, amostras);
+    tamanho_resposta = 0;
+    inicia_saida_html(&saida, guarda_chunk, NULL);
+    medicao_envia_json(&saida, medicoes, pinos, &tabela, 4, amostras);
+    TEST_ASSERT_EQUAL_INT(0, finaliza_saida_html(&saida));
+    TEST_ASSERT_NOT_NULL(strstr(resposta, "\"captura\":{\"canal\":4,\"amostras\":[[1000000,0],[1133333,133],"));
+    TEST_ASSERT_NOT_NULL(strstr(resposta, ",[3000000,2000]]}}"));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_porta_nos_limites);
+    RUN_TEST(test_resultado_de_um_canal);
+    RUN_TEST(test_json_da_medicao);
+    return UNITY_END();
+}
@@ -0,0 +1,148 @@
+/*Histogramas de latência do /metrics (src/metricas.c) no PC: a faixa de cada duração nos limites, a contagem
+sem lock com várias threads no mesmo histograma, como os cores do ESP32, e o texto do Prometheus com as faixas
+acumuladas, os cores somados e uma linha de TYPE por família.
+
+    pio test -e native -f test_metricas -v*/
+#include <pthread.h>
+#include <string.h>
+
+#include <unity.h>
+
+#include "metricas.h"
+
+#define NUM_THREADS             4
+#define REGISTROS_THREAD        100000
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+//Junta a resposta inteira num buffer, como o cliente que lê o /metrics
+static char resposta[8192];
+static size_t tamanho_resposta;
+
+static int guarda_chunk(void *destino, const char *dados, size_t tamanho)
+{
+    TEST_ASSERT_TRUE(tamanho_resposta + tamanho < sizeof(resposta));
+    memcpy(resposta + tamanho_resposta, dados, tamanho);
+    tamanho_resposta += tamanho;
+    resposta[tamanho_resposta] = '\0';
+    return 0;
+}
+
+
+static void test_faixa_nos_limites(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, metricas_faixa(0));
+    TEST_ASSERT_EQUAL_INT(0, metricas_faixa(-5));           //relógio que voltou não sai da tabela
+    TEST_ASSERT_EQUAL_INT(0, metricas_faixa(100));          //o limite é "até", como o le do Prometheus
+    TEST_ASSERT_EQUAL_INT(1, metricas_faixa(101));
+    TEST_ASSERT_EQUAL_INT(4, metricas_faixa(10000));
+    TEST_ASSERT_EQUAL_INT(8, metricas_faixa(1000000));
+    TEST_ASSERT_EQUAL_INT(NUM_FAIXAS_LATENCIA, metricas_faixa(1000001));
+    TEST_ASSERT_EQUAL_INT(NUM_FAIXAS_LATENCIA, metricas_faixa(INT64_MAX));
+}
+
+
+static struct histograma_latencia compartilhado;
+
+static void *registra_varias(void *argumento)
+{
+    for (int i = 0; i < REGISTROS_THREAD; i++)
+        metricas_registra(&compartilhado, (i % 2) ? 50 : 2000);
+    return NULL;
+}
+
+static void test_registro_sem_lock_nao_perde_contagem(void)
+{
+    pthread_t threads[NUM_THREADS];
+
+    memset(&compartilhado, 0, sizeof(compartilhado));
+    for (int t = 0; t < NUM_THREADS; t++)
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[t], NULL, registra_varias, NULL));
+    for (int t = 0; t < NUM_THREADS; t++)
+        pthread_join(threads[t], NULL);
+
+    TEST_ASSERT_EQUAL_UINT32(NUM_THREADS * REGISTROS_THREAD / 2, compartilhado.faixas[0]);
+    TEST_ASSERT_EQUAL_UINT32(NUM_THREADS * REGISTROS_THREAD / 2, compartilhado.faixas[3]);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(NUM_THREADS * (REGISTROS_THREAD / 2) * (50 + 2000)), compartilhado.soma_us);
+}
+
+
+static void test_soma_em_32_bits_da_a_volta(void)
+{
+    struct histograma_latencia histograma;
+    memset(&histograma, 0, sizeof(histograma));
+
+    histograma.soma_us = UINT32_MAX - 10;
+    metricas_registra(&histograma, 20);
+    TEST_ASSERT_EQUAL_UINT32(9, histograma.soma_us);
+    TEST_ASSERT_EQUAL_UINT32(1, histograma.faixas[0]);
+}
+
+
+static void test_texto_do_prometheus(void)
+{
+    static const struct nome_metrica nomes[3] = {
+        {"pwm_http_requisicao_segundos", "uri=\"/\",metodo=\"GET\""},
+        {"pwm_http_requisicao_segundos", "uri=\"/api/pwm\",metodo=\"PUT\""},
+        {"pwm_udp_comando_segundos", ""},
+    };
+    struct histograma_latencia histogramas[2][3];
+    struct saida_html saida;
+
+    memset(histogramas, 0, sizeof(histogramas));
+    metricas_registra(&histogramas[0][0], 80);              //cada core com uma parte
+    metricas_registra(&histogramas[1][0], 3000);
+    metricas_registra(&histogramas[1][0], 2000000);
+    metricas_registra(&histogramas[0][2], 1500000);
+    metricas_registra(&histogramas[1][2], 1);
+
+    tamanho_resposta = 0;
+    inicia_saida_html(&saida, guarda_chunk, NULL);
+    metricas_envia_histogramas(&saida, nomes, &histogramas[0][0], 2, 3);
+    TEST_ASSERT_EQUAL_INT(0, finaliza_saida_html(&saida));
+
+    //uma linha de TYPE por família, mesmo com dois histogramas nela
+    TEST_ASSERT_NOT_NULL(strstr(resposta, "# TYPE pwm_http_requisicao_segundos histogram\n"));
+    TEST_ASSERT_NULL(strstr(strstr(resposta, "# TYPE pwm_http") + 1, "# TYPE pwm_http"));
+    TEST_ASSERT_NOT_NULL(strstr(resposta, "# TYPE pwm_udp_comando_segundos histogram\n"));
+
+    //faixas acumuladas, com os dois cores somados
+    TEST_ASSERT_NOT_NULL(strstr(resposta,
+        "pwm_http_requisicao_segundos_bucket{uri=\"/\",metodo=\"GET\",le=\"0.0001\"} 1\n"
+        "pwm_http_requisicao_segundos_bucket{uri=\"/\",metodo=\"GET\",le=\"0.0005\"} 1\n"
+        "pwm_http_requisicao_segundos_bucket{uri=\"/\",metodo=\"GET\",le=\"0.001\"} 1\n"
+        "pwm_http_requisicao_segundos_bucket{uri=\"/\",metodo=\"GET\",le=\"0.005\"} 2\n"));
+    TEST_ASSERT_NOT_NULL(strstr(resposta,
+        "pwm_http_requisicao_segundos_bucket{uri=\"/\",metodo=\"GET\",le=\"1\"} 2\n"
+        "pwm_http_requisicao_segundos_bucket{uri=\"/\",metodo=\"GET\",le=\"+Inf\"} 3\n"
+        "pwm_http_requisicao_segundos_sum{uri=\"/\",metodo=\"GET\"} 2.003080\n"
+        "pwm_http_requisicao_segundos_count{uri=\"/\",metodo=\"GET\"} 3\n"));
+    TEST_ASSERT_NOT_NULL(strstr(resposta,
+        "pwm_http_requisicao_segundos_count{uri=\"/api/pwm\",metodo=\"PUT\"} 0\n"));
+
+    //sem rótulos, o le vem sozinho e sem vírgula
+    TEST_ASSERT_NOT_NULL(strstr(resposta, "pwm_udp_comando_segundos_bucket{le=\"0.0001\"} 1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(resposta,
+        "pwm_udp_comando_segundos_bucket{le=\"+Inf\"} 2\n"
+        "pwm_udp_comando_segundos_sum{} 1.500001\n"
+        "pwm_udp_comando_segundos_count{} 2\n"));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_faixa_nos_limites);
+    RUN_TEST(test_registro_sem_lock_nao_perde_contagem);
+    RUN_TEST(test_soma_em_32_bits_da_a_volta);
+    RUN_TEST(test_texto_do_prometheus);
+    return UNITY_END();
+}
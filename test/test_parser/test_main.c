@@ -0,0 +1,283 @@
+/*O parser do formulário e do JSON no PC: os campos válidos e inválidos, o %XX e o '+', os limites de cada
+valor e a independência dos pedaços em que o corpo chega. O benchmark mede a vazão do parser do formulário
+com o corpo inteiro, em pedaços do tamanho dos do handler e byte a byte, e a do JSON do PUT.
+
+    pio test -e native -f test_parser -v
+
+O fuzzer do mesmo parser está em test/fuzz*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <unity.h>
+
+#include "parser.h"
+#include "geradores.h"
+#include "timer_pwm.h"
+
+#define PEDACO_HANDLER          64          //FORMULARIO_PEDACO do main.c
+#define REPETICOES_BENCHMARK    20000
+
+static struct parametros_pwm canais[NUM_CANAIS_PWM];
+static struct parser_formulario parser;
+
+
+//Todos os canais desligados em 1 kHz e 50%
+void setUp(void)
+{
+    memset(canais, 0, sizeof(canais));
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        canais[i].frequencia = 1000;
+        canais[i].duty_fino  = PERCENTUAL_PARA_DUTY_FINO(50);
+    }
+}
+
+void tearDown(void)
+{
+}
+
+
+//O corpo inteiro de uma vez
+static bool le_formulario(const char *corpo)
+{
+    parser_formulario_inicia(&parser, canais);
+    parser_formulario_alimenta(&parser, corpo, strlen(corpo));
+    return parser_formulario_finaliza(&parser);
+}
+
+static int64_t agora_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+
+/*---------------------------------------------Formulário-----------------------------------------------------*/
+static void test_formulario_altera_os_canais_pedidos(void)
+{
+    TEST_ASSERT_TRUE(le_formulario("freq3=2000&duty3=40&estado3=ligado&pwm3=Aplicar&freq15=40000000&estado15=1"));
+    TEST_ASSERT_EQUAL_HEX32((1u << 3) | (1u << 15), parser.mascara);
+    TEST_ASSERT_EQUAL_INT(2000, canais[3].frequencia);
+    TEST_ASSERT_EQUAL_INT(PERCENTUAL_PARA_DUTY_FINO(40), canais[3].duty_fino);
+    TEST_ASSERT_TRUE(canais[3].estado);
+    TEST_ASSERT_EQUAL_INT(PWM_FREQUENCIA_MAXIMA, canais[15].frequencia);
+    TEST_ASSERT_TRUE(canais[15].estado);
+
+    //os outros canais ficam como estavam
+    TEST_ASSERT_EQUAL_INT(1000, canais[4].frequencia);
+    TEST_ASSERT_FALSE(canais[4].estado);
+}
+
+static void test_formulario_decodifica_porcento_e_mais(void)
+{
+    //"duty%31" = "duty1", "%32%35" = "25", "desligado" com um '+' vira "desligado " e é inválido
+    TEST_ASSERT_TRUE(le_formulario("duty%31=%32%35&estado1=%6Cigado"));
+    TEST_ASSERT_EQUAL_INT(PERCENTUAL_PARA_DUTY_FINO(25), canais[1].duty_fino);
+    TEST_ASSERT_TRUE(canais[1].estado);
+
+    TEST_ASSERT_FALSE(le_formulario("estado1=desligado+"));
+    TEST_ASSERT_TRUE(le_formulario("pwm2=Aplicar+canal+2"));        //o botão só marca o canal
+    TEST_ASSERT_EQUAL_HEX32(1u << 2, parser.mascara);
+}
+
+static void test_formulario_limites_dos_valores(void)
+{
+    TEST_ASSERT_TRUE(le_formulario("duty0=0&duty1=100&freq2=1"));
+    TEST_ASSERT_EQUAL_INT(0, canais[0].duty_fino);
+    TEST_ASSERT_EQUAL_INT(DUTY_FINO_MAXIMO, canais[1].duty_fino);
+    TEST_ASSERT_EQUAL_INT(1, canais[2].frequencia);
+
+    const char *invalidos[] = {
+        "duty0=101", "duty0=-1", "duty0=", "duty0=1.5", "freq0=0", "freq0=40000001", "freq0=99999999999999999999",
+        "estado0=talvez", "estado0=", "duty16=10", "duty=10", "duty00000000001=1", "freq0=0000000000001",
+        "pwm000000000003=x",
+    };
+    for (size_t i = 0; i < sizeof(invalidos) / sizeof(invalidos[0]); i++)
+        TEST_ASSERT_FALSE_MESSAGE(le_formulario(invalidos[i]), invalidos[i]);
+}
+
+static void test_formulario_ignora_campos_desconhecidos(void)
+{
+    TEST_ASSERT_TRUE(le_formulario("nome=teste&um_campo_com_nome_bem_comprido=1&&=&duty3=10"));
+    TEST_ASSERT_EQUAL_HEX32(1u << 3, parser.mascara);
+
+    //o mesmo corpo sem nenhum canal é válido para o parser, quem decide o que fazer é o handler
+    TEST_ASSERT_TRUE(le_formulario("nada=1"));
+    TEST_ASSERT_EQUAL_HEX32(0, parser.mascara);
+    TEST_ASSERT_TRUE(le_formulario(""));
+}
+
+static void test_formulario_porcento_incompleto_ou_errado(void)
+{
+    TEST_ASSERT_FALSE(le_formulario("duty3=1%2"));
+    TEST_ASSERT_FALSE(le_formulario("duty3=1%"));
+    TEST_ASSERT_FALSE(le_formulario("duty3=%G1"));
+
+    //depois de inválido o resto do corpo não altera nada
+    TEST_ASSERT_FALSE(le_formulario("duty3=%zz&freq4=5000"));
+    TEST_ASSERT_EQUAL_INT(1000, canais[4].frequencia);
+}
+
+//Qualquer divisão do corpo em pedaços dá o mesmo resultado que o corpo inteiro
+static void test_formulario_independe_dos_pedacos(void)
+{
+    const char *corpo = "freq10=%31%32%33%34&duty10=7&estado10=ligado&nome=a+b%3Dc&freq11=39999999&duty11=100";
+    size_t tamanho = strlen(corpo);
+
+    TEST_ASSERT_TRUE(le_formulario(corpo));
+    struct parametros_pwm esperado[NUM_CANAIS_PWM];
+    memcpy(esperado, canais, sizeof(esperado));
+    uint32_t mascara = parser.mascara;
+    TEST_ASSERT_EQUAL_INT(1234, esperado[10].frequencia);
+
+    for (size_t pedaco = 1; pedaco <= tamanho; pedaco++) {
+        setUp();
+        parser_formulario_inicia(&parser, canais);
+        for (size_t i = 0; i < tamanho; i += pedaco)
+            parser_formulario_alimenta(&parser, corpo + i, (tamanho - i < pedaco) ? tamanho - i : pedaco);
+        TEST_ASSERT_TRUE(parser_formulario_finaliza(&parser));
+        TEST_ASSERT_EQUAL_HEX32(mascara, parser.mascara);
+        TEST_ASSERT_EQUAL_MEMORY(esperado, canais, sizeof(canais));
+    }
+}
+
+static void test_converte_numero(void)
+{
+    uint32_t valor;
+    TEST_ASSERT_TRUE(parser_converte_numero("0", 10, &valor));
+    TEST_ASSERT_EQUAL_UINT32(0, valor);
+    TEST_ASSERT_TRUE(parser_converte_numero("4294967295", UINT32_MAX, &valor));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, valor);
+    TEST_ASSERT_FALSE(parser_converte_numero("4294967296", UINT32_MAX, &valor));
+    TEST_ASSERT_FALSE(parser_converte_numero("11", 10, &valor));
+    TEST_ASSERT_FALSE(parser_converte_numero("", 10, &valor));
+    TEST_ASSERT_FALSE(parser_converte_numero(" 1", 10, &valor));
+    TEST_ASSERT_FALSE(parser_converte_numero("+1", 10, &valor));
+}
+
+
+/*-------------------------------------------------JSON-------------------------------------------------------*/
+static void test_json_campos(void)
+{
+    const char *json = "{ \"estado\" : true,\"frequencia\":25000,\n\t\"fase\": -90, \"complementar\":false }";
+    int valor;
+
+    TEST_ASSERT_TRUE(parser_json_campo(json, "estado", &valor));
+    TEST_ASSERT_EQUAL_INT(1, valor);
+    TEST_ASSERT_TRUE(parser_json_campo(json, "frequencia", &valor));
+    TEST_ASSERT_EQUAL_INT(25000, valor);
+    TEST_ASSERT_TRUE(parser_json_campo(json, "fase", &valor));
+    TEST_ASSERT_EQUAL_INT(-90, valor);
+    TEST_ASSERT_TRUE(parser_json_campo(json, "complementar", &valor));
+    TEST_ASSERT_EQUAL_INT(0, valor);
+
+    TEST_ASSERT_FALSE(parser_json_campo(json, "pulsos", &valor));
+    TEST_ASSERT_FALSE(parser_json_campo(json, "freq", &valor));              //só o prefixo de uma chave
+    TEST_ASSERT_FALSE(parser_json_campo("{\"duty\": \"x\"}", "duty", &valor));
+    TEST_ASSERT_FALSE(parser_json_campo("{\"duty\": 99999999999}", "duty", &valor));
+    TEST_ASSERT_FALSE(parser_json_campo("{\"duty\"", "duty", &valor));
+    TEST_ASSERT_FALSE(parser_json_campo("{\"duty", "duty", &valor));
+}
+
+static void test_json_chave_igual_a_um_valor(void)
+{
+    int valor;
+    //"estado" aparece primeiro como valor de outra chave
+    TEST_ASSERT_TRUE(parser_json_campo("{\"nome\":\"estado\",\"estado\":1}", "estado", &valor));
+    TEST_ASSERT_EQUAL_INT(1, valor);
+    TEST_ASSERT_FALSE(parser_json_campo("{\"nome\":\"estado\"}", "estado", &valor));
+}
+
+static void test_json_gerador(void)
+{
+    int gerador;
+    for (int g = 0; g < NUM_GERADORES; g++) {
+        char json[48];
+        snprintf(json, sizeof(json), "{\"gerador\": \"%s\"}", gerador_nome(g));
+        TEST_ASSERT_TRUE(parser_json_gerador(json, "gerador", &gerador));
+        TEST_ASSERT_EQUAL_INT(g, gerador);
+    }
+    TEST_ASSERT_TRUE(parser_json_gerador("{\"gerador\":\"ledcx\"}", "gerador", &gerador));
+    TEST_ASSERT_EQUAL_INT(-1, gerador);
+    TEST_ASSERT_TRUE(parser_json_gerador("{\"gerador\":1}", "gerador", &gerador));
+    TEST_ASSERT_EQUAL_INT(-1, gerador);
+    TEST_ASSERT_TRUE(parser_json_gerador("{\"gerador\":\"", "gerador", &gerador));
+    TEST_ASSERT_EQUAL_INT(-1, gerador);
+    TEST_ASSERT_FALSE(parser_json_gerador("{\"estado\":1}", "gerador", &gerador));
+}
+
+
+/*---------------------------------------------Benchmark------------------------------------------------------*/
+static double vazao_formulario(const char *corpo, size_t tamanho, size_t pedaco)
+{
+    int64_t inicio_ns = agora_ns();
+    for (int r = 0; r < REPETICOES_BENCHMARK; r++) {
+        parser_formulario_inicia(&parser, canais);
+        for (size_t i = 0; i < tamanho; i += pedaco)
+            parser_formulario_alimenta(&parser, corpo + i, (tamanho - i < pedaco) ? tamanho - i : pedaco);
+        TEST_ASSERT_TRUE(parser_formulario_finaliza(&parser));
+    }
+    return (double)tamanho * REPETICOES_BENCHMARK / ((agora_ns() - inicio_ns) / 1e9) / 1e6;
+}
+
+static void test_benchmark(void)
+{
+    //o formulário com os 16 canais, como a página manda, e o mesmo com todos os dígitos em %XX
+    static char formulario[2048], codificado[2048];
+    size_t tamanho = 0, tamanho_codificado = 0;
+    for (int c = 0; c < NUM_CANAIS_PWM; c++) {
+        tamanho += snprintf(formulario + tamanho, sizeof(formulario) - tamanho,
+                            "%sfreq%d=%d&duty%d=%d&estado%d=ligado", c > 0 ? "&" : "", c, 1000 + c * 37, c, c * 6, c);
+    }
+    for (size_t i = 0; i < tamanho; i++) {
+        if (formulario[i] >= '0' && formulario[i] <= '9')
+            tamanho_codificado += snprintf(codificado + tamanho_codificado, 4, "%%%02X", formulario[i]);
+        else
+            codificado[tamanho_codificado++] = formulario[i];
+    }
+
+    printf("BENCH formulario %u bytes inteiro:   %7.1f MB/s\n", (unsigned)tamanho,
+           vazao_formulario(formulario, tamanho, tamanho));
+    printf("BENCH formulario %u bytes em %d:     %7.1f MB/s\n", (unsigned)tamanho, PEDACO_HANDLER,
+           vazao_formulario(formulario, tamanho, PEDACO_HANDLER));
+    printf("BENCH formulario %u bytes byte a byte: %5.1f MB/s\n", (unsigned)tamanho,
+           vazao_formulario(formulario, tamanho, 1));
+    printf("BENCH formulario %u bytes com %%XX:   %7.1f MB/s\n", (unsigned)tamanho_codificado,
+           vazao_formulario(codificado, tamanho_codificado, PEDACO_HANDLER));
+
+    static const char json[] = "{\"estado\": true, \"gerador\": \"mcpwm\", \"frequencia\": 25000, "
+                               "\"percentual_duty\": 33, \"fase\": 90, \"complementar\": true, "
+                               "\"tempo_morto_ns\": 500, \"pulsos\": 0}";
+    static const char *const campos[] = {"estado", "frequencia", "percentual_duty", "duty_fino", "fase",
+                                         "complementar", "tempo_morto_ns", "pulsos"};
+    int valor, gerador, encontrados = 0;
+    int64_t inicio_ns = agora_ns();
+    for (int r = 0; r < REPETICOES_BENCHMARK; r++) {
+        for (size_t c = 0; c < sizeof(campos) / sizeof(campos[0]); c++)
+            encontrados += parser_json_campo(json, campos[c], &valor);
+        encontrados += parser_json_gerador(json, "gerador", &gerador);
+    }
+    double json_ns = (double)(agora_ns() - inicio_ns) / REPETICOES_BENCHMARK;
+    TEST_ASSERT_EQUAL_INT(8 * REPETICOES_BENCHMARK, encontrados);
+    printf("BENCH JSON do PUT %u bytes, 9 campos: %6.2f us (%5.1f MB/s)\n", (unsigned)strlen(json),
+           json_ns / 1000, strlen(json) / json_ns * 1000);
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_formulario_altera_os_canais_pedidos);
+    RUN_TEST(test_formulario_decodifica_porcento_e_mais);
+    RUN_TEST(test_formulario_limites_dos_valores);
+    RUN_TEST(test_formulario_ignora_campos_desconhecidos);
+    RUN_TEST(test_formulario_porcento_incompleto_ou_errado);
+    RUN_TEST(test_formulario_independe_dos_pedacos);
+    RUN_TEST(test_converte_numero);
+    RUN_TEST(test_json_campos);
+    RUN_TEST(test_json_chave_igual_a_um_valor);
+    RUN_TEST(test_json_gerador);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
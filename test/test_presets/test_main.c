@@ -0,0 +1,130 @@
+/*Tabela dos presets (src/presets.c) no PC: o próximo e o anterior ocupados a partir do atual, com buracos na
+tabela, a volta e o começo sem preset aplicado, a procura pelo nome, os canais ligados e os nomes que a API
+aceita.
+
+    pio test -e native -f test_presets -v*/
+#include <string.h>
+
+#include <unity.h>
+
+#include "presets.h"
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+static struct preset_pwm presets[PRESET_MAXIMO];
+
+
+//Ocupa os presets da máscara, cada um com o nome "p<n>"
+static void ocupa(uint32_t mascara)
+{
+    memset(presets, 0, sizeof(presets));
+    for (int p = 0; p < PRESET_MAXIMO; p++) {
+        presets[p].ocupado = (mascara & (1u << p)) != 0;
+        presets[p].nome[0] = 'p';
+        presets[p].nome[1] = (char)('0' + p);
+    }
+}
+
+
+static void test_vizinho_pula_os_vazios(void)
+{
+    ocupa((1u << 1) | (1u << 4) | (1u << 6));
+
+    TEST_ASSERT_EQUAL_INT(4, preset_vizinho(presets, 1, 1));
+    TEST_ASSERT_EQUAL_INT(6, preset_vizinho(presets, 4, 1));
+    TEST_ASSERT_EQUAL_INT(1, preset_vizinho(presets, 6, 1));            //dá a volta
+    TEST_ASSERT_EQUAL_INT(6, preset_vizinho(presets, 1, -1));
+    TEST_ASSERT_EQUAL_INT(4, preset_vizinho(presets, 6, -1));
+
+    //vários passos de uma vez (apertos do botão juntados pela task)
+    TEST_ASSERT_EQUAL_INT(6, preset_vizinho(presets, 1, 2));
+    TEST_ASSERT_EQUAL_INT(1, preset_vizinho(presets, 1, 3));
+    TEST_ASSERT_EQUAL_INT(4, preset_vizinho(presets, 1, -2));
+    TEST_ASSERT_EQUAL_INT(6, preset_vizinho(presets, 1, PRESET_PASSO_MAXIMO));      //8 passos em 3 presets
+
+    //o atual pode ter sido apagado: anda a partir da posição dele
+    TEST_ASSERT_EQUAL_INT(4, preset_vizinho(presets, 2, 1));
+    TEST_ASSERT_EQUAL_INT(1, preset_vizinho(presets, 2, -1));
+}
+
+
+static void test_vizinho_sem_preset_aplicado(void)
+{
+    ocupa((1u << 2) | (1u << 5));
+
+    //o próximo é o primeiro ocupado e o anterior é o último
+    TEST_ASSERT_EQUAL_INT(2, preset_vizinho(presets, -1, 1));
+    TEST_ASSERT_EQUAL_INT(5, preset_vizinho(presets, -1, -1));
+    TEST_ASSERT_EQUAL_INT(5, preset_vizinho(presets, -1, 2));
+
+    //só um ocupado: qualquer passo volta para ele
+    ocupa(1u << 7);
+    TEST_ASSERT_EQUAL_INT(7, preset_vizinho(presets, 7, 1));
+    TEST_ASSERT_EQUAL_INT(7, preset_vizinho(presets, 7, -3));
+    TEST_ASSERT_EQUAL_INT(7, preset_vizinho(presets, -1, -1));
+
+    //nenhum ocupado
+    ocupa(0);
+    TEST_ASSERT_EQUAL_INT(-1, preset_vizinho(presets, -1, 1));
+    TEST_ASSERT_EQUAL_INT(-1, preset_vizinho(presets, 3, -1));
+    TEST_ASSERT_FALSE(preset_algum_ocupado(presets));
+}
+
+
+static void test_procura_pelo_nome(void)
+{
+    ocupa((1u << 0) | (1u << 3));
+
+    TEST_ASSERT_TRUE(preset_algum_ocupado(presets));
+    TEST_ASSERT_EQUAL_INT(3, preset_procura_nome(presets, "p3"));
+    TEST_ASSERT_EQUAL_INT(0, preset_procura_nome(presets, "p0"));
+    TEST_ASSERT_EQUAL_INT(-1, preset_procura_nome(presets, "p2"));      //o nome ficou, mas está vazio
+    TEST_ASSERT_EQUAL_INT(-1, preset_procura_nome(presets, "p"));
+    TEST_ASSERT_EQUAL_INT(-1, preset_procura_nome(presets, "p30"));
+}
+
+
+static void test_canais_ligados(void)
+{
+    ocupa(1);
+    TEST_ASSERT_EQUAL_HEX32(0, preset_ligados(&presets[0]));
+    presets[0].canais[0].estado  = true;
+    presets[0].canais[9].estado  = true;
+    presets[0].canais[15].estado = true;
+    TEST_ASSERT_EQUAL_HEX32(0x8201, preset_ligados(&presets[0]));
+}
+
+
+static void test_nomes_aceitos(void)
+{
+    TEST_ASSERT_TRUE(preset_nome_valido("a"));
+    TEST_ASSERT_TRUE(preset_nome_valido("Bancada_2-v1.0"));
+    TEST_ASSERT_TRUE(preset_nome_valido("123456789012345"));            //PRESET_NOME_TAMANHO - 1
+
+    TEST_ASSERT_FALSE(preset_nome_valido(""));
+    TEST_ASSERT_FALSE(preset_nome_valido("1234567890123456"));
+    TEST_ASSERT_FALSE(preset_nome_valido("com espaco"));
+    TEST_ASSERT_FALSE(preset_nome_valido("aspas\""));
+    TEST_ASSERT_FALSE(preset_nome_valido("barra\\"));
+    TEST_ASSERT_FALSE(preset_nome_valido("acentuação"));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_vizinho_pula_os_vazios);
+    RUN_TEST(test_vizinho_sem_preset_aplicado);
+    RUN_TEST(test_procura_pelo_nome);
+    RUN_TEST(test_canais_ligados);
+    RUN_TEST(test_nomes_aceitos);
+    return UNITY_END();
+}
@@ -0,0 +1,298 @@
+/*Protocolo do controle por UDP (src/protocolo_udp.c) no PC: a conferência do cabeçalho e do tamanho de cada
+versão, a resposta preparada para cada uma, o instante relativo da versão 2, a ordem das sequências com a
+volta do contador e a leitura dos comandos sobre a configuração dos canais.
+
+    pio test -e native -f test_protocolo_udp -v*/
+#include <string.h>
+
+#include <unity.h>
+
+#include "protocolo_udp.h"
+
+#define CHEGADA_US              5000000
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+static uint8_t pacote[UDP_PACOTE_MAXIMO + 1];
+static size_t  tamanho;
+
+
+//Começa um pacote com o cabeçalho
+static void cabecalho(uint8_t versao, uint8_t quantidade, uint32_t sequencia)
+{
+    struct udp_cabecalho c = {.magico = UDP_MAGICO, .versao = versao, .quantidade = quantidade,
+                              .sequencia = sequencia};
+    memcpy(pacote, &c, sizeof(c));
+    tamanho = sizeof(c);
+}
+
+
+//Acrescenta bytes ao pacote
+static void acrescenta(const void *dados, size_t n)
+{
+    memcpy(pacote + tamanho, dados, n);
+    tamanho += n;
+}
+
+
+//O gerador aceita tudo, ou recusa acima de 1 MHz (como o RMT com um divisor grande)
+static bool aceita_tudo(const struct parametros_pwm *parametros)
+{
+    return true;
+}
+
+static bool ate_1mhz(const struct parametros_pwm *parametros)
+{
+    return parametros->frequencia <= 1000000;
+}
+
+
+static void test_consulta_da_versao_1(void)
+{
+    struct pedido_udp pedido;
+    struct udp_resposta_agendada resposta;
+    size_t tamanho_resposta;
+
+    cabecalho(UDP_VERSAO, 0, 42);
+    TEST_ASSERT_TRUE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_EQUAL_size_t(sizeof(struct udp_resposta), tamanho_resposta);
+    TEST_ASSERT_EQUAL_HEX16(UDP_MAGICO, resposta.base.magico);
+    TEST_ASSERT_EQUAL_UINT8(UDP_VERSAO, resposta.base.versao);
+    TEST_ASSERT_EQUAL_UINT32(42, resposta.base.sequencia);
+    TEST_ASSERT_FALSE(pedido.agendado);
+    TEST_ASSERT_FALSE(pedido.preset);
+
+    //uma consulta nunca está atrasada, nem com a sequência repetida
+    TEST_ASSERT_FALSE(udp_atrasado(&pedido, 42));
+}
+
+
+static void test_pacotes_invalidos(void)
+{
+    struct pedido_udp pedido;
+    struct udp_resposta_agendada resposta;
+    size_t tamanho_resposta;
+    struct udp_comando comando = {.canal = 0, .ligado = 1, .duty_fino = 100, .frequencia = 1000};
+
+    //menor que o cabeçalho
+    cabecalho(UDP_VERSAO, 0, 1);
+    TEST_ASSERT_FALSE(udp_decodifica(pacote, tamanho - 1, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_EQUAL_UINT8(UDP_INVALIDO, resposta.base.status);
+    TEST_ASSERT_EQUAL_size_t(sizeof(struct udp_resposta), tamanho_resposta);
+
+    //mágico errado
+    cabecalho(UDP_VERSAO, 0, 1);
+    pacote[0] ^= 1;
+    TEST_ASSERT_FALSE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+
+    //versão desconhecida
+    cabecalho(4, 0, 1);
+    TEST_ASSERT_FALSE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+
+    //mais comandos que canais
+    cabecalho(UDP_VERSAO, NUM_CANAIS_PWM + 1, 1);
+    for (int i = 0; i <= NUM_CANAIS_PWM; i++)
+        acrescenta(&comando, sizeof(comando));
+    TEST_ASSERT_FALSE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+
+    //um byte a mais ou a menos que a quantidade diz
+    cabecalho(UDP_VERSAO, 1, 1);
+    acrescenta(&comando, sizeof(comando));
+    TEST_ASSERT_TRUE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_FALSE(udp_decodifica(pacote, tamanho + 1, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_FALSE(udp_decodifica(pacote, tamanho - 1, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+
+    //a versão 1 com o tamanho de comandos da versão 2
+    cabecalho(UDP_VERSAO, 1, 1);
+    struct udp_comando_fase com_fase = {.comando = comando};
+    acrescenta(&com_fase, sizeof(com_fase));
+    TEST_ASSERT_FALSE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+
+    //o preset não leva comandos
+    cabecalho(UDP_VERSAO_PRESET, 1, 1);
+    struct udp_preset troca = {.indice = 0};
+    acrescenta(&troca, sizeof(troca));
+    acrescenta(&comando, sizeof(comando));
+    TEST_ASSERT_FALSE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_EQUAL_UINT8(UDP_VERSAO_PRESET, resposta.base.versao);
+}
+
+
+static void test_agendamento_da_versao_2(void)
+{
+    struct pedido_udp pedido;
+    struct udp_resposta_agendada resposta;
+    size_t tamanho_resposta;
+    struct udp_agendamento agendamento = {.instante_us = 250000,
+                                          .opcoes = UDP_AGENDA_RELATIVO | UDP_AGENDA_SINCRONIZA};
+
+    cabecalho(UDP_VERSAO_AGENDADA, 0, 7);
+    acrescenta(&agendamento, sizeof(agendamento));
+    TEST_ASSERT_TRUE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_TRUE(pedido.agendado);
+    TEST_ASSERT_TRUE(pedido.sincroniza);
+    TEST_ASSERT_EQUAL_INT64(CHEGADA_US + 250000, pedido.instante_us);
+
+    //a resposta da versão 2 leva o relógio da chegada
+    TEST_ASSERT_EQUAL_size_t(sizeof(struct udp_resposta_agendada), tamanho_resposta);
+    TEST_ASSERT_EQUAL_UINT8(UDP_VERSAO_AGENDADA, resposta.base.versao);
+    TEST_ASSERT_EQUAL_INT64(CHEGADA_US, resposta.relogio_us);
+
+    //instante absoluto, sem sincronizar
+    agendamento.opcoes = 0;
+    cabecalho(UDP_VERSAO_AGENDADA, 0, 7);
+    acrescenta(&agendamento, sizeof(agendamento));
+    TEST_ASSERT_TRUE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_FALSE(pedido.sincroniza);
+    TEST_ASSERT_EQUAL_INT64(250000, pedido.instante_us);
+}
+
+
+static void test_troca_de_preset_da_versao_3(void)
+{
+    struct pedido_udp pedido;
+    struct udp_resposta_agendada resposta;
+    size_t tamanho_resposta;
+    struct udp_preset troca = {.indice = UDP_PRESET_VIZINHO, .passo = -1};
+
+    cabecalho(UDP_VERSAO_PRESET, 0, 9);
+    acrescenta(&troca, sizeof(troca));
+    TEST_ASSERT_TRUE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_TRUE(pedido.preset);
+    TEST_ASSERT_EQUAL_UINT8(UDP_PRESET_VIZINHO, pedido.troca.indice);
+    TEST_ASSERT_EQUAL_INT8(-1, pedido.troca.passo);
+    TEST_ASSERT_EQUAL_size_t(sizeof(struct udp_resposta), tamanho_resposta);
+
+    //a troca de preset segue a ordem das sequências como os comandos
+    TEST_ASSERT_TRUE(udp_atrasado(&pedido, 9));
+    TEST_ASSERT_FALSE(udp_atrasado(&pedido, 8));
+}
+
+
+static void test_ordem_das_sequencias(void)
+{
+    struct pedido_udp pedido;
+    struct udp_resposta_agendada resposta;
+    size_t tamanho_resposta;
+    struct udp_comando comando = {.canal = 3, .ligado = 1, .duty_fino = 100, .frequencia = 1000};
+
+    cabecalho(UDP_VERSAO, 1, 100);
+    acrescenta(&comando, sizeof(comando));
+    udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta);
+    TEST_ASSERT_FALSE(udp_atrasado(&pedido, 99));
+    TEST_ASSERT_TRUE(udp_atrasado(&pedido, 100));
+    TEST_ASSERT_TRUE(udp_atrasado(&pedido, 101));
+
+    //a sequência 0 reinicia a contagem
+    cabecalho(UDP_VERSAO, 1, 0);
+    acrescenta(&comando, sizeof(comando));
+    udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta);
+    TEST_ASSERT_FALSE(udp_atrasado(&pedido, 1000));
+
+    //o contador dá a volta: 5 vem depois de 0xFFFFFFF0
+    cabecalho(UDP_VERSAO, 1, 5);
+    acrescenta(&comando, sizeof(comando));
+    udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta);
+    TEST_ASSERT_FALSE(udp_atrasado(&pedido, 0xFFFFFFF0u));
+}
+
+
+static void test_comandos_sobre_a_configuracao(void)
+{
+    struct pedido_udp pedido;
+    struct udp_resposta_agendada resposta;
+    size_t tamanho_resposta;
+    struct parametros_pwm canais[NUM_CANAIS_PWM];
+    uint32_t mascara;
+
+    for (int i = 0; i < NUM_CANAIS_PWM; i++)
+        canais[i] = (struct parametros_pwm){.frequencia = 500, .duty_fino = 1, .fase = 1000, .gerador = 1};
+
+    //versão 1: a fase configurada fica
+    struct udp_comando c1 = {.canal = 2, .ligado = 1, .duty_fino = 30000, .frequencia = 2000};
+    struct udp_comando c2 = {.canal = 15, .ligado = 0, .duty_fino = 65535, .frequencia = 40000000};
+    cabecalho(UDP_VERSAO, 2, 1);
+    acrescenta(&c1, sizeof(c1));
+    acrescenta(&c2, sizeof(c2));
+    TEST_ASSERT_TRUE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_EQUAL_INT(UDP_OK, udp_le_comandos(&pedido, canais, &mascara, aceita_tudo));
+    TEST_ASSERT_EQUAL_HEX32((1u << 2) | (1u << 15), mascara);
+    TEST_ASSERT_TRUE(canais[2].estado);
+    TEST_ASSERT_EQUAL_INT(2000, canais[2].frequencia);
+    TEST_ASSERT_EQUAL_INT(30000, canais[2].duty_fino);
+    TEST_ASSERT_EQUAL_INT(1000, canais[2].fase);
+    TEST_ASSERT_EQUAL_INT(1, canais[2].gerador);
+    TEST_ASSERT_FALSE(canais[15].estado);
+    TEST_ASSERT_EQUAL_INT(500, canais[0].frequencia);
+
+    //versão 2: cada comando traz a fase
+    struct udp_agendamento agendamento = {.instante_us = 0};
+    struct udp_comando_fase f = {.comando = {.canal = 4, .ligado = 1, .duty_fino = 10, .frequencia = 300},
+                                 .fase = 32768};
+    cabecalho(UDP_VERSAO_AGENDADA, 1, 2);
+    acrescenta(&agendamento, sizeof(agendamento));
+    acrescenta(&f, sizeof(f));
+    TEST_ASSERT_TRUE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_EQUAL_INT(UDP_OK, udp_le_comandos(&pedido, canais, &mascara, aceita_tudo));
+    TEST_ASSERT_EQUAL_HEX32(1u << 4, mascara);
+    TEST_ASSERT_EQUAL_INT(32768, canais[4].fase);
+    TEST_ASSERT_EQUAL_INT(300, canais[4].frequencia);
+}
+
+
+static void test_comandos_fora_da_faixa(void)
+{
+    struct pedido_udp pedido;
+    struct udp_resposta_agendada resposta;
+    size_t tamanho_resposta;
+    struct parametros_pwm canais[NUM_CANAIS_PWM] = {0};
+    uint32_t mascara;
+    const struct udp_comando invalidos[] = {
+        {.canal = NUM_CANAIS_PWM, .frequencia = 1000},
+        {.canal = 0, .frequencia = 0},
+        {.canal = 0, .frequencia = 40000001},
+    };
+
+    for (int i = 0; i < 3; i++) {
+        struct udp_comando bom = {.canal = 1, .ligado = 1, .frequencia = 1000};
+        cabecalho(UDP_VERSAO, 2, 1);
+        acrescenta(&bom, sizeof(bom));
+        acrescenta(&invalidos[i], sizeof(invalidos[i]));
+        TEST_ASSERT_TRUE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+        TEST_ASSERT_EQUAL_INT(UDP_FORA_DA_FAIXA, udp_le_comandos(&pedido, canais, &mascara, aceita_tudo));
+    }
+
+    //o gerador configurado não consegue a frequência
+    struct udp_comando alto = {.canal = 6, .ligado = 1, .frequencia = 2000000};
+    cabecalho(UDP_VERSAO, 1, 1);
+    acrescenta(&alto, sizeof(alto));
+    TEST_ASSERT_TRUE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_EQUAL_INT(UDP_FORA_DA_FAIXA, udp_le_comandos(&pedido, canais, &mascara, ate_1mhz));
+    alto.frequencia = 1000000;
+    cabecalho(UDP_VERSAO, 1, 1);
+    acrescenta(&alto, sizeof(alto));
+    TEST_ASSERT_TRUE(udp_decodifica(pacote, tamanho, CHEGADA_US, &pedido, &resposta, &tamanho_resposta));
+    TEST_ASSERT_EQUAL_INT(UDP_OK, udp_le_comandos(&pedido, canais, &mascara, ate_1mhz));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_consulta_da_versao_1);
+    RUN_TEST(test_pacotes_invalidos);
+    RUN_TEST(test_agendamento_da_versao_2);
+    RUN_TEST(test_troca_de_preset_da_versao_3);
+    RUN_TEST(test_ordem_das_sequencias);
+    RUN_TEST(test_comandos_sobre_a_configuracao);
+    RUN_TEST(test_comandos_fora_da_faixa);
+    return UNITY_END();
+}
@@ -0,0 +1,329 @@
+/*A saída em chunks (src/saida_html.c) no PC: como ela junta os fragmentos, quando esvazia o buffer, o que
+acontece com um erro do envio, e o benchmark contra a página do commit inicial, montada inteira com malloc e
+strcat antes do envio. As duas versões da página estão aqui como eram no firmware: a antiga sem o vTaskDelay
+de 3 s antes do free (que só segurava o heap por mais tempo), a em chunks com os fragmentos do primeiro
+commit dela. O heap é medido com o contador de test/stubs/simulacao.h.
+
+    pio test -e native -f test_saida_html -v*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unity.h>
+
+#include "simulacao.h"          //sim_heap_*
+#include "saida_html.h"
+
+#define REPETICOES_BENCHMARK    20000
+#define CHUNKS_MAXIMO           64
+
+//O que a página mostrava de cada canal
+struct canal_pagina{
+    bool estado;
+    int frequencia;
+    int percentual_duty;
+};
+
+//Destino que guarda a resposta e conta os chunks, no lugar do socket
+struct destino_teste{
+    char   resposta[32768];
+    size_t tamanho;
+    int    chunks;
+    size_t maior_chunk;
+    bool   terminou;
+    int    falha_no_chunk;      //o envio desse chunk (contando de 1) retorna erro, 0 nunca
+    int64_t primeiro_chunk_ns;  //quando o primeiro chunk saiu
+};
+
+static struct destino_teste destino;
+//no máximo 7 dígitos: a antiga formatava a frequência com as aspas em char[10] e estourava com 8
+static const struct canal_pagina canais[2] = {{true, 1000, 50}, {false, 2500000, 100}};
+
+
+void setUp(void)
+{
+    memset(&destino, 0, sizeof(destino));
+}
+
+void tearDown(void)
+{
+}
+
+
+static int64_t agora_ns(void);
+
+static int envia_teste(void *alvo, const char *dados, size_t tamanho)
+{
+    struct destino_teste *d = alvo;
+    if (d->terminou)
+        return -1;
+    if (dados == NULL || tamanho == 0) {
+        d->terminou = true;
+        return 0;
+    }
+    if (++d->chunks == d->falha_no_chunk)
+        return -2;
+    if (d->chunks == 1)
+        d->primeiro_chunk_ns = agora_ns();
+    if (tamanho > d->maior_chunk)
+        d->maior_chunk = tamanho;
+    if (d->tamanho + tamanho < sizeof(d->resposta)) {
+        memcpy(d->resposta + d->tamanho, dados, tamanho);
+        d->tamanho += tamanho;
+        d->resposta[d->tamanho] = '\0';
+    }
+    return 0;
+}
+
+static int64_t agora_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+
+/*-----------------------------------Página do commit inicial (malloc e strcat)-------------------------------*/
+static void pagina_antiga(const struct canal_pagina *pwm, envia_chunk_t envia, void *destino)
+{
+
+    char *buffer;
+    buffer = (char *) malloc(4000);
+    
+    const char *index_html_part1= "<!DOCTYPE html><html><head><meta content=\"text/html;charset=utf-8\" http-equiv=\"Content-Type\"> <meta content=\"utf-8\" http-equiv=\"encoding\"><meta name=\"viewport\" content=\"width=device-width, initial-scale=1\"><link rel=\"icon\" href=\"data:,\"> <title>Projeto 10 - Gerador PWM controlado via Wireless</title><style>html{color: #ffffff;font-family: Verdana;text-align: center;background-color:#272727fd}.wrap {padding-top: 2.5%;padding-right: 2.5%;padding-left: 2.5%;width: 95%;overflow:auto;}.fleft {border-style: solid;border-radius: 1px;border-width: 2px;border-color: #bdbdbd;float:left; width: 47.5%;background: rgb(95, 95, 95);height:fit-content;padding-bottom: 3%;}.fright {border-style: solid;border-radius: 1px;border-width: 2px;border-color: #bdbdbd;float: right;width: 47.5%;background:rgb(95, 95, 95);height:fit-content;padding-bottom: 3%; } .fcenter {float: center;width: 5%; background:#272727fd;height:fit-content; padding-bottom: 3%;}.formulario{padding: 0px 0px;float: center;width: 95%;text-align:center;}.campo_freq{width: 30%;text-align: center;font-family:sans-serif;font-size: 14px;font-weight: bold;border-style: solid;border-radius: 1px;border-width: 3px;border-color: #000000;}.campo_duty{-webkit-appearance: none;width: 28%;height: 5px;background: #ffffff;outline: none;opacity: 1;-webkit-transition: .2s;transition: opacity .2s;    }.campo_duty::-webkit-slider-thumb{-webkit-appearance: none;appearance: none;background: #04AA6D;}.btn_submit{text-align: center;background-color: #02500f;font-size: 20px;font-family: sans-serif;font-weight: bold;color: #ffffff;border-style: solid; border-radius: 1px;border-width: 3px;border-color: #ffffff;} </style> </head> <body><h2>Projeto 10 - Gerador PWM controlado via Wireless</h2><div class=\"wrap\"><div class=\"fleft\"><h3>PWM 0</h3><form class=\"formulario\" method=\"post\"><label>Frequência: </label><input class=\"campo_freq\" type=\"text\" id=\"freq\" name=\"freq\" value=";
+
+    char pwm0frequencia[10];
+    sprintf(pwm0frequencia, "\"%d\"", pwm[0].frequencia);
+
+    const char *index_html_part2= "autocomplete=\"off\"><label>  Hz </label><br><br> <label>Duty Cicle:&#160; </label><input class=\"campo_duty\" type=\"range\" min=\"0\" max=\"100\"  value=";
+
+    char pwm0percentual[6];
+    sprintf(pwm0percentual, "\"%d\"", pwm[0].percentual_duty);
+    
+    const char *index_html_part3="name=\"duty0\" id=\"duty0\"><label> <span id=\"demo\"></span>%</label><br><br><label>Output: </label><input name=\"estado\" id=\"1\" value=\"ligado\" class= \"campo_saida\" type=\"radio\" ";
+
+    const char *pwmchecked="checked=\"checked\"";
+    
+    const char *index_html_part4="><label>Ligado </label><input name=\"estado\" id=\"2\" value=\"desligado\"  class= \"campo_saida\" type=\"radio\"";
+
+    const char *index_html_part5="><label>Desligado </label><br><br><input class=\"btn_submit\" type=\"submit\" value=\"Atualizar\" name=\"pwm0\"></form>  </div><div class=\"fright\"><h3>PWM 1</h3><form class=\"formulario\" method=\"post\"><label>Frequência: </label><input class=\"campo_freq\" type=\"text\" id=\"freq\" name=\"freq\" value=";
+    
+    char pwm1frequencia[10];
+    sprintf(pwm1frequencia, "\"%d\"", pwm[1].frequencia);
+    
+    const char *index_html_part6="autocomplete=\"off\"><label>  Hz </label><br><br> <label>Duty Cicle:&#160; </label><input class=\"campo_duty\" type=\"range\" min=\"0\" max=\"100\" value=";
+    
+    char pwm1percentual[6];
+    sprintf(pwm1percentual, "\"%d\"", pwm[1].percentual_duty);
+    
+    const char *index_html_part7="name=\"duty1\"id=\"duty1\"><label> <span id=\"demo2\"></span>%</label><br><br><label>Output: </label>   <input name=\"estado\"id=\"2\" value=\"ligado\"class= \"campo_saida\" type=\"radio\"";
+    
+    const char *index_html_part8="><label>Desligado </label><br><br><input class=\"btn_submit\" type=\"submit\" value=\"Atualizar\" name=\"pwm1\"></form></div></div><script>var slider = document.getElementById(\"duty0\");var output = document.getElementById(\"demo\");output.innerHTML = slider.value;slider.oninput = function() {output.innerHTML = this.value;}; var slider2 = document.getElementById(\"duty1\");var output2 = document.getElementById(\"demo2\");output2.innerHTML = slider2.value;slider2.oninput = function() {output2.innerHTML = this.value;}</script></body></html>";
+   
+    strcpy(buffer, index_html_part1);
+    strcat(buffer, pwm0frequencia);
+    strcat(buffer, index_html_part2);
+    strcat(buffer, pwm0percentual);
+    strcat(buffer, index_html_part3);
+    if(pwm[0].estado)
+    {
+        strcat(buffer, pwmchecked);
+    }
+    strcat(buffer, index_html_part4);
+    if(!pwm[0].estado)
+    {
+        strcat(buffer, pwmchecked);
+    }
+    strcat(buffer, index_html_part5);
+    strcat(buffer, pwm1frequencia);
+    strcat(buffer, index_html_part6);
+    strcat(buffer, pwm1percentual);
+    strcat(buffer, index_html_part7);
+    if(pwm[1].estado)
+    {
+        strcat(buffer, pwmchecked);
+    }
+    strcat(buffer, index_html_part4);
+    if(!pwm[1].estado)
+    {
+        strcat(buffer, pwmchecked);
+    }
+    strcat(buffer, index_html_part8);
+
+
+    envia(destino, buffer, strlen(buffer)); //envia via http o buffer que contém a página html completa
+    envia(destino, NULL, 0);
+
+    free(buffer);
+
+}
+
+
+/*-----------------------------------Página em chunks (primeiro commit dela)----------------------------------*/
+#define ENVIA_FRAGMENTO(saida, fragmento) envia_html((saida), (fragmento), sizeof(fragmento) - 1)
+
+static const char html_cabecalho[] = "<!DOCTYPE html><html><head><meta content=\"text/html;charset=utf-8\" http-equiv=\"Content-Type\"> <meta content=\"utf-8\" http-equiv=\"encoding\"><meta name=\"viewport\" content=\"width=device-width, initial-scale=1\"><link rel=\"icon\" href=\"data:,\"> <title>Projeto 10 - Gerador PWM controlado via Wireless</title><style>html{color: #ffffff;font-family: Verdana;text-align: center;background-color:#272727fd}.wrap {padding-top: 2.5%;padding-right: 2.5%;padding-left: 2.5%;width: 95%;overflow:auto;}.fleft {border-style: solid;border-radius: 1px;border-width: 2px;border-color: #bdbdbd;float:left; width: 47.5%;background: rgb(95, 95, 95);height:fit-content;padding-bottom: 3%;}.fright {border-style: solid;border-radius: 1px;border-width: 2px;border-color: #bdbdbd;float: right;width: 47.5%;background:rgb(95, 95, 95);height:fit-content;padding-bottom: 3%; } .fcenter {float: center;width: 5%; background:#272727fd;height:fit-content; padding-bottom: 3%;}.formulario{padding: 0px 0px;float: center;width: 95%;text-align:center;}.campo_freq{width: 30%;text-align: center;font-family:sans-serif;font-size: 14px;font-weight: bold;border-style: solid;border-radius: 1px;border-width: 3px;border-color: #000000;}.campo_duty{-webkit-appearance: none;width: 28%;height: 5px;background: #ffffff;outline: none;opacity: 1;-webkit-transition: .2s;transition: opacity .2s;    }.campo_duty::-webkit-slider-thumb{-webkit-appearance: none;appearance: none;background: #04AA6D;}.btn_submit{text-align: center;background-color: #02500f;font-size: 20px;font-family: sans-serif;font-weight: bold;color: #ffffff;border-style: solid; border-radius: 1px;border-width: 3px;border-color: #ffffff;} </style> </head> <body><h2>Projeto 10 - Gerador PWM controlado via Wireless</h2><div class=\"wrap\">";
+
+static const char html_canal_frequencia[] = "<form class=\"formulario\" method=\"post\"><label>Frequência: </label><input class=\"campo_freq\" type=\"text\" id=\"freq\" name=\"freq\" value=";
+
+static const char html_canal_duty[] = "autocomplete=\"off\"><label>  Hz </label><br><br> <label>Duty Cicle:&#160; </label><input class=\"campo_duty\" type=\"range\" min=\"0\" max=\"100\" value=";
+
+static const char html_canal_ligado[] = "%</label><br><br><label>Output: </label><input name=\"estado\" value=\"ligado\" class= \"campo_saida\" type=\"radio\" ";
+
+static const char html_checked[] = " checked=\"checked\"";
+
+static const char html_canal_desligado[] = "><label>Ligado </label><input name=\"estado\" value=\"desligado\" class= \"campo_saida\" type=\"radio\"";
+
+static const char html_canal_fim[] = "><label>Desligado </label><br><br><input class=\"btn_submit\" type=\"submit\" value=\"Atualizar\" name=";
+
+static const char html_rodape[] = "</div><script>document.querySelectorAll(\".campo_duty\").forEach(function(slider){var output = document.getElementById(\"demo\" + slider.id.substring(4));output.innerHTML = slider.value;slider.oninput = function() {output.innerHTML = this.value;};});</script></body></html>";
+
+static int pagina_em_chunks(const struct canal_pagina *pwm, int num_canais, envia_chunk_t envia, void *alvo)
+{
+    struct saida_html saida;
+    inicia_saida_html(&saida, envia, alvo);
+
+    ENVIA_FRAGMENTO(&saida, html_cabecalho);
+
+    for (int i = 0; i < num_canais; i++) {
+        envia_html_formatado(&saida, "<div class=\"%s\"><h3>PWM %d</h3>", (i % 2) ? "fright" : "fleft", i);
+        ENVIA_FRAGMENTO(&saida, html_canal_frequencia);
+        envia_html_formatado(&saida, "\"%d\"", pwm[i].frequencia);
+        ENVIA_FRAGMENTO(&saida, html_canal_duty);
+        envia_html_formatado(&saida, "\"%d\" name=\"duty%d\" id=\"duty%d\"><label> <span id=\"demo%d\"></span>",
+                             pwm[i].percentual_duty, i, i, i);
+        ENVIA_FRAGMENTO(&saida, html_canal_ligado);
+        if (pwm[i].estado)
+            ENVIA_FRAGMENTO(&saida, html_checked);
+        ENVIA_FRAGMENTO(&saida, html_canal_desligado);
+        if (!pwm[i].estado)
+            ENVIA_FRAGMENTO(&saida, html_checked);
+        ENVIA_FRAGMENTO(&saida, html_canal_fim);
+        envia_html_formatado(&saida, "\"pwm%d\"></form></div>", i);
+    }
+
+    ENVIA_FRAGMENTO(&saida, html_rodape);
+    return finaliza_saida_html(&saida);
+}
+
+
+/*-----------------------------------------------Testes-------------------------------------------------------*/
+//As duas versões mandam a mesma página, a menos dos ids que a antiga repetia e que a nova tirou
+static void test_as_duas_paginas_tem_os_mesmos_valores(void)
+{
+    pagina_antiga(canais, envia_teste, &destino);
+    TEST_ASSERT_TRUE(destino.terminou);
+    TEST_ASSERT_EQUAL_INT(1, destino.chunks);
+    TEST_ASSERT_NOT_NULL(strstr(destino.resposta, "value=\"2500000\""));
+    size_t tamanho_antiga = destino.tamanho;
+
+    setUp();
+    TEST_ASSERT_EQUAL_INT(0, pagina_em_chunks(canais, 2, envia_teste, &destino));
+    TEST_ASSERT_TRUE(destino.terminou);
+    TEST_ASSERT_NOT_NULL(strstr(destino.resposta, "value=\"2500000\""));
+    TEST_ASSERT_NOT_NULL(strstr(destino.resposta, "\"100\" name=\"duty1\""));
+    TEST_ASSERT_NOT_NULL(strstr(destino.resposta, "</html>"));
+    TEST_ASSERT_INT_WITHIN(tamanho_antiga / 5, tamanho_antiga, destino.tamanho);
+}
+
+//Fragmentos pequenos vão juntos, em chunks do tamanho do buffer, e os grandes vão direto, sem cópia
+static void test_junta_fragmentos_e_manda_os_grandes_direto(void)
+{
+    static char grande[1500];
+    memset(grande, 'g', sizeof(grande));
+
+    struct saida_html saida;
+    inicia_saida_html(&saida, envia_teste, &destino);
+    for (int i = 0; i < 100; i++)
+        envia_html(&saida, "0123456789", 10);                   //1000 bytes: um chunk cheio e sobra
+    TEST_ASSERT_EQUAL_INT(1, destino.chunks);
+    TEST_ASSERT_EQUAL_UINT32(510, destino.tamanho);             //51 fragmentos inteiros cabem em 512
+
+    envia_html(&saida, grande, sizeof(grande));                 //esvazia o que tinha e manda o grande
+    TEST_ASSERT_EQUAL_INT(3, destino.chunks);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(grande), destino.maior_chunk);
+
+    envia_html_formatado(&saida, "[%d]", 42);
+    TEST_ASSERT_EQUAL_INT(0, finaliza_saida_html(&saida));
+    TEST_ASSERT_EQUAL_INT(4, destino.chunks);
+    TEST_ASSERT_TRUE(destino.terminou);
+    TEST_ASSERT_EQUAL_UINT32(1000 + sizeof(grande) + 4, destino.tamanho);
+    TEST_ASSERT_EQUAL_STRING("[42]", destino.resposta + destino.tamanho - 4);
+}
+
+//Depois do primeiro erro do envio nada mais é enviado, nem o fim da resposta, e o erro chega a quem chamou
+static void test_erro_do_envio_para_a_saida(void)
+{
+    destino.falha_no_chunk = 2;
+    int erro = pagina_em_chunks(canais, 2, envia_teste, &destino);
+    TEST_ASSERT_EQUAL_INT(-2, erro);
+    TEST_ASSERT_EQUAL_INT(2, destino.chunks);
+    TEST_ASSERT_FALSE(destino.terminou);
+}
+
+static void test_campo_maior_que_o_buffer_de_formatacao(void)
+{
+    static char texto[200];
+    memset(texto, 'x', sizeof(texto) - 1);
+
+    struct saida_html saida;
+    inicia_saida_html(&saida, envia_teste, &destino);
+    envia_html(&saida, "antes", 5);
+    envia_html_formatado(&saida, "%s", texto);
+    envia_html(&saida, "depois", 6);
+    TEST_ASSERT_EQUAL_INT(SAIDA_HTML_CAMPO_GRANDE, finaliza_saida_html(&saida));
+    TEST_ASSERT_EQUAL_INT(0, destino.chunks);                   //nada sai, nem o que estava no buffer
+    TEST_ASSERT_FALSE(destino.terminou);
+}
+
+
+/*---------------------------------------------Benchmark------------------------------------------------------*/
+//Tempo médio de uma página, até o primeiro chunk sair e inteira, e o pico do heap durante ela
+static void mede_pagina(const char *nome, int num_canais, bool antiga)
+{
+    struct canal_pagina pwm[16];
+    for (int i = 0; i < 16; i++)
+        pwm[i] = canais[i % 2];
+
+    size_t em_uso = sim_heap_em_uso();
+    sim_heap_reinicia_pico();
+    int64_t pagina_ns = 0, primeiro_chunk_ns = 0;
+    for (int r = 0; r < REPETICOES_BENCHMARK; r++) {
+        setUp();
+        int64_t inicio_ns = agora_ns();
+        if (antiga)
+            pagina_antiga(pwm, envia_teste, &destino);
+        else
+            pagina_em_chunks(pwm, num_canais, envia_teste, &destino);
+        pagina_ns += agora_ns() - inicio_ns;
+        primeiro_chunk_ns += destino.primeiro_chunk_ns - inicio_ns;
+    }
+    TEST_ASSERT_TRUE(destino.terminou);
+    TEST_ASSERT_EQUAL_UINT32(em_uso, sim_heap_em_uso());
+
+    printf("BENCH %-26s %5u bytes %2d chunks (maior %4u)  primeiro %5.2f us  inteira %5.2f us  heap +%u  "
+           "pilha %u\n", nome, (unsigned)destino.tamanho, destino.chunks, (unsigned)destino.maior_chunk,
+           primeiro_chunk_ns / 1000.0 / REPETICOES_BENCHMARK, pagina_ns / 1000.0 / REPETICOES_BENCHMARK,
+           (unsigned)(sim_heap_pico() - em_uso), antiga ? 0 : (unsigned)sizeof(struct saida_html));
+}
+
+static void test_benchmark(void)
+{
+    mede_pagina("malloc e strcat, 2 canais", 2, true);
+    mede_pagina("em chunks, 2 canais", 2, false);
+    //a antiga não cabia com mais canais: o malloc era de 4000 bytes
+    mede_pagina("em chunks, 16 canais", 16, false);
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_as_duas_paginas_tem_os_mesmos_valores);
+    RUN_TEST(test_junta_fragmentos_e_manda_os_grandes_direto);
+    RUN_TEST(test_erro_do_envio_para_a_saida);
+    RUN_TEST(test_campo_maior_que_o_buffer_de_formatacao);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
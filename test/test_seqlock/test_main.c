@@ -0,0 +1,305 @@
+/*Estresse do seqlock (src/seqlock.c) com threads: vários escritores publicam a configuração dos 16 canais,
+cada publicação com todos os campos derivados de um mesmo número, e vários leitores conferem que cada cópia
+que fazem é de uma publicação só. Os escritores cedem a CPU no meio da escrita para que os leitores peguem
+escritas pela metade mesmo com um núcleo só; um leitor sem o seqlock mostra que o teste as enxerga.
+
+O benchmark mede a latência da publicação até a leitura por uma thread acordada por notificação, como a task
+do PWM, com os leitores disputando os dados ao mesmo tempo.
+
+    pio test -e native -f test_seqlock -v*/
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unity.h>
+
+#include "canais.h"
+#include "seqlock.h"
+
+#define NUM_ESCRITORES          3
+#define NUM_LEITORES            3
+#define PUBLICACOES_ESCRITOR    5000
+#define CANAIS_POR_CESSAO       4           //o escritor cede a CPU a cada 4 canais copiados
+#define PUBLICACOES_LATENCIA    2000
+#define INTERVALO_LATENCIA_US   200
+
+//O que a task do PWM lê: os canais e o instante da publicação
+struct publicacao{
+    struct parametros_pwm canais[NUM_CANAIS_PWM];
+    int64_t instante_ns;
+};
+
+static struct publicacao publicada;
+static uint32_t seq_publicada;
+static pthread_mutex_t mutex_escritores = PTHREAD_MUTEX_INITIALIZER;      //o spinlock do firmware
+static volatile bool parar_leitores;
+
+//Notificação da thread que aplica, como o xTaskNotifyGive/ulTaskNotifyTake
+static pthread_mutex_t mutex_notificacao = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cond_notificacao  = PTHREAD_COND_INITIALIZER;
+static uint32_t notificacoes;
+static bool parar_aplicacao;
+
+struct resultado_leitor{
+    bool     com_seqlock;
+    uint64_t leituras;
+    uint64_t repeticoes;
+    uint64_t rasgadas;              //cópias com canais de publicações diferentes
+};
+
+
+void setUp(void)
+{
+    memset(&publicada, 0, sizeof(publicada));
+    seq_publicada   = 0;
+    parar_leitores  = false;
+    parar_aplicacao = false;
+    notificacoes    = 0;
+}
+
+void tearDown(void)
+{
+}
+
+
+static int64_t agora_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+//Todos os campos do canal saem do número da publicação
+static void preenche_canal(struct parametros_pwm *canal, uint32_t numero, int i)
+{
+    canal->estado         = numero & 1;
+    canal->frequencia     = (int)(numero + i);
+    canal->duty_fino      = (int)((numero * 7 + i) & 0xFFFF);
+    canal->fase           = (int)((numero ^ i) & 0xFFFF);
+    canal->gerador        = (int)(numero % 3);
+    canal->tempo_morto_ns = (int)(numero >> 3);
+    canal->pulsos         = (int)(numero * 3);
+    canal->complementar   = (numero >> 1) & 1;
+}
+
+//Confere que os canais copiados são todos da mesma publicação
+static bool copia_inteira(const struct publicacao *copia)
+{
+    uint32_t numero = (uint32_t)copia->canais[0].frequencia;
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        struct parametros_pwm esperado;
+        const struct parametros_pwm *c = &copia->canais[i];
+        preenche_canal(&esperado, numero, i);
+        if (c->estado != esperado.estado || c->frequencia != esperado.frequencia ||
+            c->duty_fino != esperado.duty_fino || c->fase != esperado.fase || c->gerador != esperado.gerador ||
+            c->tempo_morto_ns != esperado.tempo_morto_ns || c->pulsos != esperado.pulsos ||
+            c->complementar != esperado.complementar)
+            return false;
+    }
+    return true;
+}
+
+//Publica como o publica_config_pwm, mas copiando canal a canal e, em metade das publicações, cedendo a CPU no
+//meio da escrita
+static void publica(uint32_t numero)
+{
+    struct parametros_pwm canais[NUM_CANAIS_PWM];
+    memset(canais, 0, sizeof(canais));
+    for (int i = 0; i < NUM_CANAIS_PWM; i++)
+        preenche_canal(&canais[i], numero, i);
+
+    pthread_mutex_lock(&mutex_escritores);
+    seqlock_inicia_escrita(&seq_publicada);
+    for (int i = 0; i < NUM_CANAIS_PWM; i++) {
+        memcpy(&publicada.canais[i], &canais[i], sizeof(canais[i]));
+        if ((numero & 8) && i % CANAIS_POR_CESSAO == CANAIS_POR_CESSAO - 1)
+            sched_yield();
+    }
+    publicada.instante_ns = agora_ns();
+    seqlock_termina_escrita(&seq_publicada);
+    pthread_mutex_unlock(&mutex_escritores);
+
+    pthread_mutex_lock(&mutex_notificacao);
+    notificacoes++;
+    pthread_cond_signal(&cond_notificacao);
+    pthread_mutex_unlock(&mutex_notificacao);
+}
+
+//Lê como o le_config_pwm_com_instante e conta as repetições. Com um núcleo só, o leitor que pega a escrita
+//pela metade cede a CPU antes de repetir, senão gira até o fim da fatia de tempo sem o escritor terminar
+static void le(struct publicacao *copia, uint64_t *repeticoes)
+{
+    uint32_t seq;
+    for (;;) {
+        seq = seqlock_inicia_leitura(&seq_publicada);
+        memcpy(copia, &publicada, sizeof(*copia));
+        if (!seqlock_repete_leitura(&seq_publicada, seq))
+            return;
+        (*repeticoes)++;
+        sched_yield();
+    }
+}
+
+static void *escritor(void *arg)
+{
+    uint32_t base = (uint32_t)(uintptr_t)arg << 24;
+    for (uint32_t n = 1; n <= PUBLICACOES_ESCRITOR; n++) {
+        publica(base + n * 8);                  //múltiplo de 8: números diferentes nunca coincidem nos campos
+        sched_yield();                          //os leitores também pegam a configuração parada
+    }
+    return NULL;
+}
+
+static void *leitor(void *arg)
+{
+    struct resultado_leitor *resultado = arg;
+    struct publicacao copia;
+    while (!parar_leitores) {
+        if (resultado->com_seqlock)
+            le(&copia, &resultado->repeticoes);
+        else
+            memcpy(&copia, &publicada, sizeof(copia));
+        resultado->leituras++;
+        if (!copia_inteira(&copia))
+            resultado->rasgadas++;
+        sched_yield();                          //os escritores e os outros leitores rodam entre as leituras
+    }
+    return NULL;
+}
+
+
+/*-----------------------------------------------Testes-------------------------------------------------------*/
+static void test_leitores_nunca_veem_uma_publicacao_pela_metade(void)
+{
+    pthread_t escritores[NUM_ESCRITORES], leitores[NUM_LEITORES + 1];
+    struct resultado_leitor resultados[NUM_LEITORES + 1];
+    memset(resultados, 0, sizeof(resultados));
+    for (int i = 0; i < NUM_CANAIS_PWM; i++)
+        preenche_canal(&publicada.canais[i], 0, i);
+
+    //o último leitor copia sem o seqlock, para mostrar que as escritas pela metade acontecem
+    for (int l = 0; l <= NUM_LEITORES; l++) {
+        resultados[l].com_seqlock = l < NUM_LEITORES;
+        pthread_create(&leitores[l], NULL, leitor, &resultados[l]);
+    }
+    for (int e = 0; e < NUM_ESCRITORES; e++)
+        pthread_create(&escritores[e], NULL, escritor, (void *)(uintptr_t)(e + 1));
+    for (int e = 0; e < NUM_ESCRITORES; e++)
+        pthread_join(escritores[e], NULL);
+    parar_leitores = true;
+    for (int l = 0; l <= NUM_LEITORES; l++)
+        pthread_join(leitores[l], NULL);
+
+    uint64_t leituras = 0, repeticoes = 0, rasgadas = 0;
+    for (int l = 0; l < NUM_LEITORES; l++) {
+        leituras   += resultados[l].leituras;
+        repeticoes += resultados[l].repeticoes;
+        rasgadas   += resultados[l].rasgadas;
+    }
+    printf("%d escritores, %d publicacoes: %llu leituras com o seqlock, %llu repeticoes, %llu pela metade; "
+           "sem o seqlock %llu de %llu pela metade\n", NUM_ESCRITORES, NUM_ESCRITORES * PUBLICACOES_ESCRITOR,
+           (unsigned long long)leituras, (unsigned long long)repeticoes, (unsigned long long)rasgadas,
+           (unsigned long long)resultados[NUM_LEITORES].rasgadas,
+           (unsigned long long)resultados[NUM_LEITORES].leituras);
+
+    TEST_ASSERT_EQUAL_UINT32(2 * NUM_ESCRITORES * PUBLICACOES_ESCRITOR, seq_publicada);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, (uint32_t)leituras);
+    TEST_ASSERT_EQUAL_UINT64(0, rasgadas);
+}
+
+static void test_sequencia_impar_durante_a_escrita(void)
+{
+    uint32_t seq = 0;
+    uint32_t inicio = seqlock_inicia_leitura(&seq);
+    TEST_ASSERT_FALSE(seqlock_repete_leitura(&seq, inicio));
+
+    seqlock_inicia_escrita(&seq);
+    TEST_ASSERT_EQUAL_UINT32(1, seq);
+    TEST_ASSERT_TRUE(seqlock_repete_leitura(&seq, inicio));                     //mudou durante a cópia
+    TEST_ASSERT_TRUE(seqlock_repete_leitura(&seq, seqlock_inicia_leitura(&seq)));  //começou no meio
+
+    seqlock_termina_escrita(&seq);
+    TEST_ASSERT_EQUAL_UINT32(2, seq);
+    TEST_ASSERT_FALSE(seqlock_repete_leitura(&seq, seqlock_inicia_leitura(&seq)));
+}
+
+
+/*---------------------------------------------Benchmark------------------------------------------------------*/
+static int compara_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+//A thread que aplica: dorme até a notificação e lê a última publicação, como a task do PWM
+static int64_t latencias_ns[PUBLICACOES_LATENCIA];
+static int num_latencias;
+
+static void *aplicacao(void *arg)
+{
+    uint64_t repeticoes = 0;
+    struct publicacao copia;
+    for (;;) {
+        pthread_mutex_lock(&mutex_notificacao);
+        while (notificacoes == 0 && !parar_aplicacao)
+            pthread_cond_wait(&cond_notificacao, &mutex_notificacao);
+        bool parar = parar_aplicacao && notificacoes == 0;
+        notificacoes = 0;
+        pthread_mutex_unlock(&mutex_notificacao);
+        if (parar)
+            return NULL;
+
+        le(&copia, &repeticoes);
+        if (num_latencias < PUBLICACOES_LATENCIA)
+            latencias_ns[num_latencias++] = agora_ns() - copia.instante_ns;
+    }
+}
+
+static void test_benchmark_publicacao_ate_a_leitura(void)
+{
+    pthread_t aplicador, leitores[NUM_LEITORES];
+    struct resultado_leitor resultados[NUM_LEITORES];
+    memset(resultados, 0, sizeof(resultados));
+    num_latencias = 0;
+
+    pthread_create(&aplicador, NULL, aplicacao, NULL);
+    for (int l = 0; l < NUM_LEITORES; l++) {
+        resultados[l].com_seqlock = true;
+        pthread_create(&leitores[l], NULL, leitor, &resultados[l]);
+    }
+
+    struct timespec intervalo = {0, INTERVALO_LATENCIA_US * 1000};
+    for (uint32_t n = 1; n <= PUBLICACOES_LATENCIA; n++) {
+        publica(n * 8);
+        nanosleep(&intervalo, NULL);
+    }
+
+    parar_leitores = true;
+    for (int l = 0; l < NUM_LEITORES; l++)
+        pthread_join(leitores[l], NULL);
+    pthread_mutex_lock(&mutex_notificacao);
+    parar_aplicacao = true;
+    pthread_cond_signal(&cond_notificacao);
+    pthread_mutex_unlock(&mutex_notificacao);
+    pthread_join(aplicador, NULL);
+
+    TEST_ASSERT_GREATER_THAN_INT(0, num_latencias);
+    qsort(latencias_ns, num_latencias, sizeof(latencias_ns[0]), compara_int64);
+    printf("BENCH publicacao ate a leitura (%d leitores disputando): p50 %6.1f us  p99 %6.1f us  max %7.1f us  "
+           "(%d leituras)\n", NUM_LEITORES, latencias_ns[num_latencias / 2] / 1000.0,
+           latencias_ns[(num_latencias * 99) / 100] / 1000.0, latencias_ns[num_latencias - 1] / 1000.0,
+           num_latencias);
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sequencia_impar_durante_a_escrita);
+    RUN_TEST(test_leitores_nunca_veem_uma_publicacao_pela_metade);
+    RUN_TEST(test_benchmark_publicacao_ate_a_leitura);
+    return UNITY_END();
+}
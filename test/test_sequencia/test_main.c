@@ -0,0 +1,288 @@
+/*Sequenciador (src/sequencia.c) no PC: o interpretador do texto dos programas com os limites de cada passo, e a
+máquina de passos com os prazos absolutos da varredura, da rajada, da rampa e dos laços, o fim do programa e
+uma task que acorda atrasada, que executa os passos vencidos sem empurrar os seguintes.
+
+    pio test -e native -f test_sequencia -v*/
+#include <string.h>
+
+#include <unity.h>
+
+#include "sequencia.h"
+
+#define INICIO_US               1000000
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+//Interpreta um programa que precisa ser válido e começa ele num canal parado com 'atual'
+static void inicia_programa(struct execucao_sequencia *s, const char *texto, const struct parametros_pwm *atual)
+{
+    struct passo_sequencia passos[SEQ_MAX_PASSOS];
+    int num_passos = 0;
+    char erro[64] = "";
+
+    TEST_ASSERT_TRUE_MESSAGE(sequencia_interpreta(texto, passos, &num_passos, erro, sizeof(erro)), erro);
+    memset(s, 0, sizeof(*s));
+    sequencia_inicia(s, passos, num_passos, atual, INICIO_US);
+}
+
+
+//O programa tem que ser recusado com essa mensagem
+static void confere_recusado(const char *texto, const char *mensagem)
+{
+    struct passo_sequencia passos[SEQ_MAX_PASSOS];
+    int num_passos = -1;
+    char erro[64] = "";
+
+    TEST_ASSERT_FALSE_MESSAGE(sequencia_interpreta(texto, passos, &num_passos, erro, sizeof(erro)), texto);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(mensagem, erro, texto);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(-1, num_passos, texto);
+}
+
+
+static void test_interpreta_todos_os_passos(void)
+{
+    struct passo_sequencia passos[SEQ_MAX_PASSOS];
+    int num_passos = 0;
+    char erro[64] = "";
+
+    //separadores misturados e letras minúsculas
+    TEST_ASSERT_TRUE(sequencia_interpreta(" e1;F1000\r\nD32768\tR0,500 W100; s2000,100,10 B3,10,20 L1,2 ",
+                                          passos, &num_passos, erro, sizeof(erro)));
+    TEST_ASSERT_EQUAL_INT(8, num_passos);
+
+    TEST_ASSERT_EQUAL_UINT8(SEQ_ESTADO, passos[0].op);
+    TEST_ASSERT_EQUAL_UINT32(1, passos[0].valor);
+    TEST_ASSERT_EQUAL_UINT8(SEQ_FREQUENCIA, passos[1].op);
+    TEST_ASSERT_EQUAL_UINT32(1000, passos[1].valor);
+    TEST_ASSERT_EQUAL_UINT8(SEQ_DUTY, passos[2].op);
+    TEST_ASSERT_EQUAL_UINT32(32768, passos[2].valor);
+    TEST_ASSERT_EQUAL_UINT8(SEQ_RAMPA, passos[3].op);
+    TEST_ASSERT_EQUAL_UINT32(0, passos[3].valor);
+    TEST_ASSERT_EQUAL_UINT32(500, passos[3].ms);
+    TEST_ASSERT_EQUAL_UINT8(SEQ_ESPERA, passos[4].op);
+    TEST_ASSERT_EQUAL_UINT32(100, passos[4].ms);
+    TEST_ASSERT_EQUAL_UINT8(SEQ_VARREDURA, passos[5].op);
+    TEST_ASSERT_EQUAL_UINT32(2000, passos[5].valor);
+    TEST_ASSERT_EQUAL_UINT32(100, passos[5].ms);
+    TEST_ASSERT_EQUAL_UINT16(10, passos[5].n);
+    TEST_ASSERT_EQUAL_UINT8(SEQ_RAJADA, passos[6].op);
+    TEST_ASSERT_EQUAL_UINT16(3, passos[6].n);
+    TEST_ASSERT_EQUAL_UINT32(10, passos[6].ms);
+    TEST_ASSERT_EQUAL_UINT32(20, passos[6].valor);
+    TEST_ASSERT_EQUAL_UINT8(SEQ_LACO, passos[7].op);
+    TEST_ASSERT_EQUAL_UINT32(1, passos[7].valor);
+    TEST_ASSERT_EQUAL_UINT16(2, passos[7].n);
+
+    //programa vazio é válido: é o que para a sequência
+    TEST_ASSERT_TRUE(sequencia_interpreta(" ;\n", passos, &num_passos, erro, sizeof(erro)));
+    TEST_ASSERT_EQUAL_INT(0, num_passos);
+}
+
+
+static void test_interpreta_recusa_programas_invalidos(void)
+{
+    confere_recusado("W1 W1 W1 W1 W1 W1 W1 W1 W1 W1 W1 W1 W1 W1 W1 W1 W1", "Mais de 16 passos");
+    confere_recusado("F1000 D1x", "Passo 1: numero invalido");
+    confere_recusado("F4294967296", "Passo 0: numero invalido");
+    confere_recusado("F", "Passo 0: numero invalido");
+    confere_recusado("W1,2,3,4", "Passo 0: numero invalido");
+    confere_recusado("X1", "Passo 0: passo desconhecido, use E F D R W S B ou L");
+    confere_recusado("E2", "Passo 0: E<0|1>");
+    confere_recusado("F0", "Passo 0: F<hz>");
+    confere_recusado("F40000001", "Passo 0: F<hz>");
+    confere_recusado("D65536", "Passo 0: D<duty de 0 a 65535>");
+    confere_recusado("R100,0", "Passo 0: R<duty de 0 a 65535>,<ms>");
+    confere_recusado("W3600001", "Passo 0: W<ms>");
+    confere_recusado("S1000,5,10", "Passo 0: S<hz>,<ms>,<degraus>");          //menos de 1 ms por degrau
+    confere_recusado("S1000,2000,1001", "Passo 0: S<hz>,<ms>,<degraus>");
+    confere_recusado("B0,10,10", "Passo 0: B<pulsos>,<ms ligado>,<ms desligado>");
+    confere_recusado("W10 L1,2", "Passo 1: L<passo anterior>,<vezes>");        //o laço só volta
+    confere_recusado("W10 L0,65536", "Passo 1: L<passo anterior>,<vezes>");
+    confere_recusado("W10 F100 W0 L1,0", "Passo 3: L precisa de uma espera no trecho repetido");
+    confere_recusado("W10 L", "Passo 1: numero invalido");
+
+    //os limites aceitos
+    struct passo_sequencia passos[SEQ_MAX_PASSOS];
+    int num_passos = 0;
+    char erro[64] = "";
+    TEST_ASSERT_TRUE(sequencia_interpreta("F1 F40000000 D65535 R0,3600000 S1,1000,1000 B65535,1,1 L0,0",
+                                          passos, &num_passos, erro, sizeof(erro)));
+    TEST_ASSERT_EQUAL_INT(7, num_passos);
+}
+
+
+static void test_varredura_em_degraus_com_prazos_absolutos(void)
+{
+    struct parametros_pwm atual = {.estado = true, .frequencia = 1000, .duty_fino = 30000};
+    struct execucao_sequencia s;
+    bool terminou;
+
+    inicia_programa(&s, "S2000,100,4", &atual);
+    TEST_ASSERT_TRUE(s.executando);
+    TEST_ASSERT_EQUAL_INT64(INICIO_US, sequencia_proximo_prazo(&s, INICIO_US));
+
+    //cada degrau no seu prazo: 1250, 1500, 1750 e 2000 Hz a cada 25 ms
+    for (int degrau = 1; degrau <= 4; degrau++) {
+        int64_t agora_us = INICIO_US + (degrau - 1) * 25000;
+        TEST_ASSERT_EQUAL_UINT32(1, sequencia_avanca(&s, agora_us, &terminou));
+        TEST_ASSERT_FALSE(terminou);
+        TEST_ASSERT_EQUAL_INT(1000 + 250 * degrau, s.saida.frequencia);
+        TEST_ASSERT_EQUAL_INT64(INICIO_US + degrau * 25000, s.prazo_us);
+        TEST_ASSERT_TRUE(sequencia_segura_canal(&s, agora_us));
+
+        //antes do prazo nada acontece
+        TEST_ASSERT_EQUAL_UINT32(0, sequencia_avanca(&s, s.prazo_us - 1, &terminou));
+    }
+
+    //no último prazo o programa termina com a frequência final, que vira a configuração do canal
+    TEST_ASSERT_EQUAL_UINT32(0, sequencia_avanca(&s, INICIO_US + 100000, &terminou));
+    TEST_ASSERT_TRUE(terminou);
+    TEST_ASSERT_FALSE(s.executando);
+    TEST_ASSERT_EQUAL_INT(2000, s.saida.frequencia);
+    TEST_ASSERT_EQUAL_INT(30000, s.saida.duty_fino);
+    TEST_ASSERT_EQUAL_UINT32(4, s.passos_executados);
+    TEST_ASSERT_FALSE(sequencia_segura_canal(&s, INICIO_US + 100000));
+    TEST_ASSERT_EQUAL_INT64(INT64_MAX, sequencia_proximo_prazo(&s, INICIO_US + 100000));
+}
+
+
+static void test_rajada_liga_e_zera_o_duty(void)
+{
+    struct parametros_pwm atual = {.estado = true, .frequencia = 5000, .duty_fino = 1000};
+    struct execucao_sequencia s;
+    bool terminou;
+
+    //o duty dos pulsos é o último pedido por D, a rajada termina com o duty zerado
+    inicia_programa(&s, "D40000 B2,10,30", &atual);
+    const int32_t duty[]   = {40000, 0, 40000, 0};
+    const int64_t prazo[]  = {10000, 40000, 50000, 80000};
+    int64_t agora_us = INICIO_US;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_UINT32((i == 0) ? 2 : 1, sequencia_avanca(&s, agora_us, &terminou));
+        TEST_ASSERT_EQUAL_INT(duty[i], s.saida.duty_fino);
+        TEST_ASSERT_EQUAL_INT64(INICIO_US + prazo[i], s.prazo_us);
+        agora_us = s.prazo_us;
+    }
+    sequencia_avanca(&s, agora_us, &terminou);
+    TEST_ASSERT_TRUE(terminou);
+    TEST_ASSERT_EQUAL_INT(0, s.saida.duty_fino);
+    TEST_ASSERT_EQUAL_INT(5000, s.saida.frequencia);
+}
+
+
+static void test_rampa_segura_o_canal_ate_o_fim_do_fade(void)
+{
+    struct parametros_pwm atual = {.estado = true, .frequencia = 1000, .duty_fino = 0};
+    struct execucao_sequencia s;
+    bool terminou;
+
+    inicia_programa(&s, "R65535,200", &atual);
+    TEST_ASSERT_EQUAL_UINT32(1, sequencia_avanca(&s, INICIO_US, &terminou));
+    TEST_ASSERT_EQUAL_INT(65535, s.saida.duty_fino);
+    TEST_ASSERT_EQUAL_UINT32(200, s.rampa_ms);
+    TEST_ASSERT_EQUAL_INT64(INICIO_US + 200000, s.fim_rampa_us);
+
+    //parada no meio da rampa (programa vazio) a sequência não roda mais, mas o canal fica com ela até o fade
+    //terminar, e a task precisa acordar nesse instante
+    sequencia_inicia(&s, NULL, 0, &atual, INICIO_US + 50000);
+    TEST_ASSERT_FALSE(s.executando);
+    TEST_ASSERT_TRUE(sequencia_segura_canal(&s, INICIO_US + 50000));
+    TEST_ASSERT_EQUAL_INT64(INICIO_US + 200000, sequencia_proximo_prazo(&s, INICIO_US + 50000));
+    TEST_ASSERT_FALSE(sequencia_segura_canal(&s, INICIO_US + 200000));
+    TEST_ASSERT_EQUAL_INT64(INT64_MAX, sequencia_proximo_prazo(&s, INICIO_US + 200000));
+}
+
+
+static void test_laco_repete_o_trecho(void)
+{
+    struct parametros_pwm atual = {.estado = false, .frequencia = 1000, .duty_fino = 0};
+    struct execucao_sequencia s;
+    bool terminou = false;
+    uint32_t executados = 0;
+
+    //E1 W10 E0 W10 repetido 3 vezes ao todo: 60 ms, 4 passos por volta mais o L
+    inicia_programa(&s, "E1 W10 E0 W10 L0,3", &atual);
+    int ligado_ms = 0;
+    for (int64_t agora_us = INICIO_US; !terminou; agora_us += 1000) {
+        executados += sequencia_avanca(&s, agora_us, &terminou);
+        ligado_ms += s.saida.estado;
+    }
+    TEST_ASSERT_EQUAL_UINT32(3 * 5, executados);
+    TEST_ASSERT_EQUAL_UINT32(executados, s.passos_executados);
+    TEST_ASSERT_EQUAL_INT(30, ligado_ms);
+    TEST_ASSERT_FALSE(s.saida.estado);
+
+    //L<passo>,0 repete para sempre
+    inicia_programa(&s, "W10 L0,0", &atual);
+    TEST_ASSERT_EQUAL_UINT32(2 * 1000 + 1, sequencia_avanca(&s, INICIO_US + 10000000, &terminou));
+    TEST_ASSERT_FALSE(terminou);
+    TEST_ASSERT_TRUE(s.executando);
+    TEST_ASSERT_EQUAL_INT64(INICIO_US + 10010000, s.prazo_us);
+}
+
+
+static void test_task_atrasada_nao_empurra_os_prazos(void)
+{
+    struct parametros_pwm atual = {.estado = true, .frequencia = 1000, .duty_fino = 0};
+    struct execucao_sequencia s;
+    bool terminou;
+
+    //a task acorda 37 ms depois do começo de uma varredura de 10 degraus de 10 ms: os degraus vencidos
+    //são executados de uma vez e o próximo continua no prazo do programa
+    inicia_programa(&s, "S11000,100,10 D100", &atual);
+    TEST_ASSERT_EQUAL_UINT32(4, sequencia_avanca(&s, INICIO_US + 37000, &terminou));
+    TEST_ASSERT_EQUAL_INT(5000, s.saida.frequencia);
+    TEST_ASSERT_EQUAL_INT64(INICIO_US + 40000, s.prazo_us);
+
+    //atrasada além do fim do programa, tudo é executado numa passada e ele termina
+    TEST_ASSERT_EQUAL_UINT32(7, sequencia_avanca(&s, INICIO_US + 500000, &terminou));
+    TEST_ASSERT_TRUE(terminou);
+    TEST_ASSERT_EQUAL_INT(11000, s.saida.frequencia);
+    TEST_ASSERT_EQUAL_INT(100, s.saida.duty_fino);
+}
+
+
+static void test_programa_novo_continua_de_onde_o_anterior_parou(void)
+{
+    struct parametros_pwm atual = {.estado = true, .frequencia = 1000, .duty_fino = 0};
+    struct parametros_pwm outra = {.estado = true, .frequencia = 7, .duty_fino = 7};
+    struct execucao_sequencia s;
+    bool terminou;
+
+    inicia_programa(&s, "F3000 D20000 W1000", &atual);
+    sequencia_avanca(&s, INICIO_US, &terminou);
+
+    //com a sequência rodando, o programa novo parte da saída dela e não da configuração publicada
+    struct passo_sequencia passos[SEQ_MAX_PASSOS];
+    int num_passos;
+    char erro[64];
+    TEST_ASSERT_TRUE(sequencia_interpreta("B1,10,10", passos, &num_passos, erro, sizeof(erro)));
+    sequencia_inicia(&s, passos, num_passos, &outra, INICIO_US + 5000);
+    TEST_ASSERT_EQUAL_UINT32(0, s.passos_executados);
+    TEST_ASSERT_EQUAL_UINT32(1, sequencia_avanca(&s, INICIO_US + 5000, &terminou));
+    TEST_ASSERT_EQUAL_INT(3000, s.saida.frequencia);
+    TEST_ASSERT_EQUAL_INT(20000, s.saida.duty_fino);
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_interpreta_todos_os_passos);
+    RUN_TEST(test_interpreta_recusa_programas_invalidos);
+    RUN_TEST(test_varredura_em_degraus_com_prazos_absolutos);
+    RUN_TEST(test_rajada_liga_e_zera_o_duty);
+    RUN_TEST(test_rampa_segura_o_canal_ate_o_fim_do_fade);
+    RUN_TEST(test_laco_repete_o_trecho);
+    RUN_TEST(test_task_atrasada_nao_empurra_os_prazos);
+    RUN_TEST(test_programa_novo_continua_de_onde_o_anterior_parou);
+    return UNITY_END();
+}
@@ -0,0 +1,421 @@
+/*O firmware inteiro no PC: o main.c compila com os cabeçalhos de test/stubs, o app_main sobe as tasks (threads)
+e, quando a rede simulada dá o IP, o server. Os testes fazem as requisições pelos handlers registrados e
+conferem o que chegou aos registradores simulados; os benchmarks medem o parse dos corpos, o tempo das
+respostas, o heap e a latência do POST até o ledc_update_duty do canal.
+
+    pio test -e native -f test_simulacao -v
+
+Os números dos benchmarks são do PC, não do ESP32: servem para comparar versões do código, não como valores
+absolutos. O -v mostra as linhas "BENCH"*/
+#include <unity.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"       //o main.c usa os formatos do Xtensa (%lld para int64_t)
+#include "../../src/main.c"
+#pragma GCC diagnostic pop
+
+//a página embutida, como o board_build.embed_files faz no firmware (o pio roda o compilador na raiz do projeto)
+#define EMBUTE_ARQUIVO(simbolo, caminho)                        \
+    asm(".section .rodata\n"                                    \
+        ".global _binary_" simbolo "_start\n"                   \
+        "_binary_" simbolo "_start:\n"                          \
+        ".incbin \"" caminho "\"\n"                             \
+        ".global _binary_" simbolo "_end\n"                     \
+        "_binary_" simbolo "_end:\n"                            \
+        ".previous\n")
+EMBUTE_ARQUIVO("index_html_gz", "webpage/gerado/index.html.gz");
+EMBUTE_ARQUIVO("style_css_gz", "webpage/gerado/style.css.gz");
+EMBUTE_ARQUIVO("app_js_gz", "webpage/gerado/app.js.gz");
+
+#define CANAL_TESTE             3
+#define PRAZO_APLICACAO_MS      1000
+#define REPETICOES_PARSE        20000
+#define REPETICOES_RESPOSTA     2000
+#define REPETICOES_LATENCIA     500
+#define INTERVALO_SLIDER_MS     100         //um PUT a cada 100 ms, como a página enquanto o slider é arrastado
+
+static struct sim_resposta resposta;        //grande demais para a pilha, e fora do heap medido
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+static int compara_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+//Imprime a mediana, o p99 e o máximo de 'n' durações em ns
+static void imprime_percentis(const char *nome, int64_t *duracoes_ns, int n)
+{
+    qsort(duracoes_ns, n, sizeof(duracoes_ns[0]), compara_int64);
+    printf("BENCH %-34s p50 %8.1f us  p99 %8.1f us  max %8.1f us  (%d amostras)\n", nome,
+           duracoes_ns[n / 2] / 1000.0, duracoes_ns[(n * 99) / 100] / 1000.0, duracoes_ns[n - 1] / 1000.0, n);
+}
+
+//O duty que o LEDC recebe para 'percentual' na frequência dada, pela mesma conta do firmware
+static uint32_t duty_esperado(uint32_t frequencia, int percentual)
+{
+    struct config_timer_pwm timer;
+    TEST_ASSERT_TRUE(timer_pwm_calcula(frequencia, PWM_CLK_APB, &timer));
+    return (uint32_t)(((uint64_t)PERCENTUAL_PARA_DUTY_FINO(percentual) << timer.resolucao_duty) / DUTY_FINO_MAXIMO);
+}
+
+//Faz o POST do formulário e espera o ledc_update_duty do canal de teste, retorna a latência em ns
+static int64_t post_ate_duty(const char *corpo, struct sim_registro *aplicado)
+{
+    uint64_t marca = sim_total_registros();
+    int64_t inicio_ns = sim_agora_ns();
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_POST, "/", corpo, &resposta));
+    TEST_ASSERT_EQUAL_STRING("303 See Other", resposta.status);
+    TEST_ASSERT_TRUE(sim_espera_registro("ledc_update_duty", modo_do_canal(CANAL_TESTE), canal_ledc(CANAL_TESTE),
+                                         marca, PRAZO_APLICACAO_MS, aplicado));
+    return aplicado->ns - inicio_ns;
+}
+
+
+/*-----------------------------------------------Testes-------------------------------------------------------*/
+static void test_boot_configura_ledc_mcpwm_e_server(void)
+{
+    //o boot configura os 16 canais com o timer 0 do grupo e as duas unidades do MCPWM
+    TEST_ASSERT_EQUAL_INT(NUM_CANAIS_PWM, sim_conta_registros("ledc_channel_config", 0));
+    TEST_ASSERT_EQUAL_INT(2, sim_conta_registros("mcpwm_group_set_resolution", 0));
+    TEST_ASSERT_EQUAL_INT(pinos_pwm[CANAL_TESTE],
+                          sim_ledc()->canais[modo_do_canal(CANAL_TESTE)][canal_ledc(CANAL_TESTE)].gpio);
+
+    //e o server sobe com todas as URIs quando a rede dá o IP
+    TEST_ASSERT_NOT_NULL(server);
+    TEST_ASSERT_EQUAL_INT(NUM_URIS_HTTP, sim_httpd()->num_uris);
+}
+
+static void test_post_formulario_chega_ao_ledc(void)
+{
+    struct sim_registro aplicado;
+    post_ate_duty("freq3=2000&duty3=40&estado3=ligado&pwm3=Aplicar", &aplicado);
+    TEST_ASSERT_UINT32_WITHIN(1, duty_esperado(2000, 40), (uint32_t)aplicado.arg[2]);
+
+    //o timer do canal ficou com o divisor e a resolução de 2 kHz
+    struct config_timer_pwm timer;
+    TEST_ASSERT_TRUE(timer_pwm_calcula(2000, PWM_CLK_APB, &timer));
+    struct sim_ledc *ledc = sim_ledc();
+    int t = ledc->canais[modo_do_canal(CANAL_TESTE)][canal_ledc(CANAL_TESTE)].timer;
+    TEST_ASSERT_EQUAL_UINT32(timer.divisor, ledc->timers[modo_do_canal(CANAL_TESTE)][t].divisor);
+    TEST_ASSERT_EQUAL_UINT32(timer.resolucao_duty, ledc->timers[modo_do_canal(CANAL_TESTE)][t].resolucao);
+}
+
+static void test_formulario_invalido_responde_400_sem_tocar_no_ledc(void)
+{
+    const char *invalidos[] = {
+        "freq3=0",                  //frequência zero
+        "duty3=101",                //mais de 100%
+        "estado3=talvez",
+        "duty99=10",                //canal inexistente
+        "duty3=1%2",                //%XX incompleto
+        "freq3=99999999999",
+        "nada=1",                   //nenhum canal
+    };
+    for (size_t i = 0; i < sizeof(invalidos) / sizeof(invalidos[0]); i++) {
+        uint64_t marca = sim_total_registros();
+        TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_POST, "/", invalidos[i], &resposta));
+        TEST_ASSERT_EQUAL_STRING_MESSAGE("400 Bad Request", resposta.status, invalidos[i]);
+        sim_dorme_us(20000);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, sim_conta_registros("ledc_update_duty", marca), invalidos[i]);
+    }
+}
+
+static void test_put_api_pwm_aplica_e_get_devolve(void)
+{
+    uint64_t marca = sim_total_registros();
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_PUT, "/api/pwm/3",
+                                           "{\"estado\": true, \"frequencia\": 5000, \"percentual_duty\": 25}",
+                                           &resposta));
+    TEST_ASSERT_EQUAL_STRING("200 OK", resposta.status);
+    TEST_ASSERT_NOT_NULL(strstr(resposta.corpo, "\"canal\":3"));
+
+    struct sim_registro aplicado;
+    TEST_ASSERT_TRUE(sim_espera_registro("ledc_update_duty", modo_do_canal(CANAL_TESTE), canal_ledc(CANAL_TESTE),
+                                         marca, PRAZO_APLICACAO_MS, &aplicado));
+    TEST_ASSERT_UINT32_WITHIN(1, duty_esperado(5000, 25), (uint32_t)aplicado.arg[2]);
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_GET, "/api/pwm/3", NULL, &resposta));
+    TEST_ASSERT_NOT_NULL(strstr(resposta.corpo, "\"frequencia\":5000"));
+    TEST_ASSERT_NOT_NULL(strstr(resposta.corpo, "\"percentual_duty\":25"));
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_PUT, "/api/pwm/16", "{\"estado\": true}", &resposta));
+    TEST_ASSERT_EQUAL_STRING("404 Not Found", resposta.status);
+}
+
+static void test_pagina_revalidada_pelo_etag(void)
+{
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_GET, "/", NULL, &resposta));
+    TEST_ASSERT_EQUAL_STRING("200 OK", resposta.status);
+    TEST_ASSERT_EQUAL_UINT32(index_html_gz_fim - index_html_gz_inicio, resposta.tamanho);
+    TEST_ASSERT_EQUAL_UINT8(0x1f, (uint8_t)resposta.corpo[0]);      //gzip
+    TEST_ASSERT_EQUAL_UINT8(0x8b, (uint8_t)resposta.corpo[1]);
+
+    const char *etag = NULL;
+    for (int c = 0; c < resposta.num_cabecalhos; c++) {
+        if (strcmp(resposta.cabecalhos[c].campo, "ETag") == 0)
+            etag = resposta.cabecalhos[c].valor;
+    }
+    TEST_ASSERT_NOT_NULL(etag);
+
+    char cabecalhos[96];
+    snprintf(cabecalhos, sizeof(cabecalhos), "If-None-Match: %s\r\n", etag);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http_fd(1, HTTP_GET, "/", cabecalhos, NULL, &resposta));
+    TEST_ASSERT_EQUAL_STRING("304 Not Modified", resposta.status);
+    TEST_ASSERT_EQUAL_UINT32(0, resposta.tamanho);
+}
+
+//As requisições de leitura e de alteração, depois de aquecidas, não deixam nada no heap
+static void test_requisicoes_nao_deixam_nada_no_heap(void)
+{
+    static const char *const leituras[] = {"/api/pwm", "/api/pwm/3", "/api/ledc", "/api/ledc/trace", "/metrics",
+                                           "/api/medicao", "/api/preset", "/api/agenda", "/api/seq", "/",
+                                           "/style.css"};
+    const int num_leituras = sizeof(leituras) / sizeof(leituras[0]);
+    char corpo[96];
+
+    for (int aquecimento = 0; aquecimento < 2; aquecimento++) {
+        size_t em_uso = sim_heap_em_uso();
+        uint64_t alocacoes = sim_heap_alocacoes();
+        sim_heap_reinicia_pico();
+
+        for (int n = 0; n < 400; n++) {
+            if (n % 4 == 3) {
+                snprintf(corpo, sizeof(corpo), "freq3=%d&duty3=%d&estado3=1", 1000 + n, 10 + n % 80);
+                sim_http(HTTP_POST, "/", corpo, &resposta);
+            } else {
+                sim_http(HTTP_GET, leituras[n % num_leituras], NULL, &resposta);
+            }
+            TEST_ASSERT_TRUE_MESSAGE(resposta.terminou, resposta.status);
+        }
+        sim_dorme_us(50000);        //a task do PWM termina o que ficou na fila
+
+        if (aquecimento == 1) {
+            printf("BENCH heap: %d bytes de diferenca, pico +%u bytes, %llu alocacoes em 400 requisicoes\n",
+                   (int)(sim_heap_em_uso() - em_uso), (unsigned)(sim_heap_pico() - em_uso),
+                   (unsigned long long)(sim_heap_alocacoes() - alocacoes));
+            TEST_ASSERT_EQUAL_UINT32(em_uso, sim_heap_em_uso());
+            TEST_ASSERT_EQUAL_UINT64(alocacoes, sim_heap_alocacoes());
+        }
+    }
+}
+
+static void test_slider_arrastado_grava_a_nvs_uma_vez(void)
+{
+    uint64_t marca = sim_total_registros();
+    char corpo[96];
+    int ultimo = 0;
+
+    //arrasta o slider por mais tempo que o atraso da gravação: cada PUT recomeça a espera da task da NVS
+    int64_t fim_ns = sim_agora_ns() + (int64_t)(NVS_ATRASO_GRAVACAO_MS + 1000) * 1000000;
+    for (int r = 0; sim_agora_ns() < fim_ns; r++) {
+        ultimo = r % 101;
+        snprintf(corpo, sizeof(corpo), "{\"estado\": true, \"frequencia\": 5000, \"percentual_duty\": %d}", ultimo);
+        TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_PUT, "/api/pwm/3", corpo, &resposta));
+        TEST_ASSERT_EQUAL_STRING("200 OK", resposta.status);
+        sim_dorme_us(INTERVALO_SLIDER_MS * 1000);
+    }
+    TEST_ASSERT_EQUAL_INT(0, sim_conta_registros("nvs_set_blob", marca));
+
+    //uma gravação só, NVS_ATRASO_GRAVACAO_MS depois do último PUT, com o estado final
+    struct sim_registro gravado;
+    TEST_ASSERT_TRUE(sim_espera_registro("nvs_set_blob", sizeof(struct config_salva), -1, marca,
+                                         NVS_INTERVALO_MINIMO_MS + NVS_ATRASO_GRAVACAO_MS, &gravado));
+    TEST_ASSERT_EQUAL_INT(1, sim_conta_registros("nvs_set_blob", marca));
+
+    struct parametros_pwm salvos[NUM_CANAIS_PWM];
+    TEST_ASSERT_EQUAL_INT(ESP_OK, carrega_config_salva(salvos));
+    TEST_ASSERT_EQUAL_INT(PERCENTUAL_PARA_DUTY_FINO(ultimo), salvos[CANAL_TESTE].duty_fino);
+    TEST_ASSERT_EQUAL_INT(5000, salvos[CANAL_TESTE].frequencia);
+}
+
+static void test_leitura_do_pcnt_com_a_interrupcao_atrasada(void)
+{
+    //a task da medição configurou o PCNT no boot; a medição começa com o contador e os estouros zerados
+    pcnt_counter_clear(MEDICAO_UNIDADE_PCNT);
+    estouros_pcnt = 0;
+
+    struct amostra_contagem antes, pendente, depois;
+    sim_pcnt_conta(MEDICAO_UNIDADE_PCNT, MEDICAO_LIMITE_PCNT - 50, false);
+    le_contagem_pcnt(&antes, -1);
+    TEST_ASSERT_EQUAL_INT64(MEDICAO_LIMITE_PCNT - 50, antes.pulsos);
+
+    //o contador chega no limite e zera, mas a interrupção ainda não rodou quando a leitura acontece
+    sim_pcnt_conta(MEDICAO_UNIDADE_PCNT, 50, true);
+    le_contagem_pcnt(&pendente, antes.pulsos);
+    TEST_ASSERT_EQUAL_INT64(MEDICAO_LIMITE_PCNT, pendente.pulsos);
+
+    //a interrupção roda, o contador anda e a leitura seguinte continua de onde a outra parou
+    sim_pcnt_entrega_isr(MEDICAO_UNIDADE_PCNT);
+    sim_pcnt_conta(MEDICAO_UNIDADE_PCNT, 50, false);
+    le_contagem_pcnt(&depois, pendente.pulsos);
+    TEST_ASSERT_EQUAL_INT64(MEDICAO_LIMITE_PCNT + 50, depois.pulsos);
+}
+
+static void test_presets_pela_api(void)
+{
+    //salva a configuração atual como o preset 2 e a lista mostra o nome e os canais ligados
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_PUT, "/api/preset/2?nome=teste", NULL, &resposta));
+    TEST_ASSERT_EQUAL_STRING("200 OK", resposta.status);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_GET, "/api/preset", NULL, &resposta));
+    TEST_ASSERT_NOT_NULL(strstr(resposta.corpo, "{\"indice\":2,\"nome\":\"teste\",\"ligados\":"));
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_POST, "/api/preset?passo=-1", NULL, &resposta));
+    TEST_ASSERT_EQUAL_STRING("202 Accepted", resposta.status);
+
+    //o passo precisa ser um número inteiro, sem nada depois, e andar no máximo uma volta
+    const char *invalidos[] = {"abc", "1x", "", "0", "9", "-9", "1000000000", "99999999999999999999"};
+    for (size_t i = 0; i < sizeof(invalidos) / sizeof(invalidos[0]); i++) {
+        char uri[64];
+        snprintf(uri, sizeof(uri), "/api/preset?passo=%s", invalidos[i]);
+        TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_POST, uri, NULL, &resposta));
+        TEST_ASSERT_EQUAL_STRING_MESSAGE("400 Bad Request", resposta.status, invalidos[i]);
+    }
+}
+
+
+/*---------------------------------------------Benchmarks-----------------------------------------------------*/
+//Um cliente que parou de ler o /metrics não atrasa ninguém: a resposta dele fica com uma task de envio,
+//que fecha a conexão quando o prazo vence, e a outra task responde o resto
+static void test_cliente_parado_nao_segura_o_server(void)
+{
+    const int fd_parado = 5;
+    uint64_t marca = sim_total_registros();
+    struct sim_registro fechou;
+
+    sim_http_socket_parado(fd_parado, true);
+    int64_t inicio_ns = sim_agora_ns();
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http_fd(fd_parado, HTTP_GET, "/metrics", NULL, NULL, &resposta));
+    TEST_ASSERT_FALSE(resposta.terminou);
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_GET, "/api/pwm", NULL, &resposta));
+    TEST_ASSERT_TRUE(resposta.terminou);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sim_http(HTTP_GET, "/metrics", NULL, &resposta));
+    TEST_ASSERT_TRUE(resposta.terminou);
+    TEST_ASSERT_EQUAL_STRING("200 OK", resposta.status);
+    TEST_ASSERT_EQUAL_STRING("text/plain; version=0.0.4", resposta.tipo);
+    TEST_ASSERT_NOT_NULL(strstr(resposta.corpo, "pwm_http_envios_total{resultado=\"enviado\"}"));
+    TEST_ASSERT_TRUE(sim_agora_ns() - inicio_ns < HTTP_PRAZO_ENVIO_MS * 1000000LL / 10);
+    TEST_ASSERT_FALSE(sim_procura_registro("httpd_sess_trigger_close", fd_parado, -1, marca, &fechou));
+
+    TEST_ASSERT_TRUE(sim_espera_registro("httpd_sess_trigger_close", fd_parado, -1, marca,
+                                         HTTP_PRAZO_ENVIO_MS + 1000, &fechou));
+    TEST_ASSERT_TRUE(fechou.ns - inicio_ns >= HTTP_PRAZO_ENVIO_MS * 1000000LL);
+    sim_http_socket_parado(fd_parado, false);
+}
+
+static void test_benchmark_parse(void)
+{
+    //o formulário com todos os canais, o maior que a página manda, e o JSON do PUT
+    static char formulario[FORMULARIO_TAMANHO_MAXIMO];
+    size_t tamanho = 0;
+    for (int c = 0; c < NUM_CANAIS_PWM; c++)
+        tamanho += snprintf(formulario + tamanho, sizeof(formulario) - tamanho, "%sfreq%d=%d&duty%d=%d&estado%d=ligado",
+                            c > 0 ? "&" : "", c, 1000 + c * 37, c, c * 6, c);
+    const char *json = "{\"estado\": true, \"gerador\": \"ledc\", \"frequencia\": 25000, \"percentual_duty\": 33, "
+                       "\"fase\": 90, \"complementar\": false, \"tempo_morto_ns\": 0, \"pulsos\": 0}";
+
+    struct parametros_pwm canais[NUM_CANAIS_PWM];
+    le_config_pwm(canais);
+    int64_t inicio_ns = sim_agora_ns();
+    for (int r = 0; r < REPETICOES_PARSE; r++) {
+        struct parser_formulario parser;
+        parser_formulario_inicia(&parser, canais);
+        //em pedaços do tamanho dos lidos pelo handler
+        for (size_t i = 0; i < tamanho; i += FORMULARIO_PEDACO)
+            parser_formulario_alimenta(&parser, formulario + i, MIN(FORMULARIO_PEDACO, tamanho - i));
+        TEST_ASSERT_TRUE(parser_formulario_finaliza(&parser));
+        TEST_ASSERT_EQUAL_HEX32(0xFFFF, parser.mascara);
+    }
+    double formulario_ns = (double)(sim_agora_ns() - inicio_ns) / REPETICOES_PARSE;
+
+    inicio_ns = sim_agora_ns();
+    int soma = 0;
+    for (int r = 0; r < REPETICOES_PARSE; r++) {
+        int valor, gerador;
+        static const char *const campos[] = {"estado", "frequencia", "percentual_duty", "duty_fino", "fase",
+                                             "complementar", "tempo_morto_ns", "pulsos"};
+        for (size_t c = 0; c < sizeof(campos) / sizeof(campos[0]); c++)
+            soma += parser_json_campo(json, campos[c], &valor);
+        soma += parser_json_gerador(json, "gerador", &gerador);
+    }
+    double json_ns = (double)(sim_agora_ns() - inicio_ns) / REPETICOES_PARSE;
+    TEST_ASSERT_EQUAL_INT(8 * REPETICOES_PARSE, soma);
+
+    printf("BENCH parse formulario 16 canais (%u bytes): %8.2f us  %7.1f MB/s\n", (unsigned)tamanho,
+           formulario_ns / 1000, tamanho / formulario_ns * 1000);
+    printf("BENCH parse JSON do PUT (%u bytes, 9 campos): %8.2f us\n", (unsigned)strlen(json), json_ns / 1000);
+}
+
+static void test_benchmark_respostas(void)
+{
+    static const char *const uris[] = {"/", "/api/pwm", "/api/pwm/3", "/metrics", "/api/medicao"};
+    static int64_t duracoes_ns[REPETICOES_RESPOSTA];
+
+    esp_log_level_set("*", ESP_LOG_WARN);
+    for (size_t u = 0; u < sizeof(uris) / sizeof(uris[0]); u++) {
+        size_t pico = 0;
+        for (int r = 0; r < REPETICOES_RESPOSTA; r++) {
+            size_t antes = sim_heap_em_uso();
+            sim_heap_reinicia_pico();
+            int64_t inicio_ns = sim_agora_ns();
+            sim_http(HTTP_GET, uris[u], NULL, &resposta);
+            duracoes_ns[r] = sim_agora_ns() - inicio_ns;
+            pico = MAX(pico, sim_heap_pico() - antes);
+            TEST_ASSERT_TRUE_MESSAGE(resposta.terminou, uris[u]);
+        }
+        char nome[64];
+        snprintf(nome, sizeof(nome), "GET %s (%u B, %d chunks, heap +%u)", uris[u], (unsigned)resposta.tamanho,
+                 resposta.chunks, (unsigned)pico);
+        imprime_percentis(nome, duracoes_ns, REPETICOES_RESPOSTA);
+    }
+}
+
+static void test_benchmark_latencia_post_ate_duty(void)
+{
+    static int64_t latencias_ns[REPETICOES_LATENCIA];
+    char corpo[64];
+
+    for (int r = 0; r < REPETICOES_LATENCIA; r++) {
+        int percentual = 10 + r % 80;
+        snprintf(corpo, sizeof(corpo), "freq3=2000&duty3=%d&estado3=1", percentual);
+        struct sim_registro aplicado;
+        latencias_ns[r] = post_ate_duty(corpo, &aplicado);
+        TEST_ASSERT_UINT32_WITHIN(1, duty_esperado(2000, percentual), (uint32_t)aplicado.arg[2]);
+    }
+    imprime_percentis("POST / ate o ledc_update_duty", latencias_ns, REPETICOES_LATENCIA);
+}
+
+
+int main(void)
+{
+    setvbuf(stdout, NULL, _IONBF, 0);       //a saída das threads não se perde se um teste abortar
+    app_main();
+    sim_wifi_recebe_ip();
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_boot_configura_ledc_mcpwm_e_server);
+    RUN_TEST(test_post_formulario_chega_ao_ledc);
+    RUN_TEST(test_formulario_invalido_responde_400_sem_tocar_no_ledc);
+    RUN_TEST(test_put_api_pwm_aplica_e_get_devolve);
+    RUN_TEST(test_pagina_revalidada_pelo_etag);
+    RUN_TEST(test_requisicoes_nao_deixam_nada_no_heap);
+    RUN_TEST(test_slider_arrastado_grava_a_nvs_uma_vez);
+    RUN_TEST(test_leitura_do_pcnt_com_a_interrupcao_atrasada);
+    RUN_TEST(test_presets_pela_api);
+    RUN_TEST(test_cliente_parado_nao_segura_o_server);
+    RUN_TEST(test_benchmark_parse);
+    RUN_TEST(test_benchmark_respostas);
+    RUN_TEST(test_benchmark_latencia_post_ate_duty);
+    return UNITY_END();
+}
@@ -0,0 +1,236 @@
+/*timer_pwm_calcula no PC: varre de 1 Hz a 40 MHz com o clock APB e confere, para cada frequência, que a
+resolução é a maior possível, que o divisor está dentro do registrador e que o erro informado é o da
+frequência que o timer gera. A conta de referência é em ponto flutuante, escrita à parte da do firmware.
+
+    pio test -e native -f test_timer_pwm -v
+
+O benchmark compara o tempo por chamada com o da referência em double*/
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <unity.h>
+
+#include "canais.h"
+#include "timer_pwm.h"
+
+#define PASSO_VARREDURA         1.0005      //razão entre frequências vizinhas: ~22000 frequências inteiras de 1 Hz a 40 MHz
+#define REPETICOES_BENCHMARK    20
+
+//Clocks com que o firmware chama a conta: APB, REF_TICK e o APB calibrado dos dois lados
+static const uint32_t clocks[] = {PWM_CLK_APB, PWM_CLK_REF_TICK, PWM_CLK_APB - 4000, PWM_CLK_APB + 4000};
+
+static uint32_t frequencias[40000];
+static int      num_frequencias;
+
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+
+//A mesma conta em double, do jeito da documentação do LEDC
+static bool referencia_double(uint32_t frequencia, uint32_t clk, uint32_t *divisor, uint32_t *resolucao)
+{
+    if (frequencia == 0 || frequencia > clk / 2)
+        return false;
+    double bits = floor(log2((double)clk / frequencia));
+    if (bits > PWM_RESOLUCAO_MAXIMA)
+        bits = PWM_RESOLUCAO_MAXIMA;
+    double d = floor((double)clk * 256.0 / ((double)frequencia * ldexp(1.0, (int)bits)) + 0.5);
+    if (d < PWM_DIVISOR_MINIMO)
+        d = PWM_DIVISOR_MINIMO;
+    if (d > PWM_DIVISOR_MAXIMO)
+        return false;
+    *divisor   = (uint32_t)d;
+    *resolucao = (uint32_t)bits;
+    return true;
+}
+
+static int64_t agora_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+//Frequências da varredura: geométrica de 1 Hz a 40 MHz, mais as vizinhas de cada potência de 2 do clock,
+//onde a resolução muda
+static void monta_varredura(void)
+{
+    num_frequencias = 0;
+    for (double f = 1; f <= PWM_FREQUENCIA_MAXIMA; f *= PASSO_VARREDURA) {
+        uint32_t inteira = (uint32_t)f;
+        if (num_frequencias == 0 || frequencias[num_frequencias - 1] != inteira)
+            frequencias[num_frequencias++] = inteira;
+    }
+    for (int bits = 1; bits <= 27; bits++) {
+        uint32_t f = PWM_CLK_APB >> bits;
+        for (uint32_t vizinha = f - 1; vizinha <= f + 1; vizinha++) {
+            if (vizinha > 0 && vizinha <= PWM_FREQUENCIA_MAXIMA)
+                frequencias[num_frequencias++] = vizinha;
+        }
+    }
+    frequencias[num_frequencias++] = PWM_FREQUENCIA_MAXIMA;
+}
+
+
+/*-----------------------------------------------Testes-------------------------------------------------------*/
+static void test_varredura_de_1hz_a_40mhz(void)
+{
+    char mensagem[64];
+    int32_t maior_erro_ppm = 0;
+    uint32_t frequencia_maior_erro = 0;
+
+    for (int i = 0; i < num_frequencias; i++) {
+        uint32_t f = frequencias[i];
+        struct config_timer_pwm timer;
+        snprintf(mensagem, sizeof(mensagem), "%u Hz", f);
+        TEST_ASSERT_TRUE_MESSAGE(timer_pwm_calcula(f, PWM_CLK_APB, &timer), mensagem);
+
+        //divisor dentro do registrador 10.8 e resolução dentro do LEDC
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32_MESSAGE(PWM_DIVISOR_MINIMO, timer.divisor, mensagem);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(PWM_DIVISOR_MAXIMO, timer.divisor, mensagem);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32_MESSAGE(1, timer.resolucao_duty, mensagem);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(PWM_RESOLUCAO_MAXIMA, timer.resolucao_duty, mensagem);
+
+        //a maior resolução: com um bit a mais o divisor ficaria abaixo de 1.0
+        if (timer.resolucao_duty < PWM_RESOLUCAO_MAXIMA)
+            TEST_ASSERT_TRUE_MESSAGE((uint64_t)f << (timer.resolucao_duty + 1) > PWM_CLK_APB, mensagem);
+
+        //a frequência informada é a que o divisor e a resolução geram
+        double gerada = (double)PWM_CLK_APB * 256.0 / ((double)timer.divisor * ldexp(1.0, timer.resolucao_duty));
+        TEST_ASSERT_TRUE_MESSAGE(fabs(gerada * 1000.0 - (double)timer.frequencia_mhz) <= 1.0, mensagem);
+        double erro_ppm = (gerada - f) / f * 1e6;
+        TEST_ASSERT_TRUE_MESSAGE(fabs(erro_ppm - timer.erro_ppm) <= 1.0, mensagem);
+
+        //o divisor foi arredondado: o erro não passa de meio passo do divisor
+        double meio_passo_ppm = 1e6 / (2.0 * timer.divisor) + 1.0;
+        TEST_ASSERT_TRUE_MESSAGE(fabs(erro_ppm) <= meio_passo_ppm, mensagem);
+
+        if (abs(timer.erro_ppm) > abs(maior_erro_ppm)) {
+            maior_erro_ppm = timer.erro_ppm;
+            frequencia_maior_erro = f;
+        }
+    }
+    printf("%d frequencias, maior erro %d ppm em %u Hz\n", num_frequencias, (int)maior_erro_ppm,
+           frequencia_maior_erro);
+}
+
+static void test_igual_a_referencia_em_todos_os_clocks(void)
+{
+    char mensagem[64];
+    for (size_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+        for (int i = 0; i < num_frequencias; i++) {
+            uint32_t f = frequencias[i];
+            uint32_t divisor, resolucao;
+            struct config_timer_pwm timer;
+            snprintf(mensagem, sizeof(mensagem), "%u Hz com clock %u", f, clocks[c]);
+            bool possivel = referencia_double(f, clocks[c], &divisor, &resolucao);
+            TEST_ASSERT_EQUAL_INT_MESSAGE(possivel, timer_pwm_calcula(f, clocks[c], &timer), mensagem);
+            if (possivel) {
+                TEST_ASSERT_EQUAL_UINT32_MESSAGE(resolucao, timer.resolucao_duty, mensagem);
+                TEST_ASSERT_EQUAL_UINT32_MESSAGE(divisor, timer.divisor, mensagem);
+            }
+        }
+    }
+}
+
+static void test_limites(void)
+{
+    struct config_timer_pwm timer;
+
+    TEST_ASSERT_FALSE(timer_pwm_calcula(0, PWM_CLK_APB, &timer));
+    TEST_ASSERT_FALSE(timer_pwm_calcula(PWM_FREQUENCIA_MAXIMA + 1, PWM_CLK_APB, &timer));
+    TEST_ASSERT_FALSE(timer_pwm_calcula(PWM_CLK_REF_TICK / 2 + 1, PWM_CLK_REF_TICK, &timer));
+
+    //40 MHz: 1 bit com divisor 1.0, sem erro
+    TEST_ASSERT_TRUE(timer_pwm_calcula(PWM_FREQUENCIA_MAXIMA, PWM_CLK_APB, &timer));
+    TEST_ASSERT_EQUAL_UINT32(1, timer.resolucao_duty);
+    TEST_ASSERT_EQUAL_UINT32(PWM_DIVISOR_MINIMO, timer.divisor);
+    TEST_ASSERT_EQUAL_INT32(0, timer.erro_ppm);
+
+    //1 Hz: 19 bits, divisor 80 MHz / 2^19 = 152.59 (39063 em 10.8)
+    TEST_ASSERT_TRUE(timer_pwm_calcula(1, PWM_CLK_APB, &timer));
+    TEST_ASSERT_EQUAL_UINT32(PWM_RESOLUCAO_MAXIMA, timer.resolucao_duty);
+    TEST_ASSERT_EQUAL_UINT32(39063, timer.divisor);
+
+    //5 kHz: 13 bits, como no commit do cálculo
+    TEST_ASSERT_TRUE(timer_pwm_calcula(5000, PWM_CLK_APB, &timer));
+    TEST_ASSERT_EQUAL_UINT32(13, timer.resolucao_duty);
+
+    //o divisor só estoura abaixo de clock / (1024 * 2^19): com o REF_TICK nem 1 Hz chega perto
+    TEST_ASSERT_TRUE(timer_pwm_calcula(1, PWM_CLK_REF_TICK, &timer));
+    TEST_ASSERT_EQUAL_UINT32(19, timer.resolucao_duty);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(PWM_DIVISOR_MAXIMO, timer.divisor);
+}
+
+
+static void test_duty_de_100_porcento_em_1hz(void)
+{
+    struct config_timer_pwm timer;
+    uint32_t duty, hpoint;
+
+    //abaixo de ~152 Hz a resolução fica no máximo; com 20 bits o duty 2^20 zeraria a saída
+    TEST_ASSERT_TRUE(timer_pwm_calcula(1, PWM_CLK_APB, &timer));
+    timer_pwm_duty(DUTY_FINO_MAXIMO, 0, timer.resolucao_duty, &duty, &hpoint);
+    TEST_ASSERT_EQUAL_UINT32(1u << timer.resolucao_duty, duty);
+    TEST_ASSERT_LESS_THAN_UINT32(1u << 20, duty);
+    TEST_ASSERT_EQUAL_UINT32(0, hpoint);
+
+    //meio período de fase: o duty de 100% é cortado no fim do período
+    timer_pwm_duty(DUTY_FINO_MAXIMO, (DUTY_FINO_MAXIMO + 1) / 2, timer.resolucao_duty, &duty, &hpoint);
+    TEST_ASSERT_EQUAL_UINT32(1u << (timer.resolucao_duty - 1), hpoint);
+    TEST_ASSERT_EQUAL_UINT32(1u << (timer.resolucao_duty - 1), duty);
+
+    timer_pwm_duty(0, 0, timer.resolucao_duty, &duty, &hpoint);
+    TEST_ASSERT_EQUAL_UINT32(0, duty);
+}
+
+
+/*---------------------------------------------Benchmark------------------------------------------------------*/
+static void test_benchmark(void)
+{
+    volatile uint32_t soma = 0;     //para o compilador não descartar as chamadas
+    struct config_timer_pwm timer;
+
+    int64_t inicio_ns = agora_ns();
+    for (int r = 0; r < REPETICOES_BENCHMARK; r++) {
+        for (int i = 0; i < num_frequencias; i++) {
+            timer_pwm_calcula(frequencias[i], PWM_CLK_APB, &timer);
+            soma += timer.divisor;
+        }
+    }
+    double inteira_ns = (double)(agora_ns() - inicio_ns) / (REPETICOES_BENCHMARK * num_frequencias);
+
+    inicio_ns = agora_ns();
+    for (int r = 0; r < REPETICOES_BENCHMARK; r++) {
+        for (int i = 0; i < num_frequencias; i++) {
+            uint32_t divisor, resolucao;
+            referencia_double(frequencias[i], PWM_CLK_APB, &divisor, &resolucao);
+            soma += divisor;
+        }
+    }
+    double double_ns = (double)(agora_ns() - inicio_ns) / (REPETICOES_BENCHMARK * num_frequencias);
+
+    printf("BENCH timer_pwm_calcula: %6.1f ns por chamada (referencia em double: %6.1f ns)\n", inteira_ns, double_ns);
+    TEST_ASSERT_NOT_EQUAL(0, soma);
+}
+
+
+int main(void)
+{
+    monta_varredura();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_varredura_de_1hz_a_40mhz);
+    RUN_TEST(test_igual_a_referencia_em_todos_os_clocks);
+    RUN_TEST(test_limites);
+    RUN_TEST(test_duty_de_100_porcento_em_1hz);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Assinantes do WebSocket /ws do Gerador PWM, para medir o custo de empurrar o estado dos canais.
+
+Abre N conexões no /ws, muda o duty do canal pelo UDP (tools/cliente_udp.py) na taxa pedida e, pelos
+contadores do /metrics antes e depois, mostra quanto a task do server gastou enviando (pwm_ws_envio_segundos)
+e quantos bytes foram para o ar (pwm_ws_bytes_total). Rodar com 1 e depois com 10 assinantes mostra quanto
+cada assinante a mais custa: a mensagem é montada uma vez só e o que cresce é só o envio.
+
+Exemplos:
+    python3 tools/assina_ws.py 192.168.0.50 --assinantes 1 --segundos 10
+    python3 tools/assina_ws.py 192.168.0.50 --assinantes 10 --segundos 10 --udp-hz 50
+    python3 tools/assina_ws.py 192.168.0.50 --mostrar
+"""
+
+import argparse
+import base64
+import json
+import os
+import selectors
+import socket
+import struct
+import time
+import urllib.request
+
+from cliente_udp import PORTA, DUTY_FINO_MAXIMO, monta_pacote
+
+CONTADORES = ["pwm_ws_envio_segundos_sum", "pwm_ws_mensagens_total", "pwm_ws_quadros_total", "pwm_ws_bytes_total"]
+
+
+class Assinante:
+    """Cliente WebSocket mínimo: só o handshake e a leitura de quadros de texto sem máscara."""
+
+    def __init__(self, ip, porta):
+        self.sock = socket.create_connection((ip, porta), timeout=5)
+        chave = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(("GET /ws HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n" % (ip, chave)).encode())
+        resposta = b""
+        while b"\r\n\r\n" not in resposta:
+            pedaco = self.sock.recv(256)
+            if not pedaco:
+                raise ConnectionError("conexão fechada no handshake")
+            resposta += pedaco
+        if not resposta.startswith(b"HTTP/1.1 101"):
+            raise ConnectionError(resposta.split(b"\r\n")[0].decode())
+        self.buffer = resposta.split(b"\r\n\r\n", 1)[1]
+        self.mensagens = 0
+        self.bytes = 0
+
+    def recebe(self):
+        """Lê o que chegou e devolve as mensagens completas."""
+        pedaco = self.sock.recv(8192)
+        if not pedaco:
+            raise ConnectionError("conexão fechada")
+        self.buffer += pedaco
+        mensagens = []
+        while len(self.buffer) >= 2:
+            tamanho = self.buffer[1] & 0x7F
+            inicio = 2
+            if tamanho == 126:
+                if len(self.buffer) < 4:
+                    break
+                tamanho = struct.unpack(">H", self.buffer[2:4])[0]
+                inicio = 4
+            elif tamanho == 127:
+                if len(self.buffer) < 10:
+                    break
+                tamanho = struct.unpack(">Q", self.buffer[2:10])[0]
+                inicio = 10
+            if len(self.buffer) < inicio + tamanho:
+                break
+            if self.buffer[0] & 0x0F == 1:
+                mensagens.append(self.buffer[inicio:inicio + tamanho].decode())
+                self.mensagens += 1
+                self.bytes += tamanho
+            self.buffer = self.buffer[inicio + tamanho:]
+        return mensagens
+
+
+def le_contadores(ip):
+    with urllib.request.urlopen("http://%s/metrics" % ip, timeout=5) as resposta:
+        texto = resposta.read().decode()
+    valores = {}
+    for linha in texto.splitlines():
+        partes = linha.split(" ")
+        if len(partes) == 2 and partes[0] in CONTADORES:
+            valores[partes[0]] = float(partes[1])
+    return valores
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("ip")
+    parser.add_argument("--porta-http", type=int, default=80)
+    parser.add_argument("--assinantes", type=int, default=1)
+    parser.add_argument("--segundos", type=float, default=10.0)
+    parser.add_argument("--udp-hz", type=float, default=20.0, help="mudanças de duty por segundo, 0 para só ouvir")
+    parser.add_argument("--canal", type=int, default=0)
+    parser.add_argument("--frequencia", type=int, default=1000, help="Hz do canal que muda")
+    parser.add_argument("--mostrar", action="store_true", help="imprime as mensagens do primeiro assinante")
+    args = parser.parse_args()
+
+    assinantes = [Assinante(args.ip, args.porta_http) for _ in range(args.assinantes)]
+    seletor = selectors.DefaultSelector()
+    for assinante in assinantes:
+        seletor.register(assinante.sock, selectors.EVENT_READ, assinante)
+
+    antes = le_contadores(args.ip)
+    udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    inicio = time.monotonic()
+    proximo_udp = inicio
+    sequencia = 1
+    while time.monotonic() - inicio < args.segundos:
+        agora = time.monotonic()
+        if args.udp_hz > 0 and agora >= proximo_udp:
+            duty_fino = (sequencia * 997) % (DUTY_FINO_MAXIMO + 1)
+            udp.sendto(monta_pacote(sequencia, [(args.canal, 1, duty_fino, args.frequencia)]), (args.ip, PORTA))
+            sequencia += 1
+            proximo_udp += 1.0 / args.udp_hz
+        espera = max(0.0, proximo_udp - time.monotonic()) if args.udp_hz > 0 else 0.1
+        for chave, _ in seletor.select(timeout=espera):
+            for mensagem in chave.data.recebe():
+                if args.mostrar and chave.data is assinantes[0]:
+                    print(json.dumps(json.loads(mensagem)))
+    duracao = time.monotonic() - inicio
+    depois = le_contadores(args.ip)
+
+    diferenca = {nome: depois.get(nome, 0.0) - antes.get(nome, 0.0) for nome in CONTADORES}
+    print("%d assinantes, %.1f s, %d mudanças enviadas pelo UDP" % (args.assinantes, duracao, sequencia - 1))
+    print("  ESP32: %.1f mensagens/s, %.1f quadros/s, %.0f bytes/s no ar, envio ocupou %.2f%% da task do server"
+          % (diferenca["pwm_ws_mensagens_total"] / duracao, diferenca["pwm_ws_quadros_total"] / duracao,
+             diferenca["pwm_ws_bytes_total"] / duracao, 100.0 * diferenca["pwm_ws_envio_segundos_sum"] / duracao))
+    recebidas = sum(a.mensagens for a in assinantes)
+    print("  assinantes: %.1f mensagens/s cada, %.0f bytes por mensagem"
+          % (recebidas / len(assinantes) / duracao, sum(a.bytes for a in assinantes) / max(recebidas, 1)))
+
+
+if __name__ == "__main__":
+    main()
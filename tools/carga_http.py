@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+"""Teste de carga do server http do Gerador PWM: p50 e p99 com 1, 8 e 16 clientes ao mesmo tempo.
+
+Cada cliente é uma thread com a sua conexão keep-alive, fazendo requisições misturadas (leituras da API e da
+página e PUTs que mudam o duty de um canal) pelo tempo pedido. Todos os handlers rodam na mesma task do
+server, então com mais clientes o que cresce é a fila: o p99 mostra quanto um cliente espera pelos outros.
+O /metrics e o /api/medicao não entram nessa conta: saem pelas tasks de envio, fora da task do server.
+Com mais clientes que os HTTP_MAX_SOCKETS (12) do firmware, o LRU fecha as conexões paradas há mais tempo;
+o cliente reconecta e a reconexão entra na conta.
+
+Com --lento, um cliente a mais abre uma conexão e manda o corpo de um PUT um byte por vez durante todo o
+teste: o prazo do corpo (HTTP_PRAZO_CORPO_MS) responde 408 e fecha o socket, e o p99 dos outros não deve
+passar muito desse prazo. O pwm_http_corpos_expirados_total do /metrics conta esses 408.
+
+Com --parado, um cliente a mais pede o /metrics com um buffer de recepção mínimo e não lê a resposta: a task
+de envio espera ele até o HTTP_PRAZO_ENVIO_MS e fecha a conexão, sem que o p99 dos outros mude. O
+pwm_http_envios_total{resultado="falha"} conta esses envios.
+
+Exemplos:
+    python3 tools/carga_http.py 192.168.0.50
+    python3 tools/carga_http.py 192.168.0.50 --clientes 1 4 8 12 16 --segundos 20
+    python3 tools/carga_http.py 192.168.0.50 --lento --canal 3
+    python3 tools/carga_http.py 192.168.0.50 --parado
+"""
+
+import argparse
+import http.client
+import json
+import socket
+import threading
+import time
+
+LEITURAS = ["/api/pwm", "/api/pwm/0", "/api/ledc", "/api/agenda", "/api/preset", "/", "/style.css"]
+EXPIRADOS = "pwm_http_corpos_expirados_total"
+ENVIOS_FALHOS = 'pwm_http_envios_total{resultado="falha"}'
+
+
+def conecta(ip, porta):
+    """Conexão com o TCP_NODELAY, como a de um navegador: o Nagle não segura o corpo do PUT."""
+    conexao = http.client.HTTPConnection(ip, porta, timeout=10)
+    conexao.connect()
+    conexao.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    return conexao
+
+
+class Cliente(threading.Thread):
+    """Faz requisições numa conexão keep-alive até o prazo e guarda a duração de cada uma."""
+
+    def __init__(self, ip, porta, numero, canal, prazo):
+        super().__init__(daemon=True)
+        self.ip = ip
+        self.porta = porta
+        self.numero = numero
+        self.canal = canal
+        self.prazo = prazo
+        self.duracoes = []
+        self.erros = 0
+        self.reconexoes = 0
+
+    def requisicao(self, n):
+        if n % 4 == 3:
+            corpo = json.dumps({"estado": True, "percentual_duty": 10 + (n // 4 + self.numero) % 80})
+            return "PUT", "/api/pwm/%d" % self.canal, corpo
+        return "GET", LEITURAS[(n + self.numero) % len(LEITURAS)], None
+
+    def run(self):
+        conexao = None
+        n = 0
+        while time.monotonic() < self.prazo:
+            if conexao is None:
+                try:
+                    conexao = conecta(self.ip, self.porta)
+                except OSError:
+                    time.sleep(0.1)             #sem socket livre no server agora: tenta de novo
+                    continue
+            metodo, caminho, corpo = self.requisicao(n)
+            inicio = time.monotonic()
+            try:
+                conexao.request(metodo, caminho, body=corpo, headers={"Connection": "keep-alive"})
+                resposta = conexao.getresponse()
+                resposta.read()
+            except (http.client.HTTPException, OSError):
+                #o LRU do server fechou a conexão (ou ela caiu): reconecta e repete a mesma requisição
+                conexao.close()
+                conexao = None
+                self.reconexoes += 1
+                continue
+            self.duracoes.append(time.monotonic() - inicio)
+            if resposta.status >= 400:
+                self.erros += 1
+            n += 1
+        if conexao is not None:
+            conexao.close()
+
+
+class ClienteLento(threading.Thread):
+    """Manda o corpo de um PUT um byte por vez, de novo a cada 408, até o prazo."""
+
+    def __init__(self, ip, porta, canal, prazo, intervalo):
+        super().__init__(daemon=True)
+        self.ip = ip
+        self.porta = porta
+        self.canal = canal
+        self.prazo = prazo
+        self.intervalo = intervalo
+        self.respostas_408 = 0
+
+    def run(self):
+        corpo = json.dumps({"estado": True, "percentual_duty": 50}).encode()
+        while time.monotonic() < self.prazo:
+            try:
+                sock = socket.create_connection((self.ip, self.porta), timeout=10)
+                sock.sendall(("PUT /api/pwm/%d HTTP/1.1\r\nHost: %s\r\nContent-Length: %d\r\n\r\n" %
+                              (self.canal, self.ip, len(corpo))).encode())
+                for byte in corpo[:-1]:         #o último byte nunca vai: o server é que desiste
+                    sock.sendall(bytes([byte]))
+                    time.sleep(self.intervalo)
+                    if time.monotonic() >= self.prazo:
+                        break
+                else:
+                    if sock.recv(64).startswith(b"HTTP/1.1 408"):
+                        self.respostas_408 += 1
+                sock.close()
+            except OSError:
+                pass                            #o server fechou o socket no 408, antes do recv
+
+
+class ClienteParado(threading.Thread):
+    """Pede o /metrics sem ler a resposta e espera o server desistir, de novo até o prazo."""
+
+    def __init__(self, ip, porta, prazo, espera):
+        super().__init__(daemon=True)
+        self.ip = ip
+        self.porta = porta
+        self.prazo = prazo
+        self.espera = espera
+        self.pedidos = 0
+
+    def run(self):
+        while time.monotonic() < self.prazo:
+            try:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1024)    #a janela do TCP fecha logo
+                sock.settimeout(10)
+                sock.connect((self.ip, self.porta))
+                sock.sendall(("GET /metrics HTTP/1.1\r\nHost: %s\r\n\r\n" % self.ip).encode())
+                self.pedidos += 1
+                time.sleep(max(0.0, min(self.espera, self.prazo - time.monotonic())))
+                sock.close()
+            except OSError:
+                time.sleep(0.1)
+
+
+def percentil(ordenadas, p):
+    return ordenadas[min(len(ordenadas) - 1, (len(ordenadas) * p) // 100)]
+
+
+def contador(ip, porta, nome):
+    """O valor de uma linha do /metrics, com os rótulos no nome."""
+    conexao = http.client.HTTPConnection(ip, porta, timeout=10)
+    conexao.request("GET", "/metrics")
+    for linha in conexao.getresponse().read().decode().splitlines():
+        partes = linha.split(" ")
+        if len(partes) == 2 and partes[0] == nome:
+            conexao.close()
+            return int(partes[1])
+    conexao.close()
+    return 0
+
+
+def rodada(args, num_clientes):
+    prazo = time.monotonic() + args.segundos
+    clientes = [Cliente(args.ip, args.porta_http, c, args.canal, prazo) for c in range(num_clientes)]
+    lento = ClienteLento(args.ip, args.porta_http, args.canal, prazo, args.intervalo_lento) if args.lento else None
+    parado = ClienteParado(args.ip, args.porta_http, prazo, args.espera_parado) if args.parado else None
+    expirados_antes = contador(args.ip, args.porta_http, EXPIRADOS) if lento else 0
+    falhas_antes = contador(args.ip, args.porta_http, ENVIOS_FALHOS) if parado else 0
+    extras = [c for c in (lento, parado) if c is not None]
+
+    for cliente in clientes + extras:
+        cliente.start()
+    for cliente in clientes + extras:
+        cliente.join()
+
+    duracoes = sorted(d for cliente in clientes for d in cliente.duracoes)
+    erros = sum(cliente.erros for cliente in clientes)
+    reconexoes = sum(cliente.reconexoes for cliente in clientes)
+    if not duracoes:
+        print("%2d clientes: nenhuma requisição respondida" % num_clientes)
+        return
+    print("%2d clientes: %6d requisições (%5.0f/s)  p50 %7.1f ms  p99 %7.1f ms  max %7.1f ms  "
+          "%d erros  %d reconexões" %
+          (num_clientes, len(duracoes), len(duracoes) / args.segundos, percentil(duracoes, 50) * 1000,
+           percentil(duracoes, 99) * 1000, duracoes[-1] * 1000, erros, reconexoes))
+    if lento:
+        print("            cliente lento: %d respostas 408, pwm_http_corpos_expirados_total +%d" %
+              (lento.respostas_408, contador(args.ip, args.porta_http, EXPIRADOS) - expirados_antes))
+    if parado:
+        print("            cliente parado: %d pedidos do /metrics, pwm_http_envios_total falha +%d" %
+              (parado.pedidos, contador(args.ip, args.porta_http, ENVIOS_FALHOS) - falhas_antes))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("ip")
+    parser.add_argument("--porta-http", type=int, default=80)
+    parser.add_argument("--clientes", type=int, nargs="+", default=[1, 8, 16], help="clientes de cada rodada")
+    parser.add_argument("--segundos", type=float, default=10.0, help="duração de cada rodada")
+    parser.add_argument("--canal", type=int, default=0, help="canal que os PUTs alteram")
+    parser.add_argument("--lento", action="store_true", help="um cliente a mais mandando o corpo byte a byte")
+    parser.add_argument("--intervalo-lento", type=float, default=0.5, help="segundos entre os bytes do lento")
+    parser.add_argument("--parado", action="store_true", help="um cliente a mais que não lê o /metrics")
+    parser.add_argument("--espera-parado", type=float, default=6.0,
+                        help="segundos que o parado segura cada conexão (mais que o HTTP_PRAZO_ENVIO_MS)")
+    args = parser.parse_args()
+
+    for num_clientes in args.clientes:
+        rodada(args, num_clientes)
+        time.sleep(1.0)         #as conexões da rodada anterior fecham antes da próxima
+
+
+if __name__ == "__main__":
+    main()
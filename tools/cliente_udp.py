@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""Cliente do controle por UDP do Gerador PWM.
+
+Envia comandos no formato binário do firmware (struct udp_cabecalho / udp_comando em src/protocolo_udp.h) e mede
+o tempo de ida e volta de cada pacote.
+
+Exemplos:
+    python3 tools/cliente_udp.py 192.168.0.50 --canal 0 --frequencia 1000 --duty 50
+    python3 tools/cliente_udp.py 192.168.0.50 --status
+    python3 tools/cliente_udp.py 192.168.0.50 --bench 2000
+    python3 tools/cliente_udp.py 192.168.0.50 --canal 1 --fase 50 --em-ms 100 --sincroniza
+    python3 tools/cliente_udp.py 192.168.0.50 --preset 2
+    python3 tools/cliente_udp.py 192.168.0.50 --proximo
+"""
+
+import argparse
+import socket
+import struct
+import time
+
+PORTA = 5005
+MAGICO = 0x5750
+VERSAO = 1
+VERSAO_AGENDADA = 2
+VERSAO_PRESET = 3
+PRESET_VIZINHO = 0xFF
+AGENDA_RELATIVO = 0x01
+AGENDA_SINCRONIZA = 0x02
+DUTY_FINO_MAXIMO = 65535
+
+CABECALHO = struct.Struct("<HBBI")
+COMANDO = struct.Struct("<BBHI")
+RESPOSTA = struct.Struct("<HBBIHHI")
+AGENDAMENTO = struct.Struct("<qB3x")
+COMANDO_FASE = struct.Struct("<BBHIH2x")
+RESPOSTA_AGENDADA = struct.Struct("<HBBIHHIq")
+PRESET = struct.Struct("<Bbxx")
+
+STATUS = ["ok", "invalido", "fora_da_faixa", "atrasado", "sem_timer", "agenda_cheia"]
+
+
+def monta_pacote(sequencia, comandos):
+    pacote = CABECALHO.pack(MAGICO, VERSAO, len(comandos), sequencia)
+    for canal, ligado, duty_fino, frequencia in comandos:
+        pacote += COMANDO.pack(canal, ligado, duty_fino, frequencia)
+    return pacote
+
+
+def monta_pacote_agendado(sequencia, comandos, instante_us, opcoes):
+    """Versão 2: comandos (canal, ligado, duty_fino, frequencia, fase) aplicados juntos no instante."""
+    pacote = CABECALHO.pack(MAGICO, VERSAO_AGENDADA, len(comandos), sequencia)
+    pacote += AGENDAMENTO.pack(instante_us, opcoes)
+    for comando in comandos:
+        pacote += COMANDO_FASE.pack(*comando)
+    return pacote
+
+
+def monta_pacote_preset(sequencia, indice, passo=0):
+    """Versão 3: troca todos os canais para o preset indice (ou anda passo presets com PRESET_VIZINHO)."""
+    return CABECALHO.pack(MAGICO, VERSAO_PRESET, 0, sequencia) + PRESET.pack(indice, passo)
+
+
+def envia(sock, endereco, sequencia, comandos, pacote=None):
+    """Envia um pacote e devolve (resposta, tempo de ida e volta em segundos)."""
+    inicio = time.perf_counter()
+    sock.sendto(pacote or monta_pacote(sequencia, comandos), endereco)
+    while True:
+        dados, _ = sock.recvfrom(64)
+        if len(dados) == RESPOSTA_AGENDADA.size:
+            resposta = RESPOSTA_AGENDADA.unpack(dados)
+        elif len(dados) == RESPOSTA.size:
+            resposta = RESPOSTA.unpack(dados)
+        else:
+            continue
+        if resposta[3] == sequencia:
+            return resposta, time.perf_counter() - inicio
+
+
+def mostra(resposta, ida_volta):
+    _, _, status, sequencia, aceitos, ligados, processamento_us = resposta[:7]
+    nome = STATUS[status] if status < len(STATUS) else str(status)
+    relogio = f", relogio {resposta[7]} us" if len(resposta) > 7 else ""
+    print(f"seq {sequencia}: {nome}, aceitos 0x{aceitos:04x}, ligados 0x{ligados:04x}, "
+          f"processamento {processamento_us} us, ida e volta {ida_volta * 1e3:.2f} ms{relogio}")
+
+
+def percentil(ordenados, p):
+    return ordenados[min(len(ordenados) - 1, int(len(ordenados) * p / 100))]
+
+
+def bench(sock, endereco, n, canal, frequencia):
+    """Varre o duty de um canal n vezes, um pacote por vez, e mostra as latências e a taxa.
+
+    A sequência começa em 0 para reiniciar a contagem do firmware.
+    """
+    tempos = []
+    perdidos = 0
+    inicio = time.perf_counter()
+    for i in range(n):
+        duty = (i * 997) % (DUTY_FINO_MAXIMO + 1)
+        try:
+            resposta, ida_volta = envia(sock, endereco, i, [(canal, 1, duty, frequencia)])
+        except socket.timeout:
+            perdidos += 1
+            continue
+        if resposta[2] == 0:
+            tempos.append(ida_volta)
+    total = time.perf_counter() - inicio
+
+    if not tempos:
+        print("nenhuma resposta")
+        return
+    tempos.sort()
+    print(f"{len(tempos)} atualizações em {total:.2f} s ({len(tempos) / total:.0f}/s), {perdidos} perdidos")
+    print(f"ida e volta: p50 {percentil(tempos, 50) * 1e3:.2f} ms, p99 {percentil(tempos, 99) * 1e3:.2f} ms, "
+          f"máx {tempos[-1] * 1e3:.2f} ms")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("ip")
+    parser.add_argument("--porta", type=int, default=PORTA)
+    parser.add_argument("--canal", type=int, default=0)
+    parser.add_argument("--frequencia", type=int, default=5000, help="Hz")
+    parser.add_argument("--duty", type=float, default=50.0, help="percentual, aceita frações")
+    parser.add_argument("--desligar", action="store_true")
+    parser.add_argument("--status", action="store_true", help="só consulta os canais ligados")
+    parser.add_argument("--bench", type=int, metavar="N", help="mede N atualizações seguidas")
+    parser.add_argument("--sequencia", type=int, default=0,
+                        help="número de sequência do pacote (0 reinicia a contagem no firmware)")
+    parser.add_argument("--fase", type=float, help="percentual do período onde o pulso começa (usa a versão 2)")
+    parser.add_argument("--em-ms", type=float, help="aplica daqui a tantos ms (usa a versão 2)")
+    parser.add_argument("--sincroniza", action="store_true", help="reinicia juntos os timers dos canais (versão 2)")
+    parser.add_argument("--preset", type=int, help="aplica o preset salvo (usa a versão 3)")
+    parser.add_argument("--proximo", action="store_true", help="aplica o próximo preset (versão 3)")
+    parser.add_argument("--anterior", action="store_true", help="aplica o preset anterior (versão 3)")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(1.0)
+    endereco = (args.ip, args.porta)
+
+    if args.bench:
+        bench(sock, endereco, args.bench, args.canal, args.frequencia)
+        return
+
+    if args.preset is not None or args.proximo or args.anterior:
+        if args.preset is not None:
+            pacote = monta_pacote_preset(args.sequencia, args.preset)
+        else:
+            pacote = monta_pacote_preset(args.sequencia, PRESET_VIZINHO, 1 if args.proximo else -1)
+        mostra(*envia(sock, endereco, args.sequencia, [], pacote))
+        return
+
+    duty_fino = round(args.duty * DUTY_FINO_MAXIMO / 100)
+    ligado = 0 if args.desligar else 1
+    if args.fase is not None or args.em_ms is not None or args.sincroniza:
+        comandos = []
+        if not args.status:
+            fase = round((args.fase or 0) * DUTY_FINO_MAXIMO / 100)
+            comandos.append((args.canal, ligado, duty_fino, args.frequencia, fase))
+        opcoes = AGENDA_RELATIVO | (AGENDA_SINCRONIZA if args.sincroniza else 0)
+        instante_us = round((args.em_ms or 0) * 1000)
+        pacote = monta_pacote_agendado(args.sequencia, comandos, instante_us, opcoes)
+        mostra(*envia(sock, endereco, args.sequencia, comandos, pacote))
+        return
+
+    comandos = []
+    if not args.status:
+        comandos.append((args.canal, ligado, duty_fino, args.frequencia))
+    mostra(*envia(sock, endereco, args.sequencia, comandos))
+
+
+if __name__ == "__main__":
+    main()
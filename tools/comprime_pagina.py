@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Gera a página embutida no firmware a partir de webpage/: o .gz de cada arquivo e o pagina_etags.h com o ETag
+de cada um (o FNV-1a de 32 bits do .gz, entre aspas). Nada disso vai para o git, sai sempre dos fontes.
+
+Roda sozinho no build: pelo extra_scripts do platformio.ini (antes da compilação, nos dois ambientes) e pelo
+add_custom_command do src/CMakeLists.txt, no build com o idf.py. Os arquivos só são reescritos quando o conteúdo
+muda, para não recompilar o firmware à toa.
+
+Exemplo, da raiz do projeto:
+    python3 tools/comprime_pagina.py webpage/gerado
+"""
+
+import gzip
+import os
+import sys
+
+ARQUIVOS = ["index.html", "style.css", "app.js"]
+
+
+def fnv1a(dados):
+    """O mesmo hash que o firmware usava no boot: o ETag só muda quando o arquivo muda."""
+    valor = 2166136261
+    for byte in dados:
+        valor = ((valor ^ byte) * 16777619) & 0xFFFFFFFF
+    return valor
+
+
+def comprime(dados):
+    """gzip -9 -n: sem nome nem data no cabeçalho, a mesma entrada sempre dá os mesmos bytes."""
+    return gzip.compress(dados, compresslevel=9, mtime=0)
+
+
+def escreve_se_mudou(caminho, conteudo):
+    try:
+        with open(caminho, "rb") as arquivo:
+            if arquivo.read() == conteudo:
+                return
+    except FileNotFoundError:
+        pass
+    with open(caminho, "wb") as arquivo:
+        arquivo.write(conteudo)
+
+
+def gera(pagina, saida):
+    os.makedirs(saida, exist_ok=True)
+    linhas = ["/*Gerado pelo tools/comprime_pagina.py a partir de webpage/, não edite*/",
+              "#ifndef PAGINA_ETAGS_H", "#define PAGINA_ETAGS_H", ""]
+    for nome in ARQUIVOS:
+        with open(os.path.join(pagina, nome), "rb") as arquivo:
+            comprimido = comprime(arquivo.read())
+        escreve_se_mudou(os.path.join(saida, nome + ".gz"), comprimido)
+        macro = "PAGINA_ETAG_" + nome.replace(".", "_").upper()
+        linhas.append('#define %-24s "\\"%08x\\""' % (macro, fnv1a(comprimido)))
+    linhas += ["", "#endif", ""]
+    escreve_se_mudou(os.path.join(saida, "pagina_etags.h"), "\n".join(linhas).encode())
+
+
+try:
+    Import("env")                       # noqa: F821 - pelo extra_scripts do PlatformIO (SCons)
+    _projeto = env.subst("$PROJECT_DIR")  # noqa: F821
+    gera(os.path.join(_projeto, "webpage"), os.path.join(_projeto, "webpage", "gerado"))
+except NameError:
+    if __name__ == "__main__":
+        _projeto = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        gera(os.path.join(_projeto, "webpage"),
+             sys.argv[1] if len(sys.argv) > 1 else os.path.join(_projeto, "webpage", "gerado"))
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Confere que as requisições ao Gerador PWM não deixam nada no heap.
+
+Aquece o server com algumas requisições de cada tipo, lê o heap livre do /metrics (pwm_heap_livre_bytes),
+faz N requisições misturadas numa mesma conexão (leituras da API e da página, o /metrics e PUTs que mudam o
+duty de um canal, que passam pela task do PWM e pelo gerador) e lê o heap de novo. Como nada no caminho de
+uma requisição ou da aplicação usa o heap, a diferença tem que ficar dentro da tolerância; o código de saída
+é 1 se não ficar. O canal usado nos PUTs termina ligado com o último duty enviado.
+
+Exemplos:
+    python3 tools/verifica_heap.py 192.168.0.50
+    python3 tools/verifica_heap.py 192.168.0.50 --requisicoes 10000 --canal 3 --gerador rmt
+    python3 tools/verifica_heap.py 192.168.0.50 --tolerancia 256
+"""
+
+import argparse
+import http.client
+import json
+import sys
+import time
+
+LEITURAS = ["/api/pwm", "/api/pwm/0", "/api/ledc", "/api/agenda", "/api/medicao", "/api/preset", "/api/seq",
+            "/style.css", "/metrics"]
+
+
+def requisita(conexao, metodo, caminho, corpo=None):
+    conexao.request(metodo, caminho, body=corpo, headers={"Connection": "keep-alive"})
+    resposta = conexao.getresponse()
+    dados = resposta.read()
+    if resposta.status >= 500:
+        raise RuntimeError("%s %s: %d" % (metodo, caminho, resposta.status))
+    return dados
+
+
+def heap_livre(conexao):
+    for linha in requisita(conexao, "GET", "/metrics").decode().splitlines():
+        partes = linha.split(" ")
+        if len(partes) == 2 and partes[0] == "pwm_heap_livre_bytes":
+            return int(partes[1])
+    raise RuntimeError("pwm_heap_livre_bytes não está no /metrics")
+
+
+def faz_requisicoes(conexao, quantidade, canal, gerador, frequencia):
+    for n in range(quantidade):
+        if n % 4 == 3:
+            corpo = json.dumps({"estado": True, "gerador": gerador, "frequencia": frequencia,
+                                "percentual_duty": 10 + (n // 4) % 80})
+            requisita(conexao, "PUT", "/api/pwm/%d" % canal, corpo)
+        else:
+            requisita(conexao, "GET", LEITURAS[n % len(LEITURAS)])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("ip")
+    parser.add_argument("--porta-http", type=int, default=80)
+    parser.add_argument("--requisicoes", type=int, default=10000)
+    parser.add_argument("--aquecimento", type=int, default=200, help="requisições antes da primeira leitura")
+    parser.add_argument("--canal", type=int, default=0)
+    parser.add_argument("--gerador", default="ledc", choices=["ledc", "mcpwm", "rmt"])
+    parser.add_argument("--frequencia", type=int, default=1000)
+    parser.add_argument("--tolerancia", type=int, default=0, help="bytes de diferença aceitos")
+    args = parser.parse_args()
+
+    conexao = http.client.HTTPConnection(args.ip, args.porta_http, timeout=5)
+    faz_requisicoes(conexao, args.aquecimento, args.canal, args.gerador, args.frequencia)
+    time.sleep(1.0)             #a task do PWM e o lwip terminam o que ficou das últimas requisições
+    antes = heap_livre(conexao)
+
+    inicio = time.monotonic()
+    faz_requisicoes(conexao, args.requisicoes, args.canal, args.gerador, args.frequencia)
+    duracao = time.monotonic() - inicio
+    time.sleep(1.0)
+    depois = heap_livre(conexao)
+    conexao.close()
+
+    diferenca = antes - depois
+    print("%d requisições em %.1f s (%.0f/s)" % (args.requisicoes, duracao, args.requisicoes / duracao))
+    print("  heap livre: %d bytes antes, %d depois, %+d" % (antes, depois, -diferenca))
+    if abs(diferenca) > args.tolerancia:
+        print("  FALHOU: o heap mudou mais que %d bytes" % args.tolerancia)
+        sys.exit(1)
+    print("  ok")
+
+
+if __name__ == "__main__":
+    main()
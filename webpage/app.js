@@ -0,0 +1,175 @@
+// Monta um cartão para cada canal com os valores do GET /api/pwm e envia as alterações pelo
+// PUT /api/pwm/{n}. A página, o css e este script são estáticos e ficam no cache do navegador,
+// só os valores dos canais trafegam a cada acesso. Depois disso o ESP32 empurra pelo WebSocket /ws
+// os canais que mudarem, não importa por onde (outra página, UDP, sequenciador, presets).
+var canais = document.getElementById("canais");
+var modelo = document.getElementById("modelo_canal");
+var cartoes = [];   // cartão de cada canal, pelo número do canal
+
+// o campo que o usuário está editando (ou o slider sendo arrastado) não é sobrescrito
+function escreveCampo(campo, propriedade, valor) {
+    if (campo !== document.activeElement)
+        campo[propriedade] = valor;
+}
+
+function mostraCanal(cartao, canal) {
+    var saidas = cartao.querySelectorAll(".campo_saida");
+    var duty = cartao.querySelector(".campo_duty");
+    escreveCampo(cartao.querySelector(".campo_freq"), "value", canal.frequencia);
+    escreveCampo(duty, "value", canal.percentual_duty);
+    if (duty !== document.activeElement)
+        cartao.querySelector(".valor_duty").textContent = canal.percentual_duty;
+    escreveCampo(saidas[0], "checked", canal.estado);
+    escreveCampo(saidas[1], "checked", !canal.estado);
+    escreveCampo(cartao.querySelector(".campo_gerador"), "value", canal.gerador);
+    cartao.querySelector(".aplicado").textContent = canal.estado ?
+        "Aplicado: " + canal.frequencia_aplicada + " Hz (" + canal.erro_ppm + " ppm), " +
+        canal.resolucao_duty + " bits no " + canal.gerador.toUpperCase() : "";
+}
+
+function criaCanal(canal) {
+    var cartao = modelo.content.firstElementChild.cloneNode(true);
+    var form = cartao.querySelector("form");
+    var freq = cartao.querySelector(".campo_freq");
+    var duty = cartao.querySelector(".campo_duty");
+    var saidas = cartao.querySelectorAll(".campo_saida");
+    var gerador = cartao.querySelector(".campo_gerador");
+
+    cartao.className = (canal.canal % 2) ? "fright" : "fleft";
+    cartao.querySelector("h3").textContent = "PWM " + canal.canal + " (GPIO " + canal.gpio + ")";
+    // mesmos nomes de campo do formulário tratado pelo POST /
+    freq.name = "freq" + canal.canal;
+    duty.name = "duty" + canal.canal;
+    saidas[0].name = saidas[1].name = "estado" + canal.canal;
+
+    duty.oninput = function () {
+        cartao.querySelector(".valor_duty").textContent = this.value;
+    };
+
+    form.onsubmit = function (evento) {
+        evento.preventDefault();
+        fetch("/api/pwm/" + canal.canal, {
+            method: "PUT",
+            headers: { "Content-Type": "application/json" },
+            body: JSON.stringify({
+                estado: saidas[0].checked,
+                frequencia: parseInt(freq.value, 10),
+                percentual_duty: parseInt(duty.value, 10),
+                gerador: gerador.value
+            })
+        }).then(function (resposta) {
+            if (!resposta.ok)
+                return resposta.text().then(function (texto) { throw new Error(texto); });
+            return resposta.json();
+        }).then(function (novo) {
+            mostraCanal(cartao, novo);
+        }).catch(function (erro) {
+            cartao.querySelector(".aplicado").textContent = erro.message;
+        });
+    };
+
+    mostraCanal(cartao, canal);
+    cartoes[canal.canal] = cartao;
+    canais.appendChild(cartao);
+}
+
+function atualizaCanais() {
+    return fetch("/api/pwm").then(function (resposta) {
+        return resposta.json();
+    }).then(function (lista) {
+        lista.forEach(function (canal) {
+            if (cartoes[canal.canal])
+                mostraCanal(cartoes[canal.canal], canal);
+            else
+                criaCanal(canal);
+        });
+    });
+}
+
+// Estado empurrado pelo ESP32: cada mensagem traz só os canais que mudaram (a primeira traz todos) e os
+// cartões são atualizados no lugar. Se a conexão cair, assina de novo depois de um tempo
+var websocket = null;
+
+function assinaEstado() {
+    websocket = new WebSocket((location.protocol === "https:" ? "wss://" : "ws://") + location.host + "/ws");
+    websocket.onmessage = function (evento) {
+        JSON.parse(evento.data).canais.forEach(function (canal) {
+            if (cartoes[canal.canal])
+                mostraCanal(cartoes[canal.canal], canal);
+        });
+    };
+    websocket.onclose = function () {
+        websocket = null;
+        setTimeout(assinaEstado, 2000);
+    };
+}
+
+// Presets: a troca é feita pelo ESP32 logo depois da resposta, os canais novos chegam pelo WebSocket
+var listaPresets = document.getElementById("lista_presets");
+var nomePreset = document.getElementById("nome_preset");
+var mensagemPreset = document.getElementById("mensagem_preset");
+var presets = [];
+
+function verificaResposta(resposta) {
+    if (!resposta.ok)
+        return resposta.text().then(function (texto) { throw new Error(texto); });
+    return resposta;
+}
+
+function atualizaPresets() {
+    return fetch("/api/preset").then(function (resposta) {
+        return resposta.json();
+    }).then(function (lista) {
+        presets = lista.presets;
+        listaPresets.innerHTML = "";
+        presets.forEach(function (preset) {
+            var opcao = document.createElement("option");
+            opcao.value = preset.indice;
+            opcao.textContent = preset.nome;
+            opcao.selected = (preset.indice === lista.atual);
+            listaPresets.appendChild(opcao);
+        });
+    });
+}
+
+document.getElementById("aplica_preset").onclick = function () {
+    if (listaPresets.value === "")
+        return;
+    fetch("/api/preset/" + listaPresets.value, { method: "POST" }).then(verificaResposta).then(function () {
+        mensagemPreset.textContent = "";
+        if (websocket === null || websocket.readyState !== WebSocket.OPEN)
+            setTimeout(atualizaCanais, 100);
+    }).catch(function (erro) {
+        mensagemPreset.textContent = erro.message;
+    });
+};
+
+// salva a configuração atual no preset com o mesmo nome ou no primeiro livre
+document.getElementById("salva_preset").onclick = function () {
+    var nome = nomePreset.value.trim();
+    var indice = -1;
+    var ocupados = {};
+    presets.forEach(function (preset) {
+        ocupados[preset.indice] = true;
+        if (preset.nome === nome)
+            indice = preset.indice;
+    });
+    for (var i = 0; indice < 0 && i < 8; i++) {
+        if (!ocupados[i])
+            indice = i;
+    }
+    if (indice < 0) {
+        mensagemPreset.textContent = "Nenhum preset livre";
+        return;
+    }
+    fetch("/api/preset/" + indice + "?nome=" + encodeURIComponent(nome), { method: "PUT" })
+        .then(verificaResposta).then(function () {
+            mensagemPreset.textContent = "Salvo";
+            return atualizaPresets();
+        }).catch(function (erro) {
+            mensagemPreset.textContent = erro.message;
+        });
+};
+
+atualizaCanais().then(assinaEstado);
+atualizaPresets();